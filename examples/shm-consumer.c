@@ -0,0 +1,222 @@
+//
+//  shm-consumer.c
+//  RadarKit
+//
+//  Follows the pulses and rays of a radar on the same host through shared memory,
+//  e.g., rkutil -s -M, and optionally the same rays through the command center to
+//  compare the cost of the two paths.
+//
+//    shm-consumer [-d seconds] [-t host] /radarkit-px-1000
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <RadarKit.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+typedef struct consumer_stats {
+    uint64_t   count;
+    uint64_t   bytes;
+    uint64_t   torn;
+    double     latency;
+    double     cpuTime;
+    double     elapsedTime;
+    float      sum;
+} ConsumerStats;
+
+static double cpuTime(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return RKTimevalDiff(usage.ru_utime, (struct timeval){0, 0}) + RKTimevalDiff(usage.ru_stime, (struct timeval){0, 0});
+}
+
+static double now(void) {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return (double)t.tv_sec + 1.0e-6 * (double)t.tv_usec;
+}
+
+static void showStats(const char *label, const char *unit, const ConsumerStats *stats, const uint64_t dropCount) {
+    RKLog("%s %s %ss (%.1f / s)   %s B/s   drops = %s   torn = %s   latency = %.2f ms\n",
+          label,
+          RKUIntegerToCommaStyleString(stats->count), unit,
+          (double)stats->count / stats->elapsedTime,
+          RKFloatToCommaStyleString((double)stats->bytes / stats->elapsedTime),
+          RKUIntegerToCommaStyleString(dropCount),
+          RKUIntegerToCommaStyleString(stats->torn),
+          stats->count ? 1.0e3 * stats->latency / (double)stats->count : 0.0);
+}
+
+// Follow the rings in place, read the Z data of every ray and the H samples of every pulse
+static void followSharedMemory(RKSharedMemoryReader *reader, const double duration, ConsumerStats *rayStats, ConsumerStats *pulseStats) {
+    int k;
+    RKRay *ray;
+    RKPulse *pulse;
+    float *z;
+    RKInt16C *x;
+    const double c0 = cpuTime(), t0 = now();
+    double t = t0;
+    while (t - t0 < duration && RKSharedMemoryReaderIsLive(reader)) {
+        bool idle = true;
+        while ((ray = RKSharedMemoryReaderGetRay(reader)) != NULL) {
+            z = RKGetFloatDataFromRay(ray, RKProductIndexZ);
+            for (k = 0; k < ray->header.gateCount; k++) {
+                rayStats->sum += z[k];
+            }
+            if (!RKSharedMemoryReaderIsRayIntact(reader, ray)) {
+                rayStats->torn++;
+                continue;
+            }
+            t = now();
+            rayStats->latency += t - (double)ray->header.endTime.tv_sec - 1.0e-6 * (double)ray->header.endTime.tv_usec;
+            rayStats->bytes += ray->header.gateCount * sizeof(float);
+            rayStats->count++;
+            idle = false;
+        }
+        while ((pulse = RKSharedMemoryReaderGetPulse(reader)) != NULL) {
+            x = RKGetInt16CDataFromPulse(pulse, 0);
+            for (k = 0; k < pulse->header.gateCount; k++) {
+                pulseStats->sum += (float)x[k].i;
+            }
+            if (!RKSharedMemoryReaderIsPulseIntact(reader, pulse)) {
+                pulseStats->torn++;
+                continue;
+            }
+            pulseStats->bytes += pulse->header.gateCount * sizeof(RKInt16C);
+            pulseStats->count++;
+            idle = false;
+        }
+        if (idle) {
+            usleep(1000);
+        }
+        t = now();
+    }
+    rayStats->elapsedTime = t - t0;
+    rayStats->cpuTime = cpuTime() - c0;
+    pulseStats->elapsedTime = rayStats->elapsedTime;
+    pulseStats->cpuTime = rayStats->cpuTime;
+}
+
+// Same rays through the product stream of the command center, the path local consumers take without shared memory
+static int followCommandCenter(const char *host, const double duration, ConsumerStats *rayStats) {
+    int sd, k;
+    size_t r, size;
+    ssize_t n;
+    RKNetDelimiter delimiter;
+    struct sockaddr_in sa;
+    struct timeval timeout = {1, 0};
+    const char command[] = "s ZVWDPRKS" RKEOL;
+    uint8_t *payload = (uint8_t *)malloc(RKMaximumPacketSize);
+
+    if (payload == NULL || (sd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        free(payload);
+        return RKResultClientNotConnected;
+    }
+    memset(&sa, 0, sizeof(struct sockaddr_in));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(10000);
+    if (inet_pton(AF_INET, host, &sa.sin_addr) != 1 || connect(sd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        RKLog("Error. Unable to connect to %s:10000\n", host);
+        close(sd);
+        free(payload);
+        return RKResultClientNotConnected;
+    }
+    setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    send(sd, command, strlen(command), 0);
+
+    const double c0 = cpuTime(), t0 = now();
+    double t = t0;
+    while (t - t0 < duration) {
+        for (r = 0; r < sizeof(RKNetDelimiter); r += n) {
+            if ((n = recv(sd, (uint8_t *)&delimiter + r, sizeof(RKNetDelimiter) - r, 0)) <= 0) {
+                break;
+            }
+        }
+        if (r < sizeof(RKNetDelimiter) || delimiter.size > RKMaximumPacketSize) {
+            break;
+        }
+        for (size = 0; size < delimiter.size; size += n) {
+            if ((n = recv(sd, payload + size, delimiter.size - size, 0)) <= 0) {
+                break;
+            }
+        }
+        t = now();
+        if (delimiter.type != RKNetworkPacketTypeRayDisplay || delimiter.size < sizeof(RKRayHeader)) {
+            continue;
+        }
+        RKRayHeader *header = (RKRayHeader *)payload;
+        float *z = (float *)(payload + sizeof(RKRayHeader));
+        for (k = 0; k < header->gateCount; k++) {
+            rayStats->sum += z[k];
+        }
+        rayStats->latency += t - (double)header->endTime.tv_sec - 1.0e-6 * (double)header->endTime.tv_usec;
+        rayStats->bytes += delimiter.size;
+        rayStats->count++;
+    }
+    rayStats->elapsedTime = t - t0;
+    rayStats->cpuTime = cpuTime() - c0;
+    close(sd);
+    free(payload);
+    return RKResultSuccess;
+}
+
+int main(int argc, char *argv[]) {
+
+    int opt;
+    double duration = 10.0;
+    char *host = NULL;
+    ConsumerStats rayStats, pulseStats, tcpStats;
+
+    RKSetWantScreenOutput(true);
+
+    while ((opt = getopt(argc, argv, "d:t:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                duration = atof(optarg);
+                break;
+            case 't':
+                host = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-d seconds] [-t host] name\n"
+                                "  -d  Seconds to follow each path (default = 10)\n"
+                                "  -t  Also follow the product stream of the command center at host, e.g., 127.0.0.1\n",
+                                argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Please supply the name of the shared memory, e.g., /radarkit-px-1000\n");
+        return EXIT_FAILURE;
+    }
+
+    RKSharedMemoryReader *reader = RKSharedMemoryReaderInit(argv[optind]);
+    if (reader == NULL) {
+        return EXIT_FAILURE;
+    }
+    RKLog("%s   %s   pulses = %s x %s   rays = %s x %s\n",
+          reader->name, reader->header->desc.name,
+          RKIntegerToCommaStyleString(reader->header->pulseBufferDepth), RKIntegerToCommaStyleString(reader->header->pulseCapacity),
+          RKIntegerToCommaStyleString(reader->header->rayBufferDepth), RKIntegerToCommaStyleString(reader->header->rayCapacity));
+
+    memset(&rayStats, 0, sizeof(ConsumerStats));
+    memset(&pulseStats, 0, sizeof(ConsumerStats));
+    followSharedMemory(reader, duration, &rayStats, &pulseStats);
+    showStats("Shared memory", "ray", &rayStats, reader->rayDropCount);
+    showStats("Shared memory", "pulse", &pulseStats, reader->pulseDropCount);
+    RKLog("Shared memory CPU = %.2f %%\n", 100.0 * rayStats.cpuTime / rayStats.elapsedTime);
+
+    if (host) {
+        memset(&tcpStats, 0, sizeof(ConsumerStats));
+        if (followCommandCenter(host, duration, &tcpStats) == RKResultSuccess) {
+            showStats("Command center", "ray", &tcpStats, 0);
+            RKLog("Command center CPU = %.2f %%\n", 100.0 * tcpStats.cpuTime / tcpStats.elapsedTime);
+        }
+    }
+
+    RKSharedMemoryReaderFree(reader);
+
+    return EXIT_SUCCESS;
+}
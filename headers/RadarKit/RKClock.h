@@ -15,6 +15,35 @@
 #define RKClockDefaultBufferDepth        2000
 #define RKClockDefaultStride             1000
 #define RKClockAWhile                    300.0
+#define RKClockRebaseLimit               (1LL << 40)
+
+//
+// The source of the arrival time x
+//
+//   RKClockSourceTimeOfDay    - gettimeofday(), slewed by NTP, microsecond resolution
+//   RKClockSourceMonotonicRaw - CLOCK_MONOTONIC_RAW, not slewed, nanosecond resolution
+//   RKClockSourceTAI          - CLOCK_TAI, continuous across leap seconds, nanosecond resolution
+//
+// The monotonic and TAI sources are mapped to the wall clock once, at reset, and
+// derive time with an exact least-squares fit of the latest stride readings, which
+// is updated in O(1) per call. RKClockSourceTimeOfDay keeps the original running
+// averages.
+//
+typedef uint8_t RKClockSource;
+enum {
+    RKClockSourceTimeOfDay,
+    RKClockSourceMonotonicRaw,
+    RKClockSourceTAI
+};
+
+// The latest tic-to-time relation, which can be read from any thread without a lock
+typedef struct rk_clock_mapping {
+    int64_t          tic;                         // Reference tic
+    int64_t          time;                        // Nanoseconds at the reference tic, same epoch as RKClockGetTime()
+    double           slope;                       // Nanoseconds per tic
+    double           offset;                      // Time offset set by user
+    uint64_t         count;                       // Number of calls behind the relation, 0 = not available
+} RKClockMapping;
 
 typedef struct rk_clock {
     // User set parameters
@@ -30,6 +59,7 @@ typedef struct rk_clock {
 	uint32_t         block;                       // Block size of data during burst transfers
     uint32_t         stride;                      // Size to compute average
     uint64_t         tic;                         // An internal tic in case user does not obey the rule
+    RKClockSource    source;                      // Source of the arrival time
 
     // Program set parameters
     struct timeval   *tBuffer;                    // The time which a request was made (dirty)
@@ -53,6 +83,21 @@ typedef struct rk_clock {
     double           sum_x0;
     double           sum_u0;
 
+    // Least-squares fit of the monotonic and TAI sources, in tics and nanoseconds relative to an anchor
+    int64_t          *vBuffer;                    // Tics of the readings
+    int64_t          *wBuffer;                    // Nanoseconds of the readings
+    int64_t          epoch;                       // Nanoseconds from the source to the output epoch
+    int64_t          anchorTic;
+    int64_t          anchorTime;
+    __int128         sum_v;
+    __int128         sum_w;
+    __int128         sum_vv;
+    __int128         sum_vw;
+
+    // Seqlock of the mapping, odd while the mapping is being written
+    uint32_t         sequence;
+    RKClockMapping   mapping;
+
 } RKClock;
 
 RKClock *RKClockInitWithSize(const uint32_t, const uint32_t);
@@ -67,10 +112,14 @@ void RKClockSetOffset(RKClock *, const double);
 void RKClockSetDxDu(RKClock *, const double);
 void RKClockSetDuDx(RKClock *, const double);
 void RKClockSetHighPrecision(RKClock *, const bool);
+void RKClockSetSource(RKClock *, const RKClockSource);
 
 //void RKClockSync(RKClock *clock, const double u);
 
 double RKClockGetTime(RKClock *, const double, struct timeval *);
+double RKClockGetTimeOfReading(RKClock *, const double, const struct timespec *);
+void RKClockGetMapping(RKClock *, RKClockMapping *);
+double RKClockGetTimeOfTic(RKClock *, const double);
 
 void RKClockReset(RKClock *);
 
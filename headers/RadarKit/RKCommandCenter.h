@@ -11,8 +11,88 @@
 
 #include <RadarKit/RKRadar.h>
 
-#define RKCommandCenterMaxConnections 32
+#define RKCommandCenterMaxConnections 256
 #define RKCommandCenterMaxRadars       4
+#define RKCommandCenterRayCacheDepth   512                                                         // Must be a power of 2
+#define RKCommandCenterRayCacheProbe   8
+#define RKCommandCenterStringSize      (256 * 1024)                                                // Initial size of RKUser->string, enough for the text streams
+#define RKCommandCenterScratchSize     RKMaximumStringLength                                       // Initial size of RKUser->scratch
+#define RKCommandCenterResponseSize    (64 * 1024)                                                 // Size of RKUser->commandResponse
+#define RKCommandCenterStreamBudget    (512 * 1024)                                                // Default bytes a user may have waiting before the ray streams are held back
+#define RKCommandCenterStreamLagLimit  3.0f                                                        // Default seconds a user may be behind the latest ray
+#define RKCommandCenterRayLagFraction  4                                                           // Never more than rayBufferDepth / this rays behind, the buffer wraps around
+#define RKCommandCenterMaxRayStride    16                                                          // Coarsest ray stride of RKStreamPolicyDownsample
+#define RKCommandCenterRelayQueueLimit (512 * 1024)                                                // Unsent bytes before a relay channel of priority 0 is held back, halved every level
+
+//
+// A user who cannot keep up with the ray streams is never waited for. The rays are held back
+// while the write queue of the user is deeper than RKUser->streamBudget and, once the user
+// is more than RKUser->streamLagLimit behind, the policy decides which rays are not sent:
+//
+//   RKStreamPolicyDropOldest    - drop the oldest rays so the user stays at the lag limit
+//   RKStreamPolicySkipToCurrent - drop all pending rays and continue from the latest ray
+//   RKStreamPolicyDownsample    - send every n-th ray, n doubles every second while lagging
+//                                 and halves once the user has caught up
+//
+typedef uint8_t RKStreamPolicy;
+enum {
+    RKStreamPolicyDropOldest,
+    RKStreamPolicySkipToCurrent,
+    RKStreamPolicyDownsample,
+    RKStreamPolicyCount
+};
+
+typedef uint8_t RKRayStreamFormat;
+enum {
+    RKRayStreamFormatHeader,                                                                       // RKRayHeader of the product streams
+    RKRayStreamFormatHeaderF1,                                                                     // RKRayHeaderF1 of the display streams
+    RKRayStreamFormatFloat,                                                                        // Product data
+    RKRayStreamFormatUInt8                                                                         // Display data
+};
+
+//
+// A ray stream block is the down-sampled payload of one product of one ray. It is encoded
+// once and sent to all users who stream the same product at the same down-sampling ratio
+// and codec. A block is only reused for something else when no user is sending from it.
+//
+// When a user selects a codec other than RKNetworkCodecNone through the command 'e', each
+// ray of the product and display streams is sent as:
+//
+//   RKNetDelimiter  - type = RKNetworkPacketTypeRayDisplay, subtype = codec,
+//                     size = bytes that follow, decodedSize = size without compression
+//   Header          - RKRayHeader or RKRayHeaderF1 as is
+//   Products        - for each product in productList, a uint32_t size followed by
+//                     that many bytes of the product encoded by RKNetworkEncode()
+//
+// Without a codec, the packet is exactly as before: the header and the raw products.
+//
+typedef struct rk_ray_stream_block {
+    RKRay                            *ray;                                                         // The source ray
+    RKIdentifier                     identifier;                                                   // Identifier of the source ray when encoded
+    RKRayStreamFormat                format;                                                       // Header or data format
+    RKProductIndex                   productIndex;                                                 // Product index of the data
+    uint16_t                         downSamplingRatio;                                            // Down-sampling ratio of the gates
+    RKNetworkCodec                   codec;                                                        // Codec of the data, always none for headers
+    uint32_t                         refCount;                                                     // Number of users sending from this block
+    bool                             ready;                                                        // Encoded payload is complete, the block is shared only then
+    uint64_t                         tic;                                                          // Latest use, for eviction
+    uint32_t                         size;                                                         // Size of the encoded payload
+    uint32_t                         capacity;                                                     // Capacity of *data
+    void                             *data;                                                        // The encoded payload
+} RKRayStreamBlock;
+
+//
+// Commands that take a while, e.g., 'dr' which restarts the engines, are posted to the executor
+// so that the shared workers of the server never wait. The following commands of the user are
+// deferred until the executor is done and the response has been sent by the stream handler.
+//
+typedef uint8_t RKUserJob;
+enum {
+    RKUserJobNone,
+    RKUserJobPosted,                                                                               // Waiting for the executor
+    RKUserJobRunning,                                                                              // Being executed
+    RKUserJobDone                                                                                  // Response is ready to be sent
+};
 
 typedef struct rk_user {
     char                             login[64];
@@ -43,16 +123,46 @@ typedef struct rk_user {
     uint16_t                         rayDownSamplingRatio;                                         // Additional down-sampling ratio for ray live stream
     uint16_t                         asciiArtStride;                                               // Gate stride for ASCII art
     uint16_t                         ascopeMode;                                                   // The ASCope mode: 1-4
+    RKNetworkCodec                   codec;                                                        // Codec of the product and display streams
+    RKStreamPolicy                   streamPolicy;                                                 // What to drop when the user is behind
+    uint16_t                         rayStride;                                                    // Send every n-th ray, more than 1 only with RKStreamPolicyDownsample
+    uint32_t                         streamBudget;                                                 // Bytes allowed in the write queue before the ray streams are held back
+    float                            streamLagLimit;                                               // Seconds behind the latest ray before the policy drops rays
+    uint64_t                         rayDropCount;                                                 // Rays not sent because the user was behind
+    uint64_t                         txByteCountLastRate;                                          // serverOperator->txByteCount at timeLastRate
+    double                           timeLastRate;                                                 // Time sendRate was last updated
+    double                           timeLastStride;                                               // Time rayStride was last changed
+    double                           sendRate;                                                     // Bytes per second into the write queue
+    double                           streamLag;                                                    // Seconds behind the latest ray
+    bool                             relay;                                                        // Streams relay frames instead, see RKRadarRelay.h
+    uint8_t                          relayPriorities[RKRelayChannelCount];                         // Priority of each relay channel, 0 = highest
+    uint32_t                         relayIndices[RKRelayChannelCount];                            // Slot of the next payload of each relay channel
+    RKIdentifier                     relaySequences[RKRelayChannelCount];                          // Identifier of the next payload of each relay channel
+    uint64_t                         relayDropCounts[RKRelayChannelCount];                         // Payloads overwritten before they could be sent
     pthread_mutex_t                  mutex;                                                        //
-    char                             string[RKMaximumPacketSize];                                  // A local storage to buffer a packet
-    char                             scratch[RKMaximumPacketSize];                                 // A local storage as scratch space
-    char                             commandResponse[RKMaximumPacketSize];                         // A local storage as feedback
-    RKInt16C                         samples[2][RKMaximumGateCount];                               // A local storage for raw I/Q for AScope
+    char                             *string;                                                      // A local storage to buffer a packet
+    char                             *scratch;                                                     // A local storage as scratch space
+    char                             *commandResponse;                                             // A local storage as feedback
+    RKInt16C                         *samples[2];                                                  // A local storage for raw I/Q for AScope
+    size_t                           stringCapacity;                                               // Capacity of *string, grows on demand
+    size_t                           scratchCapacity;                                              // Capacity of *scratch, grows on demand
+    size_t                           sampleCapacities[2];                                          // Capacity of *samples[] in bytes, grows on demand
     RKOperator                       *serverOperator;                                              // The reference to the socket server operator
     RKRadar                          *radar;                                                       // The reference to the radar object
     uint8_t                          productCount;                                                 // Product count from PyRadarKit
     RKProductId                      productIds[RKMaximumProductCount];                            // Product identifiers for active algorithms of PyRadarKit
     RKProductDesc                    productDescriptions[RKMaximumProductCount];                   // Product descriptions for active algorithms of PyRadarKit
+    RKSweep                          *sweep;                                                       // Sweep sent to PyRadarKit, waiting for the products
+    uint8_t                          sweepProductCount;                                            // Number of products received for the sweep
+    RKProduct                        *sweepProduct;                                                // Product of which the header has been received
+    void                             *sweepPayload;                                                // Where the data of that product goes
+    struct timeval                   timevalSweepOrigin;                                           // Time the sweep started to go out
+    struct timeval                   timevalSweepTx;                                               // Time the sweep was sent
+    char                             *payload;                                                     // A local storage for the payloads from PyRadarKit
+    size_t                           payloadCapacity;                                              // Capacity of *payload, grows on demand
+    RKUserJob                        job;                                                          // State of the command with the executor, guarded by executorMutex
+    RKCommand                        jobCommand;                                                   // The command for the executor
+    char                             jobResponse[RKMaximumStringLength];                           // Response of the executor
 } RKUser;
 
 typedef struct rk_command_center {
@@ -60,6 +170,7 @@ typedef struct rk_command_center {
     RKName                           name;
     int                              verbose;
     RKRadar                          *radars[RKCommandCenterMaxRadars];
+    RKHealthNode                     healthNodes[RKCommandCenterMaxRadars];                        // Health node of each radar for the streaming users
 
     // Program set variables
     bool                             relayMode;
@@ -68,9 +179,20 @@ typedef struct rk_command_center {
     int                              radarCount;
     RKUser                           users[RKCommandCenterMaxConnections];
     pthread_mutex_t                  mutex;
+    RKRayStreamBlock                 *rayStreamBlocks;                                             // Encoded ray stream payloads shared among users
+    pthread_mutex_t                  rayStreamMutex;
+    uint64_t                         rayStreamTic;
+    double                           timeLastHealthOut;                                            // Time the streaming users were last posted to the health nodes
+    uint64_t                         rayDropCountLastHealth[RKCommandCenterMaxRadars];             // Rays dropped by the users of each radar at the last post
+    pthread_t                        executorThreadId;                                             // Runs the commands that take a while
+    pthread_mutex_t                  executorMutex;
+    pthread_cond_t                   executorPosted;
+    bool                             executorActive;
 
     // Status / health
-    size_t                           memoryUsage;
+    size_t                           memoryUsage;                                                  // Guarded by mutex
+    uint64_t                         rayStreamHitCount;                                            // Ray stream blocks reused
+    uint64_t                         rayStreamMissCount;                                           // Ray stream blocks encoded
 } RKCommandCenter;
 
 RKCommandCenter *RKCommandCenterInit(void);
@@ -78,6 +200,8 @@ void RKCommandCenterFree(RKCommandCenter *);
 
 void RKCommandCenterSetVerbose(RKCommandCenter *, const int);
 void RKCommandCenterSetPort(RKCommandCenter *, const int);
+void RKCommandCenterSetWebSocketPort(RKCommandCenter *, const int);
+void RKCommandCenterSetZeroCopyThreshold(RKCommandCenter *, const size_t);
 void RKCommandCenterAddRadar(RKCommandCenter *, RKRadar *);
 void RKCommandCenterRemoveRadar(RKCommandCenter *, RKRadar *);
 
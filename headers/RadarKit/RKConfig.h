@@ -11,6 +11,8 @@
 
 #include <RadarKit/RKFoundation.h>
 
+#define RKConfigIdInvalid    UINT64_MAX                                        // Identifier of a slot that is being written
+
 size_t RKConfigBufferAlloc(RKConfig **, const uint32_t configBufferDepth);
 void RKConfigBufferFree(RKConfig *);
 
@@ -44,6 +44,17 @@
 //                                      :
 //
 //
+//  Each remover keeps an index of the files, ordered by the time in the filenames,
+//  that is maintained incrementally from RKFileManagerAddFile() and, on Linux, the
+//  inotify events of the folders, e.g., files that are written, moved or removed by
+//  other processes. The folders are only listed entirely at start or when the index
+//  is no longer consistent, e.g., there are more files than the capacity.
+//
+//  The removers only decide which files go, the usage is updated from the index
+//  right away. The files are unlinked relative to the directory of each remover by
+//  a small pool of workers under a budget of removals and bytes per second, so that
+//  a mass expiry does not flood the disk that the recorders are writing to.
+//
 //  Created by Boonleng Cheong on 3/11/17.
 //  Copyright © 2017-2021 Boonleng Cheong. All rights reserved.
 //
@@ -53,11 +64,21 @@
 
 #include <RadarKit/RKFoundation.h>
 
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#define RKFileManagerHasInotify
+#endif
+
 #define RKFileManagerDefaultUsageLimit     (size_t)1024 * 1024 * 1024 * 1024 * 12 / 10
 #define RKFileManagerRawDataRatio          8
 #define RKFileManagerMomentDataRatio       5
 #define RKFileManagerHealthDataRatio       1
 #define RKFileManagerDefaultLogAgeInDays   30
+#define RKFileManagerDefaultRemovalRate    500                                  // Files per second
+#define RKFileManagerDefaultRemovalBytes   ((size_t)2 * 1024 * 1024 * 1024)     // Bytes per second
+#define RKFileManagerRemovalWorkerCount    2
+#define RKFileManagerRemovalQueueDepth     4096
 
 typedef struct rk_file_remover RKFileRemover;
 typedef struct rk_file_manager RKFileManager;
@@ -69,9 +90,9 @@ struct rk_file_remover {
     pthread_t                        tid;
     RKFileManager                    *parent;
 
-    int                              index;                               // Index to get sorted index for removal
-    int                              count;                               // Dual use index: count and index to add (reusable buffer)
-    int                              capacity;                            // Capcity of *folders, *filenames and *indexedStats
+    int                              count;                               // Number of files in the index
+    int                              capacity;                            // Capcity of *filenames, *indexedStats and *heap
+    int                              folderCount;                         // Number of folders in *folders
     size_t                           usage;
     size_t                           limit;
     char                             path[RKMaximumFolderPathLength + 384];
@@ -79,7 +100,16 @@ struct rk_file_remover {
     void                             *folders;
     void                             *filenames;
     void                             *indexedStats;
-    bool                             reusable;
+    int                              *heap;                               // Indices of *indexedStats in a min-heap of time
+    int                              *buckets;                            // Hash table of the filenames
+    uint32_t                         bucketMask;
+    int                              vacancy;                             // First vacant slot of *indexedStats that has been used before
+    int                              allocated;                           // Slots of *indexedStats that have been used
+    int                              fd;                                  // inotify descriptor, -1 if not available
+    int                              wd;                                  // Watch descriptor of path
+    int                              dirfd;                               // Descriptor of path for unlinkat()
+    bool                             consistent;                          // All files are in the index, a full scan is needed otherwise
+    uint64_t                         scanCount;                           // Number of full scans
 
     struct timeval                   latestTime;
 };
@@ -95,6 +125,8 @@ struct rk_file_manager {
     size_t                           userRawDataUsageLimit;               // User set raw data usage limit
     size_t                           userMomentDataUsageLimit;            // User set moment data usage limit
     size_t                           userHealthDataUsageLimit;            // User set health data usage limit
+    double                           removalRate;                         // Maximum number of removals per second, 0 = unlimited
+    size_t                           removalBytes;                        // Maximum number of bytes removed per second, 0 = unlimited
 
     // Program set variables
     uint64_t                         tic;
@@ -103,10 +135,21 @@ struct rk_file_manager {
     pthread_t                        tidFileWatcher;
     pthread_mutex_t                  mutex;
     char                             scratch[RKMaximumStringLength];
+    pthread_t                        tidRemovalWorkers[RKFileManagerRemovalWorkerCount];
+    pthread_mutex_t                  removalMutex;
+    pthread_cond_t                   removalCondition;
+    void                             *removals;                           // Queue of files and folders to remove
+    uint32_t                         removalHead;                         // Next removal to take
+    uint32_t                         removalTail;                         // Next removal to add
+    double                           removalTokens;                       // Removals that can be done now
+    double                           removalByteTokens;                   // Bytes that can be removed now
+    struct timeval                   removalTime;                         // Time of the last token update
+    bool                             removalWantActive;
 
     // Status / health
     RKEngineState                    state;
     uint32_t                         memoryUsage;
+    uint64_t                         removeCount;                         // Number of files removed, used by others to know space has been freed
 };
 
 RKFileManager *RKFileManagerInit(void);
@@ -120,6 +163,7 @@ void RKFileManagerSetMaximumLogAgeInDays(RKFileManager *, const int age);
 void RKFileManagerSetRawDataLimit(RKFileManager *, const size_t);
 void RKFileManagerSetMomentDataLimit(RKFileManager *, const size_t);
 void RKFileManagerSetHealthDataLimit(RKFileManager *, const size_t);
+void RKFileManagerSetRemovalRate(RKFileManager *, const double filesPerSecond, const size_t bytesPerSecond);
 
 int RKFileManagerStart(RKFileManager *);
 int RKFileManagerStop(RKFileManager *);
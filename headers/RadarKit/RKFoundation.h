@@ -15,6 +15,9 @@
 #include <RadarKit/RKSIMD.h>
 
 #define RKDefaultLogfile                 "messages.log"
+#define RKLogRingDepth                   256                                   // Entries per thread in asynchronous mode, see RKSetLogRingDepth()
+#define RKLogEntryLength                 1024                                  // Longer messages are truncated in asynchronous mode
+#define RKLogIdleInterval                10000                                 // Microseconds the logger sleeps when there is nothing
 #define RKEOL                            "\r\n"
 
 // Compute the next/previous N-stride location with size S
@@ -117,6 +120,10 @@ RKComplex RKComplexArraySum(RKComplex *src, const int);
 
 // Log
 int RKLog(const char *, ...);
+void RKSetAsynchronousLog(const bool);
+bool RKGetAsynchronousLog(void);
+void RKSetLogRingDepth(const uint32_t);
+uint64_t RKLogGetDropCount(void);
 void RKExit(int);
 
 // File operations (they just directly copied for ctypes to work)
@@ -127,6 +134,7 @@ size_t RKFileGetSize(FILE *);
 int RKFileSeek(FILE *, long);
 size_t RKFileWrite(const void *, size_t, size_t, FILE *);
 size_t RKFileRead(void *, size_t, size_t, FILE *);
+int RKRemoveFolder(const char *);
 
 // Variables in rkGlobalVariable / Presentation
 void RKSetStatusColor(const bool);
@@ -170,6 +178,8 @@ void RKZeroTailFloat(RKFloat *data, const uint32_t capacity, const uint32_t orig
 void RKZeroTailIQZ(RKIQZ *data, const uint32_t capacity, const uint32_t origin);
 
 // Pulse
+size_t RKPulseBufferSize(const uint32_t capacity, const uint32_t count);
+void RKPulseBufferInit(RKBuffer, const uint32_t capacity, const uint32_t count);
 size_t RKPulseBufferAlloc(RKBuffer *, const uint32_t capacity, const uint32_t count);
 void RKPulseBufferFree(RKBuffer);
 RKPulse *RKGetPulseFromBuffer(RKBuffer, const uint32_t pulseIndex);
@@ -183,6 +193,8 @@ RKBuffer RKPulseBufferAllocCopyFromBuffer(RKBuffer pulses, const uint32_t start,
 void RKPulseDuplicateSplitComplex(RKPulse *);
 
 // Ray
+size_t RKRayBufferSize(const uint32_t capacity, const uint32_t count);
+void RKRayBufferInit(RKBuffer, const uint32_t capacity, const uint32_t count);
 size_t RKRayBufferAlloc(RKBuffer *, const uint32_t capacity, const uint32_t count);
 void RKRayBufferFree(RKBuffer);
 RKRay *RKGetRayFromBuffer(RKBuffer, const uint32_t);
@@ -12,6 +12,7 @@
 #include <RadarKit/RKFoundation.h>
 #include <RadarKit/RKFileManager.h>
 #include <RadarKit/RKClient.h>
+#include <RadarKit/RKHealthRecord.h>
 
 typedef struct rk_health_engine RKHealthEngine;
 
@@ -0,0 +1,41 @@
+//
+//  RKHealthRecord.h
+//  RadarKit
+//
+//  A typed alternative to the health string of a node. The record is a fixed
+//  schema of key / value slots, where the value is kept as JSON text along with
+//  its number and enum, so that the health engine can merge the nodes without
+//  parsing. Nodes that only produce strings are tokenized into the same slots
+//  in a single pass with RKHealthRecordFromString().
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __RadarKit_Health_Record__
+#define __RadarKit_Health_Record__
+
+#include <RadarKit/RKFoundation.h>
+
+void RKHealthRecordReset(RKHealthRecord *);
+
+// Values as JSON text, without and with an enum, e.g., "Log Time":1700000000 and "Sys Heading":{"Value":"12.50 deg","Enum":0}
+// The format of a number may carry a unit in quotes, e.g., "\"%.2f deg\""
+RKHealthSlot *RKHealthRecordAdd(RKHealthRecord *, const char *key, const char *value);
+RKHealthSlot *RKHealthRecordAddBool(RKHealthRecord *, const char *key, const bool, const RKStatusEnum);
+RKHealthSlot *RKHealthRecordAddNumber(RKHealthRecord *, const char *key, const double, const char *format, const RKStatusEnum);
+RKHealthSlot *RKHealthRecordAddString(RKHealthRecord *, const char *key, const char *, const RKStatusEnum);
+
+// Slot of a key, case insensitive, NULL if it is not there
+RKHealthSlot *RKHealthRecordFind(RKHealthRecord *, const char *key);
+
+// Any slot with the status
+bool RKHealthRecordHasStatus(const RKHealthRecord *, const RKStatusEnum);
+
+// Tokenize a health string into a record, returns the number of slots or -1 if the string does not fit the schema
+int RKHealthRecordFromString(RKHealthRecord *, const char *);
+
+// Append the slots as '"key":value, ' pairs, returns the number of characters
+int RKHealthRecordToString(const RKHealthRecord *, char *, const size_t);
+
+#endif
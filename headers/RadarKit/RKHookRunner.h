@@ -0,0 +1,100 @@
+//
+//  RKHookRunner.h
+//  RadarKit
+//
+//  Run user commands, e.g., file handling scripts, in child processes created
+//  through posix_spawn() so that the calling threads never fork a large process
+//  image or wait for the command to finish. Commands are queued and run by a
+//  small pool of workers, each of which enforces a timeout and reports the exit
+//  status through an optional completion handler.
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __RadarKit_HookRunner__
+#define __RadarKit_HookRunner__
+
+#include <RadarKit/RKFoundation.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <poll.h>
+#elif defined(__APPLE__)
+#include <sys/event.h>
+#endif
+
+#define RKHookRunnerQueueDepth               16
+#define RKHookRunnerMaximumArgumentCount     64
+#define RKHookRunnerCommandLength            (RKMaximumPathLength * 24)
+#define RKHookRunnerDefaultConcurrency       2
+#define RKHookRunnerMaximumConcurrency       8
+#define RKHookRunnerDefaultTimeout           300.0
+
+typedef struct rk_hook_job RKHookJob;
+typedef struct rk_hook_worker RKHookWorker;
+typedef struct rk_hook_runner RKHookRunner;
+
+struct rk_hook_job {
+    uint64_t                         i;                                        // Job identifier
+    char                             command[RKHookRunnerCommandLength];       // Program followed by arguments, separated by spaces
+    char                             output[RKMaximumPathLength];              // Optional, e.g., the file the command is expected to produce
+    void                             (*completion)(RKHookJob *);               // Optional, called from the worker after the command exits
+    void                             *userResource;                            // Anything for the completion handler
+    int                              status;                                   // Exit status, 128 + signal if killed, -1 if not spawned
+    bool                             timedOut;                                 // The command was killed for running too long
+    float                            elapsedTime;                              // Time spent in the command (s)
+};
+
+struct rk_hook_worker {
+    RKChildName                      name;
+    int                              id;
+    pthread_t                        tid;
+    RKHookRunner                     *parent;
+
+    uint64_t                         tic;
+    pid_t                            pid;                                      // The child process of the running job, 0 if idle
+};
+
+struct rk_hook_runner {
+    // User set variables
+    RKName                           name;
+    uint8_t                          verbose;
+    uint8_t                          concurrency;                              // Number of commands that may run at the same time
+    double                           timeout;                                  // Maximum run time of a command (s), 0 for no limit
+
+    // Program set variables
+    RKHookWorker                     *workers;
+    RKHookJob                        jobs[RKHookRunnerQueueDepth];
+    uint32_t                         postCount;
+    uint32_t                         takeCount;
+    uint32_t                         doneCount;
+    pthread_mutex_t                  mutex;
+    pthread_cond_t                   jobPosted;
+    pthread_cond_t                   jobTaken;
+
+    // Status / health
+    RKEngineState                    state;
+    uint64_t                         tic;
+    uint64_t                         spawnCount;
+    uint64_t                         failureCount;                             // Non-zero exit status or failed to spawn
+    uint64_t                         timeoutCount;
+    int                              lastStatus;
+    size_t                           memoryUsage;
+};
+
+RKHookRunner *RKHookRunnerInit(void);
+void RKHookRunnerFree(RKHookRunner *);
+
+void RKHookRunnerSetName(RKHookRunner *, const char *);
+void RKHookRunnerSetVerbose(RKHookRunner *, const int);
+void RKHookRunnerSetConcurrency(RKHookRunner *, const uint8_t);
+void RKHookRunnerSetTimeout(RKHookRunner *, const double);
+
+int RKHookRunnerStart(RKHookRunner *);
+int RKHookRunnerStop(RKHookRunner *);
+
+int RKHookRunnerSubmit(RKHookRunner *, const char *command, const char *output, void (*)(RKHookJob *), void *);
+void RKHookRunnerWaitWhileBusy(RKHookRunner *);
+
+#endif
@@ -10,23 +10,44 @@
 #define __RadarKit_HostMonitor__
 
 #include <RadarKit/RKFoundation.h>
+#include <arpa/inet.h>
+#include <poll.h>
+
+//
+//  A single thread serves all hosts on one ICMP socket. The echo requests of all hosts
+//  go out in one sendmmsg() every ping interval and the replies come back in batches
+//  of recvmmsg(), matched to the hosts by identifier, sequence number and address.
+//  A datagram ICMP socket is used if the kernel allows (net.ipv4.ping_group_range),
+//  otherwise a raw socket, which requires CAP_NET_RAW. Each host keeps a histogram of
+//  the round-trip time, reported through RKHostMonitorLatencyString().
+//
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define RKHostMonitorHasMultipleMessages
+#endif
+
+#define RKHostMonitorBatchSize           32
+#define RKHostMonitorLatencyBinCount     12                                    // Edges at 0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50, 100, 200 ms
 
 typedef struct rk_unit_monitor RKUnitMonitor;
 typedef struct rk_host_monitor RKHostMonitor;
 
-//typedef char RKHostAddress[RKNameLength];
-
 struct rk_unit_monitor {
     RKShortName                      name;
     int                              id;
-    pthread_t                        tid;                                      // Thread ID
     RKHostMonitor                    *parent;                                  // Parent engine reference
 
     uint64_t                         tic;
-    uint16_t                         pingIntervalInSeconds;
-    uint16_t                         sequenceNumber;
-    uint16_t                         identifier;
-    struct timeval                   latestTime;
+    bool                             resolved;
+    bool                             pending;                                  // An echo request is waiting for its reply
+    uint16_t                         sequenceNumber;                           // Sequence number of the latest echo request
+    struct sockaddr_in               address;
+    struct timeval                   sentTime;                                 // Time of the latest echo request
+    struct timeval                   latestTime;                               // Time of the latest echo reply
+    double                           latency;                                  // Latest round-trip time in seconds
+    uint32_t                         requestCount;
+    uint32_t                         replyCount;
+    uint32_t                         histogram[RKHostMonitorLatencyBinCount];
     RKHostStatus                     hostStatus;
 };
 
@@ -35,16 +56,22 @@ struct rk_host_monitor {
     RKName                           name;
     uint8_t                          verbose;                                  // Verbosity level
     RKName                           *hosts;                                   // List of names (hostnames)
-    
+    double                           pingInterval;                             // Seconds between echo requests
+
     // Program set variables
     uint64_t                         tic;
     int                              workerCount;
     RKUnitMonitor                    *workers;
     pthread_t                        tidHostWatcher;
     pthread_mutex_t                  mutex;
+    int                              sd;                                       // The ICMP socket of all hosts
+    bool                             raw;                                      // A raw socket, replies come with the IP header
+    uint16_t                         identifier;
+    uint16_t                         sequenceNumber;
     bool                             allKnown;
     bool                             allReachable;
     bool                             anyReachable;
+    char                             latencyString[RKMaximumStringLength / 2];
 
     // Status / health
     RKEngineState                    state;
@@ -55,9 +82,13 @@ RKHostMonitor *RKHostMonitorInit(void);
 void RKHostMonitorFree(RKHostMonitor *);
 
 void RKHostMonitorSetVerbose(RKHostMonitor *, const int);
+void RKHostMonitorSetPingInterval(RKHostMonitor *, const double);
 void RKHostMonitorAddHost(RKHostMonitor *, const char *);
+void RKHostMonitorClearHosts(RKHostMonitor *);
 
 int RKHostMonitorStart(RKHostMonitor *);
 int RKHostMonitorStop(RKHostMonitor *);
 
+char *RKHostMonitorLatencyString(RKHostMonitor *);
+
 #endif
@@ -34,6 +34,7 @@
 #include <sys/socket.h>
 #include <sys/resource.h>
 #include <dirent.h>
+#include <ftw.h>
 #include <pthread.h>
 #include <netdb.h>
 #include <netinet/ip.h>
@@ -17,6 +17,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 
 typedef int RKNetworkSocketType;
 enum {
@@ -48,7 +49,16 @@ enum {
     RKNetworkPacketTypeConfig,
 	RKNetworkPacketTypeSweep,
     RKNetworkPacketTypeSweepHeader,
-    RKNetworkPacketTypeSweepRay
+    RKNetworkPacketTypeSweepRay,
+    RKNetworkPacketTypeRelayFrame                          // An RKRelayFrameHeader and a payload, see RKRadarRelay.h
+};
+
+typedef uint16_t RKNetworkCodec;
+enum {
+    RKNetworkCodecNone,                                    // Raw bytes
+    RKNetworkCodecDeflate,                                 // zlib deflate at the fastest level
+    RKNetworkCodecDeltaDeflate,                            // Byte-wise difference to the previous element, then deflate
+    RKNetworkCodecCount
 };
 
 #pragma pack(push, 1)
@@ -58,14 +68,43 @@ typedef union rk_net_delimiter {
         uint16_t     type;                                 // Type
         uint16_t     subtype;                              // Sub-type
         uint32_t     size;                                 // Raw size in bytes to read / skip ahead
-        uint32_t     decodedSize;                          // Decided size if this is a compressed block
+        uint32_t     decodedSize;                          // Decoded size if this is a compressed block
     };
     RKByte bytes[16];                                      // Make this struct always fixed bytes
 } RKNetDelimiter;
 
+typedef uint8_t RKRelayChannel;
+enum {
+    RKRelayChannelStatus,                                  // RKStatus of the processor
+    RKRelayChannelHealth,                                  // RKHealth, the JSON string
+    RKRelayChannelRay,                                     // RKRayHeader and the uint8 display products
+    RKRelayChannelPulse,                                   // RKPulseHeader and the H and V samples
+    RKRelayChannelCount
+};
+
+typedef union rk_relay_frame_header {
+    struct {
+        uint16_t     type;                                 // RKNetworkPacketType of the payload
+        uint8_t      channel;                              // RKRelayChannel
+        uint8_t      codec;                                // RKNetworkCodec of the payload
+        uint16_t     stride;                               // Element size for RKNetworkCodecDeltaDeflate
+        uint16_t     reserved;                             //
+        uint32_t     decodedSize;                          // Size of the payload after decoding
+        uint32_t     reserved2;                            //
+        uint64_t     sequence;                             // Identifier of the payload in the channel, e.g., header.i of a ray
+    };
+    RKByte bytes[24];                                      // Make this struct always fixed bytes
+} RKRelayFrameHeader;
+
 #pragma pack(pop)
 
 ssize_t RKNetworkSendPackets(int, ...);
 void RKNetworkShowPacketTypeNumbers(void);
 
+size_t RKNetworkCodecBound(const RKNetworkCodec, const size_t);
+size_t RKNetworkEncode(void *destination, const size_t capacity, const void *source, const size_t size, const size_t stride, const RKNetworkCodec);
+size_t RKNetworkDecode(void *destination, const size_t capacity, const void *source, const size_t size, const size_t stride, const RKNetworkCodec);
+const char *RKNetworkCodecString(const RKNetworkCodec);
+RKNetworkCodec RKNetworkCodecFromString(const char *);
+
 #endif /* defined(___RadarKit_RKNetwork__) */
@@ -37,6 +37,18 @@
 //
 //         int routine(RKPedestal);
 //
+//  Pulses are tagged by coreCount workers, each takes blocks of RKPositionEngineBlockSize pulses
+//  in turn. A worker keeps a cursor in the position buffer that only moves forward, since pulses
+//  and positions are both time ordered, and falls back to a binary search over the position buffer
+//  when the cursor has been overrun. The engine thread then visits the pulses in order to derive the
+//  markers and to advance the configuration. Nothing polls: RKPositionEngineNotify() is called when
+//  a position is ready or when pulses have been processed by the ring filter.
+//
+//  With a position model, see RKPositionModel.h and RKPositionEngineSetPositionModel(), a pulse newer
+//  than the latest position is tagged right away by extrapolating a local polynomial fit, as long as
+//  it is within the limit of the model, instead of waiting for the pedestal. Pulses between two
+//  positions are always interpolated linearly.
+//
 //  Created by Boonleng Cheong on 1/3/17.
 //  Copyright © 2017-2021 Boonleng Cheong. All rights reserved.
 //
@@ -47,9 +59,30 @@
 #include <RadarKit/RKFoundation.h>
 #include <RadarKit/RKConfig.h>
 #include <RadarKit/RKDSP.h>
+#include <RadarKit/RKPositionModel.h>
+
+#define RKPositionEngineBlockSize          32                                  // Consecutive pulses of a worker
+#define RKPositionEngineCursorSteps        8                                   // Cursor steps before a binary search
+#define RKPositionEngineWaitTimeout        0.1                                 // Seconds to wait before checking again without a notification
 
+typedef struct rk_position_worker RKPositionWorker;
 typedef struct rk_position_engine RKPositionEngine;
 
+struct rk_position_worker {
+    RKChildName            name;
+    int                    id;
+    pthread_t              tid;                                                // Thread ID
+    RKPositionEngine       *parent;                                            // Parent engine reference
+
+    uint64_t               tic;                                                // Tic count
+    uint32_t               pid;                                                // Latest tagged index of pulses buffer
+    uint32_t               cursor;                                             // Index of the position just after the latest tagged pulse
+    uint64_t               searchCount;                                        // Number of binary searches
+    float                  lag;                                                // Lag relative to the latest index of engine
+    RKPositionModel        model;                                              // Local copy of the position model
+    uint64_t               extrapolationCount;                                 // Number of pulses tagged by extrapolation
+};
+
 struct rk_position_engine {
     // User set variables
     RKName                 name;
@@ -61,6 +94,8 @@ struct rk_position_engine {
     RKBuffer               pulseBuffer;
     uint32_t               *pulseIndex;
     uint8_t                verbose;
+    uint8_t                coreCount;
+    RKPositionModel        model;                                              // Order 0 for linear interpolation without extrapolation
     RKPedestal             pedestal;
     RKPedestal             (*hardwareInit)(void *);
     int                    (*hardwareExec)(RKPedestal, const char *);
@@ -71,6 +106,12 @@ struct rk_position_engine {
     // Program set variables
     pthread_t              threadId;
     double                 startTime;
+    RKPositionWorker       *workers;
+    uint64_t               *taggedPulseIds;                                    // Identifier of the pulse a worker has tagged [pulseBufferDepth]
+    uint32_t               *pulsePositionIndices;                              // Index of the position just after the pulse [pulseBufferDepth]
+    pthread_mutex_t        mutex;
+    pthread_cond_t         newInput;                                           // Signaled by RKPositionEngineNotify()
+    pthread_cond_t         newTag;                                             // Signaled by the workers after tagging a pulse
 
     // Status / health
     uint32_t               processedPulseIndex;
@@ -98,8 +139,12 @@ void RKPositionEngineSetInputOutputBuffers(RKPositionEngine *, const RKRadarDesc
                                            RKPosition *, uint32_t *,
                                            RKConfig *,   uint32_t *,
                                            RKBuffer,     uint32_t *) __attribute__((deprecated));
+void RKPositionEngineSetCoreCount(RKPositionEngine *, const uint8_t);
+void RKPositionEngineSetPositionModel(RKPositionEngine *, const uint8_t order, const double maximumExtrapolation);
 int RKPositionEngineStart(RKPositionEngine *);
 int RKPositionEngineStop(RKPositionEngine *);
+void RKPositionEngineNotify(RKPositionEngine *);
+uint32_t RKPositionEngineGetPositionIndexAfterTime(RKPositionEngine *, const double);
 
 char *RKPositionEngineStatusString(RKPositionEngine *);
 char *RKPositionEnginePositionString(RKPositionEngine *);
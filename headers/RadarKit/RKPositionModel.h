@@ -0,0 +1,46 @@
+//
+//  RKPositionModel.h
+//  RadarKit
+//
+//  A local polynomial model of the pedestal motion. Azimuth and elevation of the
+//  latest count positions are fitted, in the least-squares sense, to a polynomial
+//  of time, i.e., order 1 for constant velocity and order 2 for constant
+//  acceleration. The model extrapolates a short time beyond the latest report so
+//  that a pulse can be tagged before the pedestal catches up.
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __RadarKit_Position_Model__
+#define __RadarKit_Position_Model__
+
+#include <RadarKit/RKFoundation.h>
+
+#define RKPositionModelMaximumOrder          2
+#define RKPositionModelMaximumCount          16
+#define RKPositionModelDefaultExtrapolation  0.05                              // Seconds beyond the latest position
+
+typedef struct rk_position_model {
+    // User set variables
+    uint8_t                order;                                              // 0 = disabled, 1 = constant velocity, 2 = constant acceleration
+    uint8_t                count;                                              // Number of positions to fit
+    double                 maximumExtrapolation;                               // Seconds beyond the latest position
+
+    // Program set variables
+    uint32_t               index;                                              // Index of the latest position in the fit
+    double                 time;                                               // Time of the latest position in the fit, the origin of the polynomials
+    double                 span;                                               // Time span of the positions in the fit
+    double                 azimuth[RKPositionModelMaximumOrder + 1];           // Coefficients of the unwrapped azimuth relative to azimuthOrigin
+    double                 elevation[RKPositionModelMaximumOrder + 1];         // Coefficients of the elevation relative to elevationOrigin
+    float                  azimuthOrigin;                                      // Azimuth of the latest position
+    float                  elevationOrigin;                                    // Elevation of the latest position
+    bool                   valid;
+} RKPositionModel;
+
+void RKPositionModelSetOrder(RKPositionModel *, const uint8_t order, const double maximumExtrapolation);
+bool RKPositionModelFit(RKPositionModel *, const RKPosition *positions, const uint32_t index, const uint32_t depth);
+bool RKPositionModelCanExtrapolate(const RKPositionModel *, const double time);
+void RKPositionModelEvaluate(const RKPositionModel *, const double time, float *azimuth, float *elevation);
+
+#endif
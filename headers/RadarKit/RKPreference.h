@@ -11,7 +11,14 @@
 
 #include <RadarKit/RKFoundation.h>
 
-#define RKPreferenceObjectCount   128
+//
+//  The objects grow with the file. A hashed index of the keywords, case insensitive,
+//  is built once per update so that finding a keyword, the next one of the same
+//  keyword and the count of a keyword do not scan the objects. The typed values of
+//  an object are parsed once, when the object is first found.
+//
+
+#define RKPreferenceObjectCount   128                                          // Initial capacity, grows as needed
 
 enum RKParameterType {
     RKParameterTypeInt,
@@ -25,13 +32,17 @@ enum RKParameterType {
 };
 
 typedef struct rk_preference {
-    RKPreferenceObject    objects[RKPreferenceObjectCount];
+    RKPreferenceObject    *objects;
     uint32_t              count;
     uint32_t              memoryUsage;
 
     // Internal variables
+    uint32_t              capacity;                                            // Number of objects allocated
     uint32_t              previousIndex;
     char                  previousKeyword[RKNameLength];
+    void                  *keywords;                                           // Hashed index of the keywords
+    uint32_t              keywordMask;                                         // Number of slots in the index - 1
+    uint32_t              *next;                                               // Next object of the same keyword
     
     // These may not be committed
     char                  filename[RKMaximumStringLength];
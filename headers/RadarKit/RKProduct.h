@@ -16,6 +16,10 @@ size_t RKProductBufferExtend(RKProduct **, const uint32_t depth, const uint32_t
 void RKProductBufferFree(RKProduct *, const uint32_t depth);
 
 int RKProductInitFromSweep(RKProduct *, const RKSweep *);
+int RKProductInitViewFromSweep(RKProduct *, const RKSweep *);
+int RKProductFlatten(RKProduct *);
+uint32_t RKProductCountRecycledViews(const RKProduct *);
+RKFloat *RKProductGetDataOfRay(const RKProduct *, const uint32_t);
 void RKProductFree(RKProduct *);
 
 #endif
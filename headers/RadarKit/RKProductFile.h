@@ -14,6 +14,8 @@
 #include <archive_entry.h>
 #include <archive.h>
 #include <netcdf.h>
+#include <zlib.h>
+#include <sys/mman.h>
 
 #if defined(_HAS_NETCDF_MEM_H)
 #include <netcdf_mem.h>
@@ -22,6 +24,8 @@
 #define W2_MISSING_DATA       -99900.0
 #define W2_RANGE_FOLDED       -99901.0
 
+#define RKProductFilePreface  "RadarKit/Product"
+
 #if defined (COMPRESSED_NETCDF)
 #define NC_MODE  NC_NETCDF4
 #else
@@ -44,4 +48,7 @@ RKProductCollection *RKProductCollectionInitWithFilename(const char *);
 int RKProductCollectionStandardizeForCFRadial(RKProductCollection *);
 int RKProductCollectionFileWriterCF(RKProductCollection *, const char *, const RKWriterOption);
 
+int RKProductFileWriterRK(RKProduct *, const char *);
+int RKProductCollectionFileWriterRK(RKProductCollection *, const char *, const RKWriterOption);
+
 #endif
@@ -52,6 +52,8 @@ struct rk_pulse_ring_filter_engine {
     bool                             useFilter;                                // Use FIR/IIR filter
     RKIIRFilter                      filter;                                   // The FIR/IIR filter coefficients
     RKIdentifier                     filterId;                                 // A counter for filter change
+    void                             (*processedHandler)(void *);              // Called after pulses are marked RKPulseStatusRingProcessed
+    void                             *processedHandlerInput;
 
     // Program set variables
     RKPulseRingFilterWorker          *workers;
@@ -80,6 +82,7 @@ void RKPulseRingFilterEngineSetEssentials(RKPulseRingFilterEngine *, const RKRad
                                           RKBuffer pulseBuffer,   uint32_t *pulseIndex);
 void RKPulseRingFilterEngineSetCoreCount(RKPulseRingFilterEngine *, const uint8_t);
 void RKPulseRingFilterEngineSetCoreOrigin(RKPulseRingFilterEngine *, const uint8_t);
+void RKPulseRingFilterEngineSetProcessedHandler(RKPulseRingFilterEngine *, void (*)(void *), void *);
 
 void RKPulseRingFilterEngineEnableFilter(RKPulseRingFilterEngine *);
 void RKPulseRingFilterEngineDisableFilter(RKPulseRingFilterEngine *);
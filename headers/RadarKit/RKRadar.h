@@ -31,6 +31,7 @@
 #include <RadarKit/RKRadarRelay.h>
 #include <RadarKit/RKHostMonitor.h>
 #include <RadarKit/RKWebSocket.h>
+#include <RadarKit/RKSharedMemory.h>
 
 #define rk_str(s) #s
 #define RADAR_VARIABLE_OFFSET(STRING, NAME) \
@@ -47,7 +48,7 @@ enum {
     RKRadarStatePositionBufferAllocated              = (1 << 6),   //
     RKRadarStateWaveformCalibrationsAllocated        = (1 << 7),   //
     RKRadarStateControlsAllocated                    = (1 << 8),   //
-    RKRadarStateRserverd0                            = (1 << 9),   //
+    RKRadarStateSharedMemoryAllocated                = (1 << 9),   //
     RKRadarStateRserverd1                            = (1 << 10),  //
     RKRadarStateRserverd2                            = (1 << 11),  //
     RKRadarStateRserverd3                            = (1 << 12),  //
@@ -110,6 +111,7 @@ struct rk_radar {
     RKPosition                       *positions;
     RKBuffer                         pulses;
     RKBuffer                         rays;
+    RKSharedMemory                   *sharedMemory;                  // Pulse and ray buffers exported to the local processes
     // RKProduct                        *products;
     //
     // Anchor indices of the buffers
@@ -255,6 +257,7 @@ int RKSeUserDevice(RKRadar *,
 
 // These can only be set before the radar goes live
 int RKSetProcessingCoreCounts(RKRadar *, const uint8_t, const uint8_t, const uint8_t);
+int RKSetPositionModel(RKRadar *, const uint8_t order, const double maximumExtrapolation);
 
 #pragma mark - Properties
 
@@ -275,6 +278,7 @@ uint32_t RKGetPulseCapacity(RKRadar *);
 // If there is a tic count from firmware, use it as clean reference for time derivation
 void RKSetPulseTicsPerSeconds(RKRadar *, const double);
 void RKSetPositionTicsPerSeconds(RKRadar *, const double);
+void RKSetClockSource(RKRadar *, const RKClockSource);
 
 // Filter array initializer
 // int RKSetFilterArrayInit(RKRadar *radar, void (*callback)(RKCompressionScratch *));
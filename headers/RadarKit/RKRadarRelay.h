@@ -6,6 +6,23 @@
 //  from a hardware digital transceiver. It receives samples through a network socket,
 //  which have been organized by another RadarKit.
 //
+//  The relay asks the command center for relay frames with the command
+//
+//    R <streams> <codec> <priorities> <status>,<health>,<ray>,<pulse>
+//
+//  e.g., "R !hzvwdprki 2 0123 1024,-,88200,-". Every payload then arrives as an
+//  RKNetDelimiter of type RKNetworkPacketTypeRelayFrame, subtype = channel, followed
+//  by an RKRelayFrameHeader and the payload, compressed with the codec if that makes
+//  it smaller. The four channels (status, health, rays and pulses) are multiplexed on
+//  the one connection by priority, 0 = highest: a channel of priority p is held back
+//  while more than RKCommandCenterRelayQueueLimit >> p bytes wait to be sent, so a
+//  lagging link sheds pulses before the rays and the rays before the health.
+//
+//  The sequence of a frame is the identifier of its payload, e.g., header.i of a ray.
+//  After a reconnect, the relay asks for the next identifier of each channel and the
+//  command center continues from there if it is still in its buffers, so only what
+//  was missed is sent again. Gaps in the sequences are counted in gapCounts[].
+//
 //  Created by Boonleng Cheong on 4/11/17.
 //  Copyright © 2017-2021 Boonleng Cheong. All rights reserved.
 //
@@ -17,8 +34,10 @@
 #include <RadarKit/RKFileManager.h>
 #include <RadarKit/RKClient.h>
 
-#define RKRadarRelayFeedbackDepth     200
+#define RKRadarRelayFeedbackDepth     16
 #define RKRadarRelayFeedbackCapacity  8196
+#define RKRadarRelayResponseTimeout   3                                  // Seconds to wait for the response of a command
+#define RKRadarRelayReceiveBufferSize (256 * 1024)                       // Socket receive buffer, kept small to bound the latency of the frames
 
 typedef struct rk_radar_relay {
     // User defined variables
@@ -37,14 +56,22 @@ typedef struct rk_radar_relay {
     uint32_t                         *rayIndex;
     uint8_t                          verbose;
     RKFileManager                    *fileManager;
+    RKNetworkCodec                   codec;                              // Codec of the relay frames
+    uint8_t                          priorities[RKRelayChannelCount];    // Priority of each channel, 0 = highest
 
     // Program set variables
     RKClient                         *client;
     uint32_t                         responseIndex;
     char                             responses[RKRadarRelayFeedbackDepth][RKRadarRelayFeedbackCapacity];
     char                             latestCommand[RKMaximumCommandLength];
+    pthread_mutex_t                  responseMutex;
+    pthread_cond_t                   responded;                          // Signaled when a response has been queued
     pthread_t                        tidBackground;
     RKStream                         streams;
+    uint8_t                          *decodedPayload;                    // Payload of a compressed frame after decoding
+    RKIdentifier                     sequences[RKRelayChannelCount];     // Identifier of the next frame of each channel
+    uint64_t                         frameCounts[RKRelayChannelCount];   // Frames received in each channel
+    uint64_t                         gapCounts[RKRelayChannelCount];     // Payloads never received in each channel
 
     // For handling sweeps
     RKSweepHeader                    sweepHeaderCache;
@@ -74,6 +101,8 @@ void RKRadarRelaySetEssentials(RKRadarRelay *, const RKRadarDesc *, RKFileManage
                                RKBuffer pulseBuffer,   uint32_t *pulseIndex,
                                RKBuffer rayBuffer,     uint32_t *rayIndex);
 void RKRadarRelaySetHost(RKRadarRelay *, const char *hostname);
+void RKRadarRelaySetCodec(RKRadarRelay *, const RKNetworkCodec);
+void RKRadarRelaySetChannelPriority(RKRadarRelay *, const RKRelayChannel, const uint8_t priority);
 
 int RKRadarRelayStart(RKRadarRelay *);
 int RKRadarRelayStop(RKRadarRelay *);
@@ -15,6 +15,7 @@
 
 #define RKRawDataRecorderDefaultMaximumRecorderDepth   100000
 #define RKRawDataRecorderDefaultCacheSize              32 * 1024 * 1024
+#define RKRawDataRecorderDefaultRetryPeriod            10.0
 
 typedef struct rk_data_recorder RKRawDataRecorder;
 
@@ -31,6 +32,7 @@ struct rk_data_recorder {
     bool                             record;
     size_t                           cacheSize;
     size_t                           maximumRecordDepth;
+    double                           retryPeriod;                    // Seconds to wait before retrying after a write error
     RKFileManager                    *fileManager;
 
     // Program set variables
@@ -45,6 +47,15 @@ struct rk_data_recorder {
     uint64_t                         filePulseCount;
     pthread_t                        tidPulseRecorder;
 
+    // Degraded mode, entered when write() fails, e.g., ENOSPC, EIO, etc.
+    bool                             degraded;                       // Pulses are dropped while this is true, accessed with __atomic builtins
+    bool                             filePartial;                    // The current file has lost data, renamed with .part when closed
+    int                              lastErrno;                      // The errno of the last write failure
+    uint64_t                         writeErrorCount;                // Number of failed write()
+    uint64_t                         droppedPulseCount;              // Number of pulses dropped while degraded
+    uint64_t                         fileManagerRemoveCount;         // Snapshot of fileManager->removeCount when degraded
+    struct timeval                   degradedTime;                   // Time of the last write failure
+
     // Status / health
     char                             statusBuffer[RKBufferSSlotCount][RKStatusStringLength];
     uint32_t                         statusBufferIndex;
@@ -65,6 +76,7 @@ void RKRawDataRecorderSetRecord(RKRawDataRecorder *engine, const bool);
 void RKRawDataRecorderSetRawDataType(RKRawDataRecorder *engine, const RKRawDataType);
 void RKRawDataRecorderSetMaximumRecordDepth(RKRawDataRecorder *engine, const uint32_t);
 void RKRawDataRecorderSetCacheSize(RKRawDataRecorder *engine, uint32_t size);
+void RKRawDataRecorderSetRetryPeriod(RKRawDataRecorder *engine, const double);
 
 int RKRawDataRecorderStart(RKRawDataRecorder *engine);
 int RKRawDataRecorderStop(RKRawDataRecorder *engine);
@@ -76,5 +88,6 @@ int RKRawDataRecorderCloseFileQuiet(RKRawDataRecorder *engine);
 int RKRawDataRecorderIncreasePulseCount(RKRawDataRecorder *engine);
 size_t RKRawDataRecorderCacheWrite(RKRawDataRecorder *engine, const void *payload, const size_t size);
 size_t RKRawDataRecorderCacheFlush(RKRawDataRecorder *engine);
+bool RKRawDataRecorderTryRecover(RKRawDataRecorder *engine);
 
 #endif /* defined(__RadarKit_RKFile__) */
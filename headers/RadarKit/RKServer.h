@@ -11,9 +11,57 @@
 
 #include <RadarKit/RKNetwork.h>
 
-#define RKServerMaximumOperators    16
-#define RKServerSelectTimeoutUs     200;
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#include <sys/uio.h>
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define RKServerHasZeroCopy
+#endif
+
+//
+//  A single event loop thread accepts the connections and moves bytes between the
+//  non-blocking sockets and per-operator receive buffers / write queues. A small pool
+//  of workers runs the welcome, command, stream and terminate handlers, so a client
+//  costs two buffers instead of two threads. Handlers never block on a slow client:
+//  whatever cannot be sent right away is queued and flushed when the socket drains.
+//
+//  An optional second port speaks WebSocket (RFC 6455) so that a browser can connect
+//  directly. The event loop completes the handshake, unmasks the incoming frames into
+//  the same receive buffer and answers the pings, so the handlers see the same lines
+//  and the same byte stream as a plain TCP client. Each RKOperatorSendPackets() call
+//  becomes one binary message.
+//
+//  The pieces of a send go out with one sendmsg() straight from where they are, only
+//  the part the socket does not take is copied into the write queue. On Linux, pieces
+//  of at least zeroCopyThreshold bytes of an RKOperatorSendVector() call that allows
+//  it are sent with MSG_ZEROCOPY. Those buffers must be left untouched until
+//  RKOperatorZeroCopyReleased() returns true, which does not wait.
+//
+//  The handlers run on the shared workers and must not wait for anything. A command
+//  handler that cannot act on a command yet returns RKResultCommandDeferred, the
+//  command then stays at the head of the queue and is handed over again on the next
+//  round. Payloads from the client are taken with RKServerReceiveUserPayloadNonBlocking()
+//  as they arrive.
+//
+
+#define RKServerMaximumOperators    256
 #define RKServerBufferDepth         8
+#define RKServerDefaultWorkerCount  4
+#define RKServerMaximumWorkers      16
+#define RKServerEventCount          64
+#define RKServerWorkerPeriodUs      500
+#define RKServerReceiveBufferSize   (256 * 1024)
+#define RKServerWriteQueueSize      (256 * 1024)                // Initial capacity of a write queue, grows as needed
+#define RKServerStreamQueueLimit    (1024 * 1024)               // Stream handler is skipped while the write queue is deeper
+#define RKServerWriteQueueLimit     (64 * 1024 * 1024)          // Client is dropped if the write queue has to grow beyond
+#define RKServerHandshakeSize       (8 * 1024)                  // Largest WebSocket upgrade request accepted
+#define RKServerNotSentLowWater     (128 * 1024)                // Unsent bytes the kernel keeps for a client, the rest waits in the write queue
+#define RKServerMaximumVectors      32                          // Maximum number of pieces in one send
+#define RKServerPayloadIncomplete   -2                          // RKServerReceiveUserPayloadNonBlocking() has not got the whole frame yet
 
 typedef int RKServerState;
 enum {
@@ -41,8 +89,18 @@ enum {
 };
 
 
-typedef struct rk_server    RKServer;
-typedef struct rk_operator  RKOperator;
+typedef struct rk_server         RKServer;
+typedef struct rk_server_worker  RKServerWorker;
+typedef struct rk_operator       RKOperator;
+
+struct rk_server_worker {
+    RKChildName      name;
+    int              id;
+    pthread_t        tid;                                   // Thread ID of the worker
+    RKServer         *parent;                               // Pointer to the main server
+
+    uint64_t         tic;                                   // Service cycle counter
+};
 
 struct rk_server {
     RKName           name;                                  // A program name
@@ -50,14 +108,24 @@ struct rk_server {
 
     int              sd;                                    // Socket descriptor
     int              port;                                  // Port number of the server
+    int              webSocketSd;                           // Socket descriptor of the WebSocket port
+    int              webSocketPort;                         // Port number for WebSocket clients, 0 = disabled
     int              maxClient;                             // Maximum number of client connections
     int              timeoutSeconds;                        // Timeout in seconds
     RKServerOption   options;                               // Server options
 
+    int              workerCount;                           // Number of workers that run the handlers
+    size_t           zeroCopyThreshold;                     // Pieces at least this large may be sent with MSG_ZEROCOPY, 0 = never
+
     int              ireq;                                  // A global instance request
     int              state;                                 // A global flag for infinite loop
-    pthread_t        threadId;                              // Own thread ID
+    pthread_t        threadId;                              // Own thread ID, the event loop
     pthread_mutex_t  lock;                                  // Thread safety mutex of the server
+    int              efd;                                   // Event queue descriptor (epoll on Linux)
+    int              wakeFds[2];                            // A pipe to wake up the event loop
+    RKServerWorker   *workers;                              // Workers that run the handlers
+    pthread_mutex_t  workLock;                              // Mutex for the worker condition
+    pthread_cond_t   workPosted;                            // Signaled when there is something for the workers
 
     bool             busy[RKServerMaximumOperators];       // Operator occupied
     RKOperator       *operators[RKServerMaximumOperators]; // Operator reference
@@ -77,9 +145,28 @@ struct rk_operator  {
     int              timeoutSeconds;                       // Timeout in seconds
     int              sid;                                  // Socket identifier of the client
     RKOperatorState  state;                                // Connection state
-    pthread_t        tidRead;                              // Thread ID of the operator ingest
-    pthread_t        tidExecute;                           // Thread ID of the operator execution
     pthread_mutex_t  lock;                                 // Thread safety mutex of the attendant
+    pthread_cond_t   received;                             // Signaled when new bytes are in the receive buffer
+
+    uint8_t          *rx;                                  // Receive buffer, filled by the event loop
+    size_t           rxSize;                               // Number of bytes in the receive buffer
+    bool             rxStalled;                            // Receive buffer was full, socket not drained
+    bool             peerClosed;                           // Client closed or the socket failed
+    bool             webSocket;                            // Client connected through the WebSocket port
+    bool             webSocketOpen;                        // WebSocket handshake completed
+    size_t           rxDecoded;                            // Number of bytes in the receive buffer that are unframed payload
+    uint8_t          rxOpcode;                             // Opcode of the WebSocket message being received
+    size_t           rxTaken;                              // Bytes of the frame being taken by RKServerReceiveUserPayloadNonBlocking()
+    uint8_t          *tx;                                  // Write queue, flushed by the event loop
+    size_t           txHead;                               // Offset of the first unsent byte
+    size_t           txSize;                               // Number of unsent bytes
+    size_t           txCapacity;                           // Capacity of the write queue
+    uint64_t         txByteCount;                          // Bytes taken by RKOperatorSendPackets() since connected
+    bool             zeroCopy;                             // Socket takes MSG_ZEROCOPY
+    uint32_t         zeroCopySent;                         // Number of sendmsg() calls with MSG_ZEROCOPY
+    uint32_t         zeroCopyDone;                         // Number of those the kernel has released the buffers of
+    struct timeval   latestReadTime;                       // Time of the latest bytes received
+    struct timeval   latestWriteTime;                      // Time of the latest progress of the write queue
 
     RKName           name;                                 // Operator name
     char             ip[48];                               // Client's IP address
@@ -100,10 +187,14 @@ struct rk_operator  {
 
 
 ssize_t RKOperatorSendPackets(RKOperator *, ...);
+ssize_t RKOperatorSendVector(RKOperator *, const struct iovec *, const int, const bool);
+bool RKOperatorZeroCopyReleased(RKOperator *);
 ssize_t RKOperatorSendString(RKOperator *, const char *);
 ssize_t RKOperatorSendDelimitedString(RKOperator *, const char *);
 ssize_t RKOperatorSendCommandResponse(RKOperator *, const char *);
 ssize_t RKOperatorSendBeacon(RKOperator *);
+size_t RKOperatorGetQueueDepth(RKOperator *);
+size_t RKOperatorGetUnsentSize(RKOperator *);
 void RKOperatorHangUp(RKOperator *);
 
 RKServer *RKServerInit(void);
@@ -111,6 +202,9 @@ void RKServerFree(RKServer *);
 
 void RKServerSetName(RKServer *, const char *);
 void RKServerSetPort(RKServer *, const int);
+void RKServerSetWebSocketPort(RKServer *, const int);
+void RKServerSetWorkerCount(RKServer *, const int);
+void RKServerSetZeroCopyThreshold(RKServer *, const size_t);
 void RKServerSetWelcomeHandler(RKServer *, int (*)(RKOperator *));
 void RKServerSetCommandHandler(RKServer *, int (*)(RKOperator *));
 void RKServerSetTerminateHandler(RKServer *, int (*)(RKOperator *));
@@ -124,5 +218,6 @@ void RKServerWait(RKServer *);
 void RKServerStop(RKServer *);
 
 ssize_t RKServerReceiveUserPayload(RKOperator *O, void *buffer, RKNetworkMessageFormat format);
+ssize_t RKServerReceiveUserPayloadNonBlocking(RKOperator *O, void *buffer, RKNetworkMessageFormat format);
 
 #endif /* defined(___RadarKit_Server__) */
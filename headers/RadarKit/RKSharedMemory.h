@@ -0,0 +1,100 @@
+//
+//  RKSharedMemory.h
+//  RadarKit
+//
+//  Export the pulse and ray buffers of a radar to the processes on the same host.
+//  With RKInitFlagExportSharedMemory, the radar allocates both buffers in a POSIX
+//  shared memory segment that local consumers map read-only and follow in place,
+//  without the framing and the copies of the command center streams.
+//
+//  Every pulse and ray carries its own sequence counter, header.i, which is slot
+//  index + n * depth. A reader expects the next identifier at its slot: a smaller
+//  one means the producer has not reached it yet, a larger one means the slot has
+//  been overwritten and the reader skips ahead, counting the drops. The header is
+//  checked again after use with RKSharedMemoryReaderIsPulseIntact() or
+//  RKSharedMemoryReaderIsRayIntact() to find out if it was overwritten meanwhile.
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __RadarKit_SharedMemory__
+#define __RadarKit_SharedMemory__
+
+#include <RadarKit/RKFoundation.h>
+#include <sys/mman.h>
+
+#define RKSharedMemoryMagic                  0x4d534b52                        // "RKSM"
+#define RKSharedMemoryVersion                1
+#define RKSharedMemoryHeaderSize             4096                              // A page, the buffers that follow stay aligned
+#define RKSharedMemoryNameLength             64
+
+typedef uint32_t RKSharedMemoryState;
+enum {
+    RKSharedMemoryStateNull,
+    RKSharedMemoryStateLive,                                                   // Producer is running
+    RKSharedMemoryStateClosed                                                  // Producer has gone, no more updates
+};
+
+typedef union rk_shared_memory_header {
+    struct {
+        uint32_t             magic;                                            // RKSharedMemoryMagic
+        uint32_t             version;                                          // RKSharedMemoryVersion
+        RKSharedMemoryState  state;                                            // Set last when the segment is ready
+        pid_t                pid;                                              // Process ID of the producer
+        uint32_t             pulseCapacity;                                    // Gate capacity of a pulse
+        uint32_t             pulseBufferDepth;                                 // Number of pulses, 0 if not exported
+        uint64_t             pulseOffset;                                      // Offset of the pulse buffer from the segment origin
+        uint64_t             pulseBufferSize;                                  // Size of the pulse buffer in bytes
+        uint32_t             rayCapacity;                                      // Gate capacity of a ray
+        uint32_t             rayBufferDepth;                                   // Number of rays, 0 if not exported
+        uint64_t             rayOffset;                                        // Offset of the ray buffer from the segment origin
+        uint64_t             rayBufferSize;                                    // Size of the ray buffer in bytes
+        RKRadarDesc          desc;                                             // Description of the radar
+    };
+    RKByte                   bytes[RKSharedMemoryHeaderSize];
+} RKSharedMemoryHeader;
+
+// Producer side, owned by the radar
+
+typedef struct rk_shared_memory {
+    char                     name[RKSharedMemoryNameLength];                   // Name for shm_open(), e.g., "/radarkit-px1000"
+    int                      fd;
+    size_t                   size;                                             // Size of the segment
+    RKSharedMemoryHeader     *header;
+    RKBuffer                 pulses;                                           // Pulse buffer in the segment
+    RKBuffer                 rays;                                             // Ray buffer in the segment
+} RKSharedMemory;
+
+// Consumer side, in any local process
+
+typedef struct rk_shared_memory_reader {
+    char                     name[RKSharedMemoryNameLength];
+    int                      fd;
+    size_t                   size;
+    const RKSharedMemoryHeader *header;
+    RKBuffer                 pulses;                                           // Read-only
+    RKBuffer                 rays;                                             // Read-only
+    uint64_t                 pulseId;                                          // Identifier of the next pulse
+    uint64_t                 rayId;                                            // Identifier of the next ray
+    uint64_t                 pulseDropCount;                                   // Pulses overwritten before they were read
+    uint64_t                 rayDropCount;                                     // Rays overwritten before they were read
+} RKSharedMemoryReader;
+
+void RKSharedMemoryMakeName(char *, const char *);
+
+RKSharedMemory *RKSharedMemoryInit(const char *name,
+                                   const RKRadarDesc *,
+                                   const uint32_t pulseCapacity, const uint32_t pulseBufferDepth,
+                                   const uint32_t rayCapacity, const uint32_t rayBufferDepth);
+void RKSharedMemoryFree(RKSharedMemory *);
+
+RKSharedMemoryReader *RKSharedMemoryReaderInit(const char *name);
+void RKSharedMemoryReaderFree(RKSharedMemoryReader *);
+bool RKSharedMemoryReaderIsLive(RKSharedMemoryReader *);
+RKPulse *RKSharedMemoryReaderGetPulse(RKSharedMemoryReader *);
+RKRay *RKSharedMemoryReaderGetRay(RKSharedMemoryReader *);
+bool RKSharedMemoryReaderIsPulseIntact(RKSharedMemoryReader *, const RKPulse *);
+bool RKSharedMemoryReaderIsRayIntact(RKSharedMemoryReader *, const RKRay *);
+
+#endif
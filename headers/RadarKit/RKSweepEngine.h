@@ -12,9 +12,14 @@
 #define RKSweepScratchSpaceDepth             6
 #define RKMaximumProductBufferDepth          20
 #define RKMaximumListLength                  RKMaximumPathLength + RKMaximumProductBufferDepth * RKMaximumPathLength
+#define RKSweepEngineDefaultWriterCount      4
+#define RKSweepEngineMaximumWriterCount      16
+#define RKSweepEngineJobQueueDepth           32
+#define RKSweepEngineSweepQueueDepth         2
 
 #include <RadarKit/RKFoundation.h>
 #include <RadarKit/RKFileManager.h>
+#include <RadarKit/RKHookRunner.h>
 #include <RadarKit/RKSweepFile.h>
 #include <RadarKit/RKProduct.h>
 #include <RadarKit/RKProductFile.h>
@@ -28,6 +33,23 @@ typedef struct rk_sweep_scratch {
 
 typedef struct rk_sweep_engine RKSweepEngine;
 
+typedef struct rk_sweep_writer_job {
+    RKProduct                        *product;                                   // A single product for productRecorder, or
+    RKProductCollection              collection;                                 // a collection for productCollectionRecorder
+    char                             filename[RKMaximumPathLength];
+} RKSweepWriterJob;
+
+typedef struct rk_sweep_writer {
+    RKChildName                      name;
+    int                              id;
+    pthread_t                        tid;
+    RKSweepEngine                    *parent;
+
+    uint64_t                         tic;
+    uint32_t                         fileCount;
+    float                            writeTime;                                  // Time spent on the latest file (s)
+} RKSweepWriter;
+
 struct rk_sweep_engine {
     // User set variables
     RKName                           name;
@@ -42,6 +64,7 @@ struct rk_sweep_engine {
     char                             fileHandlingScript[RKMaximumPathLength];
     RKScriptProperty                 fileHandlingScriptProperties;
     RKFileManager                    *fileManager;
+    RKHookRunner                     *hookRunner;                                // Runs the file handling script away from the sweep manager
     char                             productFileExtension[RKMaximumFileExtensionLength];
     int                              (*productRecorder)(RKProduct *, const char *);
     int                              (*productCollectionRecorder)(RKProductCollection *, const char *, uint32_t);
@@ -59,6 +82,23 @@ struct rk_sweep_engine {
     RKProductList                    productList;
     RKProductId                      productIds[RKProductIndexCount];
     uint32_t                         business;
+    uint8_t                          writerCount;
+    RKSweepWriter                    *writers;
+    pthread_t                        tidSweepManager;
+    pthread_mutex_t                  queueMutex;
+    pthread_cond_t                   sweepPosted;                                // A sweep is ready for the sweep manager
+    pthread_cond_t                   sweepDone;                                  // The sweep manager has finished a sweep
+    pthread_cond_t                   jobPosted;                                  // A job is ready for the writers
+    pthread_cond_t                   jobTaken;                                   // A slot in the job queue is vacant
+    pthread_cond_t                   jobDone;                                    // A writer has finished a job
+    uint8_t                          sweepQueue[RKSweepEngineSweepQueueDepth];
+    uint32_t                         sweepPostCount;                             // Sweeps posted by the ray gatherer
+    uint32_t                         sweepTakeCount;                             // Sweeps taken by the sweep manager
+    uint32_t                         sweepDoneCount;                             // Sweeps completed by the sweep manager
+    RKSweepWriterJob                 jobs[RKSweepEngineJobQueueDepth];
+    uint32_t                         jobPostCount;                               // Jobs posted by the sweep manager
+    uint32_t                         jobTakeCount;                               // Jobs taken by the writers
+    uint32_t                         jobDoneCount;                               // Jobs completed by the writers
 
     // Status / health
     uint32_t                         processedRayIndex;
@@ -69,6 +109,8 @@ struct rk_sweep_engine {
     float                            lag;
     uint32_t                         almostFull;
     size_t                           memoryUsage;
+    float                            writeTime;                                  // Time spent on the latest file (s)
+    float                            writeTimeMaximum;                           // Longest time spent on a file (s)
 };
 
 RKSweepEngine *RKSweepEngineInit(void);
@@ -81,7 +123,12 @@ void RKSweepEngineSetEssentials(RKSweepEngine *, RKRadarDesc *, RKFileManager *,
 void RKSweepEngineSetRecord(RKSweepEngine *, const bool);
 void RKSweepEngineSetProductTimeout(RKSweepEngine *, const uint32_t);
 void RKSweepEngineSetFilesHandlingScript(RKSweepEngine *, const char *, const RKScriptProperty);
+void RKSweepEngineSetFilesHandlingConcurrency(RKSweepEngine *, const uint8_t);
+void RKSweepEngineSetFilesHandlingTimeout(RKSweepEngine *, const double);
 void RKSweepEngineSetProductRecorder(RKSweepEngine *, int (*)(RKProduct *, const char *));
+void RKSweepEngineSetProductCollectionRecorder(RKSweepEngine *, int (*)(RKProductCollection *, const char *, uint32_t));
+void RKSweepEngineSetProductFileExtension(RKSweepEngine *, const char *);
+void RKSweepEngineSetWriterCount(RKSweepEngine *, const uint8_t);
 
 int RKSweepEngineStart(RKSweepEngine *);
 int RKSweepEngineStop(RKSweepEngine *);
@@ -11,6 +11,7 @@
 
 #include <RadarKit/RKRadar.h>
 #include <RadarKit/RKReporter.h>
+#include <RadarKit/RKCommandCenter.h>
 #include <RadarKit/RKFileHeader.h>
 
 #define RKTestWaveformCacheCount 2
@@ -110,6 +111,7 @@ typedef struct rk_test_health_relay {
 
 char *RKTestByNumberDescription(const int);
 void RKTestByNumber(const int, const void *);
+int RKTestFailureCount(void);
 
 // Basic Tests
 
@@ -125,6 +127,9 @@ void RKTestBufferOverviewText(const char *);
 void RKTestHealthOverviewText(const char *);
 void RKTestReviseLogicalValues(void);
 void RKTestTimeConversion(void);
+void RKTestClockRegression(void);
+void RKTestConfigWithId(void);
+void RKTestHealthRecord(void);
 
 // File handling
 
@@ -140,17 +145,33 @@ void RKTestProductWrite(void);
 void RKTestProductWriteFromPlainToSweep(void);
 void RKTestProductWriteFromPlainToProduct(void);
 void RKTestProductWriteFromWDSS2ToProduct(const char *, const int);
+void RKTestRecorderWriteFault(void);
+void RKTestProductViewFromSweep(void);
+void RKTestProductNativeFile(void);
+void RKTestPreferenceIndex(void);
 
 // State machines
 
 void RKTestFileManager(void);
 void RKTestFileMonitor(void);
 void RKTestHostMonitor(void);
+void RKTestHostMonitorLoopback(void);
 void RKTestInitializingRadar(void);
 void RKTestWebSocket(void);
 void RKTestRadarHub(void);
 void RKTestSimplePulseEngine(const int);
 void RKTestSimpleMomentEngine(const int);
+void RKTestHookRunner(void);
+void RKTestWebSocketLoopback(void);
+void RKTestRadarRelayLoopback(void);
+void RKTestPositionEngine(const int);
+void RKTestFileIndex(void);
+void RKTestFileRemovalRate(void);
+void RKTestCommandCenterLoopback(void);
+void RKTestRayStreamCache(void);
+void RKTestServerWebSocket(void);
+void RKTestServerZeroCopy(void);
+void RKTestFileManagerStopWhileWriting(void);
 
 // DSP Tests
 
@@ -184,6 +205,8 @@ void RKTestPulseCompressionSpeed(const int);
 void RKTestPulseEngineSpeed(const int);
 void RKTestMomentProcessorSpeed(void);
 void RKTestCacheWrite(void);
+void RKTestRayStreamCodecs(void);
+void RKTestLogSpeed(void);
 
 // Transceiver Emulator
 
@@ -57,6 +57,8 @@
 #pragma mark - Constants
 
 #define RKRawDataFormat                      8                                 // Format
+#define RKProductFileFormat                  1                                 // Format of the native product file
+#define RKProductFileBlockAlignment          4096                              // Alignment of blocks in the native product file
 #define RKBufferSSlotCount                   10                                // Status
 #define RKBufferCSlotCount                   10                                // Config
 #define RKBufferHSlotCount                   50                                // Health
@@ -153,6 +155,9 @@
 #define RKNameLength                         128
 #define RKShortNameLength                    20                                // Short names, e.g., C1, M2, P0, etc. (including color)
 #define RKChildNameLength                    160                               // Child names, e.g., "PulseEngine C0"
+#define RKHealthRecordSlotCount              32                                // Keys of a health record
+#define RKHealthRecordKeyLength              48
+#define RKHealthRecordValueLength            64
 
 #define RKColorDutyCycle(x)  (x > RKDutyCyleRedThreshold ? RKBaseRedColor : (x > RKDutyCyleOrangeThreshold ? RKBaseYellowColor : RKBaseGreenColor))
 #define RKColorLag(x)        (x > RKLagRedThreshold      ? RKBaseRedColor : (x > RKLagOrangeThreshold      ? RKBaseYellowColor : RKBaseGreenColor))
@@ -411,7 +416,12 @@ N(RKResultFilenameHasBadTime) \
 N(RKResultFilenameHasBadScan) \
 N(RKResultFilenameHasNoProduct) \
 N(RKResultFailedToOpenFile) \
-N(RKResultNoRadar)
+N(RKResultNoRadar) \
+N(RKResultFailedToStartHookRunner) \
+N(RKResultFailedToWriteProduct) \
+N(RKResultFailedToAllocateUserBuffer) \
+N(RKResultNoPositionEngine) \
+N(RKResultCommandDeferred)
 
 #define N(x) x,
 enum {
@@ -652,7 +662,7 @@ enum {
     RKInitFlagManuallyAssignCPU                  = 0x00000010,
     RKInitFlagIgnoreGPS                          = 0x00000020,
     RKInitFlagIgnoreHeading                      = 0x00000040,
-    RKInitFlagReserved4                          = 0x00000080,
+    RKInitFlagExportSharedMemory                 = 0x00000080,                 // Pulse and ray buffers in shared memory, see RKSharedMemory.h
     RKInitFlagAllocStatusBuffer                  = 0x00000100,                 // 1 << 8
     RKInitFlagAllocConfigBuffer                  = 0x00000200,                 // 1 << 9
     RKInitFlagAllocRawIQBuffer                   = 0x00000400,                 // 1 << 10
@@ -1056,6 +1066,7 @@ enum {
     RKProductStatusActive                        = (1 << 0),                   // This slot has been registered
     RKProductStatusBusy                          = (1 << 1),                   // Waiting for processing node
     RKProductStatusSkipped                       = (1 << 2),                   //
+    RKProductStatusRayView                       = (1 << 3),                   // Data are views into the ray buffer, not in *data
     RKProductStatusSleep0                        = (1 << 4),                   // Sleep stage 0 -
     RKProductStatusSleep1                        = (1 << 5),                   // Sleep stage 1 -
     RKProductStatusSleep2                        = (1 << 6),                   // Sleep stage 2 -
@@ -1169,10 +1180,16 @@ typedef uint32_t RKWriterOption;
 enum RKWriterOption {
     RKWriterOptionNone                           = 0,                          //
     RKWriterOptionPackPosition                   = 1,                          // Use packed position
-    RKWriterOptionDeflateFields                  = 1 << 1,                     // Use NetCDF deflate on field variables
+    RKWriterOptionDeflateFields                  = 1 << 1,                     // Use NetCDF deflate on field variables, deflate blocks of native files
     RKWriterOptionStringVariables                = 1 << 2                      // Use NetCDF string on variables
 };
 
+typedef uint32_t RKProductFileCompression;
+enum {
+    RKProductFileCompressionNone,                                              // Raw RKFloat array
+    RKProductFileCompressionDeflate                                            // zlib deflate
+};
+
 typedef uint8_t RKMomentMethod;
 enum RKMomentMethod {
     RKMomentMethodNone,                                                        // No method
@@ -1335,6 +1352,22 @@ typedef union rk_config {
     RKByte               bytes[1024];
 } RKConfig;
 
+//
+// Typed health record, a fixed schema of key / value slots, see RKHealthRecord.h
+//
+typedef struct rk_health_slot {
+    char                 key[RKHealthRecordKeyLength];                         // Key
+    char                 value[RKHealthRecordValueLength];                     // JSON text of the value, e.g., true, 12.5, "12.5 degC"
+    double               number;                                               // Value as a number, NAN if it is not
+    RKStatusEnum         status;                                               // Enum of a {"Value":..., "Enum":...} object
+    bool                 hasStatus;                                            // The value is a {"Value":..., "Enum":...} object
+} RKHealthSlot;
+
+typedef struct rk_health_record {
+    uint32_t             count;                                                // Number of slots in use, 0 = use the string
+    RKHealthSlot         slots[RKHealthRecordSlotCount];
+} RKHealthRecord;
+
 //
 // Consolidated health buffer
 //
@@ -1345,6 +1378,7 @@ typedef union rk_health {
         struct timeval       time;                                             // Time in struct timeval
         double               timeDouble;                                       // Time in double
         char                 string[RKMaximumStringLength];                    // Health string
+        RKHealthRecord       record;                                           // Health record, has priority over the string when count > 0
     };
     RKByte               *bytes;
 } RKHealth;
@@ -1549,6 +1583,7 @@ typedef struct rk_preferene_object {
     char                 valueString[RKMaximumStringLength];                   //
     bool                 isNumeric;                                            //
     bool                 isValid;                                              //
+    bool                 isParsed;                                             // Typed values below are parsed
     int                  numericCount;                                         //
     char                 subStrings[4][RKNameLength];                          //
     double               doubleValues[4];                                      //
@@ -1698,13 +1733,49 @@ typedef struct rk_product {                                                    /
     double               *startTime;                                           // Start time of each ray
     double               *endTime;                                             // End time of each ray
     RKFloat              *data;                                                // Flattened array of user product
+    RKFloat              **views;                                              // Data of each ray in the ray buffer (RKProductStatusRayView)
+    RKRay                **viewRays;                                           // Rays of the views in the ray buffer
+    RKIdentifier         *viewIdentifiers;                                     // Identifier of each ray when the views were made
 } RKProduct;
 
 typedef struct rk_product_collection {
     uint32_t             count;                                                // Number of products
     RKProduct            *products;                                            // Products
+    void                 *map;                                                 // File mapping that views of the products point to
+    size_t               mapSize;                                              // Size of the file mapping
 } RKProductCollection;
 
+//
+// Native product file: a file header, a block table of productCount entries, the per-ray metadata and then
+// one gate x ray block of RKFloat for each product. The metadata and every block start at a multiple of
+// RKProductFileBlockAlignment so that an uncompressed file can be mapped and each block used in place.
+//
+typedef union rk_product_file_header {
+    struct {
+        RKName               preface;                                          // 128 B
+        uint32_t             format;                                           //   4 B
+        uint32_t             productCount;                                     //   4 B
+        uint32_t             rayCount;                                         //   4 B
+        uint32_t             gateCount;                                        //   4 B
+        uint64_t             metadataOffset;                                   //   8 B
+        uint64_t             metadataSize;                                     //   8 B
+        uint8_t              reserved[96];                                     //  96 B = 256 B
+        RKProductHeader      header;                                           //
+    };                                                                         //
+    RKByte               bytes[4096];                                          //
+} RKProductFileHeader;
+
+typedef union rk_product_file_block {
+    struct {
+        RKProductDesc        desc;                                             // 1024 B
+        uint64_t             offset;                                           //    8 B Offset from the beginning of the file
+        uint64_t             size;                                             //    8 B Size in the file
+        uint64_t             rawSize;                                          //    8 B Size after decompression
+        RKProductFileCompression compression;                                  //    4 B
+    };                                                                         //
+    RKByte               bytes[1280];                                          //
+} RKProductFileBlock;
+
 typedef struct rk_iir_filter {
     RKName               name;                                                 // String description of the filter
     RKFilterType         type;                                                 // Built-in type
@@ -20,6 +20,8 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <zlib.h>
 
 #include "_rfc_6455.h"
 
@@ -27,6 +29,8 @@
 #define RKWebSocketPayloadDepth                  1000
 #define RKWebSocketTimeoutDeltaMicroseconds      10000
 #define RKWebSocketTimeoutThresholdSeconds       10.0
+#define RKWebSocketDeflateThreshold              64                            // Payloads smaller than this are not compressed
+#define RKWebSocketFrameHeaderSize               14                            // Largest frame header with extended length and mask
 
 #ifndef htonll
 #define htonll(x) (((uint64_t)htonl((x) & 0xFFFFFFFF) << 32) | htonl((x) >> 32))
@@ -64,8 +68,15 @@ struct rk_websocket {
     char                     digest[64];                                       // Handshake Sec-WebSocket-Accept
     char                     upgrade[64];                                      // Handshake Upgrade
     char                     connection[64];                                   // Handshake Connection
+    char                     extensions[256];                                  // Handshake Sec-WebSocket-Extensions
     bool                     wantActive;
+    bool                     wantDeflate;                                      // Offer permessage-deflate (RFC 7692) during handshake
     bool                     connected;
+    bool                     deflate;                                          // The server agreed to permessage-deflate
+    bool                     deflateNoContextTakeover;                         // Reset the deflater after every message
+    bool                     inflateNoContextTakeover;                         // Reset the inflater after every message
+    z_stream                 deflater;                                         // Compressor of outgoing messages
+    z_stream                 inflater;                                         // Decompressor of incoming messages
 
     pthread_t                threadId;                                         // Own thread ID
     pthread_attr_t           threadAttributes;                                 // Thread attributes
@@ -79,8 +90,14 @@ struct rk_websocket {
     uint32_t                 timeoutThreshold;                                 // Internal variable
     uint32_t                 timeoutCount;                                     // Internal variable
     uint64_t                 tic;
+    uint64_t                 payloadByteCount;                                 // Payload bytes sent before compression
+    uint64_t                 wireByteCount;                                    // Bytes written to the socket
+    uint64_t                 writeCount;                                       // Number of writes, each may carry several frames
 
     uint8_t                  frame[RKWebSocketFrameSize];                      // A local buffer to store a frame
+    uint8_t                  outbox[RKWebSocketFrameSize];                     // A local buffer to coalesce outgoing frames
+    uint8_t                  deflated[RKWebSocketFrameSize];                   // A local buffer of a compressed outgoing message
+    uint8_t                  inflated[RKWebSocketFrameSize];                   // A local buffer of a decompressed incoming message
 };
 
 RKWebSocket *RKWebSocketInit(const char *, const char *);
@@ -94,6 +111,7 @@ void RKWebSocketSetOpenHandler(RKWebSocket *, void (*)(RKWebSocket *));
 void RKWebSocketSetCloseHandler(RKWebSocket *, void (*)(RKWebSocket *));
 void RKWebSocketSetMessageHandler(RKWebSocket *, void (*)(RKWebSocket *, void *, size_t));
 void RKWebSocketSetErrorHandler(RKWebSocket *, void (*)(RKWebSocket *));
+void RKWebSocketSetDeflate(RKWebSocket *, const bool);
 
 // This is technically RKWebSocketStartAsClient(). Sorry, but no plans to make RKWebSocketStartAsServer()
 void RKWebSocketStart(RKWebSocket *);
@@ -108,4 +126,7 @@ void RKWebSocketWait(RKWebSocket *);
 // Send a packet
 int RKWebSocketSend(RKWebSocket *, void *, const size_t);
 
+// Make the Sec-WebSocket-Accept value of a Sec-WebSocket-Key
+void RKWebSocketMakeAcceptKey(char *, const char *);
+
 #endif
@@ -26,6 +26,10 @@ typedef struct user_params {
     RKName                   streams;
     uint8_t                  verbose;                                            // Verbosity
     int                      port;                                               // Server port other than the default 10000
+    int                      webSocketPort;                                      // Server port for WebSocket clients, 0 = disabled
+    size_t                   zeroCopyThreshold;                                  // Stream pieces at least this large use MSG_ZEROCOPY, 0 = never
+    bool                     exportSharedMemory;                                 // Pulse and ray buffers in shared memory for local consumers
+    uint8_t                  positionModelOrder;                                 // Order of the position model, 0 = linear interpolation
     int                      coresForPulseCompression;                           // Number of cores for pulse compression
     int                      coresForPulseRingFilter;                            // Number of cores for pulse ring filter
     int                      coresForMomentProcessor;                            // Number of cores for moment calculations
@@ -92,6 +96,9 @@ static void showHelp(void) {
            "         The default is derived autmatically where the gate spacing of rays\n"
            "         would be 60 meters.\n"
            "\n"
+           "  -F (--convert) " UNDERLINE("filename") "\n"
+           "         Converts a product file from NetCDF to the native .rkp format, or back.\n"
+           "\n"
            "  -e (--empty-style)\n"
            "         Set styles of text to be empty. No color / underline. This should be set\n"
            "         for terminals that do not support color output through escape sequence.\n"
@@ -147,6 +154,24 @@ static void showHelp(void) {
            "          r - Ring filter engine\n"
            "          s - Sweep engine\n"
            "          w - RadarHub WebSocket Reporter\n"
+           "\n",
+           name);
+    printf("  -W (--websocket-port) " UNDERLINE("port") "\n"
+           "         Sets the port for WebSocket clients, e.g., a browser, to access the\n"
+           "         same streams as the command center (default = disabled).\n"
+           "\n"
+           "  -M (--shared-memory)\n"
+           "         Exports the pulse and ray buffers through shared memory, named after\n"
+           "         the radar, e.g., /radarkit-px-1000, for local consumers to follow.\n"
+           "\n"
+           "  -O (--position-model) " UNDERLINE("order") "\n"
+           "         Tags the pulses ahead of the latest position with a local polynomial\n"
+           "         fit of the positions, 1 for constant velocity and 2 for constant\n"
+           "         acceleration, instead of waiting (default = 0, wait).\n"
+           "\n"
+           "  -Z (--zero-copy) " UNDERLINE("size") "\n"
+           "         Sends the stream pieces of at least " UNDERLINE("size") " bytes, e.g., the A-scope\n"
+           "         samples, with MSG_ZEROCOPY where available (default = 0, disabled).\n"
            "\n"
            "  -T (--test) " UNDERLINE("value") "\n"
            "         Tests a specific component of the RadarKit framework.\n"
@@ -177,11 +202,39 @@ static void showHelp(void) {
            "\n\n"
            "%s / RadarKit " __RKVersion__ " / " __VERSION__
            "\n\n",
-           name,
            RKTestByNumberDescription(9),
            name);
 }
 
+static void convertProductFile(const char *filename) {
+    int r;
+    char outputFilename[RKMaximumPathLength];
+    RKProductCollection *collection = RKProductCollectionInitWithFilename(filename);
+    if (collection == NULL) {
+        RKLog("Error. Unable to read %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    snprintf(outputFilename, sizeof(outputFilename), "%s", filename);
+    const char *ext = RKFileExtension(filename);
+    if (!strcasecmp(ext, ".rkp")) {
+        RKReplaceFileExtension(outputFilename, ext, ".nc");
+        RKProductCollectionStandardizeForCFRadial(collection);
+        r = RKProductCollectionFileWriterCF(collection, outputFilename, RKWriterOptionDeflateFields);
+    } else {
+        // RK-20240101-012345-E2.0-Z.nc and its siblings -> RK-20240101-012345-E2.0.rkp
+        if (RKIsFilenameStandard(filename) == true) {
+            RKReplaceFileExtension(outputFilename, strrchr(outputFilename, '-'), ".rkp");
+        } else {
+            RKReplaceFileExtension(outputFilename, ext, ".rkp");
+        }
+        r = RKProductCollectionFileWriterRK(collection, outputFilename, RKWriterOptionDeflateFields);
+    }
+    if (r == RKResultSuccess) {
+        RKLog("Output %s\n", outputFilename);
+    }
+    RKProductCollectionFree(collection);
+}
+
 static void setSystemLevel(UserParams *user, const int level) {
     switch (level) {
         case 0:
@@ -424,13 +477,18 @@ static void updateSystemPreferencesFromCommandLine(UserParams *user, int argc, c
         {"alarm"             , no_argument      , NULL, 'A'},    // ASCII 65 - 90 : A - Z
         {"clock"             , no_argument      , NULL, 'C'},
         {"dir"               , required_argument, NULL, 'D'},
+        {"convert"           , required_argument, NULL, 'F'},
         {"host"              , required_argument, NULL, 'H'},
         {"port"              , required_argument, NULL, 'P'},
         {"relay"             , required_argument, NULL, 'L'},
+        {"shared-memory"     , no_argument      , NULL, 'M'},
+        {"position-model"    , required_argument, NULL, 'O'},
         {"system"            , required_argument, NULL, 'S'},
         {"test"              , required_argument, NULL, 'T'},
         {"engine-verbose"    , required_argument, NULL, 'V'},
+        {"websocket-port"    , required_argument, NULL, 'W'},
         {"show-preference"   , no_argument      , NULL, 'X'},
+        {"zero-copy"         , required_argument, NULL, 'Z'},
         {"azimuth"           , required_argument, NULL, 'a'},    // ASCII 97 - 122 : a - z
         {"bandwidth"         , required_argument, NULL, 'b'},
         {"core"              , required_argument, NULL, 'c'},
@@ -516,6 +574,10 @@ static void updateSystemPreferencesFromCommandLine(UserParams *user, int argc, c
                 strncpy(user->playbackFolder, RKPathStringByExpandingTilde(optarg), sizeof(user->playbackFolder) - 1);
                 RKLog("==> %s ==> %s\n", optarg, user->playbackFolder);
                 break;
+            case 'F':
+                convertProductFile(RKPathStringByExpandingTilde(optarg));
+                RKExit(EXIT_SUCCESS);
+                break;
             case 'H':
                 strncpy(user->radarhubHost, optarg, sizeof(user->radarhubHost) - 1);
                 user->pedzyHost[sizeof(user->pedzyHost) - 1] = '\0';
@@ -523,6 +585,12 @@ static void updateSystemPreferencesFromCommandLine(UserParams *user, int argc, c
             case 'P':
                 user->port = atoi(optarg);
                 break;
+            case 'M':
+                user->exportSharedMemory = true;
+                break;
+            case 'O':
+                user->positionModelOrder = (uint8_t)atoi(optarg);
+                break;
             case 'S':
                 k = atoi(optarg);
                 setSystemLevel(user, k);
@@ -531,7 +599,7 @@ static void updateSystemPreferencesFromCommandLine(UserParams *user, int argc, c
                 // A bunch of different tests
                 k = atoi(optarg);
                 RKTestByNumber(k, argc == optind ? NULL : argv[optind]);
-                RKExit(EXIT_SUCCESS);
+                RKExit(RKTestFailureCount() ? EXIT_FAILURE : EXIT_SUCCESS);
                 break;
             case 'V':
                 c = optarg;
@@ -539,12 +607,18 @@ static void updateSystemPreferencesFromCommandLine(UserParams *user, int argc, c
                     user->engineVerbose[(int)*c]++;
                 } while (*++c != '\0');
                 break;
+            case 'W':
+                user->webSocketPort = atoi(optarg);
+                break;
             case 'X':
                 user->verbose = 2;
                 RKSetWantScreenOutput(true);
                 updateSystemPreferencesFromControlFile(user);
                 RKExit(EXIT_SUCCESS);
                 break;
+            case 'Z':
+                user->zeroCopyThreshold = (size_t)atol(optarg);
+                break;
             case 'b':
                 user->fs = roundf(atof(optarg));
                 break;
@@ -744,6 +818,9 @@ static void updateRadarParameters(UserParams *systemPreferences) {
                                   systemPreferences->coresForPulseCompression,
                                   systemPreferences->coresForPulseRingFilter,
                                   systemPreferences->coresForMomentProcessor);
+        if (systemPreferences->positionModelOrder) {
+            RKSetPositionModel(myRadar, systemPreferences->positionModelOrder, RKPositionModelDefaultExtrapolation);
+        }
         RKSetRecordingLevel(myRadar, systemPreferences->recordLevel);
         RKSweepEngineSetFilesHandlingScript(myRadar->sweepEngine, "scripts/archive.sh", RKScriptPropertyProduceTxz);
         if (systemPreferences->diskUsageLimitGB) {
@@ -906,8 +983,15 @@ int main(int argc, const char **argv) {
     }
     //printf("rootDataFolder = %s\n", rkGlobalParameters.rootDataFolder);
 
+    // Workers should never wait for the log
+    RKSetAsynchronousLog(true);
+
     // Initialize a radar object
-    myRadar = RKInitWithDesc(systemPreferences->desc);
+    RKRadarDesc desc = systemPreferences->desc;
+    if (systemPreferences->exportSharedMemory) {
+        desc.initFlags |= RKInitFlagExportSharedMemory;
+    }
+    myRadar = RKInitWithDesc(desc);
     if (myRadar == NULL) {
         RKLog("Error. Could not allocate a radar.\n");
         exit(EXIT_FAILURE);
@@ -929,6 +1013,8 @@ int main(int argc, const char **argv) {
     RKCommandCenter *center = RKCommandCenterInit();
     RKCommandCenterSetVerbose(center, systemPreferences->verbose);
     RKCommandCenterSetPort(center, systemPreferences->port);
+    RKCommandCenterSetWebSocketPort(center, systemPreferences->webSocketPort);
+    RKCommandCenterSetZeroCopyThreshold(center, systemPreferences->zeroCopyThreshold);
     RKCommandCenterStart(center);
     RKCommandCenterAddRadar(center, myRadar);
 
@@ -1106,5 +1192,7 @@ int main(int argc, const char **argv) {
 
     systemPreferencesFree(systemPreferences);
 
+    RKSetAsynchronousLog(false);
+
     return 0;
 }
@@ -9,6 +9,60 @@
 
 #include <RadarKit/RKClock.h>
 
+#pragma mark - Helper Functions
+
+static int64_t RKClockTimespecToNanoseconds(const struct timespec *t) {
+    return (int64_t)t->tv_sec * 1000000000LL + (int64_t)t->tv_nsec;
+}
+
+static void RKClockReadSource(const RKClockSource source, struct timespec *t) {
+    switch (source) {
+        case RKClockSourceMonotonicRaw:
+#if defined(CLOCK_MONOTONIC_RAW)
+            clock_gettime(CLOCK_MONOTONIC_RAW, t);
+#else
+            clock_gettime(CLOCK_MONOTONIC, t);
+#endif
+            break;
+        case RKClockSourceTAI:
+#if defined(CLOCK_TAI)
+            clock_gettime(CLOCK_TAI, t);
+#else
+            RKUTCTime(t);
+#endif
+            break;
+        default:
+            RKUTCTime(t);
+            break;
+    }
+}
+
+// Map the source to the wall clock, i.e., the nanoseconds from the source to the output of RKClockGetTime()
+static void RKClockUpdateEpoch(RKClock *clock) {
+    struct timespec s, r;
+    RKClockReadSource(clock->source, &s);
+    RKUTCTime(&r);
+    clock->epoch = RKClockTimespecToNanoseconds(&r) - RKClockTimespecToNanoseconds(&s);
+    if (clock->highPrecision) {
+        clock->epoch -= (int64_t)clock->initDay * 1000000000LL;
+    }
+}
+
+static void RKClockPublishMapping(RKClock *clock, const int64_t tic, const int64_t time, const double slope) {
+    const uint32_t s = clock->sequence;
+    const uint64_t count = clock->count;
+    __atomic_store_n(&clock->sequence, s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&clock->mapping.tic, tic, __ATOMIC_RELAXED);
+    __atomic_store_n(&clock->mapping.time, time, __ATOMIC_RELAXED);
+    __atomic_store(&clock->mapping.slope, (double *)&slope, __ATOMIC_RELAXED);
+    __atomic_store(&clock->mapping.offset, &clock->offsetSeconds, __ATOMIC_RELAXED);
+    __atomic_store_n(&clock->mapping.count, count, __ATOMIC_RELAXED);
+    __atomic_store_n(&clock->sequence, s + 2, __ATOMIC_RELEASE);
+}
+
+#pragma mark - Life Cycle
+
 RKClock *RKClockInitWithSize(const uint32_t size, const uint32_t stride) {
     if (size < stride) {
         RKLog("Error. Clock size must be greater than stride.\n");
@@ -33,7 +87,9 @@ RKClock *RKClockInitWithSize(const uint32_t size, const uint32_t stride) {
     clock->uBuffer = (double *)malloc(clock->size * sizeof(double));
     clock->yBuffer = (double *)malloc(clock->size * sizeof(double));
     clock->zBuffer = (double *)malloc(clock->size * sizeof(double));
-    if (clock->tBuffer == NULL || clock->xBuffer == NULL || clock->uBuffer == NULL) {
+    clock->vBuffer = (int64_t *)malloc(clock->size * sizeof(int64_t));
+    clock->wBuffer = (int64_t *)malloc(clock->size * sizeof(int64_t));
+    if (clock->tBuffer == NULL || clock->xBuffer == NULL || clock->uBuffer == NULL || clock->vBuffer == NULL || clock->wBuffer == NULL) {
         RKLog("Error. Unable to allocate internal buffers of an RKClock.\n");
         return NULL;
     }
@@ -42,6 +98,8 @@ RKClock *RKClockInitWithSize(const uint32_t size, const uint32_t stride) {
     memset(clock->uBuffer, 0, clock->size * sizeof(double));
     memset(clock->yBuffer, 0, clock->size * sizeof(double));
     memset(clock->zBuffer, 0, clock->size * sizeof(double));
+    memset(clock->vBuffer, 0, clock->size * sizeof(int64_t));
+    memset(clock->wBuffer, 0, clock->size * sizeof(int64_t));
     struct timeval t;
     gettimeofday(&t, NULL);
     clock->initTime = (double)t.tv_sec + 1.0e-6 * (double)t.tv_usec;
@@ -49,6 +107,7 @@ RKClock *RKClockInitWithSize(const uint32_t size, const uint32_t stride) {
     clock->b = 1.0 / (double)clock->stride;
     clock->a = 1.0 - clock->b;
     clock->dx = 1.0e-6;
+    RKClockUpdateEpoch(clock);
     return clock;
 }
 
@@ -75,6 +134,8 @@ void RKClockFree(RKClock *clock) {
     free(clock->uBuffer);
     free(clock->yBuffer);
     free(clock->zBuffer);
+    free(clock->vBuffer);
+    free(clock->wBuffer);
     free(clock);
 }
 
@@ -111,6 +172,19 @@ void RKClockSetDuDx(RKClock *clock, const double dudx) {
 
 void RKClockSetHighPrecision(RKClock *clock, const bool value) {
     clock->highPrecision = value;
+    RKClockUpdateEpoch(clock);
+}
+
+void RKClockSetSource(RKClock *clock, const RKClockSource source) {
+    clock->source = source;
+    clock->index = 0;
+    clock->count = 0;
+    RKClockUpdateEpoch(clock);
+    if (clock->verbose) {
+        RKLog("%s Source = %s   epoch = %s ns\n", clock->name,
+              source == RKClockSourceMonotonicRaw ? "CLOCK_MONOTONIC_RAW" : (source == RKClockSourceTAI ? "CLOCK_TAI" : "gettimeofday()"),
+              RKIntegerToCommaStyleString(clock->epoch));
+    }
 }
 
 //
@@ -125,17 +199,11 @@ void RKClockSetHighPrecision(RKClock *clock, const bool value) {
 //   us up to the precision of microseconds. If more than such precision is needed. The
 //   reference time should be set to a running reference.
 //
-double RKClockGetTime(RKClock *clock, const double u, struct timeval *timeval) {
+static double RKClockGetTimeOfDay(RKClock *clock, const double u, const struct timeval t) {
     int j = 0;
     double x, dx, du, y;
-    struct timeval t;
     bool recent = true;
 
-    // Get the time
-    gettimeofday(&t, NULL);
-    if (timeval) {
-        *timeval = t;
-    }
     // Pre-processing
     if (clock->highPrecision) {
         x = ((double)t.tv_sec - clock->initDay) + 1.0e-6 * (double)t.tv_usec;
@@ -258,9 +326,196 @@ double RKClockGetTime(RKClock *clock, const double u, struct timeval *timeval) {
     }
     clock->latestTime = y;
 
+    if (clock->count > 1) {
+        const int64_t tic = (int64_t)llround(clock->u0);
+        RKClockPublishMapping(clock, tic, (int64_t)llround(1.0e9 * (clock->x0 + clock->dx * ((double)tic - clock->u0))), 1.0e9 * clock->dx);
+    }
+
+    return y + clock->offsetSeconds;
+}
+
+//
+// Monotonic and TAI sources:
+//   v - tic relative to the anchor
+//   w - arrival time in nanoseconds relative to the anchor
+//
+// The sums of v, w, v^2 and v w over the latest stride readings are kept exactly in
+// 128-bit integers, so a reading can be added and the oldest one removed in O(1)
+// without the round-off accumulating. The anchor is moved to the latest reading
+// when v or w grows beyond RKClockRebaseLimit, which keeps the sums far from
+// overflowing. The slope and the intercept are derived from the sums in double.
+//
+static double RKClockGetTimeOfMonotonicReading(RKClock *clock, const double u, const int64_t x) {
+    int j, k;
+    int64_t v, w, a, b, base;
+    double slope, vm, wm, y;
+    __int128 d;
+
+    const int64_t uTic = clock->useInternalReference ? (int64_t)clock->tic++ : (int64_t)u;
+
+    // Restart the fit when it has been a while or the tic went backward
+    if (clock->count > 0) {
+        j = RKPreviousModuloS(clock->index, clock->size);
+        if (x - clock->wBuffer[j] > (int64_t)(RKClockAWhile * 1.0e9)) {
+            RKLog("%s Warning. Self reset  %s ns since the last reading   count = %s\n", clock->name,
+                  RKIntegerToCommaStyleString(x - clock->wBuffer[j]), RKUIntegerToCommaStyleString(clock->count));
+            clock->count = 0;
+            clock->index = 0;
+        } else if (uTic < clock->vBuffer[j]) {
+            RKLog("%s Warning. Tic went backward  %s -> %s\n", clock->name,
+                  RKIntegerToCommaStyleString(clock->vBuffer[j]), RKIntegerToCommaStyleString(uTic));
+            clock->count = 0;
+            clock->index = 0;
+        }
+    }
+    if (clock->count == 0) {
+        clock->anchorTic = uTic;
+        clock->anchorTime = x;
+        clock->sum_v = 0;
+        clock->sum_w = 0;
+        clock->sum_vv = 0;
+        clock->sum_vw = 0;
+    }
+
+    // Number of readings in the fit before this one
+    const int64_t m = (int64_t)MIN(clock->count, (uint64_t)clock->stride);
+
+    // Move the anchor to this reading, the sums are shifted exactly
+    a = uTic - clock->anchorTic;
+    b = x - clock->anchorTime;
+    if (a > RKClockRebaseLimit || b > RKClockRebaseLimit) {
+        clock->sum_vv += -2 * (__int128)a * clock->sum_v + (__int128)m * a * a;
+        clock->sum_vw += -(__int128)a * clock->sum_w - (__int128)b * clock->sum_v + (__int128)m * a * b;
+        clock->sum_v -= (__int128)m * a;
+        clock->sum_w -= (__int128)m * b;
+        clock->anchorTic = uTic;
+        clock->anchorTime = x;
+    }
+
+    // Remove the oldest reading once there are stride readings in the fit
+    k = clock->index;
+    if (m == clock->stride) {
+        j = RKPreviousNModuloS(k, clock->stride, clock->size);
+        v = clock->vBuffer[j] - clock->anchorTic;
+        w = clock->wBuffer[j] - clock->anchorTime;
+        clock->sum_v -= v;
+        clock->sum_w -= w;
+        clock->sum_vv -= (__int128)v * v;
+        clock->sum_vw -= (__int128)v * w;
+    }
+    v = uTic - clock->anchorTic;
+    w = x - clock->anchorTime;
+    clock->sum_v += v;
+    clock->sum_w += w;
+    clock->sum_vv += (__int128)v * v;
+    clock->sum_vw += (__int128)v * w;
+    clock->vBuffer[k] = uTic;
+    clock->wBuffer[k] = x;
+    clock->index = RKNextModuloS(k, clock->size);
+
+    const int64_t n = m < clock->stride ? m + 1 : m;
+    d = (__int128)n * clock->sum_vv - clock->sum_v * clock->sum_v;
+    if (n > 1 && d == 0 && !clock->useInternalReference) {
+        RKLog("%s Warning. Reference tic did not change over %s readings.\n", clock->name, RKIntegerToCommaStyleString(n));
+        RKLog("%s Warning. Will be replaced with an internal uniform reference.\n", clock->name);
+        clock->useInternalReference = true;
+        clock->count = 0;
+        clock->index = 0;
+        base = x + clock->epoch;
+    } else if (clock->count > 0 && d > 0) {
+        if (clock->hasWisdom && clock->count < clock->stride) {
+            slope = 1.0e9 * clock->dx;
+        } else {
+            slope = (double)((__int128)n * clock->sum_vw - clock->sum_v * clock->sum_w) / (double)d;
+        }
+        vm = (double)clock->sum_v / (double)n;
+        wm = (double)clock->sum_w / (double)n;
+        base = clock->anchorTime + clock->epoch + (int64_t)llround(wm + slope * ((double)v - vm));
+        const int64_t tic = (int64_t)llround(vm);
+        RKClockPublishMapping(clock, clock->anchorTic + tic, clock->anchorTime + clock->epoch + (int64_t)llround(wm + slope * ((double)tic - vm)), slope);
+        clock->dx = 1.0e-9 * slope;
+        clock->u0 = (double)clock->anchorTic + vm;
+        clock->x0 = 1.0e-9 * (double)(clock->anchorTime + clock->epoch) + 1.0e-9 * wm;
+        if (clock->count == clock->stride) {
+            RKLog("%s Fit   du/dx = %s   offset = %.3f us", clock->name, RKFloatToCommaStyleString(1.0 / clock->dx), 1.0e6 * clock->offsetSeconds);
+        }
+        clock->count++;
+    } else {
+        base = x + clock->epoch;
+        clock->count++;
+    }
+
+    y = (double)(base / 1000000000LL) + 1.0e-9 * (double)(base % 1000000000LL);
+
+    const int64_t r = x + clock->epoch;
+    clock->tBuffer[k].tv_sec = r / 1000000000LL;
+    clock->tBuffer[k].tv_usec = (r % 1000000000LL) / 1000;
+    clock->xBuffer[k] = (double)(r / 1000000000LL) + 1.0e-9 * (double)(r % 1000000000LL);
+    clock->uBuffer[k] = (double)uTic;
+    clock->yBuffer[k] = y;
+    clock->zBuffer[k] = clock->dx;
+
+    if (y < clock->latestTime && clock->count > clock->stride) {
+        RKLog("%s WARNING. Going back in time?  y = %f < %f = latestTime\n", clock->name, y, clock->latestTime);
+    }
+    clock->latestTime = y;
+
     return y + clock->offsetSeconds;
 }
 
+// Derive the time of tic count u using a reading of the clock source taken now
+double RKClockGetTime(RKClock *clock, const double u, struct timeval *timeval) {
+    struct timeval t;
+    struct timespec s;
+    if (clock->source == RKClockSourceTimeOfDay) {
+        gettimeofday(&t, NULL);
+        if (timeval) {
+            *timeval = t;
+        }
+        return RKClockGetTimeOfDay(clock, u, t);
+    }
+    RKClockReadSource(clock->source, &s);
+    const double y = RKClockGetTimeOfMonotonicReading(clock, u, RKClockTimespecToNanoseconds(&s));
+    if (timeval) {
+        *timeval = clock->tBuffer[RKPreviousModuloS(clock->index, clock->size)];
+    }
+    return y;
+}
+
+// Derive the time of tic count u using a reading of the clock source taken elsewhere, e.g., a packet timestamp
+double RKClockGetTimeOfReading(RKClock *clock, const double u, const struct timespec *reading) {
+    if (clock->source == RKClockSourceTimeOfDay) {
+        struct timeval t = {.tv_sec = reading->tv_sec, .tv_usec = reading->tv_nsec / 1000};
+        return RKClockGetTimeOfDay(clock, u, t);
+    }
+    return RKClockGetTimeOfMonotonicReading(clock, u, RKClockTimespecToNanoseconds(reading));
+}
+
+// Copy the latest mapping, retry while the writer is in the middle of an update
+void RKClockGetMapping(RKClock *clock, RKClockMapping *mapping) {
+    uint32_t s0, s1;
+    do {
+        s0 = __atomic_load_n(&clock->sequence, __ATOMIC_ACQUIRE);
+        mapping->tic = __atomic_load_n(&clock->mapping.tic, __ATOMIC_RELAXED);
+        mapping->time = __atomic_load_n(&clock->mapping.time, __ATOMIC_RELAXED);
+        __atomic_load(&clock->mapping.slope, &mapping->slope, __ATOMIC_RELAXED);
+        __atomic_load(&clock->mapping.offset, &mapping->offset, __ATOMIC_RELAXED);
+        mapping->count = __atomic_load_n(&clock->mapping.count, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s1 = __atomic_load_n(&clock->sequence, __ATOMIC_RELAXED);
+    } while (s0 != s1 || (s0 & 1));
+}
+
+// Time of tic count u from the latest mapping, without a new reading, 0.0 if there is no mapping yet
+double RKClockGetTimeOfTic(RKClock *clock, const double u) {
+    RKClockMapping mapping;
+    RKClockGetMapping(clock, &mapping);
+    if (mapping.count == 0) {
+        return 0.0;
+    }
+    return 1.0e-9 * (double)mapping.time + 1.0e-9 * mapping.slope * (u - (double)mapping.tic) + mapping.offset;
+}
+
 #pragma mark -
 #pragma mark Interactions
 
@@ -273,5 +528,8 @@ void RKClockReset(RKClock *clock) {
     clock->tic = 0;
     clock->latestTime = 0;
     clock->infoShown = false;
+    if (clock->source != RKClockSourceTimeOfDay) {
+        RKClockUpdateEpoch(clock);
+    }
     RKLog("%s Reset   du/dx = %s\n", clock->name, RKFloatToCommaStyleString(1.0 / clock->dx));
 }
@@ -7,6 +7,7 @@
 //
 
 #include <RadarKit/RKCommandCenter.h>
+#include <ctype.h>
 
 // Private declarations
 
@@ -69,6 +70,945 @@ static void copyRayHeader(RKRayHeaderF1 *destination, RKRayHeader *source) {
     destination->reserved3       = source->reserved3;
 }
 
+// Make sure a user buffer holds at least size bytes, the content is kept. Must not be called with engine->mutex
+static void *reserveUserBuffer(RKCommandCenter *engine, RKUser *user, void **buffer, size_t *capacity, const size_t size) {
+    if (*capacity >= size) {
+        return *buffer;
+    }
+    const size_t newCapacity = MAX(size, 2 * *capacity);
+    void *newBuffer = realloc(*buffer, newCapacity);
+    if (newBuffer == NULL) {
+        RKLog("%s %s Error. Unable to allocate %s B.\n", engine->name, user->serverOperator ? user->serverOperator->name : "", RKIntegerToCommaStyleString(newCapacity));
+        return NULL;
+    }
+    pthread_mutex_lock(&engine->mutex);
+    engine->memoryUsage += newCapacity - *capacity;
+    pthread_mutex_unlock(&engine->mutex);
+    *buffer = newBuffer;
+    *capacity = newCapacity;
+    return newBuffer;
+}
+
+static int allocateUserBuffers(RKCommandCenter *engine, RKUser *user) {
+    user->commandResponse = (char *)malloc(RKCommandCenterResponseSize);
+    if (user->commandResponse == NULL) {
+        return RKResultFailedToAllocateUserBuffer;
+    }
+    pthread_mutex_lock(&engine->mutex);
+    engine->memoryUsage += RKCommandCenterResponseSize;
+    pthread_mutex_unlock(&engine->mutex);
+    if (reserveUserBuffer(engine, user, (void **)&user->string, &user->stringCapacity, RKCommandCenterStringSize) == NULL ||
+        reserveUserBuffer(engine, user, (void **)&user->scratch, &user->scratchCapacity, RKCommandCenterScratchSize) == NULL) {
+        return RKResultFailedToAllocateUserBuffer;
+    }
+    user->commandResponse[0] = '\0';
+    user->string[0] = '\0';
+    user->scratch[0] = '\0';
+    return RKResultSuccess;
+}
+
+// Must not be called with engine->mutex
+static void freeUserBuffers(RKCommandCenter *engine, RKUser *user) {
+    const size_t size = (user->commandResponse ? RKCommandCenterResponseSize : 0)
+                      + user->stringCapacity + user->scratchCapacity + user->payloadCapacity
+                      + user->sampleCapacities[0] + user->sampleCapacities[1];
+    pthread_mutex_lock(&engine->mutex);
+    engine->memoryUsage -= size;
+    pthread_mutex_unlock(&engine->mutex);
+    free(user->commandResponse);
+    free(user->string);
+    free(user->scratch);
+    free(user->payload);
+    free(user->samples[0]);
+    free(user->samples[1]);
+    user->commandResponse = NULL;
+    user->string = NULL;
+    user->scratch = NULL;
+    user->payload = NULL;
+    user->samples[0] = NULL;
+    user->samples[1] = NULL;
+    user->stringCapacity = 0;
+    user->scratchCapacity = 0;
+    user->payloadCapacity = 0;
+    user->sampleCapacities[0] = 0;
+    user->sampleCapacities[1] = 0;
+}
+
+static uint32_t encodeRayStreamBlock(void *destination, RKRay *ray, const RKRayStreamFormat format, const RKProductIndex productIndex, const uint16_t ratio) {
+    uint32_t i, k;
+    const uint32_t gateCount = ray->header.gateCount / ratio;
+    switch (format) {
+        case RKRayStreamFormatHeader:
+            memcpy(destination, &ray->header, sizeof(RKRayHeader));
+            ((RKRayHeader *)destination)->gateCount = gateCount;
+            ((RKRayHeader *)destination)->gateSizeMeters *= (float)ratio;
+            return sizeof(RKRayHeader);
+        case RKRayStreamFormatHeaderF1:
+            copyRayHeader((RKRayHeaderF1 *)destination, &ray->header);
+            ((RKRayHeaderF1 *)destination)->gateCount = gateCount;
+            ((RKRayHeaderF1 *)destination)->gateSizeMeters *= (float)ratio;
+            return sizeof(RKRayHeaderF1);
+        case RKRayStreamFormatFloat: {
+            float *f32Data = RKGetFloatDataFromRay(ray, productIndex);
+            float *lowRateData = (float *)destination;
+            for (i = 0, k = 0; i < gateCount; i++, k += ratio) {
+                lowRateData[i] = f32Data[k];
+            }
+            return gateCount * sizeof(float);
+        }
+        case RKRayStreamFormatUInt8: {
+            uint8_t *u8Data = RKGetUInt8DataFromRay(ray, productIndex);
+            uint8_t *lowRateData = (uint8_t *)destination;
+            for (i = 0, k = 0; i < gateCount; i++, k += ratio) {
+                lowRateData[i] = u8Data[k];
+            }
+            return gateCount * sizeof(uint8_t);
+        }
+        default:
+            return 0;
+    }
+}
+
+// Size needed to encode any block of a ray with a codec
+static size_t rayStreamBlockCapacity(RKRay *ray, const uint16_t ratio, const RKNetworkCodec codec) {
+    const size_t size = MAX(MAX(sizeof(RKRayHeader), sizeof(RKRayHeaderF1)), ray->header.gateCount / ratio * sizeof(float));
+    if (codec == RKNetworkCodecNone) {
+        return size;
+    }
+    // The size prefix, the encoded data, then the raw data to encode from
+    return sizeof(uint32_t) + RKNetworkCodecBound(codec, size) + size;
+}
+
+// Encode a block with a codec, an encoded product is preceded by its size as uint32_t
+static uint32_t encodeRayStreamBlockWithCodec(void *destination, RKRay *ray, const RKRayStreamFormat format, const RKProductIndex productIndex, const uint16_t ratio, const RKNetworkCodec codec) {
+    if (codec == RKNetworkCodecNone) {
+        return encodeRayStreamBlock(destination, ray, format, productIndex, ratio);
+    }
+    const size_t bound = RKNetworkCodecBound(codec, MAX(MAX(sizeof(RKRayHeader), sizeof(RKRayHeaderF1)), ray->header.gateCount / ratio * sizeof(float)));
+    void *raw = destination + sizeof(uint32_t) + bound;
+    const uint32_t rawSize = encodeRayStreamBlock(raw, ray, format, productIndex, ratio);
+    const uint32_t size = (uint32_t)RKNetworkEncode(destination + sizeof(uint32_t), bound, raw, rawSize,
+                                                    format == RKRayStreamFormatFloat ? sizeof(float) : sizeof(uint8_t), codec);
+    memcpy(destination, &size, sizeof(uint32_t));
+    return (uint32_t)sizeof(uint32_t) + size;
+}
+
+// Find the block of (ray, format, product, ratio, codec), encode it if nobody has, returns NULL if all candidates are in use
+static RKRayStreamBlock *acquireRayStreamBlock(RKCommandCenter *engine, RKRay *ray, const RKRayStreamFormat format, const RKProductIndex productIndex, const uint16_t ratio, const RKNetworkCodec codec) {
+    int p;
+    RKRayStreamBlock *block, *victim = NULL;
+    uint64_t h = ((uint64_t)(uintptr_t)ray >> 4) ^ ((uint64_t)productIndex << 40) ^ ((uint64_t)format << 48) ^ ((uint64_t)ratio << 52) ^ ((uint64_t)codec << 60);
+    h *= 0x9E3779B97F4A7C15ULL;
+    const uint32_t origin = (uint32_t)(h >> 32);
+
+    pthread_mutex_lock(&engine->rayStreamMutex);
+    for (p = 0; p < RKCommandCenterRayCacheProbe; p++) {
+        block = &engine->rayStreamBlocks[(origin + p) & (RKCommandCenterRayCacheDepth - 1)];
+        if (block->ray == ray && block->identifier == ray->header.i && block->format == format &&
+            block->productIndex == productIndex && block->downSamplingRatio == ratio && block->codec == codec) {
+            if (!block->ready) {
+                // Another user is encoding it, encoding locally is quicker than waiting
+                pthread_mutex_unlock(&engine->rayStreamMutex);
+                return NULL;
+            }
+            block->refCount++;
+            block->tic = ++engine->rayStreamTic;
+            engine->rayStreamHitCount++;
+            pthread_mutex_unlock(&engine->rayStreamMutex);
+            return block;
+        }
+        if (block->refCount == 0 && (victim == NULL || block->tic < victim->tic)) {
+            victim = block;
+        }
+    }
+    if (victim == NULL) {
+        pthread_mutex_unlock(&engine->rayStreamMutex);
+        return NULL;
+    }
+    // Claim the block, it is not shared until the encoded payload is published
+    victim->ray = ray;
+    victim->identifier = ray->header.i;
+    victim->format = format;
+    victim->productIndex = productIndex;
+    victim->downSamplingRatio = ratio;
+    victim->codec = codec;
+    victim->refCount = 1;
+    victim->ready = false;
+    victim->tic = ++engine->rayStreamTic;
+    pthread_mutex_unlock(&engine->rayStreamMutex);
+
+    // Encode without holding up the other users
+    size_t grown = 0;
+    const uint32_t capacity = (uint32_t)rayStreamBlockCapacity(ray, ratio, codec);
+    if (victim->capacity < capacity) {
+        void *data = realloc(victim->data, capacity);
+        if (data == NULL) {
+            pthread_mutex_lock(&engine->rayStreamMutex);
+            victim->ray = NULL;
+            victim->refCount = 0;
+            pthread_mutex_unlock(&engine->rayStreamMutex);
+            return NULL;
+        }
+        grown = capacity - victim->capacity;
+        victim->data = data;
+        victim->capacity = capacity;
+    }
+    victim->size = encodeRayStreamBlockWithCodec(victim->data, ray, format, productIndex, ratio, codec);
+
+    pthread_mutex_lock(&engine->rayStreamMutex);
+    victim->ready = true;
+    engine->rayStreamMissCount++;
+    pthread_mutex_unlock(&engine->rayStreamMutex);
+    if (grown) {
+        pthread_mutex_lock(&engine->mutex);
+        engine->memoryUsage += grown;
+        pthread_mutex_unlock(&engine->mutex);
+    }
+    return victim;
+}
+
+static void releaseRayStreamBlock(RKCommandCenter *engine, RKRayStreamBlock *block) {
+    pthread_mutex_lock(&engine->rayStreamMutex);
+    block->refCount--;
+    pthread_mutex_unlock(&engine->rayStreamMutex);
+}
+
+// Copy the down-sampled ray header for the user to fill in the product list
+static void copyRayStreamHeader(RKCommandCenter *engine, RKUser *user, RKRay *ray, const RKRayStreamFormat format, void *destination) {
+    RKRayStreamBlock *block = acquireRayStreamBlock(engine, ray, format, RKProductIndexCount, user->rayDownSamplingRatio, RKNetworkCodecNone);
+    if (block) {
+        memcpy(destination, block->data, block->size);
+        releaseRayStreamBlock(engine, block);
+    } else {
+        encodeRayStreamBlock(destination, ray, format, RKProductIndexCount, user->rayDownSamplingRatio);
+    }
+}
+
+// Send a ray with the header and the down-sampled products, encoded locally only when every candidate block is being sent
+static ssize_t sendRayStream(RKCommandCenter *engine, RKOperator *O, RKUser *user, RKRay *ray, const void *header, const uint32_t headerSize,
+                             const RKRayStreamFormat format, const RKProductIndex *productIndices, const int productCount) {
+    int k;
+    ssize_t size;
+    char *string = NULL;
+    struct iovec vectors[RKProductIndexCount + 2];
+    RKRayStreamBlock *blocks[RKProductIndexCount];
+    const RKNetworkCodec codec = user->codec;
+    const uint16_t ratio = user->rayDownSamplingRatio;
+    const size_t capacity = rayStreamBlockCapacity(ray, ratio, codec);
+    const uint32_t rawSize = ray->header.gateCount / ratio * (format == RKRayStreamFormatFloat ? sizeof(float) : sizeof(uint8_t));
+
+    uint32_t payloadSize = 0;
+    for (k = 0; k < productCount; k++) {
+        blocks[k] = acquireRayStreamBlock(engine, ray, format, productIndices[k], ratio, codec);
+        if (blocks[k]) {
+            vectors[k + 2].iov_base = blocks[k]->data;
+            vectors[k + 2].iov_len = blocks[k]->size;
+        } else {
+            if (string == NULL) {
+                if (!reserveUserBuffer(engine, user, (void **)&user->string, &user->stringCapacity, productCount * capacity)) {
+                    while (k-- > 0) {
+                        if (blocks[k]) {
+                            releaseRayStreamBlock(engine, blocks[k]);
+                        }
+                    }
+                    return RKResultFailedToAllocateUserBuffer;
+                }
+                string = user->string;
+            }
+            vectors[k + 2].iov_base = string + k * capacity;
+            vectors[k + 2].iov_len = encodeRayStreamBlockWithCodec(vectors[k + 2].iov_base, ray, format, productIndices[k], ratio, codec);
+        }
+        payloadSize += (uint32_t)vectors[k + 2].iov_len;
+    }
+
+    O->delimTx.type = RKNetworkPacketTypeRayDisplay;
+    O->delimTx.subtype = codec;
+    O->delimTx.size = headerSize + payloadSize;
+    O->delimTx.decodedSize = codec == RKNetworkCodecNone ? 0 : headerSize + productCount * rawSize;
+    vectors[0].iov_base = &O->delimTx;
+    vectors[0].iov_len = sizeof(RKNetDelimiter);
+    vectors[1].iov_base = (void *)header;
+    vectors[1].iov_len = headerSize;
+    // The delimiter, the header and the products straight from the shared blocks in one send
+    size = RKOperatorSendVector(O, vectors, productCount + 2, false);
+    O->delimTx.subtype = 0;
+    O->delimTx.decodedSize = 0;
+
+    for (k = 0; k < productCount; k++) {
+        if (blocks[k]) {
+            releaseRayStreamBlock(engine, blocks[k]);
+        }
+    }
+    return size;
+}
+
+// Select the codec of the product and display streams, e.g., "e deflate", "e delta" or "e none"
+static void setUserCodec(RKCommandCenter *engine, RKOperator *O, RKUser *user, const char *string) {
+    while (*string == ' ') {
+        string++;
+    }
+    const RKNetworkCodec codec = RKNetworkCodecFromString(string);
+    if (codec >= RKNetworkCodecCount) {
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "NAK. Unknown codec '%s'." RKEOL, string);
+    } else {
+        pthread_mutex_lock(&user->mutex);
+        user->codec = codec;
+        pthread_mutex_unlock(&user->mutex);
+        RKLog("%s %s Ray stream codec %s\n", engine->name, O->name, RKNetworkCodecString(codec));
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "ACK. Ray stream codec %s." RKEOL, RKNetworkCodecString(codec));
+    }
+    RKOperatorSendCommandResponse(O, user->commandResponse);
+}
+
+static const char *streamPolicyString(const RKStreamPolicy policy) {
+    return policy == RKStreamPolicySkipToCurrent ? "skip" : (policy == RKStreamPolicyDownsample ? "downsample" : "drop");
+}
+
+// Report the streaming users, or select the stream policy of this user with optional budget (kB) and lag limit (s),
+// e.g., "u", "u skip" or "u downsample 256 5"
+static void setUserStreamPolicy(RKCommandCenter *engine, RKOperator *O, RKUser *user, const char *string) {
+    int j, k;
+    char word[RKNameLength] = "";
+    int budget = 0;
+    float lagLimit = 0.0f;
+    RKServer *M = engine->server;
+    RKStreamPolicy policy = RKStreamPolicyCount;
+
+    if (sscanf(string, "%31s %d %f", word, &budget, &lagLimit) < 1) {
+        // A list of all users
+        j = snprintf(user->commandResponse, RKCommandCenterResponseSize, "{\"type\": \"users\", \"users\": [");
+        pthread_mutex_lock(&M->lock);
+        for (k = 0; k < M->maxClient && j < RKCommandCenterResponseSize - 256; k++) {
+            RKUser *other = &engine->users[k];
+            RKOperator *operator = M->operators[k];
+            if (operator == NULL || other->radar == NULL) {
+                continue;
+            }
+            j += snprintf(user->commandResponse + j, RKCommandCenterResponseSize - j,
+                          "%s{\"ip\": \"%s\", \"iid\": %d, \"policy\": \"%s\", \"budget\": %u, \"queue\": %zu, "
+                          "\"lag\": %.2f, \"stride\": %u, \"drops\": %llu, \"rate\": %.0f}",
+                          j > 36 ? ", " : "", operator->ip, operator->iid, streamPolicyString(other->streamPolicy), other->streamBudget,
+                          RKOperatorGetQueueDepth(operator), other->streamLag, other->rayStride, (unsigned long long)other->rayDropCount, other->sendRate);
+        }
+        pthread_mutex_unlock(&M->lock);
+        snprintf(user->commandResponse + j, RKCommandCenterResponseSize - j, "]}" RKEOL);
+        RKOperatorSendCommandResponse(O, user->commandResponse);
+        return;
+    }
+    if (!strcmp(word, "drop") || !strcmp(word, "0")) {
+        policy = RKStreamPolicyDropOldest;
+    } else if (!strcmp(word, "skip") || !strcmp(word, "1")) {
+        policy = RKStreamPolicySkipToCurrent;
+    } else if (!strcmp(word, "downsample") || !strcmp(word, "2")) {
+        policy = RKStreamPolicyDownsample;
+    }
+    if (policy == RKStreamPolicyCount) {
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "NAK. Unknown stream policy '%s'." RKEOL, word);
+    } else {
+        pthread_mutex_lock(&user->mutex);
+        user->streamPolicy = policy;
+        user->rayStride = 1;
+        if (budget > 0) {
+            // In kilobytes, the server stops calling the stream handler beyond RKServerStreamQueueLimit anyway
+            user->streamBudget = (uint32_t)MIN((size_t)budget * 1024, RKServerStreamQueueLimit);
+        }
+        if (lagLimit > 0.0f) {
+            user->streamLagLimit = lagLimit;
+        }
+        pthread_mutex_unlock(&user->mutex);
+        RKLog("%s %s Stream policy %s   budget = %s B   lag limit = %.1f s\n", engine->name, O->name, streamPolicyString(policy),
+              RKIntegerToCommaStyleString(user->streamBudget), user->streamLagLimit);
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "ACK. Stream policy %s, budget %u B, lag limit %.1f s." RKEOL,
+                 streamPolicyString(policy), user->streamBudget, user->streamLagLimit);
+    }
+    RKOperatorSendCommandResponse(O, user->commandResponse);
+}
+
+// Decide which of the pending rays are not sent when the user has fallen behind endIndex by more than
+// streamLagLimit seconds, or by more than a fraction of the ray buffer
+static void applyStreamPolicy(RKCommandCenter *engine, RKOperator *O, RKUser *user, const uint32_t endIndex, const double time) {
+    RKBuffer rays = user->radar->rays;
+    const uint32_t depth = user->radar->desc.rayBufferDepth;
+    const uint32_t limit = MAX(1, depth / RKCommandCenterRayLagFraction);
+    const uint32_t lag = (endIndex + depth - user->rayIndex) % depth;
+    const double latest = RKGetRayFromBuffer(rays, endIndex)->header.startTimeDouble;
+    uint32_t index = user->rayIndex;
+    uint32_t skip = 0;
+
+    user->streamLag = lag ? latest - RKGetRayFromBuffer(rays, index)->header.startTimeDouble : 0.0;
+
+    if (user->streamPolicy == RKStreamPolicyDownsample && time - user->timeLastStride >= 1.0) {
+        if (user->streamLag > 0.5 * user->streamLagLimit && user->rayStride < RKCommandCenterMaxRayStride) {
+            user->rayStride *= 2;
+            user->timeLastStride = time;
+        } else if (user->streamLag < 0.125 * user->streamLagLimit && user->rayStride > 1 && RKOperatorGetQueueDepth(O) < user->streamBudget / 2) {
+            user->rayStride /= 2;
+            user->timeLastStride = time;
+        }
+    }
+    if (lag > limit || user->streamLag > user->streamLagLimit) {
+        if (user->streamPolicy == RKStreamPolicySkipToCurrent) {
+            skip = lag;
+        } else {
+            // Drop the oldest rays until the user is within the limits again
+            while (skip < lag && (lag - skip > limit || latest - RKGetRayFromBuffer(rays, index)->header.startTimeDouble > user->streamLagLimit)) {
+                index = RKNextModuloS(index, depth);
+                skip++;
+            }
+        }
+    }
+    if (skip) {
+        user->rayIndex = (user->rayIndex + skip) % depth;
+        user->rayDropCount += skip;
+        if (engine->verbose > 1) {
+            RKLog("%s %s Behind by %s rays (%.1f s), dropped %s (%s).\n", engine->name, O->name,
+                  RKIntegerToCommaStyleString(lag), user->streamLag, RKIntegerToCommaStyleString(skip), streamPolicyString(user->streamPolicy));
+        }
+    }
+}
+
+// Post the streaming users of each radar to its health node, at most once a second unless forced
+static void reportStreamHealth(RKCommandCenter *engine, const double time, const bool force) {
+    int j, k, count, behind;
+    size_t queue;
+    double rate;
+    uint64_t drops;
+    RKServer *M = engine->server;
+
+    if ((!force && time - engine->timeLastHealthOut < 1.0) || pthread_mutex_trylock(&engine->mutex)) {
+        return;
+    }
+    engine->timeLastHealthOut = time;
+    pthread_mutex_lock(&engine->rayStreamMutex);
+    const uint64_t hits = engine->rayStreamHitCount;
+    const uint64_t misses = engine->rayStreamMissCount;
+    pthread_mutex_unlock(&engine->rayStreamMutex);
+    for (j = 0; j < engine->radarCount; j++) {
+        RKRadar *radar = engine->radars[j];
+        if (engine->healthNodes[j] == RKHealthNodeInvalid) {
+            continue;
+        }
+        count = 0;
+        behind = 0;
+        queue = 0;
+        rate = 0.0;
+        drops = 0;
+        pthread_mutex_lock(&M->lock);
+        for (k = 0; k < M->maxClient; k++) {
+            RKUser *user = &engine->users[k];
+            if (M->operators[k] == NULL || user->radar != radar) {
+                continue;
+            }
+            const size_t depth = RKOperatorGetQueueDepth(M->operators[k]);
+            count++;
+            queue += depth;
+            rate += user->sendRate;
+            drops += user->rayDropCount;
+            if (user->rayStride > 1 || depth >= user->streamBudget) {
+                behind++;
+            }
+        }
+        pthread_mutex_unlock(&M->lock);
+        RKHealth *health = RKGetVacantHealth(radar, engine->healthNodes[j]);
+        if (health == NULL) {
+            continue;
+        }
+        snprintf(health->string, RKMaximumStringLength,
+                 "{\"Stream Users\":{\"Value\":\"%d (%d behind)\",\"Enum\":%d}, "
+                 "\"Stream Queue\":{\"Value\":\"%s B\",\"Enum\":0}, "
+                 "\"Stream Rate\":{\"Value\":\"%s B/s\",\"Enum\":0}, "
+                 "\"Stream Drops\":{\"Value\":\"%s\",\"Enum\":%d}, "
+                 "\"Stream Cache\":{\"Value\":\"%s hit / %s miss\",\"Enum\":0}}",
+                 count, behind, behind ? RKStatusEnumStandby : RKStatusEnumNormal,
+                 RKIntegerToCommaStyleString(queue),
+                 RKIntegerToCommaStyleString((long)rate),
+                 RKIntegerToCommaStyleString(drops), drops > engine->rayDropCountLastHealth[j] ? RKStatusEnumStandby : RKStatusEnumNormal,
+                 RKUIntegerToCommaStyleString(hits), RKUIntegerToCommaStyleString(misses));
+        RKSetHealthReady(radar, health);
+        engine->rayDropCountLastHealth[j] = drops;
+    }
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+// Number of slots and the slot of the latest payload of a relay channel
+static uint32_t relayChannelDepth(RKRadar *radar, const RKRelayChannel channel) {
+    switch (channel) {
+        case RKRelayChannelStatus:
+            return radar->desc.statusBufferDepth;
+        case RKRelayChannelHealth:
+            return radar->desc.healthBufferDepth;
+        case RKRelayChannelRay:
+            return radar->desc.rayBufferDepth;
+        default:
+            return radar->desc.pulseBufferDepth;
+    }
+}
+
+static uint32_t relayChannelLatestIndex(RKRadar *radar, const RKRelayChannel channel) {
+    const bool processor = radar->desc.initFlags & RKInitFlagSignalProcessor;
+    switch (channel) {
+        case RKRelayChannelStatus:
+            return RKPreviousModuloS(radar->statusIndex, radar->desc.statusBufferDepth);
+        case RKRelayChannelHealth:
+            return RKPreviousModuloS(radar->healthIndex, radar->desc.healthBufferDepth);
+        case RKRelayChannelRay:
+            // Rays of a signal processor are not finished in order, stay a few behind as the ray streams do
+            return RKPreviousNModuloS(radar->rayIndex, processor ? 2 * radar->momentEngine->coreCount : 1, radar->desc.rayBufferDepth);
+        default:
+            return RKPreviousNModuloS(radar->pulseIndex, processor ? 2 * radar->pulseEngine->coreCount : 1, radar->desc.pulseBufferDepth);
+    }
+}
+
+// Identifier of the payload in a slot of a relay channel and whether it is ready to go
+static RKIdentifier relayChannelIdentifier(RKRadar *radar, const RKRelayChannel channel, const uint32_t index, bool *ready) {
+    RKRay *ray;
+    RKPulse *pulse;
+    switch (channel) {
+        case RKRelayChannelStatus:
+            *ready = radar->status[index].flag == RKStatusFlagReady;
+            return radar->status[index].i;
+        case RKRelayChannelHealth:
+            *ready = radar->healths[index].flag == RKHealthFlagReady;
+            return radar->healths[index].i;
+        case RKRelayChannelRay:
+            // A ray may be released to vacant after its sweep is concluded, it is intact until the slot is reused
+            ray = RKGetRayFromBuffer(radar->rays, index);
+            *ready = !(ray->header.s & RKRayStatusProcessing);
+            return ray->header.i;
+        default:
+            pulse = RKGetPulseFromBuffer(radar->pulses, index);
+            *ready = pulse->header.s & RKPulseStatusProcessed;
+            return pulse->header.i;
+    }
+}
+
+// Continue a relay channel from identifier if it is still in the buffer, otherwise from the latest payload
+static bool resumeRelayChannel(RKUser *user, const RKRelayChannel channel, const bool resume, const RKIdentifier identifier) {
+    bool ready;
+    RKRadar *radar = user->radar;
+    const uint32_t depth = relayChannelDepth(radar, channel);
+    uint32_t index = (uint32_t)(identifier % depth);
+    if (resume && relayChannelIdentifier(radar, channel, index, &ready) == identifier) {
+        user->relayIndices[channel] = index;
+        user->relaySequences[channel] = identifier;
+        return true;
+    }
+    index = relayChannelLatestIndex(radar, channel);
+    const RKIdentifier latest = relayChannelIdentifier(radar, channel, index, &ready);
+    // A slot that has never been filled carries a negative identifier, the buffer has not wrapped so start from the top
+    if ((int64_t)latest < 0) {
+        user->relayIndices[channel] = 0;
+        user->relaySequences[channel] = 0;
+    } else {
+        user->relayIndices[channel] = index;
+        user->relaySequences[channel] = latest;
+    }
+    return false;
+}
+
+// Switch to relay frames with the streams, the codec, the priority of each channel and the next identifier of each
+// channel to resume from, '-' for the latest, e.g., "R !hzvwdprki 2 0123 1024,-,88200,-"
+static void setUserRelay(RKCommandCenter *engine, RKOperator *O, RKUser *user, const char *string) {
+    int j, k;
+    char streams[RKNameLength] = "";
+    char codecString[RKNameLength] = "none";
+    char priorities[RKNameLength] = "0123";
+    char sequences[RKMaximumStringLength] = "";
+    char *token, *last = NULL;
+    bool resumed[RKRelayChannelCount];
+
+    if (sscanf(string, "%31s %31s %31s %1023s", streams, codecString, priorities, sequences) < 1) {
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "NAK. Relay needs streams, e.g., R !hzvwdprki." RKEOL);
+        RKOperatorSendCommandResponse(O, user->commandResponse);
+        return;
+    }
+    const RKNetworkCodec codec = RKNetworkCodecFromString(codecString);
+    if (codec >= RKNetworkCodecCount) {
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "NAK. Unknown codec '%s'." RKEOL, codecString);
+        RKOperatorSendCommandResponse(O, user->commandResponse);
+        return;
+    }
+
+    pthread_mutex_lock(&user->mutex);
+    user->streams = RKStreamFromString(streams);
+    user->streamsInProgress = RKStreamNull;
+    user->codec = codec;
+    token = strtok_r(sequences, ",", &last);
+    for (k = 0; k < RKRelayChannelCount; k++) {
+        user->relayPriorities[k] = k < strlen(priorities) && isdigit(priorities[k]) ? MIN(priorities[k] - '0', RKRelayChannelCount - 1) : k;
+        resumed[k] = resumeRelayChannel(user, k, token != NULL && isdigit(*token), token ? strtoull(token, NULL, 10) : 0);
+        user->relayDropCounts[k] = 0;
+        token = strtok_r(NULL, ",", &last);
+    }
+    user->relay = true;
+    pthread_mutex_unlock(&user->mutex);
+
+    // Keep the socket small so that the frames of a low priority channel do not pile up ahead of the others
+    k = RKCommandCenterRelayQueueLimit;
+    setsockopt(O->sid, SOL_SOCKET, SO_SNDBUF, &k, sizeof(int));
+
+    j = snprintf(user->commandResponse, RKCommandCenterResponseSize, "{\"type\": \"relay\", \"streams\": 0x%lx, \"codec\": \"%s\", \"channels\": [",
+                 (unsigned long)user->streams, RKNetworkCodecString(codec));
+    for (k = 0; k < RKRelayChannelCount; k++) {
+        j += snprintf(user->commandResponse + j, RKCommandCenterResponseSize - j, "%s{\"priority\": %u, \"sequence\": %llu, \"resumed\": %s}",
+                      k ? ", " : "", user->relayPriorities[k], (unsigned long long)user->relaySequences[k], resumed[k] ? "true" : "false");
+    }
+    snprintf(user->commandResponse + j, RKCommandCenterResponseSize - j, "]}" RKEOL);
+    RKLog("%s %s Relay %s   codec = %s   priorities = %u%u%u%u   resumed = %d%d%d%d\n", engine->name, O->name,
+          RKStringOfStream(user->streams), RKNetworkCodecString(codec),
+          user->relayPriorities[0], user->relayPriorities[1], user->relayPriorities[2], user->relayPriorities[3],
+          resumed[0], resumed[1], resumed[2], resumed[3]);
+    RKOperatorSendCommandResponse(O, user->commandResponse);
+}
+
+// Send a relay frame, pieces[0] and pieces[1] are filled here, the payload follows as is or encoded as one piece
+static ssize_t sendRelayFrame(RKCommandCenter *engine, RKOperator *O, RKUser *user, RKRelayFrameHeader *frame, struct iovec *pieces, int count) {
+    int k;
+    size_t size = 0, encodedSize = 0;
+    for (k = 2; k < count; k++) {
+        size += pieces[k].iov_len;
+    }
+    frame->codec = RKNetworkCodecNone;
+    frame->decodedSize = (uint32_t)size;
+    if (user->codec != RKNetworkCodecNone &&
+        reserveUserBuffer(engine, user, (void **)&user->scratch, &user->scratchCapacity, size) &&
+        reserveUserBuffer(engine, user, (void **)&user->string, &user->stringCapacity, RKNetworkCodecBound(user->codec, size))) {
+        for (k = 2, size = 0; k < count; k++) {
+            memcpy(user->scratch + size, pieces[k].iov_base, pieces[k].iov_len);
+            size += pieces[k].iov_len;
+        }
+        encodedSize = RKNetworkEncode(user->string, user->stringCapacity, user->scratch, size, frame->stride, user->codec);
+        // Keep the raw payload if it does not get any smaller
+        if (encodedSize > 0 && encodedSize < size) {
+            frame->codec = user->codec;
+            pieces[2].iov_base = user->string;
+            pieces[2].iov_len = encodedSize;
+            count = 3;
+            size = encodedSize;
+        }
+    }
+    O->delimTx.type = RKNetworkPacketTypeRelayFrame;
+    O->delimTx.subtype = frame->channel;
+    O->delimTx.size = (uint32_t)(sizeof(RKRelayFrameHeader) + size);
+    pieces[0].iov_base = &O->delimTx;
+    pieces[0].iov_len = sizeof(RKNetDelimiter);
+    pieces[1].iov_base = frame;
+    pieces[1].iov_len = sizeof(RKRelayFrameHeader);
+    const ssize_t r = RKOperatorSendVector(O, pieces, count, false);
+    O->delimTx.subtype = 0;
+    return r;
+}
+
+// Send the payload in a slot of a relay channel
+static ssize_t sendRelayPayload(RKCommandCenter *engine, RKOperator *O, RKUser *user, const RKRelayChannel channel, const uint32_t index) {
+    int count = 2;
+    RKRay *ray;
+    RKPulse *pulse;
+    RKRayHeader rayHeader;
+    RKPulseHeader pulseHeader;
+    RKRelayFrameHeader frame;
+    struct iovec pieces[RKProductIndexCount + 3];
+    RKRadar *radar = user->radar;
+
+    memset(&frame, 0, sizeof(RKRelayFrameHeader));
+    frame.channel = channel;
+    frame.sequence = user->relaySequences[channel];
+    frame.stride = 1;
+    switch (channel) {
+        case RKRelayChannelStatus:
+            frame.type = RKNetworkPacketTypeProcessorStatus;
+            pieces[count].iov_base = &radar->status[index];
+            pieces[count++].iov_len = sizeof(RKStatus);
+            break;
+        case RKRelayChannelHealth:
+            frame.type = RKNetworkPacketTypeHealth;
+            pieces[count].iov_base = radar->healths[index].string;
+            pieces[count++].iov_len = strnlen(radar->healths[index].string, RKMaximumStringLength - 1) + 1;
+            break;
+        case RKRelayChannelRay:
+            // The header and the uint8 display products at full resolution, RKProductList bit k is RKProductIndex k
+            ray = RKGetRayFromBuffer(radar->rays, index);
+            memcpy(&rayHeader, &ray->header, sizeof(RKRayHeader));
+            rayHeader.productList = (RKProductList)((user->streams & RKStreamDisplayAll) >> 16);
+            frame.type = RKNetworkPacketTypeRayDisplay;
+            pieces[count].iov_base = &rayHeader;
+            pieces[count++].iov_len = sizeof(RKRayHeader);
+            uint32_t productList = rayHeader.productList;
+            while (productList) {
+                const RKProductIndex productIndex = (RKProductIndex)__builtin_ctz(productList);
+                productList &= productList - 1;
+                pieces[count].iov_base = RKGetUInt8DataFromRay(ray, productIndex);
+                pieces[count++].iov_len = ray->header.gateCount * sizeof(uint8_t);
+            }
+            break;
+        default:
+            pulse = RKGetPulseFromBuffer(radar->pulses, index);
+            memcpy(&pulseHeader, &pulse->header, sizeof(RKPulseHeader));
+            frame.type = RKNetworkPacketTypePulseData;
+            frame.stride = sizeof(RKInt16C);
+            pieces[count].iov_base = &pulseHeader;
+            pieces[count++].iov_len = sizeof(RKPulseHeader);
+            pieces[count].iov_base = RKGetInt16CDataFromPulse(pulse, 0);
+            pieces[count++].iov_len = pulse->header.gateCount * sizeof(RKInt16C);
+            pieces[count].iov_base = RKGetInt16CDataFromPulse(pulse, 1);
+            pieces[count++].iov_len = pulse->header.gateCount * sizeof(RKInt16C);
+            break;
+    }
+    return sendRelayFrame(engine, O, user, &frame, pieces, count);
+}
+
+// Send what is new in every relay channel, most important first. A channel of priority p is held back while the
+// write queue is deeper than RKCommandCenterRelayQueueLimit >> p so that a burst of pulses never piles up in
+// front of the health and the rays. A channel that has been overwritten skips ahead and counts the drops.
+static void sendRelayChannels(RKCommandCenter *engine, RKOperator *O, RKUser *user, const double time) {
+    int p, c;
+    bool ready;
+    int64_t lag;
+    RKIdentifier identifier;
+    RKRadar *radar = user->radar;
+    const RKStream wanted[RKRelayChannelCount] = {
+        RKStreamStatusProcessorStatus,
+        RKStreamHealthInJSON,
+        RKStreamDisplayAll,
+        RKStreamDisplayIQ | RKStreamProductIQ
+    };
+
+    for (p = 0; p < RKRelayChannelCount; p++) {
+        for (c = 0; c < RKRelayChannelCount; c++) {
+            if (user->relayPriorities[c] != p || !(user->streams & user->access & wanted[c])) {
+                continue;
+            }
+            const uint32_t depth = relayChannelDepth(radar, c);
+            const size_t limit = RKCommandCenterRelayQueueLimit >> p;
+            while (RKOperatorGetUnsentSize(O) < limit && engine->server->state == RKServerStateActive) {
+                identifier = relayChannelIdentifier(radar, c, user->relayIndices[c], &ready);
+                lag = (int64_t)(identifier - user->relaySequences[c]);
+                if (lag > 0) {
+                    // Overwritten, continue from here, the following slots are newer still
+                    user->relayDropCounts[c] += lag;
+                    if (c == RKRelayChannelRay) {
+                        user->rayDropCount += lag;
+                    }
+                    user->relaySequences[c] = identifier;
+                } else if (lag < 0) {
+                    break;
+                }
+                if (!ready || sendRelayPayload(engine, O, user, c, user->relayIndices[c]) < 0) {
+                    break;
+                }
+                user->relaySequences[c]++;
+                user->relayIndices[c] = RKNextModuloS(user->relayIndices[c], depth);
+                user->timeLastOut = time;
+            }
+        }
+    }
+}
+
+// Re-evaluate td = time - user->timeLastOut; send a beacon if nothing has been sent for a while
+static void sendBeaconIfIdle(RKCommandCenter *engine, RKOperator *O, RKUser *user, const double time) {
+    if (time - user->timeLastOut >= 1.0) {
+        if (O->beacon.type != RKNetworkPacketTypeBeacon) {
+            RKLog("Beacon has been changed %d\n", O->beacon.type);
+        }
+        if (engine->verbose > 1) {
+            RKLog("%s %s Beacon\n", engine->name, O->name);
+        }
+        ssize_t size = RKOperatorSendBeacon(O);
+        user->timeLastOut = time;
+        if (size < 0) {
+            RKLog("Beacon failed (r = %d).\n", size);
+            RKOperatorHangUp(O);
+        }
+    }
+}
+
+// Keep the commands from here on for the next call of the command handler
+static int deferCommands(RKOperator *O, const char *commandString) {
+    while (*commandString == ' ' || *commandString == '\r' || *commandString == '\n' || *commandString == '\t') {
+        commandString++;
+    }
+    if (*commandString == '\0') {
+        return RKResultSuccess;
+    }
+    memmove(O->cmd, commandString, strlen(commandString) + 1);
+    return RKResultCommandDeferred;
+}
+
+// Send the response of the executor once it is done, the user may send more commands after that
+static void sendJobResponse(RKCommandCenter *engine, RKOperator *O, RKUser *user) {
+    bool done = false;
+    pthread_mutex_lock(&engine->executorMutex);
+    if (user->job == RKUserJobDone) {
+        snprintf(user->commandResponse, RKCommandCenterResponseSize, "%s", user->jobResponse);
+        user->job = RKUserJobNone;
+        done = true;
+    }
+    pthread_mutex_unlock(&engine->executorMutex);
+    if (done) {
+        RKOperatorSendCommandResponse(O, user->commandResponse);
+    }
+}
+
+// Take the products of the sweep from PyRadarKit as they arrive, returns true when all of them are in
+static bool receiveUserProducts(RKCommandCenter *engine, RKOperator *O, RKUser *user) {
+    ssize_t size;
+    RKProduct *product;
+    RKProductId productId;
+    RKIdentifier identifier;
+    struct timeval timevalRx;
+    double deltaTx, deltaRx;
+
+    RKSweep *sweep = user->sweep;
+
+    while (user->sweepProductCount < user->productCount) {
+        const int k = user->sweepProductCount;
+        if (user->sweepPayload == NULL) {
+            size = RKServerReceiveUserPayloadNonBlocking(O, user->payload, RKNetworkMessageFormatHeaderDefinedSize);
+            if (size == RKServerPayloadIncomplete) {
+                return false;
+            }
+            if (size < 0) {
+                RKLog("%s %s Error. Failed receiving user product header ...\n", engine->name, O->name);
+                user->sweepProductCount++;
+                continue;
+            }
+            productId = RKProductIdFromString(RKGetValueOfKey(user->payload, "productId"));
+            identifier = RKIdentifierFromString(RKGetValueOfKey(user->payload, "configId"));
+            if (user->productIds[k] != productId) {
+                RKLog("%s %s Warning. Inconsistent productId = %d (expected) != %d (reported)\n", engine->name, O->name, user->productIds[k], productId);
+                user->sweepProductCount++;
+                continue;
+            } else if (sweep->header.config.i != identifier) {
+                RKLog("%s %s Warning. Inconsistent configId = %lu (expected) != %lu (reported)\n", engine->name, O->name, sweep->header.config.i, identifier);
+                user->sweepProductCount++;
+                continue;
+            }
+            if (user->radar->sweepEngine->verbose > 1) {
+                RKLog("%s %s %s (%d) -> %u %zu\n",
+                      engine->name, O->name, user->payload, strlen(user->payload), productId, identifier);
+            }
+            product = RKSweepEngineGetVacantProduct(user->radar->sweepEngine, sweep, productId);
+            if (product) {
+                // Transfer important meta data and prepare the necessary buffer size
+                RKProductInitFromSweep(product, sweep);
+                user->sweepProduct = product;
+                user->sweepPayload = product->data;
+            } else {
+                // Still need to consume this packet so we dump it to the payload storage
+                RKLog("Warning. Unable to retrieve storage for incoming sweep.\n");
+                user->sweepPayload = user->payload;
+            }
+        }
+        size = RKServerReceiveUserPayloadNonBlocking(O, user->sweepPayload, RKNetworkMessageFormatHeaderDefinedSize);
+        if (size == RKServerPayloadIncomplete) {
+            return false;
+        }
+        if ((product = user->sweepProduct) != NULL) {
+            RKShowArray(product->data, product->desc.symbol, product->header.gateCount, product->header.rayCount);
+            RKSweepEngineSetProductComplete(user->radar->sweepEngine, sweep, product);
+        }
+        if (size < 0) {
+            RKLog("%s %s Error. Failed receiving user product data ...\n", engine->name, O->name);
+        }
+        user->sweepProduct = NULL;
+        user->sweepPayload = NULL;
+        user->sweepProductCount++;
+    }
+
+    gettimeofday(&timevalRx, NULL);
+
+    deltaTx = 1.0e3 * RKTimevalDiff(user->timevalSweepTx, user->timevalSweepOrigin);
+    deltaRx = 1.0e3 * RKTimevalDiff(timevalRx, user->timevalSweepTx);
+    RKLog("%s %s Round trip finished   %s ms   %s ms\n", engine->name, O->name,
+          RKVariableInString("tx", &deltaTx, RKValueTypeDouble),
+          RKVariableInString("rx", &deltaRx, RKValueTypeDouble));
+
+    RKSweepFree(sweep);
+    user->sweep = NULL;
+    return true;
+}
+
+// Give up on the products of the sweep, the user is leaving
+static void abandonUserProducts(RKUser *user) {
+    if (user->sweep == NULL) {
+        return;
+    }
+    if (user->sweepProduct) {
+        RKSweepEngineSetProductComplete(user->radar->sweepEngine, user->sweep, user->sweepProduct);
+    }
+    RKSweepFree(user->sweep);
+    user->sweep = NULL;
+    user->sweepProduct = NULL;
+    user->sweepPayload = NULL;
+}
+
+#pragma mark - Executor
+
+// Run the commands that take a while, one at a time, away from the workers of the server
+static void *commandExecutor(void *in) {
+    RKCommandCenter *engine = (RKCommandCenter *)in;
+
+    int k;
+    RKUser *user;
+    RKRadar *radar;
+    RKCommand command;
+    char *response = (char *)malloc(RKCommandCenterResponseSize);
+    if (response == NULL) {
+        RKLog("%s Error. Unable to allocate the executor response.\n", engine->name);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&engine->executorMutex);
+    while (engine->executorActive) {
+        for (k = 0; k < RKCommandCenterMaxConnections; k++) {
+            if (engine->users[k].job == RKUserJobPosted) {
+                break;
+            }
+        }
+        if (k == RKCommandCenterMaxConnections) {
+            pthread_cond_wait(&engine->executorPosted, &engine->executorMutex);
+            continue;
+        }
+        user = &engine->users[k];
+        user->job = RKUserJobRunning;
+        memcpy(command, user->jobCommand, sizeof(RKCommand));
+        radar = user->radar;
+        pthread_mutex_unlock(&engine->executorMutex);
+
+        if (radar == NULL) {
+            sprintf(response, "NAK. No radar." RKEOL);
+        } else {
+            // Reset the radar engines, the streams of the users were suspended by socketCommandHandler()
+            RKExecuteCommand(radar, command, response);
+
+            if (engine->verbose) {
+                RKLog("%s Skipping to current ...\n", engine->name);
+            }
+            RKCommandCenterSkipToCurrent(engine, radar);
+
+            for (k = 0; k < RKCommandCenterMaxConnections; k++) {
+                if (engine->users[k].radar == radar && engine->users[k].streamsToRestore != RKStreamNull) {
+                    pthread_mutex_lock(&engine->users[k].mutex);
+                    engine->users[k].streams = engine->users[k].streamsToRestore;
+                    engine->users[k].streamsToRestore = RKStreamNull;
+                    pthread_mutex_unlock(&engine->users[k].mutex);
+                }
+            }
+        }
+
+        // The user could have left while the command was running
+        pthread_mutex_lock(&engine->executorMutex);
+        if (user->job == RKUserJobRunning) {
+            snprintf(user->jobResponse, RKMaximumStringLength, "%s", response);
+            user->job = RKUserJobDone;
+        }
+    }
+    pthread_mutex_unlock(&engine->executorMutex);
+
+    free(response);
+    return NULL;
+}
+
 #pragma mark - Handlers
 
 int socketCommandHandler(RKOperator *O) {
@@ -77,13 +1017,21 @@ int socketCommandHandler(RKOperator *O) {
 
     int j, k;
 
+    // Commands wait until the executor is done with the previous one of this user
+    pthread_mutex_lock(&engine->executorMutex);
+    const RKUserJob job = user->job;
+    pthread_mutex_unlock(&engine->executorMutex);
+    if (job != RKUserJobNone) {
+        return RKResultCommandDeferred;
+    }
+
     char name[RKNameLength];
     memcpy(name, engine->name, RKNameLength);
 
-    j = snprintf(user->commandResponse, RKMaximumPacketSize - 256, "%s %d radar:", name, engine->radarCount);
+    j = snprintf(user->commandResponse, RKCommandCenterResponseSize - 256, "%s %d radar:", name, engine->radarCount);
     for (k = 0; k < MIN(4, engine->radarCount); k++) {
         RKRadar *radar = engine->radars[k];
-        j += snprintf(user->commandResponse + j, RKMaximumPacketSize - j, " %s", radar->desc.name);
+        j += snprintf(user->commandResponse + j, RKCommandCenterResponseSize - j, " %s", radar->desc.name);
     }
 
     struct timeval t0;
@@ -118,22 +1066,14 @@ int socketCommandHandler(RKOperator *O) {
                 RKLog("%s %s Ping x %s\n", engine->name, O->name, RKIntegerToCommaStyleString(user->pingCount));
             }
             // There is no need to send a response. The delegate function socketStreamHandler sends a beacon periodically
-        } else if (user->radar == NULL) {
-            k = 0;
-            while (user->radar == NULL) {
-                usleep(100000);
-                if (++k % 10 == 0 && engine->verbose > 1) {
-                    RKLog("%s sleep 1/%.1f s   radar->state = 0x%04x\n", engine->name, (float)k * 0.1f, user->radar->state);
-                }
+        } else if (user->radar == NULL ||
+                   (user->radar->desc.initFlags & RKInitFlagSignalProcessor && !(user->radar->state & RKRadarStateLive))) {
+            // Try again when there is a live radar
+            if (commandStringEnd != NULL) {
+                *commandStringEnd = ';';
             }
+            return deferCommands(O, commandString);
         } else if (user->radar->desc.initFlags & RKInitFlagSignalProcessor) {
-            k = 0;
-            while (!(user->radar->state & RKRadarStateLive)) {
-                usleep(100000);
-                if (++k % 10 == 0 && engine->verbose > 1) {
-                    RKLog("%s sleep 1/%.1f s   radar->state = 0x%04x\n", engine->name, (float)k * 0.1f, user->radar->state);
-                }
-            }
             user->commandCount++;
             if (*commandString >= '!' && *commandString <= 'z') {
                 RKLog("%s %s Received command '%s%s%s' (%p)\n",
@@ -183,47 +1123,39 @@ int socketCommandHandler(RKOperator *O) {
 
                 case 'd':
                     // DSP related
-                    switch (commandString[commandString[1] == ' ' ? 2 : 1]) {
-                        case 'r':
-                            // Suspend all user streams
-                            for (k = 0; k < RKCommandCenterMaxConnections; k++) {
-                                if (engine->users[k].radar == user->radar && engine->users[k].streams != RKStreamNull) {
-                                    pthread_mutex_lock(&engine->users[k].mutex);
-                                    engine->users[k].streamsToRestore = engine->users[k].streams;
-                                    engine->users[k].streams = RKStreamNull;
-                                    engine->users[k].streamsInProgress = RKStreamNull;
-                                    pthread_mutex_unlock(&engine->users[k].mutex);
-                                }
-                            }
-
-                            // Reset the radar engines
-                            RKExecuteCommand(user->radar, commandString, user->commandResponse);
-
-                            // Wait until socketStreamHandler to run another iteration
-                            uint64_t tic = user->tic;
-                            do {
-                                usleep(100000);
-                            } while (tic == user->tic);
-
-                            RKLog("%s %s Skipping to current ...", engine->name, O->name);
-                            RKCommandCenterSkipToCurrent(engine, user->radar);
-
-                            for (k = 0; k < RKCommandCenterMaxConnections; k++) {
-                                if (engine->users[k].radar == user->radar && engine->users[k].streamsToRestore != RKStreamNull) {
-                                    pthread_mutex_lock(&engine->users[k].mutex);
-                                    engine->users[k].streams = engine->users[k].streamsToRestore;
-                                    engine->users[k].streamsToRestore = RKStreamNull;
-                                    pthread_mutex_unlock(&engine->users[k].mutex);
-                                }
-                            }
-                            break;
-                        default:
-                            RKExecuteCommand(user->radar, commandString, user->commandResponse);
+                    if (commandString[commandString[1] == ' ' ? 2 : 1] == 'r') {
+                        if (!engine->executorActive) {
+                            sprintf(user->commandResponse, "NAK. Executor not running." RKEOL);
+                            RKOperatorSendCommandResponse(O, user->commandResponse);
                             break;
+                        }
+                        // Suspend all user streams, a stream handler that is running finishes before the mutex is ours
+                        for (k = 0; k < RKCommandCenterMaxConnections; k++) {
+                            if (engine->users[k].radar == user->radar && engine->users[k].streams != RKStreamNull) {
+                                pthread_mutex_lock(&engine->users[k].mutex);
+                                engine->users[k].streamsToRestore = engine->users[k].streams;
+                                engine->users[k].streams = RKStreamNull;
+                                engine->users[k].streamsInProgress = RKStreamNull;
+                                pthread_mutex_unlock(&engine->users[k].mutex);
+                            }
+                        }
+                        // The executor resets the radar engines and restores the streams, socketStreamHandler() sends the response
+                        pthread_mutex_lock(&engine->executorMutex);
+                        snprintf(user->jobCommand, sizeof(RKCommand), "%s", commandString);
+                        user->job = RKUserJobPosted;
+                        pthread_cond_signal(&engine->executorPosted);
+                        pthread_mutex_unlock(&engine->executorMutex);
+                        return deferCommands(O, commandStringEnd == NULL ? "" : commandStringEnd + 1);
                     }
+                    RKExecuteCommand(user->radar, commandString, user->commandResponse);
                     RKOperatorSendCommandResponse(O, user->commandResponse);
                     break;
 
+                case 'e':
+                    // Encoding of the ray streams
+                    setUserCodec(engine, O, user, commandString + 1);
+                    break;
+
                 case 'i':
                     O->delimTx.type = RKNetworkPacketTypeRadarDescription;
                     O->delimTx.size = (uint32_t)sizeof(RKRadarDesc);
@@ -293,6 +1225,16 @@ int socketCommandHandler(RKOperator *O) {
                     RKOperatorSendCommandResponse(O, user->commandResponse);
                     break;
 
+                case 'u':
+                    // Streaming users, or the stream policy of this user
+                    setUserStreamPolicy(engine, O, user, commandString + 1);
+                    break;
+
+                case 'R':
+                    // Relay frames, usually from RKRadarRelay
+                    setUserRelay(engine, O, user, commandString + 1);
+                    break;
+
                 default:
                     RKExecuteCommand(user->radar, commandString, user->commandResponse);
                     RKOperatorSendCommandResponse(O, user->commandResponse);
@@ -306,12 +1248,23 @@ int socketCommandHandler(RKOperator *O) {
                     O->delimTx.type = RKNetworkPacketTypeControls;
                     O->delimTx.size = (uint32_t)strlen(user->commandResponse);
                     RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), user->commandResponse, O->delimTx.size, NULL);
+                    break;
+
+                case 'e':
+                    // Encoding of the ray streams, handled locally
+                    setUserCodec(engine, O, user, commandString + 1);
+                    break;
+
+                case 'u':
+                    // Streaming users, or the stream policy of this user
+                    setUserStreamPolicy(engine, O, user, commandString + 1);
+                    break;
 
                 case 'r':
                     // Change radar
                     sscanf("%s", commandString + 1, sval1);
                     RKLog(">%s %s Selected radar %s\n", engine->name, O->name, sval1);
-                    snprintf(user->commandResponse, RKMaximumPacketSize, "ACK. %s selected." RKEOL, sval1);
+                    snprintf(user->commandResponse, RKCommandCenterResponseSize, "ACK. %s selected." RKEOL, sval1);
                     RKOperatorSendCommandResponse(O, user->commandResponse);
                     break;
 
@@ -385,12 +1338,15 @@ int socketStreamHandler(RKOperator *O) {
 
     RKRay *ray;
     RKRayHeader rayHeader;
+    struct iovec vectors[RKProductIndexCount + 2];
+    int vectorCount;
     RKRayHeaderF1 rayHeaderV1;
 
     RKSweep *sweep;
     RKSweepHeader sweepHeader;
 
-    RKProduct *product;
+    RKProductIndex productIndex;
+    RKProductIndex productIndices[RKProductIndexCount];
 
     uint8_t *u8Data = NULL;
     float *f32Data = NULL;
@@ -400,11 +1356,9 @@ int socketStreamHandler(RKOperator *O) {
     RKInt16C *userDataH = NULL;
     RKInt16C *userDataV = NULL;
 
-    RKIdentifier identifier;
-    RKProductId productId;
+    struct timeval timevalOrigin, timevalTx;
 
-    struct timeval timevalOrigin, timevalTx, timevalRx;
-    double deltaTx, deltaRx;
+    sendJobResponse(engine, O, user);
 
     if (engine->radarCount < 1) {
         return 0;
@@ -422,6 +1376,14 @@ int socketStreamHandler(RKOperator *O) {
         return 0;
     }
 
+    if (user->relay) {
+        sendRelayChannels(engine, O, user, time);
+        user->tic++;
+        pthread_mutex_unlock(&user->mutex);
+        sendBeaconIfIdle(engine, O, user, time);
+        return 0;
+    }
+
     const char colormap[16][16] = {
         {"\033[48;5;233m"},
         {"\033[48;5;243m"},
@@ -461,7 +1423,7 @@ int socketStreamHandler(RKOperator *O) {
         } else if (k == RKStreamStatusPulses) {
             // Stream "1" - Pulses
             user->streamsInProgress = RKStreamStatusPulses;
-            k = snprintf(user->string, RKMaximumPacketSize, "%s" RKEOL,
+            k = snprintf(user->string, user->stringCapacity, "%s" RKEOL,
                          RKPulseEnginePulseString(user->radar->pulseEngine));
             O->delimTx.type = RKNetworkPacketTypePlainText;
             O->delimTx.size = k + 1;
@@ -474,7 +1436,7 @@ int socketStreamHandler(RKOperator *O) {
             j = 0;
             k = 0;
             endIndex = RKPreviousModuloS(user->radar->momentEngine->rayStatusBufferIndex, RKBufferSSlotCount);
-            while (user->rayStatusIndex != endIndex && k < RKMaximumPacketSize - 200) {
+            while (user->rayStatusIndex != endIndex && k < (int)user->stringCapacity - RKMaximumStringLength - 200) {
                 c = user->radar->momentEngine->rayStatusBuffer[user->rayStatusIndex];
                 k += sprintf(user->string + k, "%s\n", c);
                 user->rayStatusIndex = RKNextModuloS(user->rayStatusIndex, RKBufferSSlotCount);
@@ -482,7 +1444,7 @@ int socketStreamHandler(RKOperator *O) {
             }
             if (j) {
                 // Take out the last '\n', replace it with somethign else + EOL
-                snprintf(user->string + k - 1, RKMaximumPacketSize - k - 1, "" RKEOL);
+                snprintf(user->string + k - 1, user->stringCapacity - k - 1, "" RKEOL);
                 O->delimTx.type = RKNetworkPacketTypePlainText;
                 O->delimTx.size = k + 1;
                 RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), user->string, O->delimTx.size, NULL);
@@ -492,7 +1454,7 @@ int socketStreamHandler(RKOperator *O) {
         } else if (k == RKStreamStatusIngest) {
             // Stream "3" - Overall status
             user->streamsInProgress = RKStreamStatusIngest;
-            k = snprintf(user->string, RKMaximumPacketSize, "%s %s %s %s %s" RKEOL,
+            k = snprintf(user->string, user->stringCapacity, "%s %s %s %s %s" RKEOL,
                          RKPulseEngineStatusString(user->radar->pulseEngine),
                          RKPulseRingFilterEngineStatusString(user->radar->pulseRingFilterEngine),
                          RKPositionEngineStatusString(user->radar->positionEngine),
@@ -511,7 +1473,7 @@ int socketStreamHandler(RKOperator *O) {
                 sprintf(spacer, "%s | %s",
                         rkGlobalParameters.showColor ? RKGetBackgroundColorOfIndex(15) : "",
                         rkGlobalParameters.showColor ? RKNoColor : "");
-                k = snprintf(user->string, RKMaximumPacketSize, "%9s%s%9s%s%9s%s%9s%s%9s%s%9s\n",
+                k = snprintf(user->string, user->stringCapacity, "%9s%s%9s%s%9s%s%9s%s%9s%s%9s\n",
                              user->radar->positionEngine->name, spacer,
                              user->radar->pulseEngine->name, spacer,
                              user->radar->momentEngine->name, spacer,
@@ -521,7 +1483,7 @@ int socketStreamHandler(RKOperator *O) {
             } else {
                 k = 0;
             }
-            k += snprintf(user->string + k, RKMaximumPacketSize - k,
+            k += snprintf(user->string + k, user->stringCapacity - k,
                           "%04x - %04d       | "
                           "%04x - %05d [%d]  | "
                           "%04x - %04d [%d]   | "
@@ -579,11 +1541,11 @@ int socketStreamHandler(RKOperator *O) {
             }
             if (ray) {
                 k = 0;
-                while (user->rayIndex != endIndex && k < RKMaximumPacketSize - 200) {
+                while (user->rayIndex != endIndex && k < (int)user->stringCapacity - RKMaximumStringLength - 200) {
                     ray = RKGetRayFromBuffer(user->radar->rays, user->rayIndex);
                     if (!(ray->header.s & RKRayStatusReady)) {
-                        usleep(10000);
-                        continue;
+                        // Not ready yet, the rest goes out next time
+                        break;
                     }
                     k += sprintf(user->string + k, "%04d %5.2f %6.2f ", (int)(ray->header.i % 1000), ray->header.startElevation, ray->header.startAzimuth);
                     // Now we paint the ASCII art
@@ -665,7 +1627,7 @@ int socketStreamHandler(RKOperator *O) {
             j = 0;
             k = 0;
             endIndex = RKPreviousModuloS(user->radar->steerEngine->statusBufferIndex, RKBufferSSlotCount);
-            while (user->steerStatusIndex != endIndex && k < RKMaximumPacketSize - 200) {
+            while (user->steerStatusIndex != endIndex && k < (int)user->stringCapacity - RKMaximumStringLength - 200) {
                 c = user->radar->steerEngine->statusBuffer[user->steerStatusIndex];
                 k += sprintf(user->string + k, "%s\n", c);
                 user->steerStatusIndex = RKNextModuloS(user->steerStatusIndex, RKBufferSSlotCount);
@@ -673,7 +1635,7 @@ int socketStreamHandler(RKOperator *O) {
             }
             if (j) {
                 // Take out the last '\n', replace it with somethign else + EOL
-                snprintf(user->string + k - 1, RKMaximumPacketSize - k, "" RKEOL);
+                snprintf(user->string + k - 1, user->stringCapacity - k, "" RKEOL);
                 O->delimTx.type = RKNetworkPacketTypePlainText;
                 O->delimTx.size = k + 1;
                 RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), user->string, O->delimTx.size, NULL);
@@ -684,28 +1646,34 @@ int socketStreamHandler(RKOperator *O) {
 
         // Send another set of controls if the radar controls have changed.
         if (user->controlFirstUID != user->radar->controls[0].uid && user->access & RKStreamControl) {
+            size = user->radar->controlCount * (sizeof(RKControl) + 64) + RKMaximumStringLength;
+            if (reserveUserBuffer(engine, user, (void **)&user->scratch, &user->scratchCapacity, size) == NULL ||
+                reserveUserBuffer(engine, user, (void **)&user->string, &user->stringCapacity, size) == NULL) {
+                pthread_mutex_unlock(&user->mutex);
+                return RKResultFailedToAllocateUserBuffer;
+            }
             user->controlFirstUID = user->radar->controls[0].uid;
             RKLog("%s %s Sending new controls.\n", engine->name, O->name);
             //j = sprintf(user->string, "{\"Radars\": [");
-            j = snprintf(user->string, RKMaximumPacketSize, "{\"Radars\": [");
+            j = snprintf(user->string, user->stringCapacity, "{\"Radars\": [");
             for (k = 0; k < MIN(4, engine->radarCount); k++) {
                 RKRadar *radar = engine->radars[k];
                 //j += sprintf(user->string + j, "\"%s\", ", radar->desc.name);
-                j += snprintf(user->string + j, RKMaximumPacketSize - j, "\"%s\", ", radar->desc.name);
+                j += snprintf(user->string + j, user->stringCapacity - j, "\"%s\", ", radar->desc.name);
             }
             if (k > 0) {
                 //j += sprintf(user->string + j - 2, "], ") - 2;
-                j += snprintf(user->string + j - 2, RKMaximumPacketSize - j, "], ") - 2;
+                j += snprintf(user->string + j - 2, user->stringCapacity - j, "], ") - 2;
             } else {
                 // j += sprintf(user->string + j, "], ");
-                j += snprintf(user->string + j, RKMaximumPacketSize - j, "], ");
+                j += snprintf(user->string + j, user->stringCapacity - j, "], ");
             }
             // Should only send the controls if the user has been authenticated
             RKMakeJSONStringFromControls(user->scratch, user->radar->controls, user->radar->controlCount);
             //j += sprintf(user->string + j, "\"Controls\": [%s]}" RKEOL, user->scratch);
-            j += snprintf(user->string + j, RKMaximumPacketSize - j, "\"Controls\": [");
-            strncpy(user->string + j, user->scratch, RKMaximumPacketSize - 16 - j);
-            j += snprintf(user->string + j, RKMaximumPacketSize - j, "]}" RKEOL);
+            j += snprintf(user->string + j, user->stringCapacity - j, "\"Controls\": [");
+            j += snprintf(user->string + j, user->stringCapacity - 16 - j, "%s", user->scratch);
+            j += snprintf(user->string + j, user->stringCapacity - j, "]}" RKEOL);
             O->delimTx.type = RKNetworkPacketTypeControls;
             O->delimTx.size = j;
             RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), user->string, O->delimTx.size, NULL);
@@ -713,6 +1681,14 @@ int socketStreamHandler(RKOperator *O) {
         }
     } // (user->radar->desc.initFlags & RKInitFlagSignalProcessor && time - user->timeLastOut >= 0.08) ...
 
+    // Send rate of this user and the health of all streaming users
+    if (time - user->timeLastRate >= 1.0) {
+        user->sendRate = user->timeLastRate > 0.0 ? (double)(O->txByteCount - user->txByteCountLastRate) / (time - user->timeLastRate) : 0.0;
+        user->txByteCountLastRate = O->txByteCount;
+        user->timeLastRate = time;
+    }
+    reportStreamHealth(engine, time, false);
+
     // For contiguous streaming:
     // If we just started a connection, grab the payload that is either:
     // 1) Up to latest available:
@@ -742,13 +1718,7 @@ int socketStreamHandler(RKOperator *O) {
             }
             user->statusIndex = endIndex;
         }
-        s = 0;
-        while (user->radar->status[user->statusIndex].flag != RKStatusFlagReady && engine->server->state == RKServerStateActive && s++ < 20) {
-            if (s % 10 == 0 && engine->verbose > 1) {
-                RKLog("%s %s sleep 0/%.1f s  RKStatus\n", engine->name, O->name, s * 0.1f);
-            }
-            usleep(50000);
-        }
+        // Nothing until the status is ready, this is called again shortly
         if (user->radar->status[user->statusIndex].flag == RKStatusFlagReady && engine->server->state == RKServerStateActive) {
             while (user->statusIndex != endIndex) {
                 O->delimTx.type = RKNetworkPacketTypeProcessorStatus;
@@ -756,8 +1726,6 @@ int socketStreamHandler(RKOperator *O) {
                 RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), &user->radar->status[user->statusIndex], sizeof(RKStatus), NULL);
                 user->statusIndex = RKNextModuloS(user->statusIndex, user->radar->desc.statusBufferDepth);
             }
-        } else {
-            RKLog("%s %s No Status / Deactivated.   statusIndex = %d\n", engine->name, O->name, user->statusIndex);
         }
     }
 
@@ -774,13 +1742,7 @@ int socketStreamHandler(RKOperator *O) {
             }
             user->healthIndex = endIndex;
         }
-        s = 0;
-        while (user->radar->healths[user->healthIndex].flag != RKHealthFlagReady && engine->server->state == RKServerStateActive && s++ < 20) {
-            if (s % 10 == 0 && engine->verbose > 1) {
-                RKLog("%s %s sleep 0/%.1f s  RKHealth\n", engine->name, O->name, s * 0.1f);
-            }
-            usleep(50000);
-        }
+        // Nothing until the health is ready, this is called again shortly
         if (user->radar->healths[user->healthIndex].flag == RKHealthFlagReady && engine->server->state == RKServerStateActive) {
             j = 0;
             k = 0;
@@ -797,8 +1759,6 @@ int socketStreamHandler(RKOperator *O) {
                 O->delimTx.size = k;
                 RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), user->string, O->delimTx.size, NULL);
             }
-        } else {
-            RKLog("%s %s No Health / Deactivated.   healthIndex = %d / %d\n", engine->name, O->name, user->healthIndex, user->radar->healthIndex);
         }
     }
 
@@ -816,13 +1776,6 @@ int socketStreamHandler(RKOperator *O) {
         if (!(user->streamsInProgress & RKStreamProductAll)) {
             user->streamsInProgress |= (user->streams & RKStreamProductAll);
             user->rayIndex = endIndex;
-            s = 0;
-            while (!(ray->header.s & RKRayStatusReady) && engine->server->state == RKServerStateActive && s++ < 20) {
-                if (s % 10 == 0 && engine->verbose > 1) {
-                    RKLog("%s %s sleep 0/%.1f s  RKRay\n", engine->name, O->name, s * 0.1f);
-                }
-                usleep(50000);
-            }
             if (engine->verbose) {
                 RKLog("%s %s Streaming RKRay products -> %d (%s).\n", engine->name, O->name, endIndex,
                       ray->header.s & RKRayStatusReady ? "ready" : "not ready");
@@ -830,96 +1783,91 @@ int socketStreamHandler(RKOperator *O) {
         }
 
         if (ray->header.s & RKRayStatusReady && engine->server->state == RKServerStateActive) {
-            while (user->rayIndex != endIndex) {
+            applyStreamPolicy(engine, O, user, endIndex, time);
+            while (user->rayIndex != endIndex && RKOperatorGetQueueDepth(O) < user->streamBudget) {
                 ray = RKGetRayFromBuffer(user->radar->rays, user->rayIndex);
+                if (ray->header.i % user->rayStride) {
+                    user->rayDropCount++;
+                    user->rayIndex = RKNextModuloS(user->rayIndex, user->radar->desc.rayBufferDepth);
+                    continue;
+                }
                 // Duplicate and send the header with only selected products
-                //memcpy(&rayHeader, &ray->header, sizeof(RKRayHeader));
-                copyRayHeader(&rayHeaderV1, &ray->header);
+                copyRayStreamHeader(engine, user, ray, RKRayStreamFormatHeader, &rayHeader);
                 // Gather the products to be sent
-                rayHeaderV1.productList = RKProductListNone;
+                rayHeader.productList = RKProductListNone;
                 if (user->streams & RKStreamProductZ) {
-                    rayHeaderV1.productList |= RKProductListFloatZ;
+                    rayHeader.productList |= RKProductListFloatZ;
                 }
                 if (user->streams & RKStreamProductV) {
-                    rayHeaderV1.productList |= RKProductListFloatV;
+                    rayHeader.productList |= RKProductListFloatV;
                 }
                 if (user->streams & RKStreamProductW) {
-                    rayHeaderV1.productList |= RKProductListFloatW;
+                    rayHeader.productList |= RKProductListFloatW;
                 }
                 if (user->streams & RKStreamProductD) {
-                    rayHeaderV1.productList |= RKProductListFloatD;
+                    rayHeader.productList |= RKProductListFloatD;
                 }
                 if (user->streams & RKStreamProductP) {
-                    rayHeaderV1.productList |= RKProductListFloatP;
+                    rayHeader.productList |= RKProductListFloatP;
                 }
                 if (user->streams & RKStreamProductR) {
-                    rayHeaderV1.productList |= RKProductListFloatR;
+                    rayHeader.productList |= RKProductListFloatR;
                 }
                 if (user->streams & RKStreamProductK) {
-                    rayHeaderV1.productList |= RKProductListFloatK;
+                    rayHeader.productList |= RKProductListFloatK;
                 }
                 if (user->streams & RKStreamProductQ) {
-                    rayHeaderV1.productList |= RKProductListFloatQ;
+                    rayHeader.productList |= RKProductListFloatQ;
                 }
                 if (user->streams & RKStreamProductSh) {
-                    rayHeaderV1.productList |= RKProductListFloatSh;
+                    rayHeader.productList |= RKProductListFloatSh;
                 }
                 if (user->streams & RKStreamProductSv) {
-                    rayHeaderV1.productList |= RKProductListFloatSv;
+                    rayHeader.productList |= RKProductListFloatSv;
                 }
-                uint32_t productList = rayHeaderV1.productList & RKProductListFloatZVWDPRKSQ;
+                uint32_t productList = rayHeader.productList & RKProductListFloatZVWDPRKSQ;
                 uint32_t productCount = __builtin_popcount(productList);
                 //RKLog("ProductCount = %d / %x\n", productCount, productList);
 
-                rayHeader.gateCount /= user->rayDownSamplingRatio;
-                rayHeader.gateSizeMeters *= (float)user->rayDownSamplingRatio;
-
-                O->delimTx.type = RKNetworkPacketTypeRayDisplay;
-                O->delimTx.size = (uint32_t)(sizeof(RKRayHeader) + productCount * rayHeader.gateCount * sizeof(float));
-                RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), &rayHeader, sizeof(RKRayHeader), NULL);
-
-                for (j = 0; j < productCount; j++) {
+                for (j = 0, i = 0; j < productCount; j++) {
                     if (productList & RKProductListFloatZ) {
                         productList ^= RKProductListFloatZ;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexZ);
+                        productIndex = RKProductIndexZ;
                     } else if (productList & RKProductListFloatV) {
                         productList ^= RKProductListFloatV;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexV);
+                        productIndex = RKProductIndexV;
                     } else if (productList & RKProductListFloatW) {
                         productList ^= RKProductListFloatW;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexW);
+                        productIndex = RKProductIndexW;
                     } else if (productList & RKProductListFloatD) {
                         productList ^= RKProductListFloatD;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexD);
+                        productIndex = RKProductIndexD;
                     } else if (productList & RKProductListFloatP) {
                         productList ^= RKProductListFloatP;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexP);
+                        productIndex = RKProductIndexP;
                     } else if (productList & RKProductListFloatR) {
                         productList ^= RKProductListFloatR;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexR);
+                        productIndex = RKProductIndexR;
                     } else if (productList & RKProductListFloatK) {
                         productList ^= RKProductListFloatK;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexK);
+                        productIndex = RKProductIndexK;
                     } else if (productList & RKProductListFloatQ) {
-                        productList ^= RKProductListFloatK;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexQ);
+                        productList ^= RKProductListFloatQ;
+                        productIndex = RKProductIndexQ;
                     } else if (productList & RKProductListFloatSh) {
                         productList ^= RKProductListFloatSh;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexSh);
+                        productIndex = RKProductIndexSh;
                     } else if (productList & RKProductListFloatSv) {
                         productList ^= RKProductListFloatSv;
-                        f32Data = RKGetFloatDataFromRay(ray, RKProductIndexSv);
+                        productIndex = RKProductIndexSv;
                     } else {
-                        f32Data = NULL;
+                        productIndex = RKProductIndexCount;
                     }
-                    if (f32Data) {
-                        float *lowRateData = (float *)user->string;
-                        for (i = 0, k = 0; i < rayHeader.gateCount; i++, k += user->rayDownSamplingRatio) {
-                            lowRateData[i] = f32Data[k];
-                        }
-                        RKOperatorSendPackets(O, lowRateData, rayHeader.gateCount * sizeof(float), NULL);
+                    if (productIndex < RKProductIndexCount) {
+                        productIndices[i++] = productIndex;
                     }
                 }
+                sendRayStream(engine, O, user, ray, &rayHeader, sizeof(RKRayHeader), RKRayStreamFormatFloat, productIndices, i);
                 ray->header.s |= RKRayStatusStreamed;
                 user->rayIndex = RKNextModuloS(user->rayIndex, user->radar->desc.rayBufferDepth);
             }
@@ -949,13 +1897,6 @@ int socketStreamHandler(RKOperator *O) {
         if (!(user->streamsInProgress & RKStreamDisplayZVWDPRKS)) {
             user->streamsInProgress |= (user->streams & RKStreamDisplayZVWDPRKS);
             user->rayIndex = endIndex;
-            s = 0;
-            while (!(ray->header.s & RKRayStatusReady) && engine->server->state == RKServerStateActive && s++ < 20) {
-                if (s % 10 == 0 && engine->verbose) {
-                    RKLog("%s %s sleep 0/%.1f s  RKRay\n", engine->name, O->name, s * 0.1f);
-                }
-                usleep(50000);
-            }
             if (engine->verbose) {
                 RKLog("%s %s Streaming RKRay displays -> %d (0x%02x %s).\n", engine->name, O->name, endIndex,
                       ray->header.s, ray->header.s & RKRayStatusReady ? "ready" : "not ready");
@@ -963,11 +1904,16 @@ int socketStreamHandler(RKOperator *O) {
         }
 
         if (ray->header.s & RKRayStatusReady && engine->server->state == RKServerStateActive) {
-            while (user->rayIndex != endIndex) {
+            applyStreamPolicy(engine, O, user, endIndex, time);
+            while (user->rayIndex != endIndex && RKOperatorGetQueueDepth(O) < user->streamBudget) {
                 ray = RKGetRayFromBuffer(user->radar->rays, user->rayIndex);
+                if (ray->header.i % user->rayStride) {
+                    user->rayDropCount++;
+                    user->rayIndex = RKNextModuloS(user->rayIndex, user->radar->desc.rayBufferDepth);
+                    continue;
+                }
                 // Duplicate and send the header with only selected products
-                // memcpy(&rayHeader, &ray->header, sizeof(RKRayHeader));
-                copyRayHeader(&rayHeaderV1, &ray->header);
+                copyRayStreamHeader(engine, user, ray, RKRayStreamFormatHeaderF1, &rayHeaderV1);
 
                 // Gather the products to be sent
                 rayHeaderV1.productList = RKProductListNone;
@@ -1005,55 +1951,45 @@ int socketStreamHandler(RKOperator *O) {
                 uint32_t displayCount = __builtin_popcount(displayList);
                 //RKLog("displayCount = %d / %x\n", productCount, productList);
 
-                rayHeaderV1.gateCount /= user->rayDownSamplingRatio;
-                rayHeaderV1.gateSizeMeters *= (float)user->rayDownSamplingRatio;
-
-                O->delimTx.type = RKNetworkPacketTypeRayDisplay;
-                O->delimTx.size = (uint32_t)(sizeof(RKRayHeaderF1) + displayCount * rayHeaderV1.gateCount * sizeof(uint8_t));
-                RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), &rayHeaderV1, sizeof(RKRayHeaderF1), NULL);
-
-                for (j = 0; j < displayCount; j++) {
+                for (j = 0, i = 0; j < displayCount; j++) {
                     if (displayList & RKProductListUInt8Z) {
                         displayList ^= RKProductListUInt8Z;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexZ);
+                        productIndex = RKProductIndexZ;
                     } else if (displayList & RKProductListUInt8V) {
                         displayList ^= RKProductListUInt8V;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexV);
+                        productIndex = RKProductIndexV;
                     } else if (displayList & RKProductListUInt8W) {
                         displayList ^= RKProductListUInt8W;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexW);
+                        productIndex = RKProductIndexW;
                     } else if (displayList & RKProductListUInt8D) {
                         displayList ^= RKProductListUInt8D;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexD);
+                        productIndex = RKProductIndexD;
                     } else if (displayList & RKProductListUInt8P) {
                         displayList ^= RKProductListUInt8P;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexP);
+                        productIndex = RKProductIndexP;
                     } else if (displayList & RKProductListUInt8R) {
                         displayList ^= RKProductListUInt8R;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexR);
+                        productIndex = RKProductIndexR;
                     } else if (displayList & RKProductListUInt8K) {
                         displayList ^= RKProductListUInt8K;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexK);
+                        productIndex = RKProductIndexK;
                     } else if (displayList & RKProductListUInt8Q) {
                         displayList ^= RKProductListUInt8Q;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexQ);
+                        productIndex = RKProductIndexQ;
                     } else if (displayList & RKProductListUInt8Sh) {
                         displayList ^= RKProductListUInt8Sh;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexSh);
+                        productIndex = RKProductIndexSh;
                     } else if (displayList & RKProductListUInt8Sv) {
                         displayList ^= RKProductListUInt8Sv;
-                        u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexSv);
+                        productIndex = RKProductIndexSv;
                     } else {
-                        u8Data = NULL;
+                        productIndex = RKProductIndexCount;
                     }
-                    if (u8Data) {
-                        uint8_t *lowRateData = (uint8_t *)user->string;
-                        for (i = 0, k = 0; i < rayHeaderV1.gateCount; i++, k += user->rayDownSamplingRatio) {
-                            lowRateData[i] = u8Data[k];
-                        }
-                        RKOperatorSendPackets(O, lowRateData, rayHeaderV1.gateCount * sizeof(uint8_t), NULL);
+                    if (productIndex < RKProductIndexCount) {
+                        productIndices[i++] = productIndex;
                     }
                 }
+                sendRayStream(engine, O, user, ray, &rayHeaderV1, sizeof(RKRayHeaderF1), RKRayStreamFormatUInt8, productIndices, i);
                 ray->header.s |= RKRayStatusStreamed;
                 user->rayIndex = RKNextModuloS(user->rayIndex, user->radar->desc.rayBufferDepth);
             } // while (user->rayIndex != endIndex) ...
@@ -1067,7 +2003,10 @@ int socketStreamHandler(RKOperator *O) {
 
     // Sweep
     #pragma mark Sweep
-    if (user->streams & user->access & RKStreamSweepAll) {
+    if (user->sweep) {
+        // Still taking the products of the previous sweep
+        receiveUserProducts(engine, O, user);
+    } else if (user->streams & user->access & RKStreamSweepAll) {
         // Sweep streams - no skipping
         if (user->scratchSpaceIndex != user->radar->sweepEngine->scratchSpaceIndex) {
             if (user->radar->sweepEngine->verbose > 1) {
@@ -1193,7 +2132,11 @@ int socketStreamHandler(RKOperator *O) {
                         ray = sweep->rays[k];
                         memcpy(&rayHeader, &ray->header, sizeof(RKRayHeader));
                         rayHeader.productList = sweepHeader.productList;
-                        size += RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), &rayHeader, sizeof(RKRayHeader), NULL);
+                        vectors[0].iov_base = &O->delimTx;
+                        vectors[0].iov_len = sizeof(RKNetDelimiter);
+                        vectors[1].iov_base = &rayHeader;
+                        vectors[1].iov_len = sizeof(RKRayHeader);
+                        vectorCount = 2;
                         productList = sweepHeader.productList;
                         if (engine->verbose > 1 && (k < 3 || k == sweepHeader.rayCount - 1)) {
                             RKLog(">%s %s k = %d   moments = %s   (%x)\n", engine->name, O->name, k, user->scratch + 1, productList);
@@ -1233,12 +2176,15 @@ int socketStreamHandler(RKOperator *O) {
                                 f32Data = NULL;
                             }
                             if (f32Data) {
-                                size += RKOperatorSendPackets(O, f32Data, sweep->header.gateCount * sizeof(float), NULL);
-                                user->timeLastOut = time;
+                                vectors[vectorCount].iov_base = f32Data;
+                                vectors[vectorCount++].iov_len = sweep->header.gateCount * sizeof(float);
                             } else if (k == 0) {
                                 RKLog("No data found %04Xh", productList);
                             }
                         } // for (j = 0; ...
+                        // The ray header and the products straight from the sweep in one send
+                        size += RKOperatorSendVector(O, vectors, vectorCount, false);
+                        user->timeLastOut = time;
                     } // for (k = 0; ...
 
                     gettimeofday(&timevalTx, NULL);
@@ -1251,54 +2197,30 @@ int socketStreamHandler(RKOperator *O) {
                         RKLog(">%s %s Sent a sweep of size %s B (%d moments)\n", engine->name, O->name, RKIntegerToCommaStyleString(size), baseProductCount);
                     }
 
-                    for (k = 0; k < user->productCount; k++) {
-                        RKLog(">%s %s Expecting return from algorithm key = %d for productId = %d ...\n",
-                              engine->name, O->name, user->productDescriptions[k].key, user->productIds[k]);
-                        size = RKServerReceiveUserPayload(O, user->string, RKNetworkMessageFormatHeaderDefinedSize);
-                        if (size < 0) {
-                            RKLog("%s %s Error. Failed receiving user product header ...\n", engine->name, O->name);
-                            continue;
+                    // The products from PyRadarKit are taken by receiveUserProducts() as they arrive, the sweep is kept until then
+                    if (user->productCount) {
+                        if (reserveUserBuffer(engine, user, (void **)&user->payload, &user->payloadCapacity, RKMaximumPacketSize + 1) == NULL) {
+                            RKSweepFree(sweep);
+                            RKOperatorHangUp(O);
+                            pthread_mutex_unlock(&user->mutex);
+                            return RKResultFailedToAllocateUserBuffer;
                         }
-                        productId = RKProductIdFromString(RKGetValueOfKey(user->string, "productId"));
-                        identifier = RKIdentifierFromString(RKGetValueOfKey(user->string, "configId"));
-                        if (user->productIds[k] != productId) {
-                            RKLog("%s %s Warning. Inconsistent productId = %d (expected) != %d (reported)\n", engine->name, O->name, user->productIds[k], productId);
-                        } else if (sweep->header.config.i != identifier) {
-                            RKLog("%s %s Warning. Inconsistent configId = %lu (expected) != %lu (reported)\n", engine->name, O->name, sweep->header.config.i, identifier);
-                        } else {
-                            product = RKSweepEngineGetVacantProduct(user->radar->sweepEngine, sweep, productId);
-                            if (product) {
-                                // Transfer important meta data and prepare the necessary buffer size
-                                RKProductInitFromSweep(product, sweep);
-                                size = RKServerReceiveUserPayload(O, product->data, RKNetworkMessageFormatHeaderDefinedSize);
-                                if (user->radar->sweepEngine->verbose > 1) {
-                                    RKLog("%s %s %s (%d) -> %u %zu\n",
-                                          engine->name, O->name, user->string, strlen(user->string), productId, identifier);
-                                }
-                                RKShowArray(product->data, product->desc.symbol, product->header.gateCount, product->header.rayCount);
-                                RKSweepEngineSetProductComplete(user->radar->sweepEngine, sweep, product);
-                            } else {
-                                // Still need to consume this packet so we dump it to a scratch space
-                                RKLog("Warning. Unable to retrieve storage for incoming sweep.\n");
-                                size = RKServerReceiveUserPayload(O, user->scratch, RKNetworkMessageFormatHeaderDefinedSize);
-                            }
-                            if (size < 0) {
-                                RKLog("%s %s Error. Failed receiving user product data ...\n", engine->name, O->name);
-                                continue;
-                            }
-                        } // else (user->productIds[k] == productId && sweep->header.config.i == identifier)
-                    } // for (k = 0; k < user->productCount; k++) ...
-
-                    gettimeofday(&timevalRx, NULL);
-
-                    deltaTx = 1.0e3 * RKTimevalDiff(timevalTx, timevalOrigin);
-                    deltaRx = 1.0e3 * RKTimevalDiff(timevalRx, timevalTx);
-                    RKLog("%s %s Round trip finished   %s ms   %s ms\n", engine->name, O->name,
-                          RKVariableInString("tx", &deltaTx, RKValueTypeDouble),
-                          RKVariableInString("rx", &deltaRx, RKValueTypeDouble));
+                        for (k = 0; k < user->productCount; k++) {
+                            RKLog(">%s %s Expecting return from algorithm key = %d for productId = %d ...\n",
+                                  engine->name, O->name, user->productDescriptions[k].key, user->productIds[k]);
+                        }
+                    }
+                    user->sweep = sweep;
+                    user->sweepProductCount = 0;
+                    user->timevalSweepOrigin = timevalOrigin;
+                    user->timevalSweepTx = timevalTx;
+                    sweep = NULL;
+                    receiveUserProducts(engine, O, user);
 
                 } // if (baseMomentCount) ...
-                RKSweepFree(sweep);
+                if (sweep) {
+                    RKSweepFree(sweep);
+                }
             } else if (engine->verbose > 1) {
                 RKLog("%s %s Empty sweep   anchorIndex = %d.\n", engine->name, O->name, user->scratchSpaceIndex);
             } // if (sweep) ...
@@ -1332,27 +2254,24 @@ int socketStreamHandler(RKOperator *O) {
         //printf("wi = %d  %d\n", user->transmitWaveIndex, (int)pulse->header.i % user->radar->pulseEngine->filterGroupCount);
         user->transmitWaveIndex = RKNextModuloS(user->transmitWaveIndex, user->radar->pulseEngine->filterGroupCount);
         //pulse = RKGetPulseFromBuffer(user->radar->pulses, endIndex);
-        s = 0;
-        while (!(pulse->header.s & RKPulseStatusProcessed) && s++ < 100) {
-            usleep(1000);
-        }
-
         if (!(user->streamsInProgress & RKPulseStatusProcessed)) {
             user->pulseIndex = endIndex;
-            s = 0;
-            while (!(pulse->header.s & RKPulseStatusHasIQData) && engine->server->state == RKServerStateActive && s++ < 20) {
-                if (s % 10 == 0) {
-                    RKLog("%s %s sleep 0/%.1f s  RKPulse\n", engine->name, O->name, s * 0.1f);
-                }
-                usleep(100000);
-            }
         }
 
-        if (pulse->header.s & RKPulseStatusProcessed && engine->server->state == RKServerStateActive) {
+        if (!RKOperatorZeroCopyReleased(O)) {
+            // The samples of the previous pulse are still being sent from user->samples, try again next time
+        } else if (pulse->header.s & RKPulseStatusProcessed && engine->server->state == RKServerStateActive) {
             user->streamsInProgress |= RKStreamDisplayIQ;
             memcpy(&pulseHeader, &pulse->header, sizeof(RKPulseHeader));
             c16DataH = RKGetInt16CDataFromPulse(pulse, 0);
             c16DataV = RKGetInt16CDataFromPulse(pulse, 1);
+            // Enough for any of the A-scope modes below
+            size = MAX(4096, MAX(pulse->header.gateCount, pulse->header.downSampledGateCount)) * sizeof(RKInt16C);
+            if (reserveUserBuffer(engine, user, (void **)&user->samples[0], &user->sampleCapacities[0], size) == NULL ||
+                reserveUserBuffer(engine, user, (void **)&user->samples[1], &user->sampleCapacities[1], size) == NULL) {
+                pthread_mutex_unlock(&user->mutex);
+                return RKResultFailedToAllocateUserBuffer;
+            }
             userDataH = user->samples[0];
             userDataV = user->samples[1];
             RKComplex *yH;
@@ -1463,7 +2382,14 @@ int socketStreamHandler(RKOperator *O) {
 
             O->delimTx.type = RKNetworkPacketTypePulseData;
             O->delimTx.size = (uint32_t)(sizeof(RKPulseHeader) + 2 * size);
-            RKOperatorSendPackets(O, &O->delimTx, sizeof(RKNetDelimiter), &pulseHeader, sizeof(RKPulseHeader), user->samples[0], size, user->samples[1], size, NULL);
+            // The samples may go out with MSG_ZEROCOPY, user->samples is left alone until the kernel is done
+            struct iovec pieces[] = {
+                {.iov_base = &O->delimTx, .iov_len = sizeof(RKNetDelimiter)},
+                {.iov_base = &pulseHeader, .iov_len = sizeof(RKPulseHeader)},
+                {.iov_base = user->samples[0], .iov_len = size},
+                {.iov_base = user->samples[1], .iov_len = size}
+            };
+            RKOperatorSendVector(O, pieces, 4, true);
 
             user->timeLastDisplayIQOut = time;
             user->timeLastOut = time;
@@ -1479,21 +2405,7 @@ int socketStreamHandler(RKOperator *O) {
 
     pthread_mutex_unlock(&user->mutex);
 
-    // Re-evaluate td = time - user->timeLastOut; send a beacon if nothing has been sent for a while
-    if (time - user->timeLastOut >= 1.0) {
-        if (O->beacon.type != RKNetworkPacketTypeBeacon) {
-            RKLog("Beacon has been changed %d\n", O->beacon.type);
-        }
-        if (engine->verbose > 1) {
-            RKLog("%s %s Beacon\n", engine->name, O->name);
-        }
-        size = RKOperatorSendBeacon(O);
-        user->timeLastOut = time;
-        if (size < 0) {
-            RKLog("Beacon failed (r = %d).\n", size);
-            RKOperatorHangUp(O);
-        }
-    }
+    sendBeaconIfIdle(engine, O, user, time);
 
     return 0;
 }
@@ -1501,18 +2413,29 @@ int socketStreamHandler(RKOperator *O) {
 int socketInitialHandler(RKOperator *O) {
     RKCommandCenter *engine = O->userResource;
 
-    if (engine->radarCount == 0) {
-        RKLog("%s No radar yet.\n", engine->name);
-        return RKResultNoRadar;
-    }
-
-    pthread_mutex_lock(&engine->mutex);
-
+    // The slot belongs to this operator, its buffers account for themselves under engine->mutex
     RKUser *user = &engine->users[O->iid];
     if (user->streams != RKStreamNull) {
         RKLog("%s %s Warning. Unexpected user state.   user->streams = %x", engine->name, O->name, user->streams);
     }
+    freeUserBuffers(engine, user);
     memset(user, 0, sizeof(RKUser));
+
+    // Buffers are allocated for connected users only, they grow as the subscribed streams need
+    if (allocateUserBuffers(engine, user) != RKResultSuccess) {
+        RKLog("%s %s Error. Unable to allocate user buffers.\n", engine->name, O->name);
+        freeUserBuffers(engine, user);
+        RKOperatorHangUp(O);
+        return RKResultFailedToAllocateUserBuffer;
+    }
+
+    pthread_mutex_lock(&engine->mutex);
+
+    if (engine->radarCount == 0) {
+        RKLog("%s No radar yet.\n", engine->name);
+        pthread_mutex_unlock(&engine->mutex);
+        return RKResultNoRadar;
+    }
     user->access = RKStreamStatusAll;
     user->access |= RKStreamDisplayAll;
     user->access |= RKStreamProductAll;
@@ -1530,6 +2453,10 @@ int socketInitialHandler(RKOperator *O) {
     user->pulseDownSamplingRatio = (uint16_t)MAX(user->radar->desc.pulseCapacity / 1000, 1);
     user->asciiArtStride = 4;
     user->ascopeMode = 0;
+    user->streamPolicy = RKStreamPolicyDropOldest;
+    user->streamBudget = RKCommandCenterStreamBudget;
+    user->streamLagLimit = RKCommandCenterStreamLagLimit;
+    user->rayStride = 1;
     pthread_mutex_init(&user->mutex, NULL);
     struct winsize terminalSize = {.ws_col = 80, .ws_row = 40};
     ioctl(O->sid, TIOCGWINSZ, &terminalSize);
@@ -1550,6 +2477,11 @@ int socketTerminateHandler(RKOperator *O) {
     user->access = RKStreamNull;
     user->streams = RKStreamNull;
     RKLog(">%s %s Disconnected.\n", engine->name, O->name);
+    // A command with the executor is no longer for this user
+    pthread_mutex_lock(&engine->executorMutex);
+    user->job = RKUserJobNone;
+    pthread_mutex_unlock(&engine->executorMutex);
+    abandonUserProducts(user);
     for (k = 0; k < user->productCount; k++) {
         if (user->productIds[k]) {
             RKSweepEngineUndescribeProduct(user->radar->sweepEngine, user->productIds[k]);
@@ -1559,6 +2491,10 @@ int socketTerminateHandler(RKOperator *O) {
     pthread_mutex_destroy(&user->mutex);
     user->radar = NULL;
     consolidateStreams(engine);
+    struct timeval t0;
+    gettimeofday(&t0, NULL);
+    reportStreamHealth(engine, (double)t0.tv_sec + 1.0e-6 * (double)t0.tv_usec, true);
+    freeUserBuffers(engine, user);
     return RKResultSuccess;
 }
 
@@ -1577,7 +2513,18 @@ RKCommandCenter *RKCommandCenterInit(void) {
     engine->verbose = 3;
     engine->memoryUsage = sizeof(RKCommandCenter);
     engine->server = RKServerInit();
+    engine->server->maxClient = MIN(engine->server->maxClient, RKCommandCenterMaxConnections);
     pthread_mutex_init(&engine->mutex, NULL);
+    engine->rayStreamBlocks = (RKRayStreamBlock *)malloc(RKCommandCenterRayCacheDepth * sizeof(RKRayStreamBlock));
+    if (engine->rayStreamBlocks == NULL) {
+        RKLog("Error. Unable to allocate ray stream blocks.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(engine->rayStreamBlocks, 0, RKCommandCenterRayCacheDepth * sizeof(RKRayStreamBlock));
+    engine->memoryUsage += RKCommandCenterRayCacheDepth * sizeof(RKRayStreamBlock);
+    pthread_mutex_init(&engine->rayStreamMutex, NULL);
+    pthread_mutex_init(&engine->executorMutex, NULL);
+    pthread_cond_init(&engine->executorPosted, NULL);
     RKServerSetName(engine->server, engine->name);
     RKServerSetWelcomeHandler(engine->server, &socketInitialHandler);
     RKServerSetCommandHandler(engine->server, &socketCommandHandler);
@@ -1588,8 +2535,18 @@ RKCommandCenter *RKCommandCenterInit(void) {
 }
 
 void RKCommandCenterFree(RKCommandCenter *engine) {
-    pthread_mutex_destroy(&engine->mutex);
     RKServerFree(engine->server);
+    for (int k = 0; k < RKCommandCenterRayCacheDepth; k++) {
+        free(engine->rayStreamBlocks[k].data);
+    }
+    for (int k = 0; k < RKCommandCenterMaxConnections; k++) {
+        freeUserBuffers(engine, &engine->users[k]);
+    }
+    free(engine->rayStreamBlocks);
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_mutex_destroy(&engine->rayStreamMutex);
+    pthread_mutex_destroy(&engine->executorMutex);
+    pthread_cond_destroy(&engine->executorPosted);
     free(engine);
     return;
 }
@@ -1606,11 +2563,31 @@ void RKCommandCenterSetPort(RKCommandCenter *engine, const int port) {
     RKServerSetPort(engine->server, port);
 }
 
+void RKCommandCenterSetWebSocketPort(RKCommandCenter *engine, const int port) {
+    RKServerSetWebSocketPort(engine->server, port);
+}
+
+void RKCommandCenterSetZeroCopyThreshold(RKCommandCenter *engine, const size_t size) {
+    RKServerSetZeroCopyThreshold(engine->server, size);
+}
+
 void RKCommandCenterAddRadar(RKCommandCenter *engine, RKRadar *radar) {
-    if (engine->radarCount >= 4) {
+    if (engine->radarCount >= RKCommandCenterMaxRadars) {
         RKLog("%s unable to add another radar.\n", engine->name);
+        return;
     }
     engine->radars[engine->radarCount] = radar;
+    // A health node to report the streaming users
+    engine->healthNodes[engine->radarCount] = RKHealthNodeInvalid;
+    if (radar->desc.initFlags & RKInitFlagSignalProcessor) {
+        RKHealthNode node = RKRequestHealthNode(radar);
+        if (node < radar->desc.healthNodeCount) {
+            engine->healthNodes[engine->radarCount] = node;
+        } else {
+            RKLog("%s Warning. No health node for the streaming users of '%s'.\n", engine->name, radar->desc.name);
+        }
+    }
+    engine->rayDropCountLastHealth[engine->radarCount] = 0;
     engine->radarCount++;
 }
 
@@ -1631,10 +2608,13 @@ void RKCommandCenterRemoveRadar(RKCommandCenter *engine, RKRadar *radar) {
     for (i = 0; i < engine->radarCount; i++) {
         if (engine->radars[i] == radar) {
             RKLog("%s Removing '%s' ...\n", engine->name, radar->desc.name);
-            while (i < engine->radarCount - 1) {
-                engine->radars[i] = engine->radars[i + 1];
+            for (j = i; j < engine->radarCount - 1; j++) {
+                engine->radars[j] = engine->radars[j + 1];
+                engine->healthNodes[j] = engine->healthNodes[j + 1];
+                engine->rayDropCountLastHealth[j] = engine->rayDropCountLastHealth[j + 1];
             }
             engine->radarCount--;
+            engine->radars[engine->radarCount] = NULL;
         }
     }
     for (i = 0; i < engine->server->maxClient; i++) {
@@ -1659,16 +2639,35 @@ void RKCommandCenterRemoveRadar(RKCommandCenter *engine, RKRadar *radar) {
 
 void RKCommandCenterStart(RKCommandCenter *center) {
     RKLog("%s Starting ...\n", center->name);
+    center->executorActive = true;
+    if (pthread_create(&center->executorThreadId, NULL, commandExecutor, center)) {
+        RKLog("%s Error. Unable to launch the executor.\n", center->name);
+        center->executorActive = false;
+    }
     RKServerStart(center->server);
-    RKLog("%s Started.   mem = %s B   radarCount = %s\n", center->name, RKUIntegerToCommaStyleString(center->memoryUsage), RKIntegerToCommaStyleString(center->radarCount));
+    pthread_mutex_lock(&center->mutex);
+    const size_t memoryUsage = center->memoryUsage;
+    pthread_mutex_unlock(&center->mutex);
+    RKLog("%s Started.   mem = %s B   radarCount = %s\n", center->name, RKUIntegerToCommaStyleString(memoryUsage), RKIntegerToCommaStyleString(center->radarCount));
 }
 
 void RKCommandCenterStop(RKCommandCenter *center) {
     if (center->verbose) {
         RKLog("%s Stopping ...\n", center->name);
     }
+    if (center->executorActive) {
+        pthread_mutex_lock(&center->executorMutex);
+        center->executorActive = false;
+        pthread_cond_signal(&center->executorPosted);
+        pthread_mutex_unlock(&center->executorMutex);
+        pthread_join(center->executorThreadId, NULL);
+    }
     RKServerStop(center->server);
-    RKLog("%s Stopped.\n", center->name);
+    pthread_mutex_lock(&center->rayStreamMutex);
+    const uint64_t hits = center->rayStreamHitCount;
+    const uint64_t misses = center->rayStreamMissCount;
+    pthread_mutex_unlock(&center->rayStreamMutex);
+    RKLog("%s Stopped.   rayStream hit = %s   miss = %s\n", center->name, RKUIntegerToCommaStyleString(hits), RKUIntegerToCommaStyleString(misses));
 }
 
 void RKCommandCenterSkipToCurrent(RKCommandCenter *engine, RKRadar *radar) {
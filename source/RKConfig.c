@@ -17,6 +17,10 @@ size_t RKConfigBufferAlloc(RKConfig **mem, const uint32_t configBufferDepth) {
         return 0;
     }
     memset(configs, 0, configBufferDepth * sizeof(RKConfig));
+    // Identifiers of the slots that were never written, the first config of slot k gets k
+    for (uint32_t k = 0; k < configBufferDepth; k++) {
+        configs[k].i = (RKIdentifier)k - configBufferDepth;
+    }
     return bytes;
 }
 
@@ -49,26 +53,34 @@ void RKConfigAdvance(RKConfig *configs, uint32_t *configIndex, uint32_t configBu
         pthread_mutex_destroy(&lock);
         return;
     }
+    if (configs == NULL || configIndex == NULL || configBufferDepth == 0) {
+        return;
+    }
 
     for (k = 0; k < RKMaximumFilterCount; k++) {
         memset(stringBuffer[k], 0, RKStatusStringLength * sizeof(char));
     }
 
-    // Use exclusive access here to prevent multiple processes trying to change RKConfig too quickly
+    // Use exclusive access here to prevent multiple processes trying to change RKConfig too quickly, readers never wait
     pthread_mutex_lock(&lock);
 
     RKConfig *newConfig = &configs[*configIndex];
     RKConfig *oldConfig = &configs[RKPreviousModuloS(*configIndex, configBufferDepth)];
 
-    const RKIdentifier configId = newConfig->i + configBufferDepth;
+    // A slot left retired by a bad input is followed by the id after the latest config
+    const RKIdentifier configId = newConfig->i == RKConfigIdInvalid ? oldConfig->i + 1 : newConfig->i + configBufferDepth;
+
+    // Retire the identifier of the slot so that RKConfigWithId() does not match it while it is being written
+    __atomic_store_n(&newConfig->i, RKConfigIdInvalid, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
 
     //RKLog("--- RKConfigAdvance()   Id = %llu ---\n", configId);
 
     RKWaveform *waveform;
     RKWaveformCalibration *waveformCal;
 
-    // Copy everything
-    memcpy(newConfig, oldConfig, sizeof(RKConfig));
+    // Copy everything except the identifier
+    memcpy((uint8_t *)newConfig + sizeof(RKIdentifier), (uint8_t *)oldConfig + sizeof(RKIdentifier), sizeof(RKConfig) - sizeof(RKIdentifier));
 
     n = 0;
     uint32_t key = va_arg(args, RKConfigKey);
@@ -168,6 +180,9 @@ void RKConfigAdvance(RKConfig *configs, uint32_t *configIndex, uint32_t configBu
                 waveform = (RKWaveform *)va_arg(args, void *);
                 if (waveform == NULL || waveform->filterCounts[0] == 0) {
                     RKLog("Bad input for RKConfigKeyWaveform\n");
+                    // The slot stays retired, part of it has been overwritten
+                    va_end(args);
+                    pthread_mutex_unlock(&lock);
                     return;
                 }
                 newConfig->waveform = waveform;
@@ -180,6 +195,9 @@ void RKConfigAdvance(RKConfig *configs, uint32_t *configIndex, uint32_t configBu
                 waveform = (RKWaveform *)va_arg(args, void *);
                 if (waveform == NULL || waveform->filterCounts[0] == 0) {
                     RKLog("Bad input for RKConfigKeyWaveformDecimate\n");
+                    // The slot stays retired, part of it has been overwritten
+                    va_end(args);
+                    pthread_mutex_unlock(&lock);
                     return;
                 }
                 newConfig->waveformDecimate = waveform;
@@ -299,18 +317,23 @@ void RKConfigAdvance(RKConfig *configs, uint32_t *configIndex, uint32_t configBu
 
     va_end(args);
 
-    // Update the identifier and the buffer index
-    newConfig->i = configId;
-    *configIndex = RKNextModuloS(*configIndex, configBufferDepth);
+    // Publish the identifier, then the buffer index
+    __atomic_store_n(&newConfig->i, configId, __ATOMIC_RELEASE);
+    __atomic_store_n(configIndex, RKNextModuloS(*configIndex, configBufferDepth), __ATOMIC_RELEASE);
 
     pthread_mutex_unlock(&lock);
 }
 
+// Configs are addressed by id % configBufferDepth, the scan is only a fallback for buffers that are not aligned
 RKConfig *RKConfigWithId(RKConfig *configs, uint32_t configBufferDepth, uint64_t id) {
+    RKConfig *config = &configs[id % configBufferDepth];
+    if (__atomic_load_n(&config->i, __ATOMIC_ACQUIRE) == id) {
+        return config;
+    }
     int k = configBufferDepth;
     while (k > 0) {
         k--;
-        if (configs[k].i == id) {
+        if (__atomic_load_n(&configs[k].i, __ATOMIC_ACQUIRE) == id) {
             return &configs[k];
         }
     }
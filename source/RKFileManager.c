@@ -8,8 +8,9 @@
 
 #include <RadarKit/RKFileManager.h>
 
-#define RKFileManagerFolderListCapacity      60
+#define RKFileManagerFolderListCapacity      400                                  // A little over a year of daily folders
 #define RKFileManagerLogFileListCapacity     1000
+#define RKFileManagerEventBufferSize         (64 * 1024)
 
 // The way RadarKit names the files should be relatively short:
 // Folder: YYYYMMDD                              ( 6 chars)
@@ -23,21 +24,27 @@
 
 typedef char RKPathname[RKFileManagerFilenameLength];
 typedef struct _rk_indexed_stat {
-    int      index;
+    int      index;                                                                // Position in the heap, -1 if vacant
     int      folderId;
+    int      next;                                                                 // Next slot in the same hash bucket, or the next vacant slot
     time_t   time;
     size_t   size;
 } RKIndexedStat;
+typedef struct _rk_indexed_folder {
+    RKPathname   name;                                                             // Empty if vacant
+    int          count;                                                            // Number of files in the index
+    int          wd;                                                               // Watch descriptor, -1 if not watched
+} RKIndexedFolder;
+typedef struct _rk_file_removal {
+    RKFileRemover   *remover;
+    size_t          size;
+    bool            isFolder;
+    uint8_t         tries;
+    char            path[2 * RKFileManagerFilenameLength];                         // folder/filename or folder, relative to the path of the remover
+} RKFileRemoval;
 
 #pragma mark - Helper Functions
 
-// Compare two unix time in RKIndexedStat
-static int struct_cmp_by_time(const void *a, const void *b) {
-    RKIndexedStat *x = (RKIndexedStat *)a;
-    RKIndexedStat *y = (RKIndexedStat *)b;
-    return (int)(x->time - y->time);
-}
-
 // Compare two filenames in the pattern of YYYYMMDD, e.g., 20170402
 static int string_cmp_by_pseudo_time(const void *a, const void *b) {
     return strncmp((char *)a, (char *)b, 8);
@@ -61,10 +68,19 @@ static time_t timeFromFilename(const char *filename) {
         return 0;
     }
     struct tm tm;
+    memset(&tm, 0, sizeof(struct tm));
     strptime(yyyymmdd, "%Y%m%d-%H%M%S", &tm);
     return mktime(&tm);
 }
 
+static uint32_t filenameHash(const char *filename) {
+    uint32_t h = 2166136261u;
+    while (*filename) {
+        h = (h ^ (uint8_t)*filename++) * 16777619u;
+    }
+    return h;
+}
+
 static int listElementsInFolder(RKPathname *list, const int maximumCapacity, const char *path, uint8_t type) {
     int r, k = 0;
     struct dirent *dir;
@@ -85,7 +101,7 @@ static int listElementsInFolder(RKPathname *list, const int maximumCapacity, con
     while ((dir = readdir(did)) != NULL && k < maximumCapacity) {
         if (dir->d_type == DT_UNKNOWN && dir->d_name[0] != '.') {
             //sprintf(pathname, "%s/%s", path, dir->d_name);
-            int r = sprintf(pathname, "%s/", path);
+            int r = snprintf(pathname, sizeof(pathname), "%s/", path);
             strncpy(pathname + r, dir->d_name, RKMaximumPathLength - r - 1);
             pathname[RKMaximumPathLength - 1] = '\0';
             lstat(pathname, &status);
@@ -115,10 +131,6 @@ static int listFoldersInFolder(RKPathname *list, const int maximumCapacity, cons
     return listElementsInFolder(list, maximumCapacity, path, DT_DIR);
 }
 
-static int listFilesInFolder(RKPathname *list, const int maximumCapacity, const char *path) {
-    return listElementsInFolder(list, maximumCapacity, path, DT_REG);
-}
-
 static bool isFolderEmpty(const char *path) {
     struct dirent *dir;
     DIR *did = opendir(path);
@@ -136,132 +148,530 @@ static bool isFolderEmpty(const char *path) {
     return true;
 }
 
-static void refreshFileList(RKFileRemover *me) {
-    int i, j, k;
-    struct stat fileStat;
-    char command[RKMaximumPathLength + 8];
-    char string[RKMaximumStringLength];
-    char format[32];
+#pragma mark - File Index
+
+static void heapSwap(RKFileRemover *me, const int i, const int j) {
+    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
+    const int k = me->heap[i];
+    me->heap[i] = me->heap[j];
+    me->heap[j] = k;
+    indexedStats[me->heap[i]].index = i;
+    indexedStats[me->heap[j]].index = j;
+}
+
+static void heapUp(RKFileRemover *me, int i) {
+    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
+    int p;
+    while (i > 0) {
+        p = (i - 1) / 2;
+        if (indexedStats[me->heap[p]].time <= indexedStats[me->heap[i]].time) {
+            break;
+        }
+        heapSwap(me, i, p);
+        i = p;
+    }
+}
 
-    RKPathname *folders = (RKPathname *)me->folders;
+static void heapDown(RKFileRemover *me, int i) {
+    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
+    int c;
+    while ((c = 2 * i + 1) < me->count) {
+        if (c + 1 < me->count && indexedStats[me->heap[c + 1]].time < indexedStats[me->heap[c]].time) {
+            c++;
+        }
+        if (indexedStats[me->heap[i]].time <= indexedStats[me->heap[c]].time) {
+            break;
+        }
+        heapSwap(me, i, c);
+        i = c;
+    }
+}
+
+static int findFolder(RKFileRemover *me, const char *name) {
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    for (int k = 0; k < RKFileManagerFolderListCapacity; k++) {
+        if (folders[k].name[0] != '\0' && !strcmp(folders[k].name, name)) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+static int findFolderOfWatch(RKFileRemover *me, const int wd) {
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    for (int k = 0; k < RKFileManagerFolderListCapacity; k++) {
+        if (folders[k].name[0] != '\0' && folders[k].wd == wd) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+// The latest folder may still receive files, it is kept even when it is empty
+static bool isLatestFolder(RKFileRemover *me, const int folderId) {
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    for (int k = 0; k < RKFileManagerFolderListCapacity; k++) {
+        if (folders[k].name[0] != '\0' && string_cmp_by_pseudo_time(folders[k].name, folders[folderId].name) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int addFolder(RKFileRemover *me, const char *name) {
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    int k = findFolder(me, name);
+    if (k >= 0) {
+        return k;
+    }
+    if (strlen(name) > RKFileManagerFilenameLength - 1) {
+        RKLog("%s Warning. Folder name %s is too long.\n", me->name, name);
+        me->consistent = false;
+        return -1;
+    }
+    for (k = 0; k < RKFileManagerFolderListCapacity && folders[k].name[0] != '\0'; k++) {
+        continue;
+    }
+    if (k == RKFileManagerFolderListCapacity) {
+        if (me->consistent) {
+            RKLog("%s Warning. Too many folders in '%s'.\n", me->name, me->path);
+        }
+        me->consistent = false;
+        return -1;
+    }
+    strcpy(folders[k].name, name);
+    folders[k].count = 0;
+    folders[k].wd = -1;
+    #if defined(RKFileManagerHasInotify)
+    if (me->fd >= 0) {
+        char path[RKMaximumPathLength + 256];
+        if (me->wd < 0) {
+            me->wd = inotify_add_watch(me->fd, me->path, IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR);
+        }
+        snprintf(path, sizeof(path), "%s/%s", me->path, name);
+        folders[k].wd = inotify_add_watch(me->fd, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+    }
+    #endif
+    me->folderCount++;
+    return k;
+}
+
+static void forgetFolder(RKFileRemover *me, const int folderId) {
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    #if defined(RKFileManagerHasInotify)
+    if (me->fd >= 0 && folders[folderId].wd >= 0) {
+        inotify_rm_watch(me->fd, folders[folderId].wd);
+    }
+    #endif
+    folders[folderId].name[0] = '\0';
+    folders[folderId].count = 0;
+    folders[folderId].wd = -1;
+    me->folderCount--;
+}
+
+static int findFile(RKFileRemover *me, const char *name) {
     RKPathname *filenames = (RKPathname *)me->filenames;
     RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
-    if (indexedStats == NULL) {
-        RKLog("%s Not properly allocated.\n", me->name);
-        return;
+    int k = me->buckets[filenameHash(name) & me->bucketMask];
+    while (k >= 0 && strcmp(filenames[k], name)) {
+        k = indexedStats[k].next;
+    }
+    return k;
+}
+
+// Add a file to the index, or update the size if it is already there, returns false if the index is full
+static bool indexFile(RKFileRemover *me, const int folderId, const char *name, const size_t size) {
+    RKPathname *filenames = (RKPathname *)me->filenames;
+    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    int k = findFile(me, name);
+    if (k >= 0) {
+        me->usage = me->usage - indexedStats[k].size + size;
+        indexedStats[k].size = size;
+        return true;
+    }
+    me->usage += size;
+    if ((me->vacancy < 0 && me->allocated == me->capacity) || strlen(name) > RKFileManagerFilenameLength - 1) {
+        if (me->consistent) {
+            RKLog("%s Info. At capacity. Suggest keeping less data on main host.\n", me->name);
+        }
+        me->consistent = false;
+        return false;
+    }
+    if (me->vacancy >= 0) {
+        k = me->vacancy;
+        me->vacancy = indexedStats[k].next;
+    } else {
+        k = me->allocated++;
     }
+    strcpy(filenames[k], name);
+    indexedStats[k].folderId = folderId;
+    indexedStats[k].time = timeFromFilename(name);
+    indexedStats[k].size = size;
+    const uint32_t b = filenameHash(name) & me->bucketMask;
+    indexedStats[k].next = me->buckets[b];
+    me->buckets[b] = k;
+    indexedStats[k].index = me->count;
+    me->heap[me->count++] = k;
+    heapUp(me, indexedStats[k].index);
+    folders[folderId].count++;
+    return true;
+}
+
+static void unindexFile(RKFileRemover *me, const int k) {
+    RKPathname *filenames = (RKPathname *)me->filenames;
+    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    int *p = &me->buckets[filenameHash(filenames[k]) & me->bucketMask];
+    while (*p != k) {
+        p = &indexedStats[*p].next;
+    }
+    *p = indexedStats[k].next;
+    const int i = indexedStats[k].index;
+    if (i < --me->count) {
+        heapSwap(me, i, me->count);
+        heapUp(me, i);
+        heapDown(me, i);
+    }
+    me->usage -= indexedStats[k].size;
+    folders[indexedStats[k].folderId].count--;
+    indexedStats[k].index = -1;
+    indexedStats[k].next = me->vacancy;
+    me->vacancy = k;
+}
 
-    me->index = 0;
+// Index all the files of a folder, returns the number of files or -1 if the folder cannot be opened
+static int scanFolder(RKFileRemover *me, const int folderId) {
+    int r, count = 0;
+    struct dirent *dir;
+    struct stat fileStat;
+    char path[RKMaximumPathLength + 256];
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    r = snprintf(path, sizeof(path), "%s/%s/", me->path, folders[folderId].name);
+    DIR *did = opendir(path);
+    if (did == NULL) {
+        return -1;
+    }
+    while ((dir = readdir(did)) != NULL) {
+        if (dir->d_name[0] == '.' || (dir->d_type != DT_REG && dir->d_type != DT_UNKNOWN)) {
+            continue;
+        }
+        snprintf(path + r, sizeof(path) - r, "%s", dir->d_name);
+        if (lstat(path, &fileStat) || !S_ISREG(fileStat.st_mode)) {
+            continue;
+        }
+        indexFile(me, folderId, dir->d_name, fileStat.st_size);
+        count++;
+    }
+    closedir(did);
+    return count;
+}
+
+static void clearIndex(RKFileRemover *me) {
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+    for (int k = 0; k < RKFileManagerFolderListCapacity; k++) {
+        if (folders[k].name[0] != '\0') {
+            forgetFolder(me, k);
+        }
+    }
+    memset(me->buckets, 0xFF, (me->bucketMask + 1) * sizeof(int));
     me->count = 0;
     me->usage = 0;
+    me->vacancy = -1;
+    me->allocated = 0;
+    me->consistent = true;
+}
+
+#pragma mark - Removals
+
+static bool openPath(RKFileRemover *me) {
+    if (me->dirfd < 0) {
+        me->dirfd = open(me->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    return me->dirfd >= 0;
+}
+
+static uint32_t vacantRemovalCount(RKFileManager *engine) {
+    pthread_mutex_lock(&engine->removalMutex);
+    const uint32_t count = RKFileManagerRemovalQueueDepth - (engine->removalTail - engine->removalHead);
+    pthread_mutex_unlock(&engine->removalMutex);
+    return count;
+}
+
+// Queue a file, or a folder if name is NULL, for the removal workers, returns false if the queue is full
+static bool queueRemoval(RKFileRemover *me, const char *folder, const char *name, const size_t size) {
+    RKFileManager *engine = me->parent;
+    RKFileRemoval *removals = (RKFileRemoval *)engine->removals;
+    pthread_mutex_lock(&engine->removalMutex);
+    if (engine->removalTail - engine->removalHead >= RKFileManagerRemovalQueueDepth) {
+        pthread_mutex_unlock(&engine->removalMutex);
+        return false;
+    }
+    RKFileRemoval *removal = &removals[engine->removalTail % RKFileManagerRemovalQueueDepth];
+    removal->remover = me;
+    removal->size = size;
+    removal->isFolder = name == NULL;
+    removal->tries = 0;
+    if (name) {
+        snprintf(removal->path, sizeof(removal->path), "%s/%s", folder, name);
+    } else {
+        snprintf(removal->path, sizeof(removal->path), "%s", folder);
+    }
+    engine->removalTail++;
+    pthread_cond_signal(&engine->removalCondition);
+    pthread_mutex_unlock(&engine->removalMutex);
+    return true;
+}
+
+// List all folders and files, only at start or when the index is no longer consistent
+static void refreshFileList(RKFileRemover *me) {
+    int k, count;
+    char string[RKMaximumPathLength + 256];
+    char format[32];
+
+    if (me->indexedStats == NULL) {
+        RKLog("%s Not properly allocated.\n", me->name);
+        return;
+    }
+
+    clearIndex(me);
+    me->scanCount++;
+
+    #if defined(RKFileManagerHasInotify)
+    if (me->fd >= 0 && me->wd < 0) {
+        me->wd = inotify_add_watch(me->fd, me->path, IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR);
+    }
+    #endif
 
     // Go through all folders
-    int folderCount = listFoldersInFolder(folders, RKFileManagerFolderListCapacity, me->path);
+    RKPathname *list = (RKPathname *)malloc(RKFileManagerFolderListCapacity * sizeof(RKPathname));
+    if (list == NULL) {
+        RKLog("%s Error. Unable to allocate space for folder list.\n", me->name);
+        return;
+    }
+    int folderCount = listFoldersInFolder(list, RKFileManagerFolderListCapacity, me->path);
     if (folderCount <= 0) {
-        me->reusable = true;
+        free(list);
         return;
     }
 
     // Sort the folders by name (should be in time numbers)
-    qsort(folders, folderCount, sizeof(RKPathname), string_cmp_by_pseudo_time);
+    qsort(list, folderCount, sizeof(RKPathname), string_cmp_by_pseudo_time);
 
     if (me->parent->verbose > 2) {
         const int w = RKDigitWidth((float)folderCount, 0);
         RKLog("%s Folders (%d)   w = %d:\n", me->name, folderCount, w);
         snprintf(format, sizeof(format), ">%%s %%%dd. %%s\n", w);
         for (k = 0; k < folderCount; k++) {
-            snprintf(string, sizeof(string), "%s/%s", me->path, folders[k]);
+            snprintf(string, sizeof(string), "%s/%s", me->path, list[k]);
             RKLog(format, me->name, k, string);
         }
     }
 
-    // Go through all files in the folders
-    for (j = 0, k = 0; k < folderCount && me->count < me->capacity; k++) {
-        snprintf(string, sizeof(string), "%s/%s", me->path, folders[k]);
-        int count = listFilesInFolder(&filenames[me->count], me->capacity - me->count, string);
+    // Go through all files in the folders, oldest first so that they are in the index if it fills up
+    for (k = 0; k < folderCount; k++) {
+        const int folderId = addFolder(me, list[k]);
+        if (folderId < 0) {
+            break;
+        }
+        snprintf(string, sizeof(string), "%s/%s", me->path, list[k]);
+        count = scanFolder(me, folderId);
         if (me->parent->verbose > 1) {
             RKLog("%s %s (%s files)\n", me->name, string, RKIntegerToCommaStyleString(count));
         }
         if (count < 0) {
             RKLog("%s Error. Unable to list files in %s\n", me->name, string);
-            return;
-        } else if (count == 0) {
+        } else if (count == 0 && k < folderCount - 1) {
             RKLog(">%s Removing %s ...\n", me->name, string);
-            i = snprintf(command, RKMaximumCommandLength, "rm -rf %s", string);
-            if (i < 0) {
-                RKLog("%s Error. Failed generating system command.\n", me->name);
-                RKLog("%s Error. path = %s.\n", me->name, string);
-                break;
-            }
-            i = system(command);
-            if (i) {
-                RKLog("Error. system(%s) -> %d   errno = %d\n", command, i, errno);
+            if (!openPath(me) || !queueRemoval(me, list[k], NULL, 0)) {
+                if (RKRemoveFolder(string)) {
+                    RKLog("%s Error. Unable to remove %s   errno = %d\n", me->name, string, errno);
+                }
             }
-        } else if (count == me->capacity - me->count) {
-            RKLog("%s Info. At capacity. Suggest keeping less data on main host.\n", me->name);
-        }
-        me->count += count;
-        if (me->count > me->capacity) {
-            RKLog("%s Error. %s > %s", me->name,
-                  RKVariableInString("count", &me->count, RKValueTypeInt), RKVariableInString("capacity", &me->capacity, RKValueTypeInt));
-            return;
-        }
-        for (; j < me->count; j++) {
-            sprintf(string, "%s/%s/%s", me->path, folders[k], filenames[j]);
-            stat(string, &fileStat);
-            indexedStats[j].index = j;
-            indexedStats[j].folderId = k;
-            indexedStats[j].time = timeFromFilename(filenames[j]);
-            indexedStats[j].size = fileStat.st_size;
-            me->usage += fileStat.st_size;
+            forgetFolder(me, folderId);
         }
     }
 
-    // Sort the files by time
-    qsort(indexedStats, me->count, sizeof(RKIndexedStat), struct_cmp_by_time);
-
     if (me->parent->verbose > 2) {
-        RKLog("%s Files (%s):\n", me->name, RKIntegerToCommaStyleString(me->count));
-        for (k = 0; k < me->count; k++) {
-            RKLog(">%s %5s. %s/%s/%s  %zu %d i%d\n", me->name,
-                  RKIntegerToCommaStyleString(k),
-                  me->parent->dataPath, folders[indexedStats[k].folderId], filenames[indexedStats[k].index],
-                  indexedStats[k].time, indexedStats[k].folderId, indexedStats[k].index);
-        }
+        RKLog("%s Files (%s)   folders = %d\n", me->name, RKIntegerToCommaStyleString(me->count), me->folderCount);
     }
 
-    // We can operate in a circular buffer fashion if all the files are accounted
-    if (me->count < me->capacity) {
-        me->reusable = true;
-    } else {
-        me->reusable = false;
+    if (!me->consistent) {
         if (folderCount == 1) {
             RKLog("%s Warning. Too many files in '%s'.\n", me->name, me->path);
             RKLog("%s Warning. Unexpected file removals may occur.\n", me->name);
         }
-        // Re-calculate the usage since all slots have been used but there were still more files
-        me->usage = 0;
-        for (k = 0; k < folderCount; k++) {
-            struct dirent *dir;
-            sprintf(string, "%s/%s/%s", me->path, folders[k], filenames[j]);
-            DIR *did = opendir(string);
-            if (did == NULL) {
-                fprintf(stderr, "Unable to list folder '%s'\n", string);
+        RKLog("%s Truncated list with total usage = %s B\n", me->name, RKUIntegerToCommaStyleString(me->usage));
+    }
+    free(list);
+}
+
+#if defined(RKFileManagerHasInotify)
+
+// Files and folders that come and go without RKFileManagerAddFile(), e.g., removed by other processes
+static void processEvents(RKFileRemover *me) {
+    int j, k;
+    ssize_t r;
+    char *c;
+    bool overflow = false;
+    struct stat fileStat;
+    char path[RKMaximumPathLength + 256];
+    char buffer[RKFileManagerEventBufferSize] __attribute__((aligned(__alignof__(struct inotify_event))));
+    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
+    RKIndexedFolder *folders = (RKIndexedFolder *)me->folders;
+
+    while ((r = read(me->fd, buffer, sizeof(buffer))) > 0) {
+        for (c = buffer; c < buffer + r; c += sizeof(struct inotify_event) + ((struct inotify_event *)c)->len) {
+            const struct inotify_event *event = (struct inotify_event *)c;
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
                 continue;
             }
-            while ((dir = readdir(did)) != NULL) {
-                sprintf(string, "%s/%s/%s", me->path, folders[k], dir->d_name);
-                stat(string, &fileStat);
-                me->usage += fileStat.st_size;
+            if (event->wd == me->wd) {
+                // Folders in path
+                if (event->len == 0 || !(event->mask & IN_ISDIR)) {
+                    continue;
+                }
+                k = findFolder(me, event->name);
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    if (k < 0 && (k = addFolder(me, event->name)) >= 0) {
+                        scanFolder(me, k);
+                    }
+                } else if (k >= 0) {
+                    if (folders[k].count) {
+                        overflow = true;
+                    } else {
+                        forgetFolder(me, k);
+                    }
+                }
+                continue;
+            }
+            if ((k = findFolderOfWatch(me, event->wd)) < 0) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                folders[k].wd = -1;
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                snprintf(path, sizeof(path), "%s/%s/%s", me->path, folders[k].name, event->name);
+                if (stat(path, &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+                    indexFile(me, k, event->name, fileStat.st_size);
+                    gettimeofday(&me->latestTime, NULL);
+                }
+            } else if ((j = findFile(me, event->name)) >= 0 && indexedStats[j].folderId == k) {
+                unindexFile(me, j);
             }
-            closedir(did);
         }
-        RKLog("%s Truncated list with total usage = %s B\n", me->name, RKUIntegerToCommaStyleString(me->usage));
+    }
+    if (overflow) {
+        RKLog("%s Events overflowed. Refreshing file list ...\n", me->name);
+        refreshFileList(me);
     }
 }
 
+#endif
+
+// Wait for the events of the folders, returns the number of events processed
+static int waitForEvents(RKFileRemover *me, const int milliseconds) {
+    #if defined(RKFileManagerHasInotify)
+    if (me->fd >= 0) {
+        struct pollfd pfd = {.fd = me->fd, .events = POLLIN};
+        if (poll(&pfd, 1, milliseconds) > 0) {
+            pthread_mutex_lock(&me->parent->mutex);
+            processEvents(me);
+            pthread_mutex_unlock(&me->parent->mutex);
+            return 1;
+        }
+        return 0;
+    }
+    #endif
+    usleep(1000 * milliseconds);
+    return 0;
+}
+
 #pragma mark - Delegate Workers
 
+// Unlink the files in the queue relative to the directory of their remover, within the budget of removals and bytes per second
+static void *fileRemovalWorker(void *in) {
+    RKFileManager *engine = (RKFileManager *)in;
+    RKFileRemoval *removals = (RKFileRemoval *)engine->removals;
+    RKFileRemoval removal;
+    struct timeval now;
+    double dt, wait;
+    char path[RKMaximumPathLength + 256];
+
+    pthread_mutex_lock(&engine->removalMutex);
+    while (engine->removalWantActive) {
+        if (engine->removalHead == engine->removalTail) {
+            pthread_cond_wait(&engine->removalCondition, &engine->removalMutex);
+            continue;
+        }
+        // Refill the budgets, up to one second worth, bytes can be borrowed so that a large file does not wait forever
+        gettimeofday(&now, NULL);
+        dt = RKTimevalDiff(now, engine->removalTime);
+        engine->removalTime = now;
+        if (engine->removalRate > 0.0) {
+            engine->removalTokens = MIN(engine->removalRate, engine->removalTokens + engine->removalRate * dt);
+        }
+        if (engine->removalBytes > 0) {
+            engine->removalByteTokens = MIN((double)engine->removalBytes, engine->removalByteTokens + (double)engine->removalBytes * dt);
+        }
+        wait = 0.0;
+        if (engine->removalRate > 0.0 && engine->removalTokens < 1.0) {
+            wait = (1.0 - engine->removalTokens) / engine->removalRate;
+        }
+        if (engine->removalBytes > 0 && engine->removalByteTokens < 0.0) {
+            wait = MAX(wait, -engine->removalByteTokens / (double)engine->removalBytes);
+        }
+        if (wait > 0.0) {
+            pthread_mutex_unlock(&engine->removalMutex);
+            usleep((useconds_t)(1.0e6 * MIN(wait, 0.1)));
+            pthread_mutex_lock(&engine->removalMutex);
+            continue;
+        }
+        removal = removals[engine->removalHead++ % RKFileManagerRemovalQueueDepth];
+        engine->removalTokens -= 1.0;
+        engine->removalByteTokens -= (double)removal.size;
+        pthread_mutex_unlock(&engine->removalMutex);
+
+        RKFileRemover *me = removal.remover;
+        if (unlinkat(me->dirfd, removal.path, removal.isFolder ? AT_REMOVEDIR : 0) == 0) {
+            if (removal.isFolder) {
+                RKLog("%s Removed folder %s/%s that is empty.\n", me->name, me->path, removal.path);
+            } else {
+                __atomic_add_fetch(&engine->removeCount, 1, __ATOMIC_RELEASE);
+            }
+        } else if (removal.isFolder && (errno == ENOTEMPTY || errno == EEXIST)) {
+            snprintf(path, sizeof(path), "%s/%s", me->path, removal.path);
+            if (removal.tries < 3) {
+                // Files of the folder may still be with the other workers, try again later
+                usleep(10000);
+                pthread_mutex_lock(&engine->removalMutex);
+                if (engine->removalTail - engine->removalHead < RKFileManagerRemovalQueueDepth) {
+                    removal.tries++;
+                    removals[engine->removalTail++ % RKFileManagerRemovalQueueDepth] = removal;
+                }
+                pthread_mutex_unlock(&engine->removalMutex);
+            } else if (isFolderEmpty(path)) {
+                RKLog("%s Removing folder %s that has no files ...\n", me->name, path);
+                if (RKRemoveFolder(path)) {
+                    RKLog("%s Error. Unable to remove %s   errno = %d\n", me->name, path, errno);
+                }
+            }
+        } else if (errno != ENOENT) {
+            RKLog("%s Error. Unable to remove %s/%s   errno = %d\n", me->name, me->path, removal.path, errno);
+        }
+
+        pthread_mutex_lock(&engine->removalMutex);
+    }
+    pthread_mutex_unlock(&engine->removalMutex);
+    return NULL;
+}
+
 static void *fileRemover(void *in) {
     RKFileRemover *me = (RKFileRemover *)in;
     RKFileManager *engine = me->parent;
@@ -271,8 +681,6 @@ static void *fileRemover(void *in) {
     const int c = me->id;
 
     char path[RKMaximumPathLength + 256];
-    char command[RKMaximumPathLength];
-    char parentFolder[RKFileManagerFilenameLength] = "";
     struct timeval time = {0, 0};
 
 	// Initiate my name
@@ -297,8 +705,8 @@ static void *fileRemover(void *in) {
     size_t bytes;
     size_t mem = 0;
 
-    bytes = RKFileManagerFolderListCapacity * sizeof(RKPathname);
-    RKPathname *folders = (RKPathname *)malloc(bytes);
+    bytes = RKFileManagerFolderListCapacity * sizeof(RKIndexedFolder);
+    RKIndexedFolder *folders = (RKIndexedFolder *)malloc(bytes);
     if (folders == NULL) {
         RKLog("%s Error. Unable to allocate space for folder list.\n", me->name);
         return (void *)-1;
@@ -306,6 +714,7 @@ static void *fileRemover(void *in) {
     memset(folders, 0, bytes);
     mem += bytes;
 
+    // The file list is only touched as it is filled
     bytes = me->capacity * sizeof(RKPathname);
     RKPathname *filenames = (RKPathname *)malloc(bytes);
     if (filenames == NULL) {
@@ -313,23 +722,53 @@ static void *fileRemover(void *in) {
         free(folders);
         return (void *)-2;
     }
-    memset(filenames, 0, bytes);
     mem += bytes;
 
-    bytes = me->capacity * sizeof(RKIndexedStat);
-    RKIndexedStat *indexedStats = (RKIndexedStat *)malloc(bytes);
-    if (indexedStats == NULL) {
+    bytes = me->capacity * (sizeof(RKIndexedStat) + sizeof(int));
+    RKIndexedStat *indexedStats = (RKIndexedStat *)malloc(me->capacity * sizeof(RKIndexedStat));
+    int *heap = (int *)malloc(me->capacity * sizeof(int));
+    if (indexedStats == NULL || heap == NULL) {
         RKLog("%s Error. Unable to allocate space for indexed stats.\n", me->name);
         free(folders);
         free(filenames);
+        free(indexedStats);
+        free(heap);
+        return (void *)-2;
+    }
+    mem += bytes;
+
+    // Hash table of about four files per bucket when the index is full
+    me->bucketMask = 1023;
+    while (me->bucketMask < me->capacity / 4) {
+        me->bucketMask = (me->bucketMask << 1) | 1;
+    }
+    bytes = (me->bucketMask + 1) * sizeof(int);
+    int *buckets = (int *)malloc(bytes);
+    if (buckets == NULL) {
+        RKLog("%s Error. Unable to allocate space for file hash table.\n", me->name);
+        free(folders);
+        free(filenames);
+        free(indexedStats);
+        free(heap);
         return (void *)-2;
     }
-    memset(indexedStats, 0, bytes);
     mem += bytes;
 
     me->folders = folders;
     me->filenames = filenames;
     me->indexedStats = indexedStats;
+    me->heap = heap;
+    me->buckets = buckets;
+    me->folderCount = 0;
+    me->fd = -1;
+    me->wd = -1;
+
+    #if defined(RKFileManagerHasInotify)
+    me->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (me->fd < 0) {
+        RKLog("%s Warning. Unable to watch %s   errno = %d\n", me->name, me->path, errno);
+    }
+    #endif
 
     pthread_mutex_lock(&engine->mutex);
     engine->memoryUsage += mem;
@@ -337,12 +776,9 @@ static void *fileRemover(void *in) {
     // Gather the initial file list in the folders
     refreshFileList(me);
 
-    // Use the first folder as the initial value of parentFolder
-    strcpy(parentFolder, folders[0]);
-
     RKLog(">%s Started.   mem = %s B   capacity = %s\n",
           me->name, RKUIntegerToCommaStyleString(mem), RKUIntegerToCommaStyleString(me->capacity));
-    RKLog(">%s Path = %s\n", me->name, me->path);
+    RKLog(">%s Path = %s%s\n", me->name, me->path, me->fd >= 0 ? "   watched" : "");
     if (me->limit > 10 * 1024 * 1024) {
         RKLog(">%s Listed.  count = %s   usage = %s / %s MB (%.2f %%)\n", me->name,
               RKIntegerToCommaStyleString(me->count),
@@ -369,7 +805,6 @@ static void *fileRemover(void *in) {
 
     engine->state |= RKEngineStateActive;
 
-    me->index = 0;
     while (engine->state & RKEngineStateWantActive) {
 
         pthread_mutex_lock(&engine->mutex);
@@ -378,80 +813,80 @@ static void *fileRemover(void *in) {
             RKLog("%s Usage -> %s B / %s B\n", me->name, RKUIntegerToCommaStyleString(me->usage), RKUIntegerToCommaStyleString(me->limit));
         }
 
-        // Removing files
+        // Removing files, oldest first
+        bool refreshed = false;
         while (me->usage > me->limit) {
+            if (me->count == 0) {
+                // The files that are not in the index, list them again but only once
+                if (refreshed) {
+                    break;
+                }
+                if (engine->verbose) {
+                    RKLog("%s Refreshing file list ...\n", me->name);
+                }
+                refreshFileList(me);
+                refreshed = true;
+                continue;
+            }
+            // Leave the rest for the next round if the removal workers are behind
+            if (vacantRemovalCount(engine) < 2 || !openPath(me)) {
+                break;
+            }
+            k = heap[0];
+            const int folderId = indexedStats[k].folderId;
             // Build the complete path from various components
-            sprintf(path, "%s/%s/%s", me->path, folders[indexedStats[me->index].folderId], filenames[indexedStats[me->index].index]);
+            sprintf(path, "%s/%s/%s", me->path, folders[folderId].name, filenames[k]);
             if (engine->verbose) {
-				if (indexedStats[me->index].size > 1.0e9) {
-					RKLog("%s Removing %s (%s GB) ...\n", me->name, path, RKFloatToCommaStyleString(1.0e-9f * (float)indexedStats[me->index].size));
-				} else if (indexedStats[me->index].size > 1.0e6) {
-					RKLog("%s Removing %s (%s MB) ...\n", me->name, path, RKFloatToCommaStyleString(1.0e-6f * (float)indexedStats[me->index].size));
-				} else if (indexedStats[me->index].size > 1.0e3) {
-					RKLog("%s Removing %s (%s KB) ...\n", me->name, path, RKFloatToCommaStyleString(1.0e-3f * (float)indexedStats[me->index].size));
+				if (indexedStats[k].size > 1.0e9) {
+					RKLog("%s Removing %s (%s GB) ...\n", me->name, path, RKFloatToCommaStyleString(1.0e-9f * (float)indexedStats[k].size));
+				} else if (indexedStats[k].size > 1.0e6) {
+					RKLog("%s Removing %s (%s MB) ...\n", me->name, path, RKFloatToCommaStyleString(1.0e-6f * (float)indexedStats[k].size));
+				} else if (indexedStats[k].size > 1.0e3) {
+					RKLog("%s Removing %s (%s KB) ...\n", me->name, path, RKFloatToCommaStyleString(1.0e-3f * (float)indexedStats[k].size));
 				} else {
-					RKLog("%s Removing %s (%s B) ...\n", me->name, path, RKUIntegerToCommaStyleString(indexedStats[me->index].size));
+					RKLog("%s Removing %s (%s B) ...\n", me->name, path, RKUIntegerToCommaStyleString(indexedStats[k].size));
 				}
             }
-            if (!strlen(parentFolder)) {
-                strcpy(parentFolder, folders[indexedStats[me->index].folderId]);
-                RKLog("%s Set parentFolder to %s\n", me->name, parentFolder);
-            }
-            remove(path);
-            me->usage -= indexedStats[me->index].size;
+            // The usage is accounted from the index as soon as the file is queued
+            queueRemoval(me, folders[folderId].name, filenames[k], indexedStats[k].size);
+            unindexFile(me, k);
 			if (engine->verbose > 1) {
 				RKLog("%s Usage -> %s B / %s B\n", me->name, RKUIntegerToCommaStyleString(me->usage), RKUIntegerToCommaStyleString(me->limit));
 			}
 
-            // Get the parent folder, if it is different than before, check if it is empty, and remove it if so.
-            if (strcmp(parentFolder, folders[indexedStats[me->index].folderId])) {
-                sprintf(path, "%s/%s", me->path, parentFolder);
-                if (isFolderEmpty(path)) {
-                    RKLog("%s Removing folder %s that is empty ...\n", me->name, path);
-                    k = snprintf(command, RKMaximumCommandLength, "rm -rf %s", path);
-                    if (k < 0) {
-                        RKLog("%s Error. Failed generating system command.\n", me->name);
-                        RKLog("%s Error. path = %s.\n", me->name, path);
-                        break;
-                    }
-                    k = system(command);
-                    if (k) {
-                        RKLog("Error. system(%s) -> %d   errno = %d\n", command, k, errno);
-                    }
-                }
-                RKLog("%s New parentFolder = %s -> %s\n", me->name, parentFolder, folders[indexedStats[me->index].folderId]);
-                strcpy(parentFolder, folders[indexedStats[me->index].folderId]);
-            }
-
-            // Update the index for next check or refresh it entirely if there are too many files
-            me->index++;
-            if (me->index == me->capacity) {
-                me->index = 0;
-                if (me->reusable) {
-                    if (engine->verbose) {
-                        RKLog("%s Reusable file list rotated to 0.\n", me->name);
-                    }
-                } else {
-                    if (engine->verbose) {
-                        RKLog("%s Refreshing file list ...\n", me->name);
-                    }
-                    refreshFileList(me);
-                }
+            // Remove the folder once it is empty
+            if (folders[folderId].count == 0 && !isLatestFolder(me, folderId)) {
+                queueRemoval(me, folders[folderId].name, NULL, 0);
+                forgetFolder(me, folderId);
             }
         }
 
         pthread_mutex_unlock(&engine->mutex);
 
-        // Now we wait
+        // Now we wait, the events of the folders are processed as they come
         k = 0;
-        while ((k++ < 10 || RKTimevalDiff(time, me->latestTime) < 0.2) && engine->state & RKEngineStateWantActive) {
+        while ((k < 10 || RKTimevalDiff(time, me->latestTime) < 0.2) && engine->state & RKEngineStateWantActive) {
             gettimeofday(&time, NULL);
-            usleep(100000);
+            if (waitForEvents(me, 100) == 0) {
+                k++;
+            }
         }
     }
 
+    #if defined(RKFileManagerHasInotify)
+    if (me->fd >= 0) {
+        close(me->fd);
+        me->fd = -1;
+    }
+    #endif
+    // RKFileManagerAddFile() may still be in the middle of indexing a file
+    pthread_mutex_lock(&engine->mutex);
+    free(folders);
     free(filenames);
     free(indexedStats);
+    free(heap);
+    free(buckets);
+    pthread_mutex_unlock(&engine->mutex);
 
     RKLog(">%s Stopped.\n", me->name);
 
@@ -534,6 +969,20 @@ static void *folderWatcher(void *in) {
     memset(engine->workers, 0, engine->workerCount * sizeof(RKFileRemover));
     engine->memoryUsage += engine->workerCount * sizeof(RKFileRemover);
 
+    // Workers that unlink the files queued by the file removers
+    engine->removalHead = 0;
+    engine->removalTail = 0;
+    engine->removalTokens = engine->removalRate;
+    engine->removalByteTokens = (double)engine->removalBytes;
+    gettimeofday(&engine->removalTime, NULL);
+    engine->removalWantActive = true;
+    for (k = 0; k < RKFileManagerRemovalWorkerCount; k++) {
+        if (pthread_create(&engine->tidRemovalWorkers[k], NULL, fileRemovalWorker, engine) != 0) {
+            RKLog(">%s Error. Failed to start a file removal worker.\n", engine->name);
+            return (void *)RKResultFailedToStartFileRemover;
+        }
+    }
+
     for (k = 0; k < engine->workerCount; k++) {
         RKFileRemover *worker = &engine->workers[k];
         const char *folder = folders[k];
@@ -541,6 +990,7 @@ static void *folderWatcher(void *in) {
         worker->id = k;
         worker->parent = engine;
         worker->capacity = capacities[k];
+        worker->dirfd = -1;
         if (engine->radarDescription != NULL && strlen(engine->radarDescription->dataPath)) {
             snprintf(worker->path, sizeof(worker->path), "%s/%s", engine->radarDescription->dataPath, folder);
         } else if (strlen(engine->dataPath)) {
@@ -618,6 +1068,20 @@ static void *folderWatcher(void *in) {
     for (k = 0; k < engine->workerCount; k++) {
         pthread_join(engine->workers[k].tid, NULL);
     }
+
+    // Files still in the queue are left for the next start
+    pthread_mutex_lock(&engine->removalMutex);
+    engine->removalWantActive = false;
+    pthread_cond_broadcast(&engine->removalCondition);
+    pthread_mutex_unlock(&engine->removalMutex);
+    for (k = 0; k < RKFileManagerRemovalWorkerCount; k++) {
+        pthread_join(engine->tidRemovalWorkers[k], NULL);
+    }
+    for (k = 0; k < engine->workerCount; k++) {
+        if (engine->workers[k].dirfd >= 0) {
+            close(engine->workers[k].dirfd);
+        }
+    }
     free(engine->workers);
 
     return NULL;
@@ -637,8 +1101,18 @@ RKFileManager *RKFileManagerInit(void) {
             rkGlobalParameters.showColor ? RKNoColor : "");
     engine->state = RKEngineStateAllocated;
     engine->maximumLogAgeInDays = RKFileManagerDefaultLogAgeInDays;
-    engine->memoryUsage = sizeof(RKFileManager);
+    engine->removalRate = RKFileManagerDefaultRemovalRate;
+    engine->removalBytes = RKFileManagerDefaultRemovalBytes;
+    engine->removals = malloc(RKFileManagerRemovalQueueDepth * sizeof(RKFileRemoval));
+    if (engine->removals == NULL) {
+        RKLog("Error. Unable to allocate a removal queue.\n");
+        free(engine);
+        return NULL;
+    }
+    engine->memoryUsage = sizeof(RKFileManager) + RKFileManagerRemovalQueueDepth * sizeof(RKFileRemoval);
     pthread_mutex_init(&engine->mutex, NULL);
+    pthread_mutex_init(&engine->removalMutex, NULL);
+    pthread_cond_init(&engine->removalCondition, NULL);
     return engine;
 }
 
@@ -647,6 +1121,9 @@ void RKFileManagerFree(RKFileManager *engine) {
         RKFileManagerStop(engine);
     }
     pthread_mutex_destroy(&engine->mutex);
+    pthread_mutex_destroy(&engine->removalMutex);
+    pthread_cond_destroy(&engine->removalCondition);
+    free(engine->removals);
     free(engine);
 }
 
@@ -696,6 +1173,15 @@ void RKFileManagerSetMomentDataLimit(RKFileManager *engine, const size_t limit)
     engine->userMomentDataUsageLimit = limit;
 }
 
+void RKFileManagerSetRemovalRate(RKFileManager *engine, const double filesPerSecond, const size_t bytesPerSecond) {
+    if (engine->state & RKEngineStateActive) {
+        RKLog("%s Removal rate can only be set before it is started.\n", engine->name);
+        return;
+    }
+    engine->removalRate = filesPerSecond;
+    engine->removalBytes = bytesPerSecond;
+}
+
 void RKFileManagerSetHealthDataLimit(RKFileManager *engine, const size_t limit) {
     if (engine->state & RKEngineStateActive) {
         RKLog("%s Data limit can only be set before it is started.\n", engine->name);
@@ -745,109 +1231,66 @@ int RKFileManagerStop(RKFileManager *engine) {
     RKLog("%s Stopping ...\n", engine->name);
     engine->state |= RKEngineStateDeactivating;
     engine->state ^= RKEngineStateWantActive;
+    pthread_mutex_unlock(&engine->mutex);
+    // The removers take the mutex to process their events until they see the state, so join without it
     pthread_join(engine->tidFileWatcher, NULL);
     engine->state ^= RKEngineStateDeactivating;
     RKLog("%s Stopped.\n", engine->name);
     if (engine->state != (RKEngineStateAllocated | RKEngineStateProperlyWired)) {
         RKLog("%s Inconsistent state 0x%04x\n", engine->name, engine->state);
     }
-    pthread_mutex_unlock(&engine->mutex);
     return RKResultSuccess;
 }
 
 int RKFileManagerAddFile(RKFileManager *engine, const char *filename, RKFileType type) {
     RKFileRemover *me = &engine->workers[type];
+    struct stat fileStat;
 
     if (!(engine->state & RKEngineStateWantActive)) {
         return RKResultEngineNotActive;
     }
 
-    pthread_mutex_lock(&engine->mutex);
-
-    struct stat fileStat;
-    stat(filename, &fileStat);
-
-    gettimeofday(&me->latestTime, NULL);
-
-    // For non-reusable type, just add the size
-    if (me->reusable == false) {
-        me->usage += fileStat.st_size;
-        pthread_mutex_unlock(&engine->mutex);
-        return RKResultFileManagerBufferNotResuable;
+    // [me->path]/YYYYMMDD/RK-YYYYMMDD-...
+    const size_t length = strlen(me->path);
+    const char *name = strrchr(filename, '/');
+    if (strncmp(me->path, filename, length) || filename[length] != '/' || name == NULL || name == filename + length) {
+        RKLog("%s File %s does not belong here (%s).\n", engine->name, filename, me->path);
+        return RKResultFileManagerInconsistentFolder;
     }
-
-    RKPathname *folders = (RKPathname *)me->folders;
-    RKPathname *filenames = (RKPathname *)me->filenames;
-    RKIndexedStat *indexedStats = (RKIndexedStat *)me->indexedStats;
-
-    // Copy over the filename and stats to the internal buffer
-    uint32_t k = me->count;
-
-    // Extract out the date portion
-    char *lastPart = strrchr(filename, '/');
-    if (lastPart) {
-        if (strlen(lastPart) > RKFileManagerFilenameLength - 1) {
-            RKLog("%s Error. I could crash here.\n", me->name);
-        }
-        if ((void *)&filenames[k] > ((void *)filenames) + me->capacity * sizeof(RKPathname) - RKFileManagerFilenameLength) {
-            RKLog("%s Error. I could crash here.   %p vs %p   k = %d / %d\n", me->name,
-                  (void *)&filenames[k], ((void *)filenames) + me->capacity * sizeof(RKPathname) - RKFileManagerFilenameLength,
-                  k, me->capacity);
-        }
-        strncpy(filenames[k], lastPart + 1, RKFileManagerFilenameLength - 1);
-    } else {
-        if (strlen(filename) > RKFileManagerFilenameLength - 1) {
-            RKLog("%s %s Warning. Filename is too long.\n", engine->name,  me->name);
-        }
-        strncpy(filenames[k], filename, RKFileManagerFilenameLength - 1);
+    if (stat(filename, &fileStat)) {
+        RKLog("%s Error. Unable to get the size of %s   errno = %d\n", me->name, filename, errno);
+        return RKResultFailedToOpenFile;
     }
 
-    if (strncmp(me->path, filename, strlen(me->path))) {
-        RKLog("%s File %s does not belong here (%s).\n", engine->name, filename, me->path);
-        return RKResultFileManagerInconsistentFolder;
+    pthread_mutex_lock(&engine->mutex);
+
+    // The engine may have been told to stop since the check above
+    if (!(engine->state & RKEngineStateWantActive)) {
+        pthread_mutex_unlock(&engine->mutex);
+        return RKResultEngineNotActive;
     }
 
-    // [me->path]/YYYYMMDD/RK-YYYYMMDD-...
+    gettimeofday(&me->latestTime, NULL);
 
-    int folderId = 0;
     char *folder = engine->scratch;
-    strcpy(folder, filename + strlen(me->path) + 1);
-    char *e = strrchr(folder, '/');
-    *e = '\0';
-    if (strlen(folder) > RKFileManagerFilenameLength - 1) {
-        RKLog("%s Warning. Folder name is too long.\n", engine->name);
-    }
-    if (k == 0) {
-        // The data folder is empty
-        folderId = 0;
-        strcpy(folders[0], folder);
-    } else {
-        folderId = indexedStats[k - 1].folderId;
-        // If same folder as the previous entry, no need to add another folder in the list. Add one otherwise.
-        if (strcmp(folder, folders[indexedStats[k - 1].folderId])) {
-            folderId++;
-            strcpy(folders[indexedStats[k - 1].folderId + 1], folder);
+    snprintf(folder, MIN(RKMaximumStringLength, name - filename - length), "%s", filename + length + 1);
+    name++;
+
+    const int folderId = addFolder(me, folder);
+    if (folderId < 0 || !indexFile(me, folderId, name, fileStat.st_size)) {
+        // Only the usage is accounted, the file will be found in the next full scan
+        if (folderId < 0) {
+            me->usage += fileStat.st_size;
         }
+        pthread_mutex_unlock(&engine->mutex);
+        return RKResultFileManagerBufferNotResuable;
     }
-    //printf("%s --> %s / %s (%d)\n", filename, folder, filenames[k], folderId);
-
-    indexedStats[k].index = k;
-    indexedStats[k].folderId = folderId;
-    indexedStats[k].time = timeFromFilename(filenames[k]);
-    indexedStats[k].size = fileStat.st_size;
-
-    me->usage += fileStat.st_size;
 
     if (engine->verbose > 2) {
-        RKLog("%s Added '%s'   %s B   k = %d\n", me->name, filename, RKUIntegerToCommaStyleString(indexedStats[k].size), k);
+        RKLog("%s Added '%s'   %s B   count = %d\n", me->name, filename, RKUIntegerToCommaStyleString(fileStat.st_size), me->count);
     }
 
-    me->count = RKNextModuloS(me->count, me->capacity);
-
     pthread_mutex_unlock(&engine->mutex);
 
-    //for (k = me->count - 3; k < me->count; k++) {
-    //    printf("%3d -> %3d. %s  %s\n", k, indexedStats[k].index, filenames[indexedStats[k].index], RKUIntegerToCommaStyleString(indexedStats[k].size));
-    //}
     return RKResultSuccess;
 }
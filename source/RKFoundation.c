@@ -90,78 +90,86 @@ RKComplex RKComplexArraySum(RKComplex *src, const int count) {
 
 #pragma mark - Logger
 
-int RKLog(const char *whatever, ...) {
-    if (rkGlobalParameters.stream == NULL && rkGlobalParameters.logfile[0] == 0) {
-        return 0;
-    }
-    int i = 0;
-    size_t len;
-    struct timeval utc;
-    va_list args;
-    struct tm tm;
-
-    // Local memory
-    static char *msg = NULL;
-    static char *filename = NULL;
-    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
-
-    if (msg == NULL) {
-        msg = (char *)malloc(RKMaximumStringLength * sizeof(char));
-    }
-    if (filename == NULL) {
-        filename = (char *)malloc(RKMaximumPathLength * sizeof(char));
-    }
-    if (msg == NULL || filename == NULL) {
-        fprintf(stderr, "Error in RKLog().\n");
-        free(filename);
-        free(msg);
-        return -1;
-    }
-
-    if (whatever == NULL) {
-        va_start(args, whatever);
-        if (va_arg(args, void *) == NULL) {
-            #if defined(DEBUG_MUTEX_DESTROY)
-            fprintf(stderr, "Deallocating RKLog's internal stuff ...\n");
-            #endif
-            if (msg) {
-                free(msg);
-            }
-            if (filename) {
-                free(filename);
-            }
-            pthread_mutex_destroy(&lock);
-        }
-        va_end(args);
-        return 0;
-    }
-
-    pthread_mutex_lock(&lock);
-
-    // Get the time
-    gettimeofday(&utc, NULL);
-    memcpy(&tm, gmtime(&utc.tv_sec), sizeof(struct tm));
+//
+// Asynchronous mode
+//
+// Each thread that logs owns a ring of RKLogRingDepth entries, or the depth set
+// through RKSetLogRingDepth() when the ring was created. The thread stamps
+// an entry with a raw clock reading, formats the message into it and publishes it
+// by advancing the head. Nothing is shared with other threads, so there is no lock.
+// The logger thread drains the rings in time order, formats the time stamps and
+// writes to the stream and the log file in batches. It sleeps up to
+// RKLogIdleInterval and is woken up early when a ring reaches half full. When a
+// ring is full, the message is dropped and counted instead of blocking the
+// caller. The ring of a thread that exits is reused by the next thread that logs.
+//
+// The message itself is formatted by the caller because the arguments, e.g., the
+// strings of RKIntegerToCommaStyleString(), cannot be kept until the logger runs.
+//
 
-    // Construct the string
-    va_start(args, whatever);
-    if (strlen(whatever) > RKMaximumStringLength - 256) {
-        fprintf(stderr, "RKLog() could potential crash for string '%s'\n", whatever);
-        return 1;
-    }
+typedef struct rk_log_entry {
+    struct timespec      time;
+    bool                 continued;                                            // Message started with '>', no time stamp
+    char                 text[RKLogEntryLength];
+} RKLogEntry;
+
+typedef struct rk_log_ring {
+    RKLogEntry           *entries;
+    uint32_t             depth;                                                // A power of 2 so that the head and tail can wrap
+    uint32_t             head;                                                 // Advanced by the owner thread
+    uint32_t             tail;                                                 // Advanced by the logger thread
+    uint32_t             cursor;                                               // Next entry to write, used by the logger thread
+    uint32_t             end;                                                  // Head when the drain started, used by the logger thread
+    uint64_t             dropCount;                                            // Incremented by the owner thread
+    uint64_t             reportedDropCount;                                    // Used by the logger thread
+    bool                 claimed;
+    bool                 busy;                                                 // Owner thread is between the check and the publish
+    struct rk_log_ring   *next;
+} RKLogRing;
+
+static struct {
+    RKLogRing            *rings;
+    pthread_t            tid;
+    pthread_key_t        key;
+    pthread_once_t       once;
+    pthread_mutex_t      mutex;
+    pthread_cond_t       wake;                                                 // Signaled when a ring reaches half full
+    uint32_t             depth;                                                // Depth of the rings created from now on
+    bool                 active;
+    bool                 exitRegistered;
+    char                 filename[RKMaximumPathLength];
+    FILE                 *file;
+} rkLogger = {.once = PTHREAD_ONCE_INIT, .mutex = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .depth = RKLogRingDepth};
+
+static __thread RKLogRing *rkLogThreadRing = NULL;
+
+// Time stamp of a log entry, returns the number of characters
+static int RKLogStamp(char *msg, const struct timespec *time, const bool continued, struct tm *tm) {
+    int i = 0;
+    gmtime_r(&time->tv_sec, tm);
     if (rkGlobalParameters.logTimeOnly) {
-        if (whatever[0] == '>') {
+        if (continued) {
             i += sprintf(msg, "             ");
         } else {
-            i += strftime(msg, 16, "%T", &tm);
-            i += sprintf(msg + i, ".%03d ", (int)utc.tv_usec / 1000);
+            i += strftime(msg, 16, "%T", tm);
+            i += sprintf(msg + i, ".%03d ", (int)(time->tv_nsec / 1000000));
         }
     } else {
-        if (whatever[0] == '>') {
+        if (continued) {
             i += sprintf(msg, "                    ");
         } else {
-            i += strftime(msg, 32, "%Y/%m/%d %T ", &tm);
+            i += strftime(msg, 32, "%Y/%m/%d %T ", tm);
         }
     }
+    return i;
+}
+
+// Message with the keyword colored and a trailing new line, returns the number of characters
+static int RKLogCompose(char *msg, const size_t size, const char *whatever, va_list args) {
+    int i;
+    size_t len;
+    char colored_whatever[RKMaximumStringLength];
+
     char *okay_str = strcasestr(whatever, "ok");
     char *info_str = strcasestr(whatever, "info");
     char *error_str = strcasestr(whatever, "error");
@@ -174,8 +182,6 @@ int RKLog(const char *whatever, ...) {
     char *anchor = (char *)whatever + (whatever[0] == '>' ? 1 : 0);
 
     if (has_ok || has_info || has_error || has_warning) {
-        char *colored_whatever = (char *)malloc(RKMaximumPacketSize * sizeof(char));
-
         if (has_ok) {
             len = (size_t)(okay_str - anchor);
         } else if (has_info) {
@@ -205,30 +211,32 @@ int RKLog(const char *whatever, ...) {
                 len += sprintf(colored_whatever + len, RKYellowColor);
             }
         }
-        strncpy(colored_whatever + len, anchor, RKMaximumStringLength - len);
+        snprintf(colored_whatever + len, RKMaximumStringLength - len, "%s", anchor);
 
-        i += vsprintf(msg + i, colored_whatever, args);
+        i = vsnprintf(msg, size, colored_whatever, args);
 
-        if (rkGlobalParameters.showColor) {
-            sprintf(msg + i, RKNoColor);
+        if (rkGlobalParameters.showColor && i >= 0 && i < size) {
+            i += snprintf(msg + i, size - i, RKNoColor);
         }
-
-        free(colored_whatever);
     } else {
-        vsprintf(msg + i, anchor, args);
+        i = vsnprintf(msg, size, anchor, args);
     }
-
-    if (whatever[strlen(whatever) - 1] != '\n') {
-        strncat(msg, "\n", RKMaximumStringLength - 1);
+    if (i < 0) {
+        i = 0;
+        msg[0] = '\0';
+    } else if (i >= size - 1) {
+        i = (int)size - 2;
     }
-    va_end(args);
-    // Produce the string to the specified stream
-    if (rkGlobalParameters.stream) {
-        fprintf(rkGlobalParameters.stream, "%s", msg);
-        fflush(rkGlobalParameters.stream);
+    if (whatever[0] == '\0' || whatever[strlen(whatever) - 1] != '\n') {
+        msg[i++] = '\n';
+        msg[i] = '\0';
     }
-    // Write the string to a file if specified
-    FILE *logFileID = NULL;
+    return i;
+}
+
+// Name of the log file at the time tm, returns false if there is no log file
+static bool RKLogFilename(char *filename, const struct tm *tm) {
+    int i;
     if (rkGlobalParameters.dailyLog) {
         if (strlen(rkGlobalParameters.logFolder)) {
             i = sprintf(filename, "%s/%s-", rkGlobalParameters.logFolder, rkGlobalParameters.program);
@@ -237,14 +245,13 @@ int RKLog(const char *whatever, ...) {
         } else {
             i = 0;
         }
-        strftime(filename + i, RKNameLength - i, "%Y%m%d.log", &tm);
+        strftime(filename + i, RKNameLength - i, "%Y%m%d.log", tm);
         if (i) {
             RKPreparePath(filename);
         }
-        logFileID = fopen(filename, "a");
+        return true;
     } else if (strlen(rkGlobalParameters.logfile)) {
         if (strlen(rkGlobalParameters.logFolder)) {
-            //sprintf(filename, "%s/%s", rkGlobalParameters.logFolder, rkGlobalParameters.logfile);
             i = snprintf(filename, RKMaximumPathLength, "%s/%s", rkGlobalParameters.logFolder, rkGlobalParameters.logfile);
             if (i < 0) {
                 fprintf(stderr, "Failed to generate filename.\n");
@@ -253,11 +260,339 @@ int RKLog(const char *whatever, ...) {
             strcpy(filename, rkGlobalParameters.logfile);
         }
         RKPreparePath(filename);
-        logFileID = fopen(filename, "a");
+        return true;
+    }
+    return false;
+}
+
+static void RKLogReleaseRing(void *in) {
+    RKLogRing *ring = (RKLogRing *)in;
+    __atomic_store_n(&ring->claimed, false, __ATOMIC_RELEASE);
+}
+
+static void RKLogCreateKey(void) {
+    pthread_key_create(&rkLogger.key, RKLogReleaseRing);
+}
+
+// Ring of the calling thread, claimed from a thread that has exited or newly allocated
+static RKLogRing *RKLogGetRing(void) {
+    RKLogRing *ring;
+    if (rkLogThreadRing) {
+        return rkLogThreadRing;
+    }
+    pthread_once(&rkLogger.once, RKLogCreateKey);
+    for (ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        bool claimed = false;
+        if (__atomic_compare_exchange_n(&ring->claimed, &claimed, true, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (ring == NULL) {
+        ring = (RKLogRing *)malloc(sizeof(RKLogRing));
+        if (ring == NULL) {
+            return NULL;
+        }
+        memset(ring, 0, sizeof(RKLogRing));
+        ring->depth = __atomic_load_n(&rkLogger.depth, __ATOMIC_RELAXED);
+        ring->entries = (RKLogEntry *)malloc(ring->depth * sizeof(RKLogEntry));
+        if (ring->entries == NULL) {
+            free(ring);
+            return NULL;
+        }
+        // Touch the pages now rather than on the first pass through the ring
+        memset(ring->entries, 0, ring->depth * sizeof(RKLogEntry));
+        ring->claimed = true;
+        ring->next = __atomic_load_n(&rkLogger.rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&rkLogger.rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+    }
+    pthread_setspecific(rkLogger.key, ring);
+    rkLogThreadRing = ring;
+    return ring;
+}
+
+static void RKLogWriteEntry(const RKLogEntry *entry, char *msg, char *filename) {
+    struct tm tm;
+    int i = RKLogStamp(msg, &entry->time, entry->continued, &tm);
+    snprintf(msg + i, RKLogEntryLength + 32 - i, "%s", entry->text);
+    if (rkGlobalParameters.stream) {
+        fputs(msg, rkGlobalParameters.stream);
+    }
+    if (!RKLogFilename(filename, &tm)) {
+        return;
+    }
+    if (rkLogger.file == NULL || strcmp(filename, rkLogger.filename)) {
+        if (rkLogger.file) {
+            fclose(rkLogger.file);
+        }
+        rkLogger.file = fopen(filename, "a");
+        strcpy(rkLogger.filename, filename);
+    }
+    if (rkLogger.file) {
+        fputs(msg, rkLogger.file);
+    }
+}
+
+// Write out everything in the rings in time order, returns the number of entries
+static int RKLogDrain(void) {
+    int n = 0;
+    uint64_t dropCount;
+    RKLogRing *ring, *oldest;
+    RKLogEntry drops;
+    char msg[RKLogEntryLength + 32];
+    char filename[RKMaximumPathLength];
+
+    // Take what has been published so far, the cursors are private to the logger
+    for (ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        ring->cursor = ring->tail;
+        ring->end = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    }
+    do {
+        oldest = NULL;
+        for (ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+            if (ring->cursor == ring->end) {
+                continue;
+            }
+            if (oldest == NULL || RKTimespecDiff(ring->entries[ring->cursor % ring->depth].time,
+                                                 oldest->entries[oldest->cursor % oldest->depth].time) < 0.0) {
+                oldest = ring;
+            }
+        }
+        if (oldest) {
+            RKLogWriteEntry(&oldest->entries[oldest->cursor % oldest->depth], msg, filename);
+            oldest->cursor++;
+            n++;
+        }
+    } while (oldest);
+    // Give the entries back to the owners
+    for (ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        if (ring->tail != ring->cursor) {
+            __atomic_store_n(&ring->tail, ring->cursor, __ATOMIC_RELEASE);
+        }
+    }
+
+    for (ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        dropCount = __atomic_load_n(&ring->dropCount, __ATOMIC_RELAXED);
+        if (dropCount != ring->reportedDropCount) {
+            RKUTCTime(&drops.time);
+            drops.continued = false;
+            snprintf(drops.text, RKLogEntryLength, "%sWarning. Log ring full, %llu messages dropped.%s\n",
+                     rkGlobalParameters.showColor ? RKYellowColor : "",
+                     (unsigned long long)(dropCount - ring->reportedDropCount),
+                     rkGlobalParameters.showColor ? RKNoColor : "");
+            RKLogWriteEntry(&drops, msg, filename);
+            ring->reportedDropCount = dropCount;
+            n++;
+        }
+    }
+
+    if (n) {
+        if (rkGlobalParameters.stream) {
+            fflush(rkGlobalParameters.stream);
+        }
+        if (rkLogger.file) {
+            fflush(rkLogger.file);
+        }
+    }
+    return n;
+}
+
+// Absolute time of now + us for pthread_cond_timedwait()
+static void RKLogDeadline(struct timespec *deadline, const long us) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_nsec += us * 1000L;
+    deadline->tv_sec += deadline->tv_nsec / 1000000000L;
+    deadline->tv_nsec %= 1000000000L;
+}
+
+static void *RKLogger(void *in) {
+    struct timespec deadline;
+    while (__atomic_load_n(&rkLogger.active, __ATOMIC_ACQUIRE)) {
+        if (RKLogDrain() == 0) {
+            RKLogDeadline(&deadline, RKLogIdleInterval);
+            pthread_mutex_lock(&rkLogger.mutex);
+            pthread_cond_timedwait(&rkLogger.wake, &rkLogger.mutex, &deadline);
+            pthread_mutex_unlock(&rkLogger.mutex);
+        }
+    }
+    return NULL;
+}
+
+static void RKLogStopAtExit(void) {
+    RKSetAsynchronousLog(false);
+}
+
+void RKSetAsynchronousLog(const bool yes) {
+    RKLogRing *ring;
+    if (yes == __atomic_load_n(&rkLogger.active, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    if (yes) {
+        __atomic_store_n(&rkLogger.active, true, __ATOMIC_SEQ_CST);
+        if (pthread_create(&rkLogger.tid, NULL, RKLogger, NULL)) {
+            __atomic_store_n(&rkLogger.active, false, __ATOMIC_SEQ_CST);
+            fprintf(stderr, "Error. Unable to launch the logger.\n");
+            return;
+        }
+        if (!rkLogger.exitRegistered) {
+            rkLogger.exitRegistered = true;
+            atexit(RKLogStopAtExit);
+        }
+        return;
+    }
+    // Stop taking new entries, wait for the writers that are in the middle of one, then write out the rest
+    __atomic_store_n(&rkLogger.active, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&rkLogger.mutex);
+    pthread_cond_signal(&rkLogger.wake);
+    pthread_mutex_unlock(&rkLogger.mutex);
+    pthread_join(rkLogger.tid, NULL);
+    for (ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        while (__atomic_load_n(&ring->busy, __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+    }
+    RKLogDrain();
+    if (rkLogger.file) {
+        fclose(rkLogger.file);
+        rkLogger.file = NULL;
+    }
+}
+
+// Depth of the rings created from now on, rounded up to a power of 2
+void RKSetLogRingDepth(const uint32_t depth) {
+    uint32_t d = 16;
+    while (d < depth && d < (1U << 31)) {
+        d <<= 1;
+    }
+    __atomic_store_n(&rkLogger.depth, d, __ATOMIC_RELAXED);
+}
+
+bool RKGetAsynchronousLog(void) {
+    return __atomic_load_n(&rkLogger.active, __ATOMIC_ACQUIRE);
+}
+
+uint64_t RKLogGetDropCount(void) {
+    uint64_t count = 0;
+    for (RKLogRing *ring = __atomic_load_n(&rkLogger.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        count += __atomic_load_n(&ring->dropCount, __ATOMIC_RELAXED);
     }
-    if (logFileID) {
-        fprintf(logFileID, "%s", msg);
-        fclose(logFileID);
+    return count;
+}
+
+// Queue an entry in the ring of the calling thread, returns false if the logger is not active
+static bool RKLogQueue(const char *whatever, va_list args, int *result) {
+    RKLogRing *ring = rkLogThreadRing ? rkLogThreadRing : RKLogGetRing();
+    if (ring == NULL) {
+        return false;
+    }
+    __atomic_store_n(&ring->busy, true, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&rkLogger.active, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&ring->busy, false, __ATOMIC_RELEASE);
+        return false;
+    }
+    const uint32_t head = ring->head;
+    const uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= ring->depth) {
+        __atomic_store_n(&ring->dropCount, ring->dropCount + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&ring->busy, false, __ATOMIC_RELEASE);
+        *result = 1;
+        return true;
+    }
+    RKLogEntry *entry = &ring->entries[head % ring->depth];
+    RKUTCTime(&entry->time);
+    entry->continued = whatever[0] == '>';
+    RKLogCompose(entry->text, RKLogEntryLength, whatever, args);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->busy, false, __ATOMIC_RELEASE);
+    // Wake up the logger early when the ring reaches half full
+    if (head + 1 - tail == ring->depth / 2) {
+        pthread_cond_signal(&rkLogger.wake);
+    }
+    *result = 0;
+    return true;
+}
+
+int RKLog(const char *whatever, ...) {
+    if (rkGlobalParameters.stream == NULL && rkGlobalParameters.logfile[0] == 0) {
+        return 0;
+    }
+    int i = 0;
+    va_list args;
+    struct tm tm;
+    struct timespec utc;
+
+    // Local memory
+    static char *msg = NULL;
+    static char *filename = NULL;
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+    if (whatever == NULL) {
+        va_start(args, whatever);
+        if (va_arg(args, void *) == NULL) {
+            #if defined(DEBUG_MUTEX_DESTROY)
+            fprintf(stderr, "Deallocating RKLog's internal stuff ...\n");
+            #endif
+            if (msg) {
+                free(msg);
+                msg = NULL;
+            }
+            if (filename) {
+                free(filename);
+                filename = NULL;
+            }
+            pthread_mutex_destroy(&lock);
+        }
+        va_end(args);
+        return 0;
+    }
+
+    if (strlen(whatever) > RKMaximumStringLength - 256) {
+        fprintf(stderr, "RKLog() could potential crash for string '%s'\n", whatever);
+        return 1;
+    }
+
+    // Asynchronous mode, the entry goes to the ring of this thread
+    if (__atomic_load_n(&rkLogger.active, __ATOMIC_RELAXED)) {
+        va_start(args, whatever);
+        bool queued = RKLogQueue(whatever, args, &i);
+        va_end(args);
+        if (queued) {
+            return i;
+        }
+    }
+
+    pthread_mutex_lock(&lock);
+
+    if (msg == NULL) {
+        msg = (char *)malloc(RKMaximumStringLength * sizeof(char));
+    }
+    if (filename == NULL) {
+        filename = (char *)malloc(RKMaximumPathLength * sizeof(char));
+    }
+    if (msg == NULL || filename == NULL) {
+        fprintf(stderr, "Error in RKLog().\n");
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    // Get the time, construct the string
+    RKUTCTime(&utc);
+    i = RKLogStamp(msg, &utc, whatever[0] == '>', &tm);
+    va_start(args, whatever);
+    RKLogCompose(msg + i, RKMaximumStringLength - i, whatever, args);
+    va_end(args);
+
+    // Produce the string to the specified stream
+    if (rkGlobalParameters.stream) {
+        fprintf(rkGlobalParameters.stream, "%s", msg);
+        fflush(rkGlobalParameters.stream);
+    }
+    // Write the string to a file if specified
+    if (RKLogFilename(filename, &tm)) {
+        FILE *logFileID = fopen(filename, "a");
+        if (logFileID) {
+            fprintf(logFileID, "%s", msg);
+            fclose(logFileID);
+        }
     }
     pthread_mutex_unlock(&lock);
     return 0;
@@ -276,6 +611,7 @@ void RKExit(int e) {
     RKFloatToCommaStyleString((double)0xFEEDFACECAFEBEEF);
     RKTimevalToString((struct timeval){0xFEEDFACE, 0}, 0, false);
     pthread_mutex_destroy(&rkGlobalParameters.lock);
+    RKSetAsynchronousLog(false);
     RKLog(NULL, NULL);
     exit(e);
 }
@@ -312,6 +648,22 @@ size_t RKFileGetSize(FILE *fid) {
     return size;
 }
 
+static int rk_remove_entry(const char *path, const struct stat *status, int flag, struct FTW *ftw) {
+    if (remove(path)) {
+        const int e = errno;
+        RKLog("Error. Unable to remove %s   %s\n", path, strerror(e));
+        errno = e;
+        return -1;
+    }
+    return 0;
+}
+
+// Remove a folder and everything in it, in process, i.e., without the cost of forking for "rm -rf".
+// Stops at the first entry that cannot be removed and returns -1 with errno set.
+int RKRemoveFolder(const char *path) {
+    return nftw(path, rk_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
 #pragma mark - Global Preferences
 
 void RKSetStatusColor(const bool color) {
@@ -1280,7 +1632,8 @@ void RKZeroTailIQZ(RKIQZ *data, const uint32_t capacity, const uint32_t origin)
 //    RKComplex          Y[2][capacity];
 //    RKIQZ              Z[2];
 //
-size_t RKPulseBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t count) {
+// Size of a buffer of count pulses, 0 if the capacity does not conform to the SIMD alignment
+size_t RKPulseBufferSize(const uint32_t capacity, const uint32_t count) {
     size_t alignment = RKMemoryAlignSize / sizeof(RKFloat);
     if (capacity != (capacity / alignment) * alignment) {
         RKLog("Error. Unable to allocate for capacity = %s. Must be multiple of %d!",
@@ -1299,15 +1652,20 @@ size_t RKPulseBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t
         RKLog("Error. The total pulse size %s does not conform to SIMD alignment.", RKUIntegerToCommaStyleString(pulseSize));
         return 0;
     }
-    size_t bytes = count * pulseSize;
-    if (posix_memalign((void **)mem, RKMemoryAlignSize, bytes)) {
-        RKLog("Error. Unable to allocate pulse buffer.");
-        exit(EXIT_FAILURE);
+    return count * pulseSize;
+}
+
+// Set up count pulses in a buffer of RKPulseBufferSize() bytes, e.g., from RKPulseBufferAlloc() or shared memory
+void RKPulseBufferInit(RKBuffer mem, const uint32_t capacity, const uint32_t count) {
+    const size_t bytes = RKPulseBufferSize(capacity, count);
+    if (bytes == 0) {
+        return;
     }
-    memset(*mem, 0, bytes);
+    const size_t pulseSize = bytes / count;
+    memset(mem, 0, bytes);
     // Set the pulse capacity
     int i = 0;
-    void *m = *mem;
+    void *m = mem;
     while (i < count) {
         RKPulse *pulse = (RKPulse *)m;
         pulse->header.capacity = capacity;
@@ -1316,6 +1674,18 @@ size_t RKPulseBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t
         m += pulseSize;
         i++;
     }
+}
+
+size_t RKPulseBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t count) {
+    size_t bytes = RKPulseBufferSize(capacity, count);
+    if (bytes == 0) {
+        return 0;
+    }
+    if (posix_memalign((void **)mem, RKMemoryAlignSize, bytes)) {
+        RKLog("Error. Unable to allocate pulse buffer.");
+        exit(EXIT_FAILURE);
+    }
+    RKPulseBufferInit(*mem, capacity, count);
     return bytes;
 }
 
@@ -1504,7 +1874,8 @@ RKPulse *RKGetVacantPulseFromBuffer(RKBuffer pulses, uint32_t *index, const uint
     pulse->header.time.tv_sec = 0;
     pulse->header.time.tv_usec = 0;
     pulse->header.positionIndex = (uint32_t)-1;
-    pulse->header.i += depth;
+    // Vacant before the new identifier is visible, readers of the shared memory load the identifier first
+    __atomic_store_n(&pulse->header.i, pulse->header.i + depth, __ATOMIC_RELEASE);
     *index = RKNextModuloS(*index, depth);
     return pulse;
 }
@@ -1551,7 +1922,8 @@ void RKPulseDuplicateSplitComplex(RKPulse *pulse) {
 //    uint8_t            idata[RKBaseProductCount][capacity];
 //    float              fdata[RKBaseProductCount][capacity];
 //
-size_t RKRayBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t count) {
+// Size of a buffer of count rays, 0 if the capacity does not conform to the SIMD alignment
+size_t RKRayBufferSize(const uint32_t capacity, const uint32_t count) {
     size_t alignment = RKMemoryAlignSize / sizeof(RKFloat);
     if (capacity != (capacity / alignment) * alignment) {
         RKLog("Error. Ray capacity must be a multiple of %d!", alignment);
@@ -1568,15 +1940,20 @@ size_t RKRayBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t c
         RKLog("Error. The total ray size %s does not conform to SIMD alignment.", RKUIntegerToCommaStyleString(raySize));
         return 0;
     }
-    size_t bytes = count * raySize;
-    if (posix_memalign((void **)mem, RKMemoryAlignSize, bytes)) {
-        RKLog("Error. Unable to allocate ray buffer.");
-        exit(EXIT_FAILURE);
+    return count * raySize;
+}
+
+// Set up count rays in a buffer of RKRayBufferSize() bytes, e.g., from RKRayBufferAlloc() or shared memory
+void RKRayBufferInit(RKBuffer mem, const uint32_t capacity, const uint32_t count) {
+    const size_t bytes = RKRayBufferSize(capacity, count);
+    if (bytes == 0) {
+        return;
     }
-    memset(*mem, 0, bytes);
+    const size_t raySize = bytes / count;
+    memset(mem, 0, bytes);
     // Set the ray capacity
     int i = 0;
-    void *m = *mem;
+    void *m = mem;
     while (i < count) {
         RKRay *ray = (RKRay *)m;
         ray->header.capacity = capacity;
@@ -1584,6 +1961,18 @@ size_t RKRayBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t c
         m += raySize;
         i++;
     }
+}
+
+size_t RKRayBufferAlloc(RKBuffer *mem, const uint32_t capacity, const uint32_t count) {
+    size_t bytes = RKRayBufferSize(capacity, count);
+    if (bytes == 0) {
+        return 0;
+    }
+    if (posix_memalign((void **)mem, RKMemoryAlignSize, bytes)) {
+        RKLog("Error. Unable to allocate ray buffer.");
+        exit(EXIT_FAILURE);
+    }
+    RKRayBufferInit(*mem, capacity, count);
     return bytes;
 }
 
@@ -1629,7 +2018,7 @@ RKRay *RKGetVacantRayFromBuffer(RKBuffer rays, uint32_t *index, const uint32_t d
     ray->header.startTime.tv_usec = 0;
     ray->header.endTime.tv_sec = 0;
     ray->header.endTime.tv_usec = 0;
-    ray->header.i += depth;
+    __atomic_store_n(&ray->header.i, ray->header.i + depth, __ATOMIC_RELEASE);
     *index = RKNextModuloS(*index, depth);
     return ray;
 }
@@ -10,29 +10,79 @@
 
 #pragma mark - Helper Functions
 
+// Number of the "Value" of a {"Value":..., "Enum":...} object of a key when the enum is normal, NAN otherwise
+static double RKHealthEngineNormalValueOfKey(const char *string, const char *key) {
+    double number = NAN;
+    char *stringObject, *stringValue, *stringEnum;
+    if ((stringObject = RKGetValueOfKey(string, key)) != NULL) {
+        stringValue = RKGetValueOfKey(stringObject, "value");
+        stringEnum = RKGetValueOfKey(stringObject, "enum");
+        if (stringValue != NULL && stringEnum != NULL && atoi(stringEnum) == RKStatusEnumNormal) {
+            if (*stringValue == '"') {
+                sscanf(stringValue, "\"%lf\"", &number);
+            } else {
+                number = atof(stringValue);
+            }
+        }
+    }
+    return number;
+}
+
+// Same as above through the slots of a record
+static double RKHealthEngineNormalValueOfSlot(RKHealthRecord *record, const char *key) {
+    RKHealthSlot *slot = RKHealthRecordFind(record, key);
+    if (slot != NULL && slot->hasStatus && slot->status == RKStatusEnumNormal) {
+        return slot->number;
+    }
+    return NAN;
+}
+
+// Enum of the first slot whose key contains the word, the record equivalent of RKReplaceEnumOfKey()
+static bool RKHealthEngineReplaceEnumOfSlot(RKHealthRecord *record, const char *word, const RKStatusEnum status) {
+    for (int k = 0; k < record->count; k++) {
+        if (strcasestr(record->slots[k].key, word)) {
+            if (record->slots[k].hasStatus) {
+                record->slots[k].status = status;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
 #pragma mark - Delegate Workers
 
 static void *healthConsolidator(void *_in) {
     RKHealthEngine *engine = (RKHealthEngine *)_in;
     RKRadarDesc *desc = engine->radarDescription;
 
-    int i, j, k, n, s;
+    int i, j, k, m, n, s;
 	struct timeval t0, t1;
 
     RKHealth *health;
+    RKHealth *nodeHealth;
+    RKHealthRecord *record;
 
 	bool allTrue;
 	char *string;
     double latitude;
     double longitude;
+    double number;
     float heading;
-    char *stringValue, *stringEnum, *stringObject;
     int headingChangeCount = 0;
     int locationChangeCount = 0;
+    bool wantNotWired[3];
+    const char *notWiredWords[] = {"heading", "latitude", "longitude"};
 
     uint32_t *indices = (uint32_t *)malloc(desc->healthNodeCount * sizeof(uint32_t));
     memset(indices, 0xFF, desc->healthNodeCount * sizeof(uint32_t));
 
+    // Records of the nodes for this round, NULL for the nodes that are not used or kept as strings
+    RKHealthRecord *scratches = (RKHealthRecord *)malloc(desc->healthNodeCount * sizeof(RKHealthRecord));
+    RKHealthRecord **records = (RKHealthRecord **)malloc(desc->healthNodeCount * sizeof(RKHealthRecord *));
+    bool *used = (bool *)malloc(desc->healthNodeCount * sizeof(bool));
+    engine->memoryUsage += desc->healthNodeCount * (sizeof(RKHealthRecord) + sizeof(RKHealthRecord *) + sizeof(bool));
+
 	// Update the engine state
 	engine->state |= RKEngineStateWantActive;
 	engine->state ^= RKEngineStateActivating;
@@ -121,6 +171,11 @@ static void *healthConsolidator(void *_in) {
                             h0->i += desc->healthBufferDepth;
                             strcpy(h0->string, h1->string);
                             RKReplaceAllValuesOfKey(h0->string, "Enum", RKStatusEnumOld);
+                            h0->record.count = h1->record.count;
+                            for (n = 0; n < h1->record.count; n++) {
+                                h0->record.slots[n] = h1->record.slots[n];
+                                h0->record.slots[n].status = RKStatusEnumOld;
+                            }
                             h0->flag = RKHealthFlagReady;
                         }
                     }
@@ -160,62 +215,95 @@ static void *healthConsolidator(void *_in) {
             RKLog("%s %s   k = %d   s = %d\n", engine->name, string, k, s);
         }
 
-        // Combine all the active JSON strings
-        i = sprintf(string, "{");
+        // Typed nodes are used as they are, string nodes are tokenized once, those that cannot be tokenized are kept as strings
         for (j = 0; j < desc->healthNodeCount; j++) {
-            n = indices[j];
-            if (engine->healthNodes[j].active && strlen(engine->healthNodes[j].healths[n].string) > 6) {   // {"k":0} is at least 7 chars
-                i += sprintf(string + i, "%s", engine->healthNodes[j].healths[n].string + 1);              // Ignore the first "{"
-                i -= RKStripTail(string);                                                                  // Strip away white spaces
-                i--;                                                                                       // Ignore the last "}"
-                i += sprintf(string + i, ", ");                                                            // Get ready to concatenante
-                engine->healthNodes[j].healths[n].flag |= RKHealthFlagUsed;
+            nodeHealth = &engine->healthNodes[j].healths[indices[j]];
+            records[j] = NULL;
+            used[j] = false;
+            if (!engine->healthNodes[j].active) {
+                continue;
+            }
+            if (nodeHealth->record.count > 0) {
+                records[j] = &nodeHealth->record;
+                used[j] = true;
+            } else if (strlen(nodeHealth->string) > 6) {                                                   // {"k":0} is at least 7 chars
+                if (RKHealthRecordFromString(&scratches[j], nodeHealth->string) > 0) {
+                    records[j] = &scratches[j];
+                }
+                used[j] = true;
             }
         }
 
-        // Tag on GPS override if there is no GPS device anywhere
+        // GPS readings from the first node that reports them
         heading = NAN;
         latitude = NAN;
         longitude = NAN;
-        if ((stringObject = RKGetValueOfKey(string, "GPS Heading")) != NULL) {
-            stringValue = RKGetValueOfKey(stringObject, "value");
-            stringEnum = RKGetValueOfKey(stringObject, "enum");
-            if (stringValue != NULL && stringEnum != NULL && atoi(stringEnum) == RKStatusEnumNormal) {
-                //heading = (float)atof(stringValue);
-                if (*stringValue == '"') {
-                    sscanf(stringValue, "\"%f\"", &heading);
-                } else {
-                    heading = (float)atof(stringValue);
-                }
+        for (j = 0; j < desc->healthNodeCount; j++) {
+            if (!used[j]) {
+                continue;
             }
-        }
-        if ((stringObject = RKGetValueOfKey(string, "GPS Latitude")) != NULL) {
-            stringValue = RKGetValueOfKey(stringObject, "value");
-            stringEnum = RKGetValueOfKey(stringObject, "enum");
-            if (stringValue != NULL && stringEnum != NULL && atoi(stringEnum) == RKStatusEnumNormal) {
-                //latitude = atof(stringValue);
-                if (*stringValue == '"') {
-                    sscanf(stringValue, "\"%lf\"", &latitude);
-                } else {
-                    latitude = atof(stringValue);
-                }
+            nodeHealth = &engine->healthNodes[j].healths[indices[j]];
+            if (isnan(heading)) {
+                number = records[j] ? RKHealthEngineNormalValueOfSlot(records[j], "GPS Heading")
+                                    : RKHealthEngineNormalValueOfKey(nodeHealth->string, "GPS Heading");
+                heading = (float)number;
+            }
+            if (isnan(latitude)) {
+                latitude = records[j] ? RKHealthEngineNormalValueOfSlot(records[j], "GPS Latitude")
+                                      : RKHealthEngineNormalValueOfKey(nodeHealth->string, "GPS Latitude");
+            }
+            if (isnan(longitude)) {
+                longitude = records[j] ? RKHealthEngineNormalValueOfSlot(records[j], "GPS Longitude")
+                                       : RKHealthEngineNormalValueOfKey(nodeHealth->string, "GPS Longitude");
             }
         }
-        if ((stringObject = RKGetValueOfKey(string, "GPS Longitude")) != NULL) {
-            stringValue = RKGetValueOfKey(stringObject, "value");
-            stringEnum = RKGetValueOfKey(stringObject, "enum");
-            if (stringValue != NULL && stringEnum != NULL && atoi(stringEnum) == RKStatusEnumNormal) {
-                //longitude = atof(stringValue);
-                if (*stringValue == '"') {
-                    sscanf(stringValue, "\"%lf\"", &longitude);
-                } else {
-                    longitude = atof(stringValue);
+        wantNotWired[0] = isnan(heading) || (desc->initFlags & RKInitFlagIgnoreHeading) || (desc->initFlags & RKInitFlagIgnoreGPS);
+        wantNotWired[1] = isnan(latitude) || isnan(longitude) || (desc->initFlags & RKInitFlagIgnoreGPS);
+        wantNotWired[2] = wantNotWired[1];
+
+        // Combine all the active nodes, if there is also supplied GPS, replace the enum of the first GPS readings to not wired
+        i = sprintf(string, "{");
+        for (j = 0; j < desc->healthNodeCount; j++) {
+            if (!used[j]) {
+                continue;
+            }
+            nodeHealth = &engine->healthNodes[j].healths[indices[j]];
+            if (records[j]) {
+                record = records[j];
+                if ((wantNotWired[0] || wantNotWired[1] || wantNotWired[2]) && record != &scratches[j]) {
+                    // Leave the record of the node untouched
+                    scratches[j].count = record->count;
+                    memcpy(scratches[j].slots, record->slots, record->count * sizeof(RKHealthSlot));
+                    record = &scratches[j];
                 }
+                for (n = 0; n < 3; n++) {
+                    if (wantNotWired[n] && RKHealthEngineReplaceEnumOfSlot(record, notWiredWords[n], RKStatusEnumNotWired)) {
+                        wantNotWired[n] = false;
+                    }
+                }
+                i += RKHealthRecordToString(record, string + i, RKMaximumStringLength - i);
+            } else {
+                m = i;
+                i += sprintf(string + i, "%s", nodeHealth->string + 1);                                  // Ignore the first "{"
+                i -= RKStripTail(string);                                                                  // Strip away white spaces
+                i--;                                                                                       // Ignore the last "}"
+                string[i] = '\0';
+                for (n = 0; n < 3; n++) {
+                    if (wantNotWired[n] && strcasestr(string + m, notWiredWords[n])) {
+                        RKReplaceEnumOfKey(string + m, notWiredWords[n], RKStatusEnumNotWired);
+                        wantNotWired[n] = false;
+                    }
+                }
+                // Replace some quoted logical values, e.g., "TRUE", "True", "true", etc. -> true
+                RKReviseLogicalValues(string + m);
+                i = m + (int)strlen(string + m);
+                i += sprintf(string + i, ", ");                                                            // Get ready to concatenante
             }
+            nodeHealth->flag |= RKHealthFlagUsed;
         }
+
+        // Tag on GPS override if there is no GPS device anywhere
         if (isnan(heading) || (desc->initFlags & RKInitFlagIgnoreHeading) || (desc->initFlags & RKInitFlagIgnoreGPS)) {
-            // If there is also supplied GPS, replace the enum of the GPS readings to not wired
-            RKReplaceEnumOfKey(string, "heading", RKStatusEnumNotWired);
             // Concatenate with heading values if GPS values are not reported
             i += sprintf(string + i,
                          "\"Heading Override\":{\"Value\":true,\"Enum\":0}, "
@@ -237,9 +325,6 @@ static void *healthConsolidator(void *_in) {
             }
         }
         if (isnan(latitude) || isnan(longitude) || (desc->initFlags & RKInitFlagIgnoreGPS)) {
-            // If there is also supplied GPS, replace the enum of the GPS readings to not wired
-            RKReplaceEnumOfKey(string, "latitude", RKStatusEnumNotWired);
-            RKReplaceEnumOfKey(string, "longitude", RKStatusEnumNotWired);
             // Concatenate with latitude, longitude and heading values if GPS values are not reported
             i += sprintf(string + i,
                          "\"GPS Override\":{\"Value\":true,\"Enum\":0}, "
@@ -267,9 +352,7 @@ static void *healthConsolidator(void *_in) {
         // Add the log time as the last object
         i += sprintf(string + i, "\"Log Time\":%zu}", t0.tv_sec);
 
-        // Replace some quoted logical values, e.g., "TRUE", "True", "true", etc. -> true
-        RKReviseLogicalValues(string);
-
+        health->i += desc->healthBufferDepth;
         health->flag = RKHealthFlagReady;
 
         if (engine->verbose > 2) {
@@ -287,6 +370,9 @@ static void *healthConsolidator(void *_in) {
     }
 
     free(indices);
+    free(scratches);
+    free(records);
+    free(used);
 
     engine->state ^= RKEngineStateActive;
     return NULL;
@@ -0,0 +1,283 @@
+//
+//  RKHealthRecord.c
+//  RadarKit
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <RadarKit/RKHealthRecord.h>
+
+#pragma mark - Helper Functions
+
+// Number of the value, quoted or not, e.g., 12.5 or "12.5 degC", NAN if it does not start with one
+static double RKHealthRecordNumber(const char *value) {
+    char *e;
+    const char *s = *value == '"' ? value + 1 : value;
+    double number = strtod(s, &e);
+    return e == s ? NAN : number;
+}
+
+static const char *RKHealthRecordSkipWhiteSpaces(const char *c) {
+    while (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n') {
+        c++;
+    }
+    return c;
+}
+
+// End of a JSON string that starts at c, i.e., one past the closing quote, NULL if it is incomplete
+static const char *RKHealthRecordScanString(const char *c) {
+    const char q = *c++;
+    while (*c != '\0' && *c != q) {
+        if (*c == '\\' && c[1] != '\0') {
+            c++;
+        }
+        c++;
+    }
+    return *c == q ? c + 1 : NULL;
+}
+
+// End of a JSON value that starts at c, NULL if it is incomplete
+static const char *RKHealthRecordScanValue(const char *c) {
+    int depth = 0;
+    if (*c == '"' || *c == '\'') {
+        return RKHealthRecordScanString(c);
+    }
+    if (*c != '{' && *c != '[') {
+        while (*c != '\0' && *c != ',' && *c != '}' && *c != ']' && *c != ' ' && *c != '\r' && *c != '\n') {
+            c++;
+        }
+        return c;
+    }
+    do {
+        if (*c == '"' || *c == '\'') {
+            if ((c = RKHealthRecordScanString(c)) == NULL) {
+                return NULL;
+            }
+            continue;
+        }
+        if (*c == '{' || *c == '[') {
+            depth++;
+        } else if (*c == '}' || *c == ']') {
+            depth--;
+        } else if (*c == '\0') {
+            return NULL;
+        }
+        c++;
+    } while (depth > 0);
+    return c;
+}
+
+// Copy a token, quoted logical values like "TRUE" become true, returns false if it does not fit
+static bool RKHealthRecordCopyValue(char *value, const char *s, const char *e) {
+    const size_t length = e - s;
+    if (length >= RKHealthRecordValueLength) {
+        return false;
+    }
+    if (length == 6 && !strncasecmp(s, "\"true\"", 6)) {
+        strcpy(value, "true");
+    } else if (length == 7 && !strncasecmp(s, "\"false\"", 7)) {
+        strcpy(value, "false");
+    } else {
+        memcpy(value, s, length);
+        value[length] = '\0';
+    }
+    return true;
+}
+
+// Parse a '{"Value":..., "Enum":...}' object into the slot, returns false if the object has anything else
+static bool RKHealthRecordParseStatus(RKHealthSlot *slot, const char *c, const char *end) {
+    const char *k, *s, *e;
+    bool hasValue = false;
+    c = RKHealthRecordSkipWhiteSpaces(c + 1);
+    while (c < end && *c != '}') {
+        if (*c != '"' || (e = RKHealthRecordScanString(c)) == NULL) {
+            return false;
+        }
+        k = c + 1;
+        c = RKHealthRecordSkipWhiteSpaces(e);
+        if (*c != ':') {
+            return false;
+        }
+        s = RKHealthRecordSkipWhiteSpaces(c + 1);
+        if (*s == '{' || *s == '[' || (e = RKHealthRecordScanValue(s)) == NULL) {
+            return false;
+        }
+        if (!strncasecmp(k, "value\"", 6)) {
+            if (!RKHealthRecordCopyValue(slot->value, s, e)) {
+                return false;
+            }
+            hasValue = true;
+        } else if (!strncasecmp(k, "enum\"", 5)) {
+            slot->status = (RKStatusEnum)atoi(*s == '"' ? s + 1 : s);
+            slot->hasStatus = true;
+        } else {
+            return false;
+        }
+        c = RKHealthRecordSkipWhiteSpaces(e);
+        if (*c == ',') {
+            c = RKHealthRecordSkipWhiteSpaces(c + 1);
+        }
+    }
+    return hasValue && slot->hasStatus;
+}
+
+static RKHealthSlot *RKHealthRecordNewSlot(RKHealthRecord *record, const char *key) {
+    if (record->count >= RKHealthRecordSlotCount || strlen(key) >= RKHealthRecordKeyLength) {
+        return NULL;
+    }
+    RKHealthSlot *slot = &record->slots[record->count++];
+    strcpy(slot->key, key);
+    slot->hasStatus = false;
+    slot->status = RKStatusEnumNormal;
+    return slot;
+}
+
+#pragma mark - Methods
+
+void RKHealthRecordReset(RKHealthRecord *record) {
+    record->count = 0;
+}
+
+RKHealthSlot *RKHealthRecordAdd(RKHealthRecord *record, const char *key, const char *value) {
+    if (strlen(value) >= RKHealthRecordValueLength) {
+        return NULL;
+    }
+    RKHealthSlot *slot = RKHealthRecordNewSlot(record, key);
+    if (slot == NULL) {
+        return NULL;
+    }
+    strcpy(slot->value, value);
+    slot->number = RKHealthRecordNumber(value);
+    return slot;
+}
+
+RKHealthSlot *RKHealthRecordAddBool(RKHealthRecord *record, const char *key, const bool value, const RKStatusEnum status) {
+    RKHealthSlot *slot = RKHealthRecordAdd(record, key, value ? "true" : "false");
+    if (slot) {
+        slot->number = value ? 1.0 : 0.0;
+        slot->status = status;
+        slot->hasStatus = true;
+    }
+    return slot;
+}
+
+RKHealthSlot *RKHealthRecordAddNumber(RKHealthRecord *record, const char *key, const double value, const char *format, const RKStatusEnum status) {
+    char string[RKHealthRecordValueLength];
+    snprintf(string, RKHealthRecordValueLength, format, value);
+    RKHealthSlot *slot = RKHealthRecordAdd(record, key, string);
+    if (slot) {
+        slot->number = value;
+        slot->status = status;
+        slot->hasStatus = true;
+    }
+    return slot;
+}
+
+RKHealthSlot *RKHealthRecordAddString(RKHealthRecord *record, const char *key, const char *value, const RKStatusEnum status) {
+    char string[RKHealthRecordValueLength];
+    if (snprintf(string, RKHealthRecordValueLength, "\"%s\"", value) >= RKHealthRecordValueLength) {
+        return NULL;
+    }
+    RKHealthSlot *slot = RKHealthRecordAdd(record, key, string);
+    if (slot) {
+        slot->status = status;
+        slot->hasStatus = true;
+    }
+    return slot;
+}
+
+RKHealthSlot *RKHealthRecordFind(RKHealthRecord *record, const char *key) {
+    for (int k = 0; k < record->count; k++) {
+        if (!strcasecmp(record->slots[k].key, key)) {
+            return &record->slots[k];
+        }
+    }
+    return NULL;
+}
+
+bool RKHealthRecordHasStatus(const RKHealthRecord *record, const RKStatusEnum status) {
+    for (int k = 0; k < record->count; k++) {
+        if (record->slots[k].hasStatus && record->slots[k].status == status) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// One pass over the string, e.g., {"Key 1":true, "Key 2":{"Value":"12 V","Enum":0}}
+// Values that are objects other than {"Value":..., "Enum":...} and arrays are kept as
+// they are. A string with a key or a value that does not fit a slot, or with more keys
+// than the slots, is rejected so that the caller can keep using the string.
+//
+int RKHealthRecordFromString(RKHealthRecord *record, const char *string) {
+    const char *c, *s, *e;
+    RKHealthSlot *slot;
+    size_t length;
+
+    record->count = 0;
+    c = RKHealthRecordSkipWhiteSpaces(string);
+    if (*c != '{') {
+        return -1;
+    }
+    c = RKHealthRecordSkipWhiteSpaces(c + 1);
+    while (*c != '}') {
+        // Key
+        if (*c != '"' || (e = RKHealthRecordScanString(c)) == NULL) {
+            return -1;
+        }
+        length = e - c - 2;
+        if (record->count >= RKHealthRecordSlotCount || length >= RKHealthRecordKeyLength) {
+            return -1;
+        }
+        slot = &record->slots[record->count];
+        memcpy(slot->key, c + 1, length);
+        slot->key[length] = '\0';
+        c = RKHealthRecordSkipWhiteSpaces(e);
+        if (*c != ':') {
+            return -1;
+        }
+        // Value
+        s = RKHealthRecordSkipWhiteSpaces(c + 1);
+        if ((e = RKHealthRecordScanValue(s)) == NULL || e == s) {
+            return -1;
+        }
+        slot->hasStatus = false;
+        slot->status = RKStatusEnumNormal;
+        if (*s != '{' || !RKHealthRecordParseStatus(slot, s, e)) {
+            slot->hasStatus = false;
+            if (!RKHealthRecordCopyValue(slot->value, s, e)) {
+                return -1;
+            }
+        }
+        slot->number = RKHealthRecordNumber(slot->value);
+        record->count++;
+        // Next
+        c = RKHealthRecordSkipWhiteSpaces(e);
+        if (*c == ',') {
+            c = RKHealthRecordSkipWhiteSpaces(c + 1);
+        } else if (*c != '}') {
+            return -1;
+        }
+    }
+    return record->count;
+}
+
+int RKHealthRecordToString(const RKHealthRecord *record, char *string, const size_t size) {
+    int i = 0, n;
+    for (int k = 0; k < record->count; k++) {
+        const RKHealthSlot *slot = &record->slots[k];
+        if (slot->hasStatus) {
+            n = snprintf(string + i, size - i, "\"%s\":{\"Value\":%s,\"Enum\":%d}, ", slot->key, slot->value, (int)slot->status);
+        } else {
+            n = snprintf(string + i, size - i, "\"%s\":%s, ", slot->key, slot->value);
+        }
+        if (n < 0 || n >= size - i) {
+            string[i] = '\0';
+            break;
+        }
+        i += n;
+    }
+    return i;
+}
@@ -0,0 +1,404 @@
+//
+//  RKHookRunner.c
+//  RadarKit
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <RadarKit/RKHookRunner.h>
+#include <spawn.h>
+
+extern char **environ;
+
+#pragma mark - Helper Functions
+
+// Split the command by white spaces, in place, into an argument list for posix_spawnp()
+static int RKHookRunnerParseArguments(char *command, char **argv) {
+    int argc = 0;
+    char *c = command;
+    while (*c != '\0' && argc < RKHookRunnerMaximumArgumentCount - 1) {
+        while (*c == ' ' || *c == '\t' || *c == '\n') {
+            *c++ = '\0';
+        }
+        if (*c == '\0') {
+            break;
+        }
+        argv[argc++] = c;
+        while (*c != '\0' && *c != ' ' && *c != '\t' && *c != '\n') {
+            c++;
+        }
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// Handle to wait on a child process without reaping it: a pidfd on Linux, a kqueue on macOS
+static int RKHookRunnerOpenChildHandle(const pid_t pid) {
+    #if defined(__linux__) && defined(SYS_pidfd_open)
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+    #elif defined(__APPLE__)
+    struct kevent event;
+    int fd = kqueue();
+    if (fd < 0) {
+        return -1;
+    }
+    EV_SET(&event, pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, NULL);
+    if (kevent(fd, &event, 1, NULL, 0, NULL) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+    #else
+    return -1;
+    #endif
+}
+
+// Block until the child exits or the timeout (s) elapses, 0 for no limit. Returns 0 on timeout
+static int RKHookRunnerWaitForChild(const int fd, const double timeout) {
+    int r;
+    #if defined(__linux__) && defined(SYS_pidfd_open)
+    struct pollfd item = {.fd = fd, .events = POLLIN};
+    do {
+        r = poll(&item, 1, timeout > 0.0 ? (int)(1.0e3 * timeout) : -1);
+    } while (r < 0 && errno == EINTR);
+    #elif defined(__APPLE__)
+    struct kevent event;
+    struct timespec t = {.tv_sec = (time_t)timeout, .tv_nsec = (long)(1.0e9 * (timeout - floor(timeout)))};
+    do {
+        r = kevent(fd, NULL, 0, &event, 1, timeout > 0.0 ? &t : NULL);
+    } while (r < 0 && errno == EINTR);
+    #else
+    r = 1;
+    #endif
+    return r;
+}
+
+static void RKHookRunnerExecute(RKHookWorker *me, RKHookJob *job) {
+    RKHookRunner *engine = me->parent;
+
+    int k, s, fd;
+    pid_t pid;
+    struct timeval t0, t1;
+    char *argv[RKHookRunnerMaximumArgumentCount];
+    char command[RKHookRunnerCommandLength];
+
+    strcpy(command, job->command);
+    if (RKHookRunnerParseArguments(command, argv) == 0) {
+        RKLog("%s Error. Empty command.\n", me->name);
+        job->status = -1;
+        return;
+    }
+
+    gettimeofday(&t0, NULL);
+    k = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+    if (k) {
+        RKLog("%s Error. Unable to spawn %s   %s\n", me->name, argv[0], strerror(k));
+        job->status = -1;
+        return;
+    }
+    me->pid = pid;
+    engine->spawnCount++;
+
+    // Sleep until the child exits, terminate it if it runs for too long. Without a handle to wait
+    // on, the timeout cannot be enforced and the child is simply waited for
+    job->timedOut = false;
+    fd = RKHookRunnerOpenChildHandle(pid);
+    if (fd < 0) {
+        if (engine->timeout > 0.0) {
+            RKLog("%s Warning. Unable to watch %s   %s   Timeout is not enforced.\n", me->name, argv[0], strerror(errno));
+        }
+    } else {
+        if (RKHookRunnerWaitForChild(fd, engine->timeout) == 0) {
+            RKLog("%s Warning. Terminating %s after %.1f s\n", me->name, argv[0], engine->timeout);
+            job->timedOut = true;
+            kill(pid, SIGTERM);
+            if (RKHookRunnerWaitForChild(fd, 1.0) == 0) {
+                kill(pid, SIGKILL);
+            }
+        }
+        close(fd);
+    }
+    s = 0;
+    do {
+        k = waitpid(pid, &s, 0);
+    } while (k < 0 && errno == EINTR);
+    gettimeofday(&t1, NULL);
+    me->pid = 0;
+
+    job->elapsedTime = RKTimevalDiff(t1, t0);
+    if (k < 0) {
+        job->status = -1;
+    } else if (WIFEXITED(s)) {
+        job->status = WEXITSTATUS(s);
+    } else if (WIFSIGNALED(s)) {
+        job->status = 128 + WTERMSIG(s);
+    } else {
+        job->status = -1;
+    }
+}
+
+#pragma mark - Delegate Workers
+
+static void *hookWorker(void *in) {
+    RKHookWorker *me = (RKHookWorker *)in;
+    RKHookRunner *engine = me->parent;
+
+    int k;
+    RKHookJob *job = (RKHookJob *)malloc(sizeof(RKHookJob));
+    if (job == NULL) {
+        RKLog("%s Error. Unable to allocate a job.\n", engine->name);
+        return NULL;
+    }
+
+    // Initiate my name
+    if (rkGlobalParameters.showColor) {
+        k = snprintf(me->name, RKChildNameLength, "%s %s", engine->name, RKGetColorOfIndex(me->id));
+    } else {
+        k = snprintf(me->name, RKChildNameLength, "%s ", engine->name);
+    }
+    k += snprintf(me->name + k, RKChildNameLength - k, "H%d", me->id);
+    if (rkGlobalParameters.showColor) {
+        snprintf(me->name + k, RKChildNameLength - k, RKNoColor);
+    }
+
+    me->tic = 1;
+
+    while (true) {
+        pthread_mutex_lock(&engine->mutex);
+        while (engine->takeCount == engine->postCount && engine->state & RKEngineStateChildActive) {
+            pthread_cond_wait(&engine->jobPosted, &engine->mutex);
+        }
+        if (engine->takeCount == engine->postCount) {
+            pthread_mutex_unlock(&engine->mutex);
+            break;
+        }
+        memcpy(job, &engine->jobs[engine->takeCount % RKHookRunnerQueueDepth], sizeof(RKHookJob));
+        engine->takeCount++;
+        pthread_cond_signal(&engine->jobTaken);
+        pthread_mutex_unlock(&engine->mutex);
+
+        if (engine->verbose > 1) {
+            RKLog("%s CMD: %s\n", me->name, job->command);
+        }
+
+        RKHookRunnerExecute(me, job);
+
+        pthread_mutex_lock(&engine->mutex);
+        engine->lastStatus = job->status;
+        if (job->status) {
+            engine->failureCount++;
+        }
+        if (job->timedOut) {
+            engine->timeoutCount++;
+        }
+        pthread_mutex_unlock(&engine->mutex);
+
+        if (job->status) {
+            RKLog("%s Error. CMD: %s\n", me->name, job->command);
+            RKLog("%s Error. Exit status %d   elapsed = %.2f s\n", me->name, job->status, job->elapsedTime);
+        } else if (engine->verbose > 1) {
+            RKLog("%s Done.   elapsed = %.2f s\n", me->name, job->elapsedTime);
+        }
+
+        if (job->completion) {
+            job->completion(job);
+        }
+
+        pthread_mutex_lock(&engine->mutex);
+        engine->doneCount++;
+        pthread_mutex_unlock(&engine->mutex);
+
+        me->tic++;
+    }
+
+    free(job);
+    return NULL;
+}
+
+#pragma mark - Life Cycle
+
+RKHookRunner *RKHookRunnerInit(void) {
+    RKHookRunner *engine = (RKHookRunner *)malloc(sizeof(RKHookRunner));
+    if (engine == NULL) {
+        RKLog("Error. Unable to allocate a hook runner.\n");
+        return NULL;
+    }
+    memset(engine, 0, sizeof(RKHookRunner));
+    sprintf(engine->name, "%s<HookRunner>%s",
+            rkGlobalParameters.showColor ? RKGetBackgroundColorOfIndex(RKEngineColorMisc) : "",
+            rkGlobalParameters.showColor ? RKNoColor : "");
+    engine->state = RKEngineStateAllocated | RKEngineStateProperlyWired;
+    engine->concurrency = RKHookRunnerDefaultConcurrency;
+    engine->timeout = RKHookRunnerDefaultTimeout;
+    engine->memoryUsage = sizeof(RKHookRunner);
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->jobPosted, NULL);
+    pthread_cond_init(&engine->jobTaken, NULL);
+    return engine;
+}
+
+void RKHookRunnerFree(RKHookRunner *engine) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKHookRunnerStop(engine);
+    }
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_cond_destroy(&engine->jobPosted);
+    pthread_cond_destroy(&engine->jobTaken);
+    free(engine);
+}
+
+#pragma mark - Properties
+
+void RKHookRunnerSetName(RKHookRunner *engine, const char *name) {
+    snprintf(engine->name, RKNameLength, "%s", name);
+}
+
+void RKHookRunnerSetVerbose(RKHookRunner *engine, const int verbose) {
+    engine->verbose = verbose;
+}
+
+void RKHookRunnerSetConcurrency(RKHookRunner *engine, const uint8_t count) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKLog("%s Error. Concurrency cannot be changed while active.\n", engine->name);
+        return;
+    }
+    engine->concurrency = MIN(MAX(count, 1), RKHookRunnerMaximumConcurrency);
+}
+
+void RKHookRunnerSetTimeout(RKHookRunner *engine, const double timeout) {
+    engine->timeout = timeout;
+}
+
+#pragma mark - Interactions
+
+int RKHookRunnerStart(RKHookRunner *engine) {
+    int k;
+    if (engine->verbose) {
+        RKLog("%s Starting ...\n", engine->name);
+    }
+    engine->state |= RKEngineStateActivating;
+    engine->workers = (RKHookWorker *)malloc(engine->concurrency * sizeof(RKHookWorker));
+    if (engine->workers == NULL) {
+        RKLog("%s Error. Unable to allocate workers.\n", engine->name);
+        return RKResultFailedToStartHookRunner;
+    }
+    memset(engine->workers, 0, engine->concurrency * sizeof(RKHookWorker));
+    engine->memoryUsage = sizeof(RKHookRunner) + engine->concurrency * sizeof(RKHookWorker);
+    engine->postCount = 0;
+    engine->takeCount = 0;
+    engine->doneCount = 0;
+    engine->state |= RKEngineStateChildActive;
+    for (k = 0; k < engine->concurrency; k++) {
+        RKHookWorker *worker = &engine->workers[k];
+        worker->id = k;
+        worker->parent = engine;
+        if (pthread_create(&worker->tid, NULL, hookWorker, worker) != 0) {
+            RKLog("%s Error. Failed to start a hook worker.\n", engine->name);
+            return RKResultFailedToStartHookRunner;
+        }
+    }
+    for (k = 0; k < engine->concurrency; k++) {
+        while (engine->workers[k].tic == 0) {
+            usleep(1000);
+        }
+    }
+    engine->state ^= RKEngineStateActivating;
+    engine->state |= RKEngineStateWantActive | RKEngineStateActive;
+    if (engine->verbose) {
+        RKLog("%s Started.   concurrency = %d   timeout = %.1f s\n", engine->name, engine->concurrency, engine->timeout);
+    }
+    return RKResultSuccess;
+}
+
+int RKHookRunnerStop(RKHookRunner *engine) {
+    int k;
+    if (engine->state & RKEngineStateDeactivating) {
+        if (engine->verbose > 1) {
+            RKLog("%s Info. Engine is being or has been deactivated.\n", engine->name);
+        }
+        return RKResultEngineDeactivatedMultipleTimes;
+    }
+    if (!(engine->state & RKEngineStateWantActive)) {
+        RKLog("%s Not active.\n", engine->name);
+        return RKResultEngineDeactivatedMultipleTimes;
+    }
+    if (engine->verbose) {
+        RKLog("%s Stopping ...\n", engine->name);
+    }
+    // Commands that have been queued still run, the workers exit once the queue is empty
+    engine->state |= RKEngineStateDeactivating;
+    engine->state ^= RKEngineStateWantActive;
+    pthread_mutex_lock(&engine->mutex);
+    engine->state ^= RKEngineStateChildActive;
+    pthread_cond_broadcast(&engine->jobPosted);
+    pthread_mutex_unlock(&engine->mutex);
+    for (k = 0; k < engine->concurrency; k++) {
+        pthread_join(engine->workers[k].tid, NULL);
+    }
+    free(engine->workers);
+    engine->workers = NULL;
+    engine->memoryUsage = sizeof(RKHookRunner);
+    engine->state ^= RKEngineStateActive;
+    engine->state ^= RKEngineStateDeactivating;
+    if (engine->verbose) {
+        RKLog("%s Stopped.   spawnCount = %s   failureCount = %s\n", engine->name,
+              RKUIntegerToCommaStyleString(engine->spawnCount),
+              RKUIntegerToCommaStyleString(engine->failureCount));
+    }
+    if (engine->state != (RKEngineStateAllocated | RKEngineStateProperlyWired)) {
+        RKLog("%s Inconsistent state 0x%04x\n", engine->name, engine->state);
+    }
+    return RKResultSuccess;
+}
+
+//
+// Queue a command, which is a program followed by arguments separated by spaces. There is no
+// shell, i.e., no redirection, pipes or quotes. The call only waits if the queue is full.
+//
+int RKHookRunnerSubmit(RKHookRunner *engine, const char *command, const char *output, void (*completion)(RKHookJob *), void *userResource) {
+    if (!(engine->state & RKEngineStateWantActive)) {
+        RKLog("%s Error. Not active.\n", engine->name);
+        return RKResultFailedToExecuteCommand;
+    }
+    if (strlen(command) >= RKHookRunnerCommandLength) {
+        RKLog("%s Error. Command is too long.\n", engine->name);
+        return RKResultFailedToExecuteCommand;
+    }
+    pthread_mutex_lock(&engine->mutex);
+    if (engine->postCount - engine->takeCount >= RKHookRunnerQueueDepth) {
+        RKLog("%s Warning. Queue is full, waiting ...\n", engine->name);
+        while (engine->postCount - engine->takeCount >= RKHookRunnerQueueDepth) {
+            pthread_cond_wait(&engine->jobTaken, &engine->mutex);
+        }
+    }
+    RKHookJob *job = &engine->jobs[engine->postCount % RKHookRunnerQueueDepth];
+    job->i = engine->tic++;
+    strcpy(job->command, command);
+    if (output) {
+        snprintf(job->output, RKMaximumPathLength, "%s", output);
+    } else {
+        job->output[0] = '\0';
+    }
+    job->completion = completion;
+    job->userResource = userResource;
+    job->status = 0;
+    job->timedOut = false;
+    job->elapsedTime = 0.0f;
+    engine->postCount++;
+    pthread_cond_signal(&engine->jobPosted);
+    pthread_mutex_unlock(&engine->mutex);
+    return RKResultSuccess;
+}
+
+void RKHookRunnerWaitWhileBusy(RKHookRunner *engine) {
+    bool busy;
+    do {
+        pthread_mutex_lock(&engine->mutex);
+        busy = engine->doneCount != engine->postCount;
+        pthread_mutex_unlock(&engine->mutex);
+        if (busy) {
+            usleep(10000);
+        }
+    } while (busy);
+}
@@ -9,6 +9,7 @@
 #include <RadarKit/RKHostMonitor.h>
 
 #define RKHostMonitorPacketSize 64
+#define RKHostMonitorReplySize  128
 
 //
 // The following structures are obtained from an example from Apple:
@@ -57,7 +58,7 @@ typedef struct rk_ipv4_header {
 
 static uint16_t rk_host_monitor_checksum (void *in, size_t len) {
     uint16_t *buf = (uint16_t *)in;
-    uint16_t sum = 0;
+    uint32_t sum = 0;
     for (sum = 0; len > 1; len -= 2) {
         sum += *buf++;
     }
@@ -66,303 +67,300 @@ static uint16_t rk_host_monitor_checksum (void *in, size_t len) {
     }
     sum = (sum >> 16) + (sum & 0xffff);
     sum += (sum >> 16);
-    return ~sum;
+    return (uint16_t)~sum;
 }
 
-#pragma mark - Delegate Workers
-
-static void *hostPinger(void *in) {
-    RKUnitMonitor *me = (RKUnitMonitor *)in;
-    RKHostMonitor *engine = me->parent;
-
-    int k;
-    int sd;
-    struct sockaddr_in targetAddress;
-    struct sockaddr_in returnAddress;
-
-    const int c = me->id;
-    const int value = 50;
-    struct protoent *protocol = getprotobyname("ICMP");
-
-    void *buff = malloc(RKHostMonitorPacketSize);
-    if (buff == NULL) {
-        RKLog("%s Error. Unable to allocate memory. Unable to continue.\n", engine->name);
-        return NULL;
+static int latencyBin(const double latency) {
+    const double edges[] = {0.1e-3, 0.2e-3, 0.5e-3, 1.0e-3, 2.0e-3, 5.0e-3, 10.0e-3, 20.0e-3, 50.0e-3, 100.0e-3, 200.0e-3};
+    int k = 0;
+    while (k < RKHostMonitorLatencyBinCount - 1 && latency >= edges[k]) {
+        k++;
     }
+    return k;
+}
 
-    RKICMPHeader *icmpHeader;
-    RKIPV4Header *ipv4Header = (RKIPV4Header *)buff;
-    socklen_t returnLength = sizeof(struct sockaddr);
-    uint16_t receivedChecksum;
-    uint16_t calculatedChecksum;
-
-    ssize_t r = 0;
-    size_t txSize = RKHostMonitorPacketSize - sizeof(RKIPV4Header);
-    size_t ipHeaderLength, offset;
-
-    double period;
-    struct timeval time;
-
-    // Initiate my name
-    if (rkGlobalParameters.showColor) {
-        pthread_mutex_lock(&engine->mutex);
-        k = snprintf(me->name, RKShortNameLength, "%s", rkGlobalParameters.showColor ? RKGetColor() : "");
-        pthread_mutex_unlock(&engine->mutex);
-    } else {
-        k = 0;
-    }
-    if (engine->workerCount > 9) {
-        k += sprintf(me->name + k, "H%02d", c);
-    } else {
-        k += sprintf(me->name + k, "H%d", c);
-    }
-    if (rkGlobalParameters.showColor) {
-        sprintf(me->name + k, RKNoColor);
-    }
+static char *addressString(const struct sockaddr_in *address) {
+    static char string[4][INET_ADDRSTRLEN];
+    static int k = 0;
+    char *s = string[k++ % 4];
+    inet_ntop(AF_INET, &address->sin_addr, s, INET_ADDRSTRLEN);
+    return s;
+}
 
-    // Resolve my host
-    pthread_mutex_lock(&engine->mutex);
-    struct hostent *hostname = gethostbyname(engine->hosts[c]);
-    pthread_mutex_unlock(&engine->mutex);
-    if (hostname == NULL) {
-        RKLog("%s %s Error. Unable to resolve %s.", engine->name, me->name, engine->hosts[c]);
-        me->hostStatus = RKHostStatusUnknown;
-        me->tic = 2;
-        free(buff);
-        return NULL;
+// A datagram ICMP socket if the kernel allows, a raw socket otherwise
+static int openSocket(RKHostMonitor *engine) {
+    const int value = 50;
+    int sd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    engine->raw = false;
+    if (sd < 0 && (errno == EACCES || errno == EPERM || errno == EPROTONOSUPPORT)) {
+        sd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+        engine->raw = true;
     }
-    memset(&targetAddress, 0, sizeof(struct sockaddr_in));
-    targetAddress.sin_family = hostname->h_addrtype;
-    targetAddress.sin_addr.s_addr = *(unsigned int *)hostname->h_addr;
-
-    // Open a socket, set some properties for ICMP
-    if ((sd = socket(AF_INET, SOCK_DGRAM, protocol->p_proto)) < 0) {
-        RKLog("%s %s Error. Unable to open a socket.  sd = %d   errno = %d (%s)\n", engine->name, me->name, sd, errno, RKErrnoString(errno));
-        if (errno == EACCES) {
-            RKLog(">%s %s Info. Use one of the following:\n", engine->name, me->name);
-            RKLog(">%s %s Info. Run 'sysctl -w net.ipv4.ping_group_range=\"0 2147483647\"'\n", engine->name, me->name);
-            RKLog(">%s %s Info. Add 'net.ipv4.ping_group_range = 0 2147483647' to /etc/sysctl.conf\n", engine->name, me->name);
-            RKLog(">%s %s Info. to allow root to use ICMP sockets\n", engine->name, me->name);
+    if (sd < 0) {
+        RKLog("%s Error. Unable to open a socket.  sd = %d   errno = %d (%s)\n", engine->name, sd, errno, RKErrnoString(errno));
+        if (errno == EACCES || errno == EPERM) {
+            RKLog(">%s Info. Use one of the following:\n", engine->name);
+            RKLog(">%s Info. Run 'sysctl -w net.ipv4.ping_group_range=\"0 2147483647\"'\n", engine->name);
+            RKLog(">%s Info. Add 'net.ipv4.ping_group_range = 0 2147483647' to /etc/sysctl.conf\n", engine->name);
+            RKLog(">%s Info. to allow root to use ICMP sockets\n", engine->name);
         }
-        me->hostStatus = RKHostStatusUnknown;
-        me->tic = 2;
-        free(buff);
-        return NULL;
-    }
-    int hold = 1;
-    if (setsockopt(sd, IPPROTO_IP, IP_RECVTTL, &hold, sizeof(hold))) {
-        RKLog("%s %s Error. Failed in setsockopt() IP_RECVTTL.\n", engine->name, me->name);
-        me->hostStatus = RKHostStatusUnknown;
-        me->tic = 2;
-        free(buff);
-        return NULL;
+        return -1;
     }
     if (setsockopt(sd, IPPROTO_IP, IP_TTL, &value, sizeof(value))) {
-        RKLog("%s %s Error. Failed in setsockopt().\n", engine->name, me->name);
-        me->hostStatus = RKHostStatusUnknown;
-        me->tic = 2;
-        free(buff);
-        return NULL;
+        RKLog("%s Error. Failed in setsockopt().\n", engine->name);
+        close(sd);
+        return -1;
     }
-    if (fcntl(sd, F_SETFL, O_NONBLOCK)) {
-        RKLog("%s %s Error. Failed in fcntl().\n", engine->name, me->name);
-        me->hostStatus = RKHostStatusUnknown;
-        me->tic = 2;
-        free(buff);
-        return NULL;
+    if (fcntl(sd, F_SETFL, O_NONBLOCK) || fcntl(sd, F_SETFD, FD_CLOEXEC)) {
+        RKLog("%s Error. Failed in fcntl().\n", engine->name);
+        close(sd);
+        return -1;
     }
+    return sd;
+}
 
-    RKLog(">%s %s Started.   host = %s (%d.%d.%d.%d)   sd = %d\n",
-          engine->name,
-          me->name,
-          engine->hosts[c],
-          (targetAddress.sin_addr.s_addr & 0xff),
-          (targetAddress.sin_addr.s_addr & 0x0000ff00) >> 8,
-          (targetAddress.sin_addr.s_addr & 0x00ff0000) >> 16,
-          (targetAddress.sin_addr.s_addr & 0xff000000) >> 24,
-          sd);
-
-    me->tic = 1;
-    me->sequenceNumber = 1;
-    me->identifier = rand() & 0xffff;
-    gettimeofday(&me->latestTime, NULL);
-
-    uint32_t unreachCount = 0;
-
-    while (engine->state & RKEngineStateWantActive) {
-
-        // Reset buffer
-        memset(buff, 0, RKHostMonitorPacketSize);
-
-        // Prepare echo request packet
-        icmpHeader = (RKICMPHeader *)buff;
-        icmpHeader->type = RKICMPv4EchoRequest;
-        icmpHeader->code = 0;
-        icmpHeader->checksum = 0;
-        icmpHeader->identifier = me->identifier;
-        icmpHeader->sequenceNumber = me->sequenceNumber;
-        icmpHeader->checksum = rk_host_monitor_checksum(buff, txSize);
-
-        pthread_mutex_lock(&engine->mutex);
-
-        // Ping
-        if ((r = sendto(sd, buff, txSize, 0, (struct sockaddr *)&targetAddress, sizeof(struct sockaddr))) == -1) {
-            if (engine->verbose > 1) {
-                RKLog("%s %s Error. Command sendto() -> %d   errno = %d / %s.", engine->name, me->name, r, errno, RKErrnoString(errno));
-            }
-            // Now we wait a little
-            pthread_mutex_unlock(&engine->mutex);
-            k = 0;
-            while (k++ < 10 && engine->state & RKEngineStateWantActive) {
-                usleep(100000);
-            }
-            // Delay reporting since other threads may still be waiting for recvfrom()
-            me->hostStatus = RKHostStatusUnreachable;
-            me->tic++;
-            if (unreachCount++ > 3) {
-                unreachCount = 0;
-                RKLog("%s %s Reinitiating socket descriptor ...\n", engine->name, me->name);
-                close(sd);
-                sd = socket(AF_INET, SOCK_DGRAM, protocol->p_proto);
-                setsockopt(sd, IPPROTO_IP, IP_TTL, &value, sizeof(value));
-                fcntl(sd, F_SETFL, O_NONBLOCK);
+// Send an echo request to every resolved host in batches, returns the number of requests sent
+static int sendRequests(RKHostMonitor *engine, const struct timeval *now) {
+    int j, k, n, r;
+    int sent = 0;
+    RKICMPHeader *icmpHeader;
+    RKUnitMonitor *hosts[RKHostMonitorBatchSize];
+    uint8_t packets[RKHostMonitorBatchSize][RKHostMonitorPacketSize];
+    const size_t txSize = RKHostMonitorPacketSize - sizeof(RKIPV4Header);
+    #if defined(RKHostMonitorHasMultipleMessages)
+    struct mmsghdr messages[RKHostMonitorBatchSize];
+    struct iovec iovs[RKHostMonitorBatchSize];
+    #endif
+
+    k = 0;
+    while (k < engine->workerCount) {
+        // Compose a batch of echo requests
+        n = 0;
+        while (k < engine->workerCount && n < RKHostMonitorBatchSize) {
+            RKUnitMonitor *host = &engine->workers[k++];
+            if (!host->resolved) {
+                continue;
             }
-            continue;
-        } else if (engine->verbose > 1) {
-            RKLog(">%s %s Ping %s (%d.%d.%d.%d)   seq = %d   size = %d bytes\n",
-                  engine->name, me->name,
-                  engine->hosts[c],
-                  (targetAddress.sin_addr.s_addr & 0xff),
-                  (targetAddress.sin_addr.s_addr & 0x0000ff00) >> 8,
-                  (targetAddress.sin_addr.s_addr & 0x00ff0000) >> 16,
-                  (targetAddress.sin_addr.s_addr & 0xff000000) >> 24,
-                  me->sequenceNumber,
-                  txSize);
+            memset(packets[n], 0, RKHostMonitorPacketSize);
+            icmpHeader = (RKICMPHeader *)packets[n];
+            icmpHeader->type = RKICMPv4EchoRequest;
+            icmpHeader->code = 0;
+            icmpHeader->identifier = engine->identifier;
+            icmpHeader->sequenceNumber = ++engine->sequenceNumber;
+            icmpHeader->checksum = rk_host_monitor_checksum(packets[n], txSize);
+            host->sequenceNumber = icmpHeader->sequenceNumber;
+            host->sentTime = *now;
+            host->pending = true;
+            host->requestCount++;
+            hosts[n++] = host;
         }
-
-        // Reset buffer
-        memset(buff, 0, RKHostMonitorPacketSize);
-
-        // Pong
-        k = 0;
-        offset = (size_t)-1;
-        returnAddress.sin_addr.s_addr = 0x0100007F;
-        while (returnAddress.sin_addr.s_addr != targetAddress.sin_addr.s_addr && k++ < engine->workerCount + 1 && engine->state & RKEngineStateWantActive) {
-            if ((r = recvfrom(sd, buff, RKHostMonitorPacketSize, 0, (struct sockaddr *)&returnAddress, &returnLength)) > 0) {
-                if (engine->verbose > 1 && engine->tic != 2) {
-                    RKLog("%s %s recvfrom()   sd = %d   r = %d  / %d   %d.%d.%d.%d   returnLength = %d\n",
-                          engine->name, me->name,
-                          sd,
-                          r,
-                          (int)(sizeof(RKIPV4Header) + sizeof(RKICMPHeader)),
-                          (returnAddress.sin_addr.s_addr & 0xff),
-                          (returnAddress.sin_addr.s_addr & 0x0000ff00) >> 8,
-                          (returnAddress.sin_addr.s_addr & 0x00ff0000) >> 16,
-                          (returnAddress.sin_addr.s_addr & 0xff000000) >> 24,
-                          returnLength);
-                }
-                if (r == txSize) {
-                    offset = 0;
-                } else if (r > sizeof(RKIPV4Header) + sizeof(RKICMPHeader) && ipv4Header->protocol == protocol->p_proto) {
-                    ipHeaderLength = (ipv4Header->versionAndHeaderLength & 0x0f) * sizeof(uint32_t);
-                    if (r >= ipHeaderLength + sizeof(RKICMPHeader)) {
-                        offset = ipHeaderLength;
-                    } else {
-                        RKLog("%s %s Error. Unexpected packet size.\n", engine->name, me->name);
-                        break;
-                    }
-                }
-            } else if (engine->verbose > 2) {
-                RKLog("%s %s recvfrom() -> %d\n", engine->name, me->name, r);
-            }
+        if (n == 0) {
+            break;
         }
-        if (offset != (size_t)-1 && returnAddress.sin_addr.s_addr == targetAddress.sin_addr.s_addr) {
-            icmpHeader = (RKICMPHeader *)(buff + offset);
-            receivedChecksum = icmpHeader->checksum;
-            icmpHeader->checksum = 0;
-            calculatedChecksum = rk_host_monitor_checksum(buff + offset, r - offset);
-            if (engine->verbose > 1) {
-                RKLog("%s %s r = %u   sd = %d   returnAddress = %d.%d.%d.%d   returnLength = %d\n",
-                      engine->name, me->name,
-                      r,
-                      sd,
-                      (returnAddress.sin_addr.s_addr & 0xff),
-                      (returnAddress.sin_addr.s_addr & 0x0000ff00) >> 8,
-                      (returnAddress.sin_addr.s_addr & 0x00ff0000) >> 16,
-                      (returnAddress.sin_addr.s_addr & 0xff000000) >> 24,
-                      returnLength);
-                RKLog(">%s %s checksum       = %   6d   %   6d\n", engine->name, me->name, receivedChecksum, calculatedChecksum);
-                RKLog(">%s %s identifier     = 0x%04x   0x%04x\n", engine->name, me->name, icmpHeader->identifier, me->identifier);
-                RKLog(">%s %s sequenceNumber = %   6d   %   6d\n", engine->name, me->name, icmpHeader->sequenceNumber, me->sequenceNumber);
+        // Send them all, one system call if possible
+        #if defined(RKHostMonitorHasMultipleMessages)
+        memset(messages, 0, n * sizeof(struct mmsghdr));
+        for (j = 0; j < n; j++) {
+            iovs[j].iov_base = packets[j];
+            iovs[j].iov_len = txSize;
+            messages[j].msg_hdr.msg_name = &hosts[j]->address;
+            messages[j].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            messages[j].msg_hdr.msg_iov = &iovs[j];
+            messages[j].msg_hdr.msg_iovlen = 1;
+        }
+        r = 0;
+        while (r < n) {
+            j = sendmmsg(engine->sd, messages + r, n - r, 0);
+            if (j <= 0) {
+                break;
             }
-            // Ignore identifier for this since it can be different for UDP implementations
-            if (receivedChecksum == calculatedChecksum &&
-                icmpHeader->type == RKICMPv4EchoReply &&
-                icmpHeader->code == 0 &&
-                icmpHeader->sequenceNumber == me->sequenceNumber) {
-                me->hostStatus = RKHostStatusReachable;
-                me->sequenceNumber++;
-                gettimeofday(&me->latestTime, NULL);
-            } else {
-                me->hostStatus = RKHostStatusReachableUnusual;
+            r += j;
+        }
+        #else
+        for (r = 0; r < n; r++) {
+            if (sendto(engine->sd, packets[r], txSize, 0, (struct sockaddr *)&hosts[r]->address, sizeof(struct sockaddr_in)) < 0) {
+                break;
             }
-            me->tic++;
-        } else {
-            // Timed out
-            gettimeofday(&time, NULL);
-            period = RKTimevalDiff(time, me->latestTime);
+        }
+        #endif
+        sent += r;
+        // The hosts that did not get a request are unreachable for now
+        for (j = r; j < n; j++) {
             if (engine->verbose > 1) {
-                RKLog(">%s %s r = %d   delta: %.3e   %d.%d.%d.%d  %d %d",
-                      engine->name, me->name,
-                      r,
-                      RKTimevalDiff(time, me->latestTime),
-                      (targetAddress.sin_addr.s_addr & 0xff),
-                      (targetAddress.sin_addr.s_addr & 0x0000ff00) >> 8,
-                      (targetAddress.sin_addr.s_addr & 0x00ff0000) >> 16,
-                      (targetAddress.sin_addr.s_addr & 0xff000000) >> 24, k, offset);
-            }
-            if (period > (double)me->pingIntervalInSeconds * 3.0) {
-                me->hostStatus = RKHostStatusUnreachable;
-                me->tic++;
-            } else if (me->sequenceNumber > 1 && period > (double)me->pingIntervalInSeconds * 1.5) {
-                me->hostStatus = RKHostStatusPartiallyReachable;
-                me->tic++;
+                RKLog("%s %s Error. Unable to send to %s   errno = %d / %s.\n", engine->name, hosts[j]->name,
+                      addressString(&hosts[j]->address), errno, RKErrnoString(errno));
             }
+            hosts[j]->pending = false;
+            hosts[j]->hostStatus = RKHostStatusUnreachable;
+            hosts[j]->tic++;
+        }
+        if (engine->verbose > 2) {
+            RKLog(">%s Ping %d / %d hosts   seq = %d   size = %zu bytes\n", engine->name, r, n, engine->sequenceNumber, txSize);
+        }
+    }
+    return sent;
+}
 
-            pthread_mutex_unlock(&engine->mutex);
+static void handleReply(RKHostMonitor *engine, uint8_t *packet, const size_t size, const struct sockaddr_in *from, const struct timeval *now) {
+    int k;
+    size_t offset = 0;
+    RKUnitMonitor *host = NULL;
 
-            // Wait less if this round failed.
-            k = 0;
-            while (k++ < 10 && engine->state & RKEngineStateWantActive) {
-                usleep(100000);
-            }
-            continue;
+    // A raw socket receives the IP header too
+    if (engine->raw) {
+        if (size < sizeof(RKIPV4Header)) {
+            return;
+        }
+        offset = (((RKIPV4Header *)packet)->versionAndHeaderLength & 0x0f) * sizeof(uint32_t);
+    }
+    if (size < offset + sizeof(RKICMPHeader)) {
+        return;
+    }
+    RKICMPHeader *icmpHeader = (RKICMPHeader *)(packet + offset);
+    // A raw socket also sees all other ICMP messages, including the requests to the loopback
+    if (icmpHeader->type != RKICMPv4EchoReply || icmpHeader->code != 0) {
+        return;
+    }
+    // The kernel sets the identifier of a datagram socket, it only delivers the replies of the socket
+    if (engine->raw && icmpHeader->identifier != engine->identifier) {
+        return;
+    }
+    for (k = 0; k < engine->workerCount; k++) {
+        if (engine->workers[k].pending &&
+            engine->workers[k].sequenceNumber == icmpHeader->sequenceNumber &&
+            engine->workers[k].address.sin_addr.s_addr == from->sin_addr.s_addr) {
+            host = &engine->workers[k];
+            break;
+        }
+    }
+    if (host == NULL) {
+        if (engine->verbose > 2) {
+            RKLog("%s Info. Late or unknown reply from %s   seq = %d\n", engine->name, addressString(from), icmpHeader->sequenceNumber);
         }
+        return;
+    }
+    const uint16_t receivedChecksum = icmpHeader->checksum;
+    icmpHeader->checksum = 0;
+    const uint16_t calculatedChecksum = rk_host_monitor_checksum(icmpHeader, size - offset);
+
+    host->pending = false;
+    host->latency = RKTimevalDiff(*now, host->sentTime);
+    host->histogram[latencyBin(host->latency)]++;
+    host->replyCount++;
+    host->latestTime = *now;
+    host->hostStatus = receivedChecksum == calculatedChecksum ? RKHostStatusReachable : RKHostStatusReachableUnusual;
+    host->tic++;
+    if (engine->verbose > 1) {
+        RKLog(">%s %s Pong %s   seq = %d   latency = %.3f ms%s\n", engine->name, host->name,
+              addressString(from), icmpHeader->sequenceNumber, 1.0e3 * host->latency,
+              receivedChecksum == calculatedChecksum ? "" : "   checksum mismatch");
+    }
+}
 
-        pthread_mutex_unlock(&engine->mutex);
+// Take all the replies that have arrived, in batches
+static void receiveReplies(RKHostMonitor *engine) {
+    int j, n;
+    struct timeval now;
+    uint8_t packets[RKHostMonitorBatchSize][RKHostMonitorReplySize];
+    struct sockaddr_in addresses[RKHostMonitorBatchSize];
+    #if defined(RKHostMonitorHasMultipleMessages)
+    struct mmsghdr messages[RKHostMonitorBatchSize];
+    struct iovec iovs[RKHostMonitorBatchSize];
+    #else
+    ssize_t r;
+    socklen_t length;
+    #endif
 
-        // Now we wait
-        k = 0;
-        while (k++ < me->pingIntervalInSeconds * 10 && engine->state & RKEngineStateWantActive) {
-            usleep(100000);
+    do {
+        #if defined(RKHostMonitorHasMultipleMessages)
+        memset(messages, 0, sizeof(messages));
+        for (j = 0; j < RKHostMonitorBatchSize; j++) {
+            iovs[j].iov_base = packets[j];
+            iovs[j].iov_len = RKHostMonitorReplySize;
+            messages[j].msg_hdr.msg_name = &addresses[j];
+            messages[j].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            messages[j].msg_hdr.msg_iov = &iovs[j];
+            messages[j].msg_hdr.msg_iovlen = 1;
         }
-    }
+        n = recvmmsg(engine->sd, messages, RKHostMonitorBatchSize, MSG_DONTWAIT, NULL);
+        if (n <= 0) {
+            break;
+        }
+        gettimeofday(&now, NULL);
+        for (j = 0; j < n; j++) {
+            handleReply(engine, packets[j], messages[j].msg_len, &addresses[j], &now);
+        }
+        #else
+        n = 0;
+        length = sizeof(struct sockaddr_in);
+        while (n < RKHostMonitorBatchSize &&
+               (r = recvfrom(engine->sd, packets[n], RKHostMonitorReplySize, 0, (struct sockaddr *)&addresses[n], &length)) > 0) {
+            gettimeofday(&now, NULL);
+            handleReply(engine, packets[n], r, &addresses[n], &now);
+            length = sizeof(struct sockaddr_in);
+            n++;
+        }
+        #endif
+    } while (n == RKHostMonitorBatchSize && engine->state & RKEngineStateWantActive);
+}
 
-    if (sd) {
-        close(sd);
+// Hosts that have not replied for a while
+static void updateTimeouts(RKHostMonitor *engine, const struct timeval *now) {
+    for (int k = 0; k < engine->workerCount; k++) {
+        RKUnitMonitor *host = &engine->workers[k];
+        if (!host->resolved) {
+            continue;
+        }
+        const double period = RKTimevalDiff(*now, host->latestTime);
+        if (period > engine->pingInterval * 3.0) {
+            if (host->hostStatus != RKHostStatusUnreachable) {
+                host->hostStatus = RKHostStatusUnreachable;
+                host->tic++;
+            }
+        } else if (host->replyCount > 0 && period > engine->pingInterval * 1.5) {
+            if (host->hostStatus != RKHostStatusPartiallyReachable) {
+                host->hostStatus = RKHostStatusPartiallyReachable;
+                host->tic++;
+            }
+        }
     }
-    free(buff);
-
-    RKLog(">%s %s Stopped.\n", engine->name, me->name);
+}
 
-    return NULL;
+static void consolidateStatus(RKHostMonitor *engine) {
+    int k;
+    bool allKnown = true;
+    bool allReachable = true;
+    bool anyReachable = false;
+    for (k = 0; k < engine->workerCount; k++) {
+        RKUnitMonitor *worker = &engine->workers[k];
+        allKnown &= worker->hostStatus != RKHostStatusUnknown;
+        anyReachable |= worker->hostStatus == RKHostStatusReachable;
+        allReachable &= (worker->hostStatus == RKHostStatusReachable || worker->hostStatus == RKHostStatusReachableUnusual);
+        if (engine->verbose > 1) {
+            RKLog("%s %s %s%s%s (%d)\n", engine->name,
+                  engine->hosts[k],
+                  rkGlobalParameters.showColor ? (worker->hostStatus == RKHostStatusReachable ? RKGreenColor :
+                                                  (worker->hostStatus == RKHostStatusReachableUnusual ? RKLimeColor :
+                                                   (worker->hostStatus == RKHostStatusPartiallyReachable ? RKOrangeColor : RKRedColor))) : "",
+                  worker->hostStatus == RKHostStatusReachable ? "responded" :
+                  (worker->hostStatus == RKHostStatusReachableUnusual ? "responded *" :
+                   (worker->hostStatus == RKHostStatusPartiallyReachable ? "delayed" : "unreachable")),
+                  rkGlobalParameters.showColor ? RKNoColor : "", engine->tic);
+        }
+    }
+    engine->allKnown = allKnown;
+    engine->allReachable = allReachable;
+    engine->anyReachable = anyReachable;
 }
 
+#pragma mark - Delegate Workers
+
 static void *hostWatcher(void *in) {
     RKHostMonitor *engine = (RKHostMonitor *)in;
 
     int k;
-    bool anyTrue, allKnown, allReachable, anyReachable;
+    double wait, next;
+    struct timeval now;
 
     engine->state |= RKEngineStateWantActive;
     engine->state ^= RKEngineStateActivating;
@@ -371,111 +369,110 @@ static void *hostWatcher(void *in) {
         RKLog("%s Workers already allocated.\n", engine->name);
         return NULL;
     }
-    engine->workers = (RKUnitMonitor *)malloc(MAX(3, engine->workerCount) * sizeof(RKUnitMonitor));
+    engine->workers = (RKUnitMonitor *)malloc(MAX(1, engine->workerCount) * sizeof(RKUnitMonitor));
     if (engine->workers == NULL) {
         RKLog(">%s Error. Unable to allocate an RKUnitMonitor.\n", engine->name);
+        engine->tic = 1;
         return (void *)RKResultFailedToCreateUnitWorker;
     }
-    memset(engine->workers, 0, engine->workerCount * sizeof(RKUnitMonitor));
+    memset(engine->workers, 0, MAX(1, engine->workerCount) * sizeof(RKUnitMonitor));
     engine->memoryUsage += engine->workerCount * sizeof(RKUnitMonitor);
 
-	for (k = 0; k < engine->workerCount; k++) {
-        RKUnitMonitor *worker = &engine->workers[k];
+    gettimeofday(&now, NULL);
 
-        worker->id = k;
-        worker->parent = engine;
-        worker->pingIntervalInSeconds = RKHostMonitorPingInterval;
-
-        // Workers that actually ping the hosts
-        if (pthread_create(&worker->tid, NULL, hostPinger, worker) != 0) {
-            RKLog(">%s Error. Failed to start a host pinger", engine->name);
-            return (void *)RKResultFailedToStartHostPinger;
+    // Resolve all hosts
+    for (k = 0; k < engine->workerCount; k++) {
+        RKUnitMonitor *host = &engine->workers[k];
+        int j;
+        if (rkGlobalParameters.showColor) {
+            j = snprintf(host->name, RKShortNameLength, "%s", RKGetColor());
+        } else {
+            j = 0;
+        }
+        if (engine->workerCount > 9) {
+            j += sprintf(host->name + j, "H%02d", k);
+        } else {
+            j += sprintf(host->name + j, "H%d", k);
+        }
+        if (rkGlobalParameters.showColor) {
+            sprintf(host->name + j, RKNoColor);
         }
+        host->id = k;
+        host->parent = engine;
+        host->latestTime = now;
+        struct hostent *hostname = gethostbyname(engine->hosts[k]);
+        if (hostname == NULL || hostname->h_addrtype != AF_INET) {
+            RKLog("%s %s Error. Unable to resolve %s.\n", engine->name, host->name, engine->hosts[k]);
+            host->hostStatus = RKHostStatusUnknown;
+            continue;
+        }
+        host->address.sin_family = AF_INET;
+        host->address.sin_addr.s_addr = *(unsigned int *)hostname->h_addr;
+        host->resolved = true;
     }
 
-    engine->state |= RKEngineStateSleep0;
+    // One socket for all hosts
+    engine->identifier = rand() & 0xffff;
+    engine->sequenceNumber = 0;
+    engine->sd = openSocket(engine);
+
     for (k = 0; k < engine->workerCount; k++) {
-        while (engine->workers[k].tic == 0 && engine->state & RKEngineStateWantActive) {
-            usleep(10000);
+        RKUnitMonitor *host = &engine->workers[k];
+        if (host->resolved) {
+            RKLog(">%s %s Host = %s (%s)\n", engine->name, host->name, engine->hosts[k], addressString(&host->address));
         }
     }
-    engine->state ^= RKEngineStateSleep0;
+
     engine->state |= RKEngineStateActive;
 
-    RKLog("%s Started.   mem = %s B\n", engine->name, RKUIntegerToCommaStyleString(engine->memoryUsage));
+    RKLog("%s Started.   mem = %s B   sd = %d (%s)\n", engine->name, RKUIntegerToCommaStyleString(engine->memoryUsage),
+          engine->sd, engine->sd < 0 ? "none" : (engine->raw ? "raw" : "datagram"));
 
     // Increase the tic once to indicate the engine is ready
     engine->tic = 1;
 
-    // Wait another tic for the first ping to properly respond
-    do {
-        anyTrue = false;
-        for (k = 0; k < engine->workerCount; k++) {
-            RKUnitMonitor *worker = &engine->workers[k];
-            anyTrue |= worker->tic == engine->tic;
-        }
-        usleep(10000);
-    } while (anyTrue && engine->state & RKEngineStateWantActive);
-
-    // Increase one more now that the children are going
-    engine->tic = 2;
-
-    if (engine->verbose > 2) {
-        for (k = 0; k < engine->workerCount; k++) {
-            RKUnitMonitor *worker = &engine->workers[k];
-            RKLog(">%s tic[%d] = %d\n", engine->name, k, worker->tic);
-        }
-    }
-
     // Wait here while the engine should stay active
+    next = (double)now.tv_sec + 1.0e-6 * (double)now.tv_usec;
     while (engine->state & RKEngineStateWantActive) {
-        // Consolidate all the state from all unit watcher
-        allKnown = true;
-        allReachable = true;
-        anyReachable = false;
-        for (k = 0; k < engine->workerCount; k++) {
-            RKUnitMonitor *worker = &engine->workers[k];
-            allKnown &= worker->hostStatus != RKHostStatusUnknown;
-            anyReachable |= worker->hostStatus == RKHostStatusReachable;
-            allReachable &= (worker->hostStatus == RKHostStatusReachable || worker->hostStatus == RKHostStatusReachableUnusual);
-            if (engine->verbose > 1) {
-                RKLog("%s %s %s%s%s (%d)\n", engine->name,
-                      engine->hosts[k],
-                      rkGlobalParameters.showColor ? (worker->hostStatus == RKHostStatusReachable ? RKGreenColor :
-                                                      (worker->hostStatus == RKHostStatusReachableUnusual ? RKLimeColor :
-                                                       (worker->hostStatus == RKHostStatusPartiallyReachable ? RKOrangeColor : RKRedColor))) : "",
-                      worker->hostStatus == RKHostStatusReachable ? "responded" :
-                      (worker->hostStatus == RKHostStatusReachableUnusual ? "responded *" :
-                       (worker->hostStatus == RKHostStatusPartiallyReachable ? "delayed" : "unreachable")),
-                      rkGlobalParameters.showColor ? RKNoColor : "", engine->tic);
+        gettimeofday(&now, NULL);
+        wait = next - (double)now.tv_sec - 1.0e-6 * (double)now.tv_usec;
+        if (wait <= 0.0) {
+            pthread_mutex_lock(&engine->mutex);
+            updateTimeouts(engine, &now);
+            consolidateStatus(engine);
+            if (engine->sd >= 0) {
+                sendRequests(engine, &now);
             }
+            pthread_mutex_unlock(&engine->mutex);
+            engine->tic++;
+            // Skip the rounds that were missed
+            next += engine->pingInterval * MAX(1.0, ceil(-wait / engine->pingInterval));
+            continue;
+        }
+        // Wait for the replies until the next round, at most 0.1 s for a responsive exit
+        wait = MIN(wait, 0.1);
+        if (engine->sd < 0) {
+            usleep((useconds_t)(wait * 1.0e6));
+            continue;
+        }
+        struct pollfd pfd = {.fd = engine->sd, .events = POLLIN};
+        if (poll(&pfd, 1, (int)ceil(wait * 1.0e3)) > 0) {
+            pthread_mutex_lock(&engine->mutex);
+            receiveReplies(engine);
+            consolidateStatus(engine);
+            pthread_mutex_unlock(&engine->mutex);
         }
-        engine->allKnown = allKnown;
-        engine->allReachable = allReachable;
-        engine->anyReachable = anyReachable;
-
-        // Wait until all children advance by one tic
-        engine->state |= RKEngineStateSleep1;
-        do {
-            usleep(100000);
-            anyTrue = false;
-            for (k = 0; k < engine->workerCount; k++) {
-                RKUnitMonitor *worker = &engine->workers[k];
-                anyTrue |= worker->tic == engine->tic;
-            }
-            if (engine->verbose > 2) {
-                RKLog("Info. %d %d %d vs %d\n", engine->workers[0].tic, engine->workers[1].tic, engine->workers[2].tic, engine->tic);
-            }
-        } while (anyTrue && engine->state & RKEngineStateWantActive);
-        engine->state ^= RKEngineStateSleep1;
-
-        engine->tic++;
     }
 
-    for (k = 0; k < engine->workerCount; k++) {
-        pthread_join(engine->workers[k].tid, NULL);
+    if (engine->sd >= 0) {
+        close(engine->sd);
+        engine->sd = -1;
     }
+    pthread_mutex_lock(&engine->mutex);
     free(engine->workers);
+    engine->workers = NULL;
+    engine->memoryUsage -= engine->workerCount * sizeof(RKUnitMonitor);
+    pthread_mutex_unlock(&engine->mutex);
 
     engine->state ^= RKEngineStateActive;
     return NULL;
@@ -494,6 +491,8 @@ RKHostMonitor *RKHostMonitorInit(void) {
             rkGlobalParameters.showColor ? RKGetBackgroundColorOfIndex(RKEngineColorHostMonitor) : "",
             rkGlobalParameters.showColor ? RKNoColor : "");
     engine->state = RKEngineStateAllocated;
+    engine->pingInterval = (double)RKHostMonitorPingInterval;
+    engine->sd = -1;
     pthread_mutex_init(&engine->mutex, NULL);
     RKHostMonitorAddHost(engine, "www.ou.edu");
     RKHostMonitorAddHost(engine, "8.8.8.8");
@@ -505,6 +504,7 @@ void RKHostMonitorFree(RKHostMonitor *engine) {
         RKHostMonitorStop(engine);
     }
     pthread_mutex_destroy(&engine->mutex);
+    free(engine->hosts);
     free(engine);
 }
 
@@ -514,6 +514,14 @@ void RKHostMonitorSetVerbose(RKHostMonitor *engine, const int verbose) {
     engine->verbose = verbose;
 }
 
+void RKHostMonitorSetPingInterval(RKHostMonitor *engine, const double interval) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKLog("%s Cannot change the ping interval after the engine has started.\n", engine->name);
+        return;
+    }
+    engine->pingInterval = MAX(0.01, interval);
+}
+
 void RKHostMonitorAddHost(RKHostMonitor *engine, const char *address) {
     if (engine->state & RKEngineStateWantActive) {
         RKLog("%s Cannot add host after the engine has started.\n", engine->name);
@@ -526,6 +534,17 @@ void RKHostMonitorAddHost(RKHostMonitor *engine, const char *address) {
     engine->state |= RKEngineStateProperlyWired;
 }
 
+void RKHostMonitorClearHosts(RKHostMonitor *engine) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKLog("%s Cannot remove hosts after the engine has started.\n", engine->name);
+        return;
+    }
+    free(engine->hosts);
+    engine->hosts = NULL;
+    engine->workerCount = 0;
+    engine->memoryUsage = sizeof(RKHostMonitor);
+}
+
 #pragma mark - Interactions
 
 int RKHostMonitorStart(RKHostMonitor *engine) {
@@ -570,3 +589,30 @@ int RKHostMonitorStop(RKHostMonitor *engine) {
     }
     return RKResultSuccess;
 }
+
+// Latest round-trip time and its histogram of each host, as a JSON object
+char *RKHostMonitorLatencyString(RKHostMonitor *engine) {
+    int j, k, n;
+    char string[RKNameLength + 16 * RKHostMonitorLatencyBinCount + 64];
+    const size_t size = sizeof(engine->latencyString);
+    size_t m = sprintf(engine->latencyString, "{");
+    pthread_mutex_lock(&engine->mutex);
+    for (k = 0; k < engine->workerCount && engine->workers != NULL; k++) {
+        RKUnitMonitor *host = &engine->workers[k];
+        n = snprintf(string, sizeof(string), "%s\"%s\":{\"Latency\":%.3f,\"Histogram\":[",
+                     m > 1 ? "," : "", engine->hosts[k], 1.0e3 * host->latency);
+        for (j = 0; j < RKHostMonitorLatencyBinCount && n < sizeof(string); j++) {
+            n += snprintf(string + n, sizeof(string) - n, "%s%u", j > 0 ? "," : "", host->histogram[j]);
+        }
+        if (n < sizeof(string)) {
+            n += snprintf(string + n, sizeof(string) - n, "]}");
+        }
+        if (n >= sizeof(string) || m + n + 2 > size) {
+            break;
+        }
+        m += sprintf(engine->latencyString + m, "%s", string);
+    }
+    pthread_mutex_unlock(&engine->mutex);
+    sprintf(engine->latencyString + m, "}");
+    return engine->latencyString;
+}
@@ -873,7 +873,7 @@ void RKPreparePath(const char *filename) {
             if (strlen(path)) {
                 if (lstat(path, &s) && errno == ENOENT) {
                     // printf("mkdir %s\n", path);
-                    if (mkdir(path, 0755)) {
+                    if (mkdir(path, 0755) && errno != EEXIST) {
                         fprintf(stderr, "Error creating directory '%s'\n", path);
                         fprintf(stderr, "Input filename '%s'\n", filename);
                     }
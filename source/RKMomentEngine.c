@@ -356,7 +356,9 @@ static void *momentEngineCore(void *in) {
 
         // Mark being processed so that the other thread will not override the length
         ray->header.s = RKRayStatusProcessing;
-        ray->header.i = tag;
+        // A new identifier is visible before any data is changed (see RKProductCountRecycledViews())
+        __atomic_store_n(&ray->header.i, tag, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
 
         // Set the ray headers
         // NOTE: pulse->header.timeDouble still has the original time from RKClock, which has a different epoch
@@ -505,7 +507,7 @@ static void *momentEngineCore(void *in) {
         ray->header.pulseCount = path.length + 1;
         ray->header.marker = marker;
         ray->header.s ^= RKRayStatusProcessing;
-        ray->header.s |= RKRayStatusReady;
+        __atomic_fetch_or(&ray->header.s, RKRayStatusReady, __ATOMIC_RELEASE);
 
         // Status of the ray
         iu = RKNextNModuloS(iu, engine->coreCount, RKBufferSSlotCount);
@@ -7,6 +7,9 @@
 //
 
 #include <RadarKit/RKNetwork.h>
+#include <zlib.h>
+
+#define RKNetworkCodecChunkSize  4096
 
 // Use as:
 // RKNetworkSendPackets(operator, payload, size, payload, size, ..., NULL);
@@ -71,4 +74,156 @@ void RKNetworkShowPacketTypeNumbers(void) {
     SHOW_PACKET_NUMBER(RKNetworkPacketTypeSweep);
     SHOW_PACKET_NUMBER(RKNetworkPacketTypeSweepHeader);
     SHOW_PACKET_NUMBER(RKNetworkPacketTypeSweepRay);
+    SHOW_PACKET_NUMBER(RKNetworkPacketTypeRelayFrame);
+}
+
+#pragma mark - Codecs
+
+// Upper bound of the encoded size of a block of size bytes
+size_t RKNetworkCodecBound(const RKNetworkCodec codec, const size_t size) {
+    if (codec == RKNetworkCodecNone) {
+        return size;
+    }
+    return (size_t)deflateBound(NULL, (uLong)size);
+}
+
+//
+// Encode a block for the network. With RKNetworkCodecDeltaDeflate, every byte is replaced by its difference
+// to the byte one stride earlier, i.e., the same byte of the previous element, before it is deflated. Slowly
+// varying data along the range, e.g., the uint8 display data, become runs of small numbers that deflate well.
+// The difference is formed in small chunks so that the source is not modified and no allocation is needed.
+// Input:
+//     void *destination - the output buffer
+//     size_t capacity - the capacity of the output buffer, see RKNetworkCodecBound()
+//     void *source - the raw block
+//     size_t size - the size of the raw block
+//     size_t stride - the element size, e.g., 1 for uint8 and 4 for float
+//     RKNetworkCodec codec - the codec
+// Output:
+//     Size of the encoded block, 0 if it does not fit in capacity or deflate fails
+//
+size_t RKNetworkEncode(void *destination, const size_t capacity, const void *source, const size_t size, const size_t stride, const RKNetworkCodec codec) {
+    size_t i, k;
+    int flush, r;
+    z_stream stream;
+    const uint8_t *s = (const uint8_t *)source;
+    uint8_t chunk[RKNetworkCodecChunkSize];
+
+    switch (codec) {
+        case RKNetworkCodecNone:
+            if (size > capacity) {
+                return 0;
+            }
+            memcpy(destination, source, size);
+            return size;
+        case RKNetworkCodecDeflate:
+        case RKNetworkCodecDeltaDeflate:
+            break;
+        default:
+            return 0;
+    }
+
+    memset(&stream, 0, sizeof(z_stream));
+    if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK) {
+        return 0;
+    }
+    stream.next_out = (Bytef *)destination;
+    stream.avail_out = (uInt)capacity;
+    if (codec == RKNetworkCodecDeflate || size == 0) {
+        stream.next_in = (Bytef *)s;
+        stream.avail_in = (uInt)size;
+        r = deflate(&stream, Z_FINISH);
+    } else {
+        r = Z_OK;
+        for (k = 0; k < size && r == Z_OK; k += RKNetworkCodecChunkSize) {
+            const size_t n = MIN(RKNetworkCodecChunkSize, size - k);
+            for (i = 0; i < n; i++) {
+                chunk[i] = k + i < stride ? s[k + i] : s[k + i] - s[k + i - stride];
+            }
+            flush = k + n == size ? Z_FINISH : Z_NO_FLUSH;
+            stream.next_in = chunk;
+            stream.avail_in = (uInt)n;
+            do {
+                r = deflate(&stream, flush);
+            } while (r == Z_OK && stream.avail_in > 0 && stream.avail_out > 0);
+        }
+    }
+    deflateEnd(&stream);
+    if (r != Z_STREAM_END) {
+        return 0;
+    }
+    return (size_t)stream.total_out;
+}
+
+// Decode a block from RKNetworkEncode(), returns the decoded size, 0 if it does not fit in capacity or is corrupt
+size_t RKNetworkDecode(void *destination, const size_t capacity, const void *source, const size_t size, const size_t stride, const RKNetworkCodec codec) {
+    size_t i;
+    z_stream stream;
+    uint8_t *d = (uint8_t *)destination;
+
+    switch (codec) {
+        case RKNetworkCodecNone:
+            if (size > capacity) {
+                return 0;
+            }
+            memcpy(destination, source, size);
+            return size;
+        case RKNetworkCodecDeflate:
+        case RKNetworkCodecDeltaDeflate:
+            break;
+        default:
+            return 0;
+    }
+
+    memset(&stream, 0, sizeof(z_stream));
+    if (inflateInit(&stream) != Z_OK) {
+        return 0;
+    }
+    stream.next_in = (Bytef *)source;
+    stream.avail_in = (uInt)size;
+    stream.next_out = (Bytef *)destination;
+    stream.avail_out = (uInt)capacity;
+    int r = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (r != Z_STREAM_END) {
+        return 0;
+    }
+    const size_t decodedSize = (size_t)stream.total_out;
+    if (codec == RKNetworkCodecDeltaDeflate) {
+        for (i = stride; i < decodedSize; i++) {
+            d[i] += d[i - stride];
+        }
+    }
+    return decodedSize;
+}
+
+const char *RKNetworkCodecString(const RKNetworkCodec codec) {
+    switch (codec) {
+        case RKNetworkCodecNone:
+            return "None";
+        case RKNetworkCodecDeflate:
+            return "Deflate";
+        case RKNetworkCodecDeltaDeflate:
+            return "DeltaDeflate";
+        default:
+            return "Unknown";
+    }
+}
+
+// Parse a codec from "none", "deflate", "delta" or a number, returns RKNetworkCodecCount if not recognized
+RKNetworkCodec RKNetworkCodecFromString(const char *string) {
+    while (*string == ' ') {
+        string++;
+    }
+    if (*string >= '0' && *string <= '9') {
+        int k = atoi(string);
+        return k < RKNetworkCodecCount ? (RKNetworkCodec)k : RKNetworkCodecCount;
+    } else if (!strncasecmp(string, "none", 4) || *string == '\0') {
+        return RKNetworkCodecNone;
+    } else if (!strncasecmp(string, "deflate", 7)) {
+        return RKNetworkCodecDeflate;
+    } else if (!strncasecmp(string, "delta", 5)) {
+        return RKNetworkCodecDeltaDeflate;
+    }
+    return RKNetworkCodecCount;
 }
@@ -93,21 +93,225 @@ static void RKPositionnEngineUpdateStatusString(RKPositionEngine *engine) {
 
 #pragma mark - Delegate Workers
 
+// Wait for a condition of the engine until a notification or RKPositionEngineWaitTimeout, whichever comes first
+static int RKPositionEngineWait(RKPositionEngine *engine, pthread_cond_t *condition) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)(RKPositionEngineWaitTimeout * 1.0e9);
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return pthread_cond_timedwait(condition, &engine->mutex, &deadline);
+}
+
+// The next pulse index of a worker, which takes blocks of RKPositionEngineBlockSize pulses in turn
+static uint32_t RKPositionEngineNextPulseIndexOfWorker(RKPositionEngine *engine, uint32_t k, const int c) {
+    do {
+        k = RKNextModuloS(k, engine->radarDescription->pulseBufferDepth);
+    } while ((k / RKPositionEngineBlockSize) % engine->coreCount != c);
+    return k;
+}
+
+// Index of the position just after time, from the cursor of a worker if it is still valid
+static uint32_t RKPositionEngineGetPositionIndexAfterTimeFromCursor(RKPositionEngine *engine, RKPositionWorker *me, const double time) {
+    int s = 0;
+    uint32_t j = me->cursor;
+    const uint32_t o = *engine->positionIndex;
+    const uint32_t depth = engine->radarDescription->positionBufferDepth;
+    // The cursor is valid if the position before it was not acquired after the pulse
+    if (engine->positionBuffer[RKPreviousModuloS(j, depth)].timeDouble <= time) {
+        while (engine->positionBuffer[j].timeDouble <= time && j != o && s++ < RKPositionEngineCursorSteps) {
+            j = RKNextModuloS(j, depth);
+        }
+        if (engine->positionBuffer[j].timeDouble > time && j != o) {
+            return j;
+        }
+    }
+    me->searchCount++;
+    return RKPositionEngineGetPositionIndexAfterTime(engine, time);
+}
+
+// Model of the positions that end at index, refitted only when the positions have changed
+static RKPositionModel *RKPositionEngineGetModelAtIndex(RKPositionEngine *engine, RKPositionWorker *me, const uint32_t index) {
+    if (me->model.index != index || me->model.time != engine->positionBuffer[index].timeDouble) {
+        RKPositionModelFit(&me->model, engine->positionBuffer, index, engine->radarDescription->positionBufferDepth);
+    }
+    return &me->model;
+}
+
+// Whether the pulse at time can be tagged by extrapolating the latest position at index
+static bool RKPositionEngineCanExtrapolate(RKPositionEngine *engine, RKPositionWorker *me, const uint32_t index, const double time) {
+    if (me->model.order == 0 || !(engine->positionBuffer[index].flag & RKPositionFlagReady)) {
+        return false;
+    }
+    return RKPositionModelCanExtrapolate(RKPositionEngineGetModelAtIndex(engine, me, index), time);
+}
+
+static void *pulseTaggerCore(void *_in) {
+    RKPositionWorker *me = (RKPositionWorker *)_in;
+    RKPositionEngine *engine = me->parent;
+
+    int k, s;
+    uint32_t i, j, n;
+    uint64_t e;
+
+    const int c = me->id;
+    const uint32_t pulseBufferDepth = engine->radarDescription->pulseBufferDepth;
+    const uint32_t positionBufferDepth = engine->radarDescription->positionBufferDepth;
+
+    RKPulse *pulse;
+    RKPosition *positionBefore;
+    RKPosition *positionAfter;
+    double alpha;
+
+    // Initiate my name
+    RKShortName name;
+    if (rkGlobalParameters.showColor) {
+        pthread_mutex_lock(&engine->mutex);
+        k = snprintf(name, RKShortNameLength, "%s", RKGetColor());
+        pthread_mutex_unlock(&engine->mutex);
+    } else {
+        k = 0;
+    }
+    k += sprintf(name + k, "C%d", c);
+    if (rkGlobalParameters.showColor) {
+        sprintf(name + k, RKNoColor);
+    }
+    snprintf(me->name, RKChildNameLength, "%s %s", engine->name, name);
+
+    // The first pulse of my first block and the identifier it has after the first check out
+    k = c * RKPositionEngineBlockSize;
+    e = k;
+
+    me->cursor = 0;
+    memcpy(&me->model, &engine->model, sizeof(RKPositionModel));
+    me->tic++;
+
+    while (engine->state & RKEngineStateWantActive) {
+        pulse = RKGetPulseFromBuffer(engine->pulseBuffer, k);
+
+        pthread_mutex_lock(&engine->mutex);
+
+        // Wait until the pulse has been checked out and processed by the ring filter. Otherwise, the time stamp is no good.
+        s = 0;
+        while (!(pulse->header.i == e && pulse->header.s & RKPulseStatusRingProcessed) && engine->state & RKEngineStateWantActive) {
+            if ((int64_t)(pulse->header.i - e) > 0) {
+                // Overrun, the slot has been reused since
+                e = pulse->header.i;
+                continue;
+            }
+            if (RKPositionEngineWait(engine, &engine->newInput) == ETIMEDOUT && ++s % 10 == 0 && engine->verbose > 1) {
+                RKLog("%s sleep 1/%.1f s   k = %d   pulseIndex = %d   header.s = 0x%02x\n",
+                      me->name, (float)s * RKPositionEngineWaitTimeout, k , *engine->pulseIndex, pulse->header.s);
+            }
+        }
+
+        // Wait until we have a position newer than pulse time, or one the model can extrapolate from.
+        s = 0;
+        i = RKPreviousModuloS(*engine->positionIndex, positionBufferDepth);
+        while ((!(engine->positionBuffer[i].flag & RKPositionFlagReady) || engine->positionBuffer[i].timeDouble <= pulse->header.timeDouble) &&
+               !RKPositionEngineCanExtrapolate(engine, me, i, pulse->header.timeDouble) &&
+               engine->state & RKEngineStateWantActive) {
+            if (RKPositionEngineWait(engine, &engine->newInput) == ETIMEDOUT && ++s % 10 == 0 && engine->verbose > 1) {
+                RKLog("%s sleep 2/%.1f s   k = %d   positionTime = %s %s %s = pulseTime\n",
+                      me->name, (float)s * RKPositionEngineWaitTimeout, k,
+                      RKFloatToCommaStyleString(engine->positionBuffer[i].timeDouble),
+                      engine->positionBuffer[i].timeDouble <= pulse->header.timeDouble ? "<=" : ">",
+                      RKFloatToCommaStyleString(pulse->header.timeDouble));
+            }
+            i = RKPreviousModuloS(*engine->positionIndex, positionBufferDepth);
+        }
+
+        pthread_mutex_unlock(&engine->mutex);
+
+        if (!(engine->state & RKEngineStateWantActive)) {
+            break;
+        }
+
+        // A newer position may have come in meanwhile
+        if (engine->positionBuffer[i].timeDouble <= pulse->header.timeDouble) {
+            n = RKPreviousModuloS(*engine->positionIndex, positionBufferDepth);
+            if (engine->positionBuffer[n].flag & RKPositionFlagReady && engine->positionBuffer[n].timeDouble > engine->positionBuffer[i].timeDouble) {
+                i = n;
+            }
+        }
+
+        // Lag of the worker
+        me->lag = fmodf(((float)*engine->pulseIndex + pulseBufferDepth - k) / pulseBufferDepth, 1.0f);
+
+        if (engine->positionBuffer[i].timeDouble <= pulse->header.timeDouble) {
+            // Extrapolate from the latest position, the one after does not exist yet
+            j = RKNextModuloS(i, positionBufferDepth);
+            positionBefore = &engine->positionBuffer[i];
+            positionBefore->flag |= RKPositionFlagUsed;
+            RKPositionModelEvaluate(RKPositionEngineGetModelAtIndex(engine, me, i), pulse->header.timeDouble,
+                                    &pulse->header.azimuthDegrees, &pulse->header.elevationDegrees);
+            me->extrapolationCount++;
+        } else {
+            // The position just after the pulse was acquired and the one just before
+            j = RKPositionEngineGetPositionIndexAfterTimeFromCursor(engine, me, pulse->header.timeDouble);
+            positionAfter = &engine->positionBuffer[j];
+            positionAfter->flag |= RKPositionFlagUsed;
+            positionBefore = &engine->positionBuffer[RKPreviousModuloS(j, positionBufferDepth)];
+            positionBefore->flag |= RKPositionFlagUsed;
+
+            // Linear interpololation : V_interp = V_before + alpha * (V_after - V_before)
+            alpha = positionAfter->timeDouble > positionBefore->timeDouble
+                  ? (pulse->header.timeDouble - positionBefore->timeDouble) / (positionAfter->timeDouble - positionBefore->timeDouble) : 0.0;
+            pulse->header.azimuthDegrees = RKInterpolatePositiveAngles(positionBefore->azimuthDegrees,
+                                                                       positionAfter->azimuthDegrees,
+                                                                       alpha);
+            pulse->header.elevationDegrees = RKInterpolateAngles(positionBefore->elevationDegrees,
+                                                                 positionAfter->elevationDegrees,
+                                                                 alpha);
+            me->cursor = j;
+        }
+        pulse->header.azimuthVelocityDegreesPerSecond = positionBefore->azimuthVelocityDegreesPerSecond;
+        pulse->header.elevationVelocityDegreesPerSecond = positionBefore->elevationVelocityDegreesPerSecond;
+        pulse->header.rawAzimuth = positionBefore->rawAzimuth;
+        pulse->header.rawElevation = positionBefore->rawElevation;
+
+        me->pid = k;
+        me->tic++;
+
+        // Hand the pulse to the engine for the markers
+        pthread_mutex_lock(&engine->mutex);
+        engine->pulsePositionIndices[k] = j;
+        engine->taggedPulseIds[k] = e;
+        pthread_cond_signal(&engine->newTag);
+        pthread_mutex_unlock(&engine->mutex);
+
+        // Move on to my next pulse
+        i = RKPositionEngineNextPulseIndexOfWorker(engine, k, c);
+        e += i > k ? i - k : i + pulseBufferDepth - k;
+        k = i;
+    }
+
+    if (engine->verbose > 1) {
+        RKLog("%s Stopped.   searchCount = %s   extrapolationCount = %s\n", me->name,
+              RKUIntegerToCommaStyleString(me->searchCount),
+              RKUIntegerToCommaStyleString(me->extrapolationCount));
+    }
+
+    return NULL;
+}
+
 static void *pulseTagger(void *_in) {
     RKPositionEngine *engine = (RKPositionEngine *)_in;
 
-    int i, j, k, s;
-    // uint16_t c0, c1;
+    int c, i, j, k, s;
+    uint32_t n;
+    uint64_t e;
     uint32_t gateCount;
     struct timeval t0, t1;
 
+    const uint32_t pulseBufferDepth = engine->radarDescription->pulseBufferDepth;
+    const uint32_t positionBufferDepth = engine->radarDescription->positionBufferDepth;
+
     RKPulse *pulse;
     RKPosition *positionBefore;
     RKPosition *positionAfter;
-    double timeBefore;
-    double timeAfter;
-    double timeLatest;
-    double alpha;
     RKMarker marker0;
     RKMarker marker1 = RKMarkerSweepEnd;
     bool hasSweepEnd;
@@ -116,9 +320,13 @@ static void *pulseTagger(void *_in) {
     engine->state |= RKEngineStateWantActive;
     engine->state ^= RKEngineStateActivating;
 
-    // If multiple workers are needed, here will be the time to launch them.
+    // Nothing has been tagged
+    for (k = 0; k < pulseBufferDepth; k++) {
+        engine->taggedPulseIds[k] = -(uint64_t)pulseBufferDepth + k;
+    }
 
-    RKLog("%s Started.   mem = %s B   pulseIndex = %d\n", engine->name, RKUIntegerToCommaStyleString(engine->memoryUsage), *engine->pulseIndex);
+    RKLog("%s Started.   mem = %s B   pulseIndex = %d   coreCount = %d\n",
+          engine->name, RKUIntegerToCommaStyleString(engine->memoryUsage), *engine->pulseIndex, engine->coreCount);
 
     // Increase the tic once to indicate the engine is ready
     engine->tic = 1;
@@ -128,114 +336,76 @@ static void *pulseTagger(void *_in) {
     // Wait until there is something ingested
     s = 0;
     engine->state |= RKEngineStateSleep0;
+    pthread_mutex_lock(&engine->mutex);
     while (*engine->positionIndex < 2 && engine->state & RKEngineStateWantActive) {
-        usleep(1000);
-        if (++s % 200 == 0 && engine->verbose > 1) {
-            RKLog("%s sleep 0/%.1f s\n", engine->name, (float)s * 0.001f);
+        if (RKPositionEngineWait(engine, &engine->newInput) == ETIMEDOUT && ++s % 20 == 0 && engine->verbose > 1) {
+            RKLog("%s sleep 0/%.1f s\n", engine->name, (float)s * RKPositionEngineWaitTimeout);
         }
     }
+    pthread_mutex_unlock(&engine->mutex);
     engine->state ^= RKEngineStateSleep0;
     engine->state |= RKEngineStateActive;
 
+    // Spin off N workers to tag the pulses
+    for (c = 0; c < engine->coreCount; c++) {
+        RKPositionWorker *worker = &engine->workers[c];
+        worker->id = c;
+        worker->parent = engine;
+        if (pthread_create(&worker->tid, NULL, pulseTaggerCore, worker) != 0) {
+            RKLog("%s Error. Failed to start a tagger core.\n", engine->name);
+            return (void *)RKResultFailedToStartPedestalWorker;
+        }
+    }
+
     pulse = RKGetPulseFromBuffer(engine->pulseBuffer, 0);
     gateCount = pulse->header.gateCount;
 
-    // Set the pulse to have position
+    // Visit the tagged pulses in order for the markers, which depend on the previous pulse
     j = 0;   // position index
     k = 0;   // pulse index;
+    e = 0;   // pulse identifier
     while (engine->state & RKEngineStateWantActive) {
-        // Get the latest pulse
         pulse = RKGetPulseFromBuffer(engine->pulseBuffer, k);
 
-        // Wait until a thread check out this pulse.
+        // Wait until a worker has tagged this pulse.
         engine->state |= RKEngineStateSleep1;
         s = 0;
-        while (k == *engine->pulseIndex && engine->state & RKEngineStateWantActive) {
-            usleep(1000);
-            if (++s % 100 == 0 && engine->verbose > 1) {
+        pthread_mutex_lock(&engine->mutex);
+        while (engine->taggedPulseIds[k] != e && engine->state & RKEngineStateWantActive) {
+            if ((int64_t)(pulse->header.i - e) > 0) {
+                e = pulse->header.i;
+                continue;
+            }
+            if (RKPositionEngineWait(engine, &engine->newTag) == ETIMEDOUT && ++s % 10 == 0 && engine->verbose > 1) {
                 RKLog("%s sleep 1/%.1f s   k = %d   pulseIndex = %d   header.s = 0x%02x\n",
-                      engine->name, (float)s * 0.001f, k , *engine->pulseIndex, pulse->header.s);
+                      engine->name, (float)s * RKPositionEngineWaitTimeout, k , *engine->pulseIndex, pulse->header.s);
             }
         }
+        n = engine->pulsePositionIndices[k];
+        pthread_mutex_unlock(&engine->mutex);
         engine->state ^= RKEngineStateSleep1;
-        engine->state ^= RKEngineStateSleep2;
-        // Wait until the pulse has data & processed. Otherwise, the time stamp is no good and there is a horse raise with the pulse compression engine (setting flag).
-        s = 0;
-        while (!(pulse->header.s & RKPulseStatusRingProcessed) && engine->state & RKEngineStateWantActive) {
-            usleep(1000);
-            if (++s % 100 == 0 && engine->verbose > 1) {
-                RKLog("%s sleep 2/%.1f s   k = %d   pulseIndex = %d   header.s = 0x%02x\n",
-                      engine->name, (float)s * 0.001f, k , *engine->pulseIndex, pulse->header.s);
-            }
-        }
-        engine->state ^= RKEngineStateSleep2;
-        engine->state |= RKEngineStateSleep3;
-        // Wait until we have a position newer than pulse time.
-        s = 0;
-        i = RKPreviousModuloS(*engine->positionIndex, engine->radarDescription->positionBufferDepth);
-        while ((!(engine->positionBuffer[i].flag & RKPositionFlagReady) || engine->positionBuffer[i].timeDouble <= pulse->header.timeDouble) && engine->state & RKEngineStateWantActive) {
-            usleep(1000);
-            if (++s % 100 == 0 && engine->verbose > 1) {
-                RKLog("%s sleep 3/%.1f s   k = %d   positionTime = %s %s %s = pulseTime\n",
-                      engine->name, (float)s * 0.001f, k,
-                      RKFloatToCommaStyleString(engine->positionBuffer[i].timeDouble),
-                      engine->positionBuffer[i].timeDouble <= pulse->header.timeDouble ? "<=" : ">",
-                      RKFloatToCommaStyleString(pulse->header.timeDouble));
-            }
-            i = RKPreviousModuloS(*engine->positionIndex, engine->radarDescription->positionBufferDepth);
-        }
-        engine->state ^= RKEngineStateSleep3;
-
-        // Record down the latest time
-        timeLatest = engine->positionBuffer[i].timeDouble;
 
         if (!(engine->state & RKEngineStateWantActive)) {
             break;
         }
 
         // Lag of the engine
-        engine->lag = fmodf(((float)*engine->pulseIndex + engine->radarDescription->pulseBufferDepth - k) / engine->radarDescription->pulseBufferDepth, 1.0f);
+        engine->lag = fmodf(((float)*engine->pulseIndex + pulseBufferDepth - k) / pulseBufferDepth, 1.0f);
 
-        // Search until the time just after the pulse was acquired.
+        // Positions passed since the previous pulse
         i = 0;
         hasSweepEnd = false;
-        while (engine->positionBuffer[j].timeDouble <= pulse->header.timeDouble && i < engine->radarDescription->pulseBufferDepth && engine->state & RKEngineStateWantActive) {
+        while (j != n) {
             hasSweepEnd |= engine->positionBuffer[j].flag & (RKPositionFlagAzimuthComplete | RKPositionFlagElevationComplete);
-            j = RKNextModuloS(j, engine->radarDescription->positionBufferDepth);
+            j = RKNextModuloS(j, positionBufferDepth);
             i++;
         }
-        if (i == engine->radarDescription->pulseBufferDepth) {
-            if (engine->verbose > 2) {
-                RKLog("Could not find an appropriate position.  %.2f %s %.2f",
-                      pulse->header.timeDouble,
-                      pulse->header.timeDouble < timeLatest ? "<" : ">=",
-                      timeLatest);
-            }
-            // Update pulseIndex for the next watch
-            RKLog("%s Warning. Skipping forward ...\n", engine->name);
-            k = RKPreviousModuloS(*engine->pulseIndex, engine->radarDescription->pulseBufferDepth);
-            continue;
+        positionAfter = &engine->positionBuffer[j];
+        positionBefore = &engine->positionBuffer[RKPreviousModuloS(j, positionBufferDepth)];
+        // An extrapolated pulse has no position after it yet
+        if (!(positionAfter->flag & RKPositionFlagReady) || positionAfter->timeDouble <= pulse->header.timeDouble) {
+            positionAfter = positionBefore;
         }
-        positionAfter  = &engine->positionBuffer[j];   timeAfter  = positionAfter->timeDouble;
-        positionAfter->flag |= RKPositionFlagUsed;
-
-        // Roll back one slot, which should be the position just before the pulse was acquired.
-        s = RKPreviousModuloS(j, engine->radarDescription->positionBufferDepth);
-        positionBefore = &engine->positionBuffer[s];   timeBefore = positionBefore->timeDouble;
-        positionBefore->flag |= RKPositionFlagUsed;
-
-        // Linear interpololation : V_interp = V_before + alpha * (V_after - V_before)
-        alpha = (pulse->header.timeDouble - timeBefore) / (timeAfter - timeBefore);
-        pulse->header.azimuthDegrees = RKInterpolatePositiveAngles(positionBefore->azimuthDegrees,
-                                                                   positionAfter->azimuthDegrees,
-                                                                   alpha);
-        pulse->header.elevationDegrees = RKInterpolateAngles(positionBefore->elevationDegrees,
-                                                             positionAfter->elevationDegrees,
-                                                             alpha);
-        pulse->header.azimuthVelocityDegreesPerSecond = positionBefore->azimuthVelocityDegreesPerSecond;
-        pulse->header.elevationVelocityDegreesPerSecond = positionBefore->elevationVelocityDegreesPerSecond;
-        pulse->header.rawAzimuth = positionBefore->rawAzimuth;
-        pulse->header.rawElevation = positionBefore->rawElevation;
 
         // Consolidate markers from the positions
         marker0 = RKMarkerNull;
@@ -317,11 +487,11 @@ static void *pulseTagger(void *_in) {
             RKLog("%s pulse[%04lu]  T [ %.4f %s %.4f %s %.4f ]   A [ %6.2f < %6.2f < %6.2f ]   E [ %.2f < %.2f < %.2f ] %s %08x < \033[3%dm%08x\033[0m < %08x (%d / %d)\n",
                   engine->name,
                   (unsigned long)pulse->header.i,
-                  timeBefore,
-                  timeBefore <= pulse->header.timeDouble ? "<" : ">=",
+                  positionBefore->timeDouble,
+                  positionBefore->timeDouble <= pulse->header.timeDouble ? "<" : ">=",
                   pulse->header.timeDouble,
-                  pulse->header.timeDouble <= timeAfter ? "<" : ">=",
-                  timeAfter,
+                  pulse->header.timeDouble <= positionAfter->timeDouble ? "<" : ">=",
+                  positionAfter->timeDouble,
                   positionBefore->azimuthDegrees,
                   pulse->header.azimuthDegrees,
                   positionAfter->azimuthDegrees,
@@ -343,8 +513,16 @@ static void *pulseTagger(void *_in) {
         engine->tic++;
 
         // Update pulseIndex for the next watch
-        k = RKNextModuloS(k, engine->radarDescription->pulseBufferDepth);
+        k = RKNextModuloS(k, pulseBufferDepth);
+        e++;
     }
+
+    // Wait for workers to return
+    RKPositionEngineNotify(engine);
+    for (c = 0; c < engine->coreCount; c++) {
+        pthread_join(engine->workers[c].tid, NULL);
+    }
+
     engine->state ^= RKEngineStateActive;
     return NULL;
 }
@@ -353,16 +531,29 @@ static void *pulseTagger(void *_in) {
 
 RKPositionEngine *RKPositionEngineInit(void) {
     RKPositionEngine *engine = (RKPositionEngine *)malloc(sizeof(RKPositionEngine));
+    if (engine == NULL) {
+        RKLog("Error. Unable to allocate a position engine.\n");
+        return NULL;
+    }
     memset(engine, 0, sizeof(RKPositionEngine));
     sprintf(engine->name, "%s<PulsePositioner>%s",
         rkGlobalParameters.showColor ? RKGetBackgroundColorOfIndex(RKEngineColorPositionEngine) : "",
         rkGlobalParameters.showColor ? RKNoColor : "");
     engine->memoryUsage = sizeof(RKPositionEngine);
     engine->state = RKEngineStateAllocated;
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->newInput, NULL);
+    pthread_cond_init(&engine->newTag, NULL);
     return engine;
 }
 
 void RKPositionEngineFree(RKPositionEngine *engine) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKPositionEngineStop(engine);
+    }
+    pthread_cond_destroy(&engine->newTag);
+    pthread_cond_destroy(&engine->newInput);
+    pthread_mutex_destroy(&engine->mutex);
     free(engine);
 }
 
@@ -394,6 +585,22 @@ void RKPositionEngineSetEssentials(RKPositionEngine *engine, const RKRadarDesc *
     engine->state |= RKEngineStateProperlyWired;
 }
 
+void RKPositionEngineSetPositionModel(RKPositionEngine *engine, const uint8_t order, const double maximumExtrapolation) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKLog("%s Error. Position model cannot change when the engine is active.\n", engine->name);
+        return;
+    }
+    RKPositionModelSetOrder(&engine->model, order, maximumExtrapolation);
+}
+
+void RKPositionEngineSetCoreCount(RKPositionEngine *engine, const uint8_t count) {
+    if (engine->state & RKEngineStateWantActive) {
+        RKLog("%s Error. Core count cannot change when the engine is active.\n", engine->name);
+        return;
+    }
+    engine->coreCount = count;
+}
+
 #pragma mark - Interactions
 
 int RKPositionEngineStart(RKPositionEngine *engine) {
@@ -401,6 +608,34 @@ int RKPositionEngineStart(RKPositionEngine *engine) {
         RKLog("%s Error. Not properly wired.\n", engine->name);
         return RKResultEngineNotWired;
     }
+    if (engine->coreCount == 0) {
+        engine->coreCount = 2;
+    }
+    // Every worker needs at least a block of pulses
+    if (engine->coreCount * RKPositionEngineBlockSize > engine->radarDescription->pulseBufferDepth) {
+        engine->coreCount = MAX(1, engine->radarDescription->pulseBufferDepth / RKPositionEngineBlockSize);
+    }
+    if (engine->workers != NULL) {
+        RKLog("%s Error. workers should be NULL here.\n", engine->name);
+    }
+    size_t bytes = engine->coreCount * sizeof(RKPositionWorker);
+    engine->workers = (RKPositionWorker *)malloc(bytes);
+    engine->taggedPulseIds = (uint64_t *)malloc(engine->radarDescription->pulseBufferDepth * sizeof(uint64_t));
+    engine->pulsePositionIndices = (uint32_t *)malloc(engine->radarDescription->pulseBufferDepth * sizeof(uint32_t));
+    if (engine->workers == NULL || engine->taggedPulseIds == NULL || engine->pulsePositionIndices == NULL) {
+        RKLog("%s Error. Unable to allocate resources for the workers.\n", engine->name);
+        free(engine->workers);
+        free(engine->taggedPulseIds);
+        free(engine->pulsePositionIndices);
+        engine->workers = NULL;
+        engine->taggedPulseIds = NULL;
+        engine->pulsePositionIndices = NULL;
+        return RKResultFailedToCreateUnitWorker;
+    }
+    memset(engine->workers, 0, bytes);
+    memset(engine->pulsePositionIndices, 0, engine->radarDescription->pulseBufferDepth * sizeof(uint32_t));
+    bytes += engine->radarDescription->pulseBufferDepth * (sizeof(uint64_t) + sizeof(uint32_t));
+    engine->memoryUsage += bytes;
     RKLog("%s Starting ...\n", engine->name);
     engine->tic = 0;
     engine->state |= RKEngineStateActivating;
@@ -431,9 +666,17 @@ int RKPositionEngineStop(RKPositionEngine *engine) {
     RKLog("%s Stopping ...\n", engine->name);
     engine->state |= RKEngineStateDeactivating;
     engine->state ^= RKEngineStateWantActive;
+    RKPositionEngineNotify(engine);
     if (engine->threadId) {
         pthread_join(engine->threadId, NULL);
         engine->threadId = (pthread_t)0;
+        free(engine->workers);
+        free(engine->taggedPulseIds);
+        free(engine->pulsePositionIndices);
+        engine->workers = NULL;
+        engine->taggedPulseIds = NULL;
+        engine->pulsePositionIndices = NULL;
+        engine->memoryUsage = sizeof(RKPositionEngine);
     } else {
         RKLog("%s Invalid thread ID.\n", engine->name);
     }
@@ -445,6 +688,32 @@ int RKPositionEngineStop(RKPositionEngine *engine) {
     return RKResultSuccess;
 }
 
+// Called by the producers when a position is ready or when pulses have been processed by the ring filter
+void RKPositionEngineNotify(RKPositionEngine *engine) {
+    pthread_mutex_lock(&engine->mutex);
+    pthread_cond_broadcast(&engine->newInput);
+    pthread_cond_broadcast(&engine->newTag);
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+// Binary search for the index of the first position acquired after time. Positions are time ordered from the
+// oldest, the one being filled at positionIndex, so the search covers the other positionBufferDepth - 1 slots.
+// A time that precedes all of them gets the oldest pair, which is extrapolated.
+uint32_t RKPositionEngineGetPositionIndexAfterTime(RKPositionEngine *engine, const double time) {
+    const uint32_t o = *engine->positionIndex;
+    const uint32_t depth = engine->radarDescription->positionBufferDepth;
+    uint32_t a = 2, b = depth - 1, m;
+    while (a < b) {
+        m = a + (b - a) / 2;
+        if (engine->positionBuffer[(o + m) % depth].timeDouble > time) {
+            b = m;
+        } else {
+            a = m + 1;
+        }
+    }
+    return (o + a) % depth;
+}
+
 char *RKPositionEngineStatusString(RKPositionEngine *engine) {
     return engine->statusBuffer[RKPreviousModuloS(engine->statusBufferIndex, RKBufferSSlotCount)];
 }
@@ -0,0 +1,156 @@
+//
+//  RKPositionModel.c
+//  RadarKit
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <RadarKit/RKPositionModel.h>
+#include <RadarKit/RKDSP.h>
+
+#pragma mark - Helper Functions
+
+// Solve the normal equations A c = b of size n in place with Gaussian elimination and partial pivoting
+static bool RKPositionModelSolve(double A[][RKPositionModelMaximumOrder + 1], double *b, double *c, const int n) {
+    int i, j, k, p;
+    double f;
+    for (k = 0; k < n; k++) {
+        p = k;
+        for (i = k + 1; i < n; i++) {
+            if (fabs(A[i][k]) > fabs(A[p][k])) {
+                p = i;
+            }
+        }
+        if (fabs(A[p][k]) < 1.0e-12) {
+            return false;
+        }
+        if (p != k) {
+            for (j = 0; j < n; j++) {
+                f = A[k][j]; A[k][j] = A[p][j]; A[p][j] = f;
+            }
+            f = b[k]; b[k] = b[p]; b[p] = f;
+        }
+        for (i = k + 1; i < n; i++) {
+            f = A[i][k] / A[k][k];
+            for (j = k; j < n; j++) {
+                A[i][j] -= f * A[k][j];
+            }
+            b[i] -= f * b[k];
+        }
+    }
+    for (k = n - 1; k >= 0; k--) {
+        f = b[k];
+        for (j = k + 1; j < n; j++) {
+            f -= A[k][j] * c[j];
+        }
+        c[k] = f / A[k][k];
+    }
+    return true;
+}
+
+static double RKPositionModelPolynomial(const double *c, const int order, const double x) {
+    double y = 0.0;
+    for (int k = order; k >= 0; k--) {
+        y = y * x + c[k];
+    }
+    return y;
+}
+
+#pragma mark - Methods
+
+void RKPositionModelSetOrder(RKPositionModel *model, const uint8_t order, const double maximumExtrapolation) {
+    memset(model, 0, sizeof(RKPositionModel));
+    model->order = MIN(order, RKPositionModelMaximumOrder);
+    model->count = MIN(2 * model->order + 2, RKPositionModelMaximumCount);
+    model->maximumExtrapolation = maximumExtrapolation;
+}
+
+// Fit the positions that end at index, going back in time while they are ready and time ordered
+bool RKPositionModelFit(RKPositionModel *model, const RKPosition *positions, const uint32_t index, const uint32_t depth) {
+    int i, j, k, n;
+    double x[RKPositionModelMaximumCount];
+    double a[RKPositionModelMaximumCount];
+    double e[RKPositionModelMaximumCount];
+    double A[RKPositionModelMaximumOrder + 1][RKPositionModelMaximumOrder + 1];
+    double B[RKPositionModelMaximumOrder + 1][RKPositionModelMaximumOrder + 1];
+    double ba[RKPositionModelMaximumOrder + 1];
+    double be[RKPositionModelMaximumOrder + 1];
+    double p;
+
+    model->valid = false;
+    model->index = index;
+    if (model->order == 0) {
+        return false;
+    }
+
+    const RKPosition *latest = &positions[index];
+    model->time = latest->timeDouble;
+    model->azimuthOrigin = latest->azimuthDegrees;
+    model->elevationOrigin = latest->elevationDegrees;
+
+    // Collect the positions, relative to the latest one
+    uint32_t m = index;
+    double t = model->time;
+    for (n = 0; n < model->count; n++) {
+        const RKPosition *position = &positions[m];
+        if (!(position->flag & RKPositionFlagReady) || (n > 0 && position->timeDouble >= t)) {
+            break;
+        }
+        t = position->timeDouble;
+        x[n] = t - model->time;
+        a[n] = RKGetSignedMinorSectorInDegrees(position->azimuthDegrees, model->azimuthOrigin);
+        e[n] = RKGetSignedMinorSectorInDegrees(position->elevationDegrees, model->elevationOrigin);
+        m = RKPreviousModuloS(m, depth);
+    }
+    if (n < 2) {
+        return false;
+    }
+
+    // Normalize time by the span for better conditioning
+    model->span = -x[n - 1];
+    for (k = 0; k < n; k++) {
+        x[k] /= model->span;
+    }
+
+    // Normal equations of the least-squares fit, the order is reduced if there are too few positions
+    const int order = MIN(model->order, n - 1);
+    memset(A, 0, sizeof(A));
+    memset(ba, 0, sizeof(ba));
+    memset(be, 0, sizeof(be));
+    for (k = 0; k < n; k++) {
+        for (i = 0; i <= order; i++) {
+            p = pow(x[k], i);
+            ba[i] += p * a[k];
+            be[i] += p * e[k];
+            for (j = 0; j <= order; j++) {
+                A[i][j] += p * pow(x[k], j);
+            }
+        }
+    }
+    memcpy(B, A, sizeof(A));
+    memset(model->azimuth, 0, sizeof(model->azimuth));
+    memset(model->elevation, 0, sizeof(model->elevation));
+    if (!RKPositionModelSolve(A, ba, model->azimuth, order + 1) ||
+        !RKPositionModelSolve(B, be, model->elevation, order + 1)) {
+        return false;
+    }
+    model->valid = true;
+    return true;
+}
+
+bool RKPositionModelCanExtrapolate(const RKPositionModel *model, const double time) {
+    return model->valid && time >= model->time && time - model->time <= model->maximumExtrapolation;
+}
+
+void RKPositionModelEvaluate(const RKPositionModel *model, const double time, float *azimuth, float *elevation) {
+    const double x = (time - model->time) / model->span;
+    float value = model->azimuthOrigin + (float)RKPositionModelPolynomial(model->azimuth, RKPositionModelMaximumOrder, x);
+    if (value >= 360.0f) {
+        value -= 360.0f;
+    } else if (value < 0.0f) {
+        value += 360.0f;
+    }
+    *azimuth = value;
+    *elevation = model->elevationOrigin + (float)RKPositionModelPolynomial(model->elevation, RKPositionModelMaximumOrder, x);
+}
@@ -7,9 +7,124 @@
 //
 
 #include <RadarKit/RKPreference.h>
+#include <ctype.h>
+#include <stddef.h>
 
 #pragma mark - Internal Functions
 
+typedef struct rk_preference_keyword {
+    uint32_t    hash;
+    uint32_t    first;                                                         // First object of the keyword
+    uint32_t    last;                                                          // Last object of the keyword
+    uint32_t    count;                                                         // Number of objects, 0 if vacant
+} RKPreferenceKeyword;
+
+#define RKPreferenceNone   UINT32_MAX
+
+// FNV-1a of the lowercase keyword
+static uint32_t keywordHash(const char *keyword) {
+    uint32_t hash = 2166136261u;
+    while (*keyword != '\0') {
+        hash ^= (uint8_t)tolower(*keyword++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static RKPreferenceKeyword *findKeywordSlot(RKPreference *preference, const char *keyword, const bool vacant) {
+    RKPreferenceKeyword *keywords = (RKPreferenceKeyword *)preference->keywords;
+    if (keywords == NULL) {
+        return NULL;
+    }
+    const uint32_t hash = keywordHash(keyword);
+    uint32_t k = hash & preference->keywordMask;
+    while (keywords[k].count) {
+        if (keywords[k].hash == hash && !strcasecmp(preference->objects[keywords[k].first].keyword, keyword)) {
+            return &keywords[k];
+        }
+        k = (k + 1) & preference->keywordMask;
+    }
+    if (vacant) {
+        keywords[k].hash = hash;
+        return &keywords[k];
+    }
+    return NULL;
+}
+
+// Index all objects by keyword, at most half of the slots are used
+static int buildKeywordIndex(RKPreference *preference) {
+    uint32_t k, size = 64;
+    while (size < 2 * preference->count) {
+        size <<= 1;
+    }
+    free(preference->keywords);
+    free(preference->next);
+    preference->keywords = calloc(size, sizeof(RKPreferenceKeyword));
+    preference->next = (uint32_t *)malloc(MAX(1, preference->count) * sizeof(uint32_t));
+    if (preference->keywords == NULL || preference->next == NULL) {
+        RKLog("Error. Unable to allocate the preference index.\n");
+        free(preference->keywords);
+        free(preference->next);
+        preference->keywords = NULL;
+        preference->next = NULL;
+        return RKResultFailedToAllocateScratchSpace;
+    }
+    preference->keywordMask = size - 1;
+    for (k = 0; k < preference->count; k++) {
+        RKPreferenceKeyword *keyword = findKeywordSlot(preference, preference->objects[k].keyword, true);
+        if (keyword->count == 0) {
+            keyword->first = k;
+        } else {
+            preference->next[keyword->last] = k;
+        }
+        keyword->last = k;
+        keyword->count++;
+        preference->next[k] = RKPreferenceNone;
+    }
+    return RKResultSuccess;
+}
+
+// Typed values of an object, parsed once
+static void parseObject(RKPreferenceObject *object) {
+    int m;
+    if (object->isParsed) {
+        return;
+    }
+    if ((object->valueString[0] >= '0' && object->valueString[0] <= '9') ||
+        (object->valueString[0] == '.' && object->valueString[1] >= '0' && object->valueString[1] <= '9') ||
+        (object->valueString[0] == '-' && object->valueString[1] >= '0' && object->valueString[1] <= '9') ||
+        (object->valueString[0] == '+' && object->valueString[1] >= '0' && object->valueString[1] <= '9')) {
+        object->isNumeric = true;
+        object->numericCount = sscanf(object->valueString, "%lf %lf %lf %lf",
+                                      &object->doubleValues[0],
+                                      &object->doubleValues[1],
+                                      &object->doubleValues[2],
+                                      &object->doubleValues[3]);
+    } else if (!strncasecmp(object->valueString, "false", 5) ||
+               !strncasecmp(object->valueString, "true", 4) ||
+               !strncasecmp(object->valueString, "yes", 3) ||
+               !strncasecmp(object->valueString, "no", 2)) {
+        sscanf(object->valueString, "%127s %127s %127s %127s",
+               object->subStrings[0],
+               object->subStrings[1],
+               object->subStrings[2],
+               object->subStrings[3]);
+        for (m = 0; m < 4; m++) {
+            object->boolValues[m] = (!strncasecmp(object->subStrings[m], "true", 4) || !strncasecmp(object->subStrings[m], "yes", 4));
+        }
+    }
+    object->isParsed = true;
+    #if defined(DEBUG)
+    printf("Keyword:'%s'   parameters:'%s' (%d)  %d  (%d) %.1f %.1f %.1f %.1f\n",
+           object->keyword, object->valueString, (int)strlen(object->valueString),
+           object->isNumeric, object->numericCount,
+           object->doubleValues[0],
+           object->doubleValues[1],
+           object->doubleValues[2],
+           object->doubleValues[3]);
+    #endif
+}
+
 #pragma mark - Implementation
 
 #pragma mark - Life Cycle
@@ -32,6 +147,9 @@ RKPreference *RKPreferenceInit(void) {
 }
 
 void RKPreferenceFree(RKPreference *object) {
+    free(object->objects);
+    free(object->keywords);
+    free(object->next);
     free(object);
 }
 
@@ -45,17 +163,16 @@ int RKPreferenceUpdate(RKPreference *preference) {
         RKLog("Error. Unable to open preference file %s.\n", preference->filename);
         return RKResultPreferenceFileNotFound;
     }
-    memset(preference->objects, 0, RKPreferenceObjectCount * sizeof(RKPreferenceObject));
     preference->count = 0;
+    preference->previousKeyword[0] = '\0';
 
     char *line = (char *)malloc(RKMaximumStringLength);
 
     char *c, *s, *e;
+    size_t n;
 
     int i = 0;
-    int k = 0;
-	int m = 0;
-    while (k < RKPreferenceObjectCount && i < 1000) {
+    while (true) {
         c = fgets(line, RKMaximumStringLength, fid);
         if (c == NULL) {
             break;
@@ -69,12 +186,25 @@ int RKPreferenceUpdate(RKPreference *preference) {
             #if defined(DEBUG)
             printf("Process line %d %s\n", i, line);
             #endif
+            // Grow the objects as needed
+            if (preference->count == preference->capacity) {
+                const uint32_t capacity = MAX(RKPreferenceObjectCount, 2 * preference->capacity);
+                RKPreferenceObject *objects = (RKPreferenceObject *)realloc(preference->objects, capacity * sizeof(RKPreferenceObject));
+                if (objects == NULL) {
+                    RKLog("Warning. Unable to digest all preference values.\n");
+                    break;
+                }
+                preference->objects = objects;
+                preference->capacity = capacity;
+            }
             // Find the first white space, divide the line into keyword and valueString
             s = line;
             while (*s != '\0' && (*s != ' ' && *s != '\t')) {
                 s++;
             }
-            *s++ = '\0';
+            if (*s != '\0') {
+                *s++ = '\0';
+            }
             // Now, find the first character
             while (*s != '\0' && (*s == ' ' || *s == '\t')) {
                 s++;
@@ -89,84 +219,54 @@ int RKPreferenceUpdate(RKPreference *preference) {
                     *e = '\0';
                 }
             }
-            strncpy(preference->objects[k].keyword, line, RKNameLength);
-            strncpy(preference->objects[k].valueString, s, RKMaximumStringLength);
-            RKStripTail(preference->objects[k].valueString);
-            preference->objects[k].isValid = true;
-            if ((preference->objects[k].valueString[0] >= '0' && preference->objects[k].valueString[0] <= '9') ||
-                (preference->objects[k].valueString[0] == '.' && preference->objects[k].valueString[1] >= '0' && preference->objects[k].valueString[1] <= '9') ||
-                (preference->objects[k].valueString[0] == '-' && preference->objects[k].valueString[1] >= '0' && preference->objects[k].valueString[1] <= '9') ||
-                (preference->objects[k].valueString[0] == '+' && preference->objects[k].valueString[1] >= '0' && preference->objects[k].valueString[1] <= '9')) {
-                preference->objects[k].isNumeric = true;
-                preference->objects[k].numericCount = sscanf(preference->objects[k].valueString, "%lf %lf %lf %lf",
-                                                             &preference->objects[k].doubleValues[0],
-                                                             &preference->objects[k].doubleValues[1],
-                                                             &preference->objects[k].doubleValues[2],
-                                                             &preference->objects[k].doubleValues[3]);
-			} else if (!strncasecmp(preference->objects[k].valueString, "false", 5) ||
-					   !strncasecmp(preference->objects[k].valueString, "true", 4) ||
-					   !strncasecmp(preference->objects[k].valueString, "yes", 3) ||
-					   !strncasecmp(preference->objects[k].valueString, "no", 2)) {
-				sscanf(preference->objects[k].valueString, "%s %s %s %s",
-					   preference->objects[k].subStrings[0],
-					   preference->objects[k].subStrings[1],
-					   preference->objects[k].subStrings[2],
-					   preference->objects[k].subStrings[3]);
-				for (m = 0; m < 4; m++) {
-					preference->objects[k].boolValues[m] = (!strncasecmp(preference->objects[k].subStrings[m], "true", 4) || !strncasecmp(preference->objects[k].subStrings[m], "yes", 4));
-				}
-			}
+            // Only the fixed part, the value string is copied up to its length
+            RKPreferenceObject *object = &preference->objects[preference->count];
+            memset(object, 0, offsetof(RKPreferenceObject, valueString));
+            memset(&object->isNumeric, 0, sizeof(RKPreferenceObject) - offsetof(RKPreferenceObject, isNumeric));
+            n = MIN(strlen(line), RKNameLength - 1);
+            memcpy(object->keyword, line, n);
+            n = MIN(strlen(s), RKMaximumStringLength - 1);
+            memcpy(object->valueString, s, n);
+            object->valueString[n] = '\0';
+            RKStripTail(object->valueString);
+            object->isValid = true;
             preference->count++;
-            #if defined(DEBUG)
-            printf("Keyword:'%s'   parameters:'%s' (%d)  %d  (%d) %.1f %.1f %.1f %.1f\n",
-                   preference->objects[k].keyword, preference->objects[k].valueString, (int)strlen(preference->objects[k].valueString),
-                   preference->objects[k].isNumeric, preference->objects[k].numericCount,
-                   preference->objects[k].doubleValues[0],
-                   preference->objects[k].doubleValues[1],
-                   preference->objects[k].doubleValues[2],
-				   preference->objects[k].doubleValues[3]);
-            #endif
-            k++;
         }
         i++;
     }
 
-    if (k == RKPreferenceObjectCount) {
-        RKLog("Warning. Unable to digest all preference values.\n");
-    }
-
     free(line);
+    fclose(fid);
 
-    return RKResultSuccess;
+    preference->memoryUsage = sizeof(RKPreference) + preference->capacity * (sizeof(RKPreferenceObject) + sizeof(uint32_t));
+
+    return buildKeywordIndex(preference);
 }
 
 RKPreferenceObject *RKPreferenceFindKeyword(RKPreference *preference, const char *keyword) {
-    int k = 0;
+    uint32_t k;
+    if (preference->count == 0) {
+        return NULL;
+    }
     if (!strcasecmp(keyword, preference->previousKeyword)) {
-        k = preference->previousIndex + 1;
-        if (k >= preference->count) {
-            return NULL;
-        }
+        // The next one of the same keyword
+        k = preference->next[preference->previousIndex];
+    } else {
+        RKPreferenceKeyword *slot = findKeywordSlot(preference, keyword, false);
+        k = slot ? slot->first : RKPreferenceNone;
     }
-    while (k < RKPreferenceObjectCount && preference->objects[k].isValid == true) {
-        if (!strcasecmp(preference->objects[k].keyword, keyword)) {
-            strcpy(preference->previousKeyword, keyword);
-            preference->previousIndex = k;
-            return &preference->objects[k];
-        }
-        k++;
+    if (k == RKPreferenceNone) {
+        return NULL;
     }
-    return NULL;
+    snprintf(preference->previousKeyword, RKNameLength, "%s", keyword);
+    preference->previousIndex = k;
+    parseObject(&preference->objects[k]);
+    return &preference->objects[k];
 }
 
 int RKPreferenceGetKeywordCount(RKPreference *preference, const char *keyword) {
-    int k = 0;
-    while (k < RKPreferenceObjectCount && preference->objects[k].isValid == true) {
-        if (!strcasecmp(preference->objects[k].keyword, keyword)) {
-            k++;
-        }
-    }
-    return k;
+    RKPreferenceKeyword *slot = findKeywordSlot(preference, keyword, false);
+    return slot ? (int)slot->count : 0;
 }
 
 int RKPreferenceGetValueOfKeyword(RKPreference *preference, const int verb, const char *keyword, void *target, const int type, const int count) {
@@ -12,6 +12,9 @@ static size_t _rk_malloc_product(RKProduct *product, const uint32_t rayCount, co
     uint32_t arraySize = gateCount * rayCount * sizeof(RKFloat);
     uint32_t halfSize = rayCount * sizeof(RKFloat);
     uint32_t fullSize = rayCount * sizeof(double);
+    uint32_t viewSize = rayCount * sizeof(RKFloat *);
+    uint32_t viewRaySize = rayCount * sizeof(RKRay *);
+    uint32_t viewIdentifierSize = rayCount * sizeof(RKIdentifier);
     product->header.rayCount = rayCount;
     product->header.gateCount = gateCount;
     product->capacity = rayCount * gateCount;
@@ -22,6 +25,9 @@ static size_t _rk_malloc_product(RKProduct *product, const uint32_t rayCount, co
     product->startTime = (double *)RKMalloc(fullSize);
     product->endTime = (double *)RKMalloc(fullSize);
     product->data = (RKFloat *)RKMalloc(arraySize);
+    product->views = (RKFloat **)malloc(viewSize);
+    product->viewRays = (RKRay **)malloc(viewRaySize);
+    product->viewIdentifiers = (RKIdentifier *)malloc(viewIdentifierSize);
     memset(product->startAzimuth, 0, halfSize);
     memset(product->endAzimuth, 0, halfSize);
     memset(product->startElevation, 0, halfSize);
@@ -29,7 +35,10 @@ static size_t _rk_malloc_product(RKProduct *product, const uint32_t rayCount, co
     memset(product->startTime, 0, fullSize);
     memset(product->endTime, 0, fullSize);
     memset(product->data, 0, arraySize);
-    product->totalBufferSize = (uint32_t)sizeof(RKProduct) + 4 * halfSize + 2 * fullSize + arraySize;
+    memset(product->views, 0, viewSize);
+    memset(product->viewRays, 0, viewRaySize);
+    memset(product->viewIdentifiers, 0, viewIdentifierSize);
+    product->totalBufferSize = (uint32_t)sizeof(RKProduct) + 4 * halfSize + 2 * fullSize + viewSize + viewRaySize + viewIdentifierSize + arraySize;
     return product->totalBufferSize;
 }
 
@@ -96,16 +105,16 @@ void RKProductBufferFree(RKProduct *buffer, const uint32_t depth) {
         free(product->startTime);
         free(product->endTime);
         free(product->data);
+        free(product->views);
+        free(product->viewRays);
+        free(product->viewIdentifiers);
     }
     free(buffer);
 }
 
-int RKProductInitFromSweep(RKProduct *product, const RKSweep *sweep) {
+static void RKProductInitHeaderFromSweep(RKProduct *product, const RKSweep *sweep) {
     int k;
 
-    // Required capacity, round to the next 90 ray count, next 100 gate count
-    const uint32_t requiredCapacity = (uint32_t)ceilf(sweep->header.rayCount / 90.0f) * 90 * (uint32_t)ceilf(sweep->header.gateCount / 100.0f) * 100;
-
     // Sweep header
     memcpy(product->header.radarName, sweep->header.desc.name, sizeof(RKName));
     product->header.latitude = sweep->header.desc.latitude;
@@ -173,6 +182,25 @@ int RKProductInitFromSweep(RKProduct *product, const RKSweep *sweep) {
     }
     memcpy(product->header.vcpDefinition, sweep->header.config.vcpDefinition, sizeof(RKMaximumCommandLength));
 
+    for (k = 0; k < product->header.rayCount; k++) {
+        product->startAzimuth[k]   = sweep->rays[k]->header.startAzimuth;
+        product->endAzimuth[k]     = sweep->rays[k]->header.endAzimuth;
+        product->startElevation[k] = sweep->rays[k]->header.startElevation;
+        product->endElevation[k]   = sweep->rays[k]->header.endElevation;
+        product->startTime[k]      = sweep->rays[k]->header.startTimeDouble;
+        product->endTime[k]        = sweep->rays[k]->header.endTimeDouble;
+    }
+}
+
+int RKProductInitFromSweep(RKProduct *product, const RKSweep *sweep) {
+    int k;
+
+    // Required capacity, round to the next 90 ray count, next 100 gate count
+    const uint32_t requiredCapacity = (uint32_t)ceilf(sweep->header.rayCount / 90.0f) * 90 * (uint32_t)ceilf(sweep->header.gateCount / 100.0f) * 100;
+
+    RKProductInitHeaderFromSweep(product, sweep);
+    product->flag &= ~RKProductStatusRayView;
+
     // Expand if the current capacity is not sufficient
     if (product->capacity < requiredCapacity) {
         product->data = (RKFloat *)realloc(product->data, requiredCapacity * sizeof(RKFloat));
@@ -183,14 +211,6 @@ int RKProductInitFromSweep(RKProduct *product, const RKSweep *sweep) {
         product->capacity = requiredCapacity;
         product->totalBufferSize = sizeof(RKProduct) + (4 * RKMaximumRaysPerSweep + product->capacity) * sizeof(RKFloat);
     }
-    for (k = 0; k < product->header.rayCount; k++) {
-        product->startAzimuth[k]   = sweep->rays[k]->header.startAzimuth;
-        product->endAzimuth[k]     = sweep->rays[k]->header.endAzimuth;
-        product->startElevation[k] = sweep->rays[k]->header.startElevation;
-        product->endElevation[k]   = sweep->rays[k]->header.endElevation;
-        product->startTime[k]      = sweep->rays[k]->header.startTimeDouble;
-        product->endTime[k]        = sweep->rays[k]->header.endTimeDouble;
-    }
     if (product->desc.index < RKProductIndexCount) {
         RKFloat *x, *y = product->data;
         for (k = 0; k < product->header.rayCount; k++) {
@@ -210,6 +230,95 @@ int RKProductInitFromSweep(RKProduct *product, const RKSweep *sweep) {
     return RKResultSuccess;
 }
 
+//
+// Same as RKProductInitFromSweep() but the data are not copied. Each ray of the product
+// points to the data of the corresponding ray in the ray buffer, i.e., rays of the sweep
+// must not be released until the product is no longer needed. Writers should access the
+// data through RKProductGetDataOfRay() and must not modify them in place. The moment engine
+// cannot be held back, so the identifier of each ray is kept for RKProductCountRecycledViews().
+//
+int RKProductInitViewFromSweep(RKProduct *product, const RKSweep *sweep) {
+    int k;
+
+    if (product->desc.index >= RKProductIndexCount) {
+        RKLog("Error. Product index %d is not a base product of the ray buffer.\n", product->desc.index);
+        return RKResultFailedToFindProductId;
+    }
+
+    RKProductInitHeaderFromSweep(product, sweep);
+    product->flag |= RKProductStatusRayView;
+
+    for (k = 0; k < product->header.rayCount; k++) {
+        if (sweep->rays[k] == NULL) {
+            RKLog("Error. Null ray.\n");
+            product->views[k] = NULL;
+            product->viewRays[k] = NULL;
+            continue;
+        }
+        product->views[k] = RKGetFloatDataFromRay(sweep->rays[k], product->desc.index);
+        product->viewRays[k] = sweep->rays[k];
+        product->viewIdentifiers[k] = __atomic_load_n(&sweep->rays[k]->header.i, __ATOMIC_ACQUIRE);
+    }
+
+    return RKResultSuccess;
+}
+
+//
+// Number of rays of a view product that have been taken by the moment engine since the views were
+// made. The moment engine sets a new identifier before it touches the data, so a zero count after
+// the data have been read means they were read intact.
+//
+uint32_t RKProductCountRecycledViews(const RKProduct *product) {
+    uint32_t k, n = 0;
+
+    if (!(product->flag & RKProductStatusRayView)) {
+        return 0;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    for (k = 0; k < product->header.rayCount; k++) {
+        if (product->viewRays[k] && __atomic_load_n(&product->viewRays[k]->header.i, __ATOMIC_RELAXED) != product->viewIdentifiers[k]) {
+            n++;
+        }
+    }
+    return n;
+}
+
+//
+// Copy the data of a ray view product into the flattened array so that it can be modified
+//
+int RKProductFlatten(RKProduct *product) {
+    int k;
+
+    if (!(product->flag & RKProductStatusRayView)) {
+        return RKResultSuccess;
+    }
+    const uint32_t requiredCapacity = product->header.rayCount * product->header.gateCount;
+    if (product->capacity < requiredCapacity) {
+        product->data = (RKFloat *)realloc(product->data, requiredCapacity * sizeof(RKFloat));
+        if (product->data == NULL) {
+            RKLog("Error. Unable to expand space.\n");
+            exit(EXIT_FAILURE);
+        }
+        product->capacity = requiredCapacity;
+    }
+    RKFloat *y = product->data;
+    for (k = 0; k < product->header.rayCount; k++) {
+        if (product->views[k]) {
+            memcpy(y, product->views[k], product->header.gateCount * sizeof(RKFloat));
+        }
+        y += product->header.gateCount;
+    }
+    product->flag ^= RKProductStatusRayView;
+    return RKResultSuccess;
+}
+
+RKFloat *RKProductGetDataOfRay(const RKProduct *product, const uint32_t k) {
+    if (product->flag & RKProductStatusRayView) {
+        return product->views[k];
+    }
+    return product->data + k * product->header.gateCount;
+}
+
 void RKProductFree(RKProduct *product) {
     free(product);
 }
@@ -20,6 +20,10 @@ typedef float float32_t;
 
 #define FILL_VALUE  -32768
 
+// The netCDF library is not thread safe, all calls into it are serialized here so that the
+// sweep engine writers can call any recorder concurrently
+static pthread_mutex_t netcdfMutex = PTHREAD_MUTEX_INITIALIZER;
+
 static int getGlobalTextAttribute(char *dst, const char *name, const int ncid) {
     int r;
     size_t n = 0;
@@ -153,7 +157,52 @@ static void i16_masked_to_rkfloat_scale_offset(const RKFloat *dst, const int16_t
     }
 }
 
-int RKProductFileWriterNC(RKProduct *product, const char *filename) {
+static void put_product_data_float(const int ncid, const int varid, RKProduct *product, float *row) {
+    int j, k;
+    float *x;
+    if (product->flag & RKProductStatusRayView) {
+        // Stream ray by ray from the ray buffer, which must not be modified
+        size_t start[2] = {0, 0};
+        size_t count[2] = {1, product->header.gateCount};
+        for (k = 0; k < product->header.rayCount; k++) {
+            x = product->views[k];
+            for (j = 0; j < product->header.gateCount; j++) {
+                row[j] = x && isfinite(x[j]) ? x[j] : W2_MISSING_DATA;
+            }
+            start[0] = k;
+            nc_put_vara_float(ncid, varid, start, count, row);
+        }
+        return;
+    }
+    x = product->data;
+    for (j = 0; j < product->header.rayCount * product->header.gateCount; j++) {
+        if (!isfinite(*x)) {
+            *x = W2_MISSING_DATA;
+        }
+        x++;
+    }
+    nc_put_var_float(ncid, varid, product->data);
+}
+
+static void product_to_i16_masked_inv_scale_offset(const int16_t *dst, const RKProduct *product) {
+    const uint32_t gateCount = product->header.gateCount;
+    int16_t *y = (int16_t *)dst;
+    for (uint32_t k = 0; k < product->header.rayCount; k++) {
+        RKFloat *x = RKProductGetDataOfRay(product, k);
+        if (x == NULL) {
+            for (uint32_t j = 0; j < gateCount; j++) {
+                y[j] = FILL_VALUE;
+            }
+        } else if (product->desc.cfOffset == 0.0f) {
+            rkfloat_to_i16_masked_inv_scale(y, x, product->desc.cfScale, gateCount);
+        } else {
+            rkfloat_to_i16_masked_inv_scale_offset(y, x, product->desc.cfScale, product->desc.cfOffset, gateCount);
+        }
+        y += gateCount;
+    }
+}
+
+static int write_product_nc(RKProduct *product, const char *filename) {
     int j;
     int ncid;
     int dimensionIds[2];
@@ -165,7 +214,6 @@ int RKProductFileWriterNC(RKProduct *product, const char *filename) {
 
     int tmpi;
     float tmpf;
-    float *x;
 
     // Check for basic requirements
     if (strlen(product->desc.name) == 0) {
@@ -347,14 +395,7 @@ int RKProductFileWriterNC(RKProduct *product, const char *filename) {
     }
     nc_put_var_float(ncid, variableIdGateWidth, array1D);
 
-    x = product->data;
-    for (j = 0; j < product->header.rayCount * product->header.gateCount; j++) {
-        if (!isfinite(*x)) {
-            *x = W2_MISSING_DATA;
-        }
-        x++;
-    }
-    nc_put_var_float(ncid, variableIdData, product->data);
+    put_product_data_float(ncid, variableIdData, product, array1D);
 
 #elif RKloat == double
 
@@ -375,14 +416,7 @@ int RKProductFileWriterNC(RKProduct *product, const char *filename) {
     }
     nc_put_var_double(ncid, variableIdGateWidth, array1D);
 
-    x = product->data;
-    for (j = 0; j < product->header.rayCount * product->header.gateCount; j++) {
-        if (!isfinite(*x)) {
-            *x = W2_MISSING_DATA;
-        }
-        x++;
-    }
-    nc_put_var_float(ncid, variableIdData, product->data);
+    put_product_data_float(ncid, variableIdData, product, array1D);
 
 #else
 
@@ -397,6 +431,13 @@ int RKProductFileWriterNC(RKProduct *product, const char *filename) {
     return RKResultSuccess;
 }
 
+int RKProductFileWriterNC(RKProduct *product, const char *filename) {
+    pthread_mutex_lock(&netcdfMutex);
+    int r = write_product_nc(product, filename);
+    pthread_mutex_unlock(&netcdfMutex);
+    return r;
+}
+
 void RKProductDimensionsFromFile(const char *filename, uint32_t *rayCount, uint32_t *gateCount) {
     int r;
     int ncid, tmpId;
@@ -458,6 +499,8 @@ RKProductCollection *RKProductCollectionInit(const int count, const uint32_t ray
         return NULL;
     }
     collection->count = count;
+    collection->map = NULL;
+    collection->mapSize = 0;
     RKProductBufferAlloc(&collection->products, collection->count, rayCount, gateCount);
     return collection;
 }
@@ -490,6 +533,9 @@ RKProductCollection *RKProductCollectionInitFromSingles(RKProductCollection *sin
 
 void RKProductCollectionFree(RKProductCollection *collection) {
     RKProductBufferFree(collection->products, collection->count);
+    if (collection->map) {
+        munmap(collection->map, collection->mapSize);
+    }
     free(collection);
 }
 
@@ -501,6 +547,8 @@ RKProductCollection *RKProductCollectionExpand(RKProductCollection *collection,
         return NULL;
     }
     newCollection->count = collection->count + count;
+    newCollection->map = NULL;
+    newCollection->mapSize = 0;
     RKProductBufferAlloc(&newCollection->products, newCollection->count, collection->products[0].header.rayCount, collection->products[0].header.gateCount);
     for (int k = 0; k < collection->count; k++) {
         memcpy(&newCollection->products[k], &collection->products[k], sizeof(RKProduct));
@@ -1307,6 +1355,117 @@ static RKProductCollection *read_tar(const char *filename) {
 
 #endif
 
+static size_t align_product_file_offset(const size_t offset) {
+    return (offset + RKProductFileBlockAlignment - 1) / RKProductFileBlockAlignment * RKProductFileBlockAlignment;
+}
+
+//
+// The native file is mapped and stays mapped with the collection. Uncompressed blocks are used in place
+// as ray views (RKProductStatusRayView) into the mapping, i.e., nothing is copied. Deflated blocks are
+// inflated straight into the RKProduct arrays. Only the small per-ray metadata is copied. There is no
+// per-gate conversion since the blocks are stored as RKFloat.
+//
+static RKProductCollection *read_rk(const char *filename) {
+    MAKE_FUNCTION_NAME(myname);
+
+    int k, p;
+    struct stat fileStat;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        RKLog("%s Error. Unable to open %s   errno = %d\n", myname, filename, errno);
+        return NULL;
+    }
+    if (fstat(fd, &fileStat) || fileStat.st_size < sizeof(RKProductFileHeader)) {
+        RKLog("%s Error. File %s is too small.\n", myname, filename);
+        close(fd);
+        return NULL;
+    }
+    const size_t fileSize = (size_t)fileStat.st_size;
+    uint8_t *map = (uint8_t *)mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        RKLog("%s Error. Unable to map %s   errno = %d\n", myname, filename, errno);
+        return NULL;
+    }
+    madvise(map, fileSize, MADV_SEQUENTIAL);
+
+    const RKProductFileHeader *fileHeader = (RKProductFileHeader *)map;
+    const RKProductFileBlock *blocks = (RKProductFileBlock *)(map + sizeof(RKProductFileHeader));
+    const uint32_t count = fileHeader->productCount;
+    const uint32_t rayCount = fileHeader->rayCount;
+    const uint32_t gateCount = fileHeader->gateCount;
+    const size_t halfSize = rayCount * sizeof(RKFloat);
+    const size_t fullSize = rayCount * sizeof(double);
+    const size_t rawSize = (size_t)rayCount * gateCount * sizeof(RKFloat);
+
+    // Check everything before allocating the collection
+    bool okay = !strncmp(fileHeader->preface, RKProductFilePreface, sizeof(RKProductFilePreface))
+             && fileHeader->format == RKProductFileFormat
+             && count > 0 && count <= RKMaximumProductCount
+             && rayCount > 0 && rayCount <= RKMaximumRaysPerSweep && gateCount > 0
+             && sizeof(RKProductFileHeader) + count * sizeof(RKProductFileBlock) <= fileSize
+             && fileHeader->metadataSize == 4 * halfSize + 2 * fullSize
+             && fileHeader->metadataOffset + fileHeader->metadataSize <= fileSize;
+    for (p = 0; okay && p < count; p++) {
+        okay = blocks[p].offset + blocks[p].size <= fileSize
+            && blocks[p].rawSize == rawSize
+            && (blocks[p].compression == RKProductFileCompressionDeflate ||
+                (blocks[p].compression == RKProductFileCompressionNone && blocks[p].size == rawSize));
+    }
+    if (!okay) {
+        RKLog("%s Error. %s is not a valid product file.\n", myname, filename);
+        munmap(map, fileSize);
+        return NULL;
+    }
+
+    // The flat arrays are only needed for deflated blocks, RKProductFlatten() expands them if needed
+    bool deflated = false;
+    for (p = 0; p < count; p++) {
+        deflated |= blocks[p].compression == RKProductFileCompressionDeflate;
+    }
+    RKProductCollection *collection = RKProductCollectionInit(count, rayCount, deflated ? gateCount : 1);
+    if (collection == NULL) {
+        munmap(map, fileSize);
+        return NULL;
+    }
+    collection->map = map;
+    collection->mapSize = fileSize;
+    const uint8_t *metadata = map + fileHeader->metadataOffset;
+    for (p = 0; p < count; p++) {
+        RKProduct *product = &collection->products[p];
+        product->desc = blocks[p].desc;
+        product->header = fileHeader->header;
+        product->header.rayCount = rayCount;
+        product->header.gateCount = gateCount;
+        memcpy(product->startTime, metadata, fullSize);
+        memcpy(product->endTime, metadata + fullSize, fullSize);
+        memcpy(product->startAzimuth, metadata + 2 * fullSize, halfSize);
+        memcpy(product->endAzimuth, metadata + 2 * fullSize + halfSize, halfSize);
+        memcpy(product->startElevation, metadata + 2 * fullSize + 2 * halfSize, halfSize);
+        memcpy(product->endElevation, metadata + 2 * fullSize + 3 * halfSize, halfSize);
+        if (blocks[p].compression == RKProductFileCompressionNone) {
+            RKFloat *x = (RKFloat *)(map + blocks[p].offset);
+            for (k = 0; k < rayCount; k++) {
+                product->views[k] = x + k * gateCount;
+            }
+            product->flag |= RKProductStatusRayView;
+        } else {
+            uLongf size = (uLongf)rawSize;
+            k = uncompress((Bytef *)product->data, &size, map + blocks[p].offset, (uLong)blocks[p].size);
+            if (k != Z_OK || size != rawSize) {
+                RKLog("%s Error. Unable to inflate %s   k = %d\n", myname, product->desc.symbol, k);
+                RKProductCollectionFree(collection);
+                return NULL;
+            }
+        }
+    }
+    if (!deflated) {
+        madvise(map, fileSize, MADV_WILLNEED);
+    }
+    return collection;
+}
+
 RKProductCollection *RKProductCollectionInitWithFilename(const char *filename) {
     MAKE_FUNCTION_NAME(myname);
     RKLog("%s %s\n", myname, filename);
@@ -1340,18 +1499,25 @@ RKProductCollection *RKProductCollectionInitWithFilename(const char *filename) {
         #else
         RKLog("Error. In-memory tar file reader is not supported.\n");
         #endif
+    } else if (!strcasecmp(ext, ".rkp")) {
+        RKLog("Reading %s ...\n", filename);
+        collection = read_rk(filename);
     } else {
         RKLog("Error. Unsupported file extension: %s\n", ext);
     }
+    if (collection == NULL) {
+        return NULL;
+    }
     for (int k = 0; k < collection->count; k++) {
         RKProduct *product = &collection->products[k];
         RKLog("%d: %s (%s)\n", k, product->desc.name, product->desc.unit);
-        RKShowArray(product->data, product->desc.symbol, product->header.gateCount, product->header.rayCount);
+        // Views of a mapped file are contiguous, the first one is the whole block
+        RKShowArray(product->flag & RKProductStatusRayView ? product->views[0] : product->data, product->desc.symbol, product->header.gateCount, product->header.rayCount);
     }
     return collection;
 }
 
-int RKProductCollectionFileWriterCF(RKProductCollection *collection, const char *filename, const RKWriterOption options) {
+static int write_collection_cf(RKProductCollection *collection, const char *filename, const RKWriterOption options) {
     MAKE_FUNCTION_NAME(name);
 
     RKProduct *product = collection->products;
@@ -1678,11 +1844,7 @@ int RKProductCollectionFileWriterCF(RKProductCollection *collection, const char
     for (k = 0; k < collection->count; k++) {
         product = collection->products + k;
         productVid = productVids + k;
-        if (product->desc.cfOffset == 0.0f) {
-            rkfloat_to_i16_masked_inv_scale(i16Array, product->data, product->desc.cfScale, cellCount);
-        } else {
-            rkfloat_to_i16_masked_inv_scale_offset(i16Array, product->data, product->desc.cfScale, product->desc.cfOffset, cellCount);
-        }
+        product_to_i16_masked_inv_scale_offset(i16Array, product);
         nc_put_var_short(ncid, *productVid, i16Array);
     }
     nc_put_var_float(ncid, zCalVid, &product->header.systemZCal[0]);
@@ -1710,6 +1872,165 @@ int RKProductCollectionFileWriterCF(RKProductCollection *collection, const char
     return RKResultSuccess;
 }
 
+int RKProductCollectionFileWriterCF(RKProductCollection *collection, const char *filename, const RKWriterOption options) {
+    pthread_mutex_lock(&netcdfMutex);
+    int r = write_collection_cf(collection, filename, options);
+    pthread_mutex_unlock(&netcdfMutex);
+    return r;
+}
+
+static size_t write_product_file_block(const int fd, const void *buffer, const size_t size, const off_t offset) {
+    ssize_t r;
+    size_t n = 0;
+    while (n < size) {
+        r = pwrite(fd, (const uint8_t *)buffer + n, size - n, offset + n);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        } else if (r <= 0) {
+            break;
+        }
+        n += r;
+    }
+    return n;
+}
+
+int RKProductFileWriterRK(RKProduct *product, const char *filename) {
+    RKProductCollection collection = {1, product};
+    return RKProductCollectionFileWriterRK(&collection, filename, RKWriterOptionNone);
+}
+
+//
+// Write a collection in the native format (see RKProductFileHeader). All products must share the same
+// dimensions. With RKWriterOptionDeflateFields, each block is deflated at the fastest level, which takes
+// far less than NetCDF deflate for a similar size. Products that are views into the ray buffer are
+// gathered ray by ray, so they need not be flattened first.
+//
+int RKProductCollectionFileWriterRK(RKProductCollection *collection, const char *filename, const RKWriterOption options) {
+    MAKE_FUNCTION_NAME(name);
+
+    int j, k, p;
+    size_t n;
+    uLongf size;
+
+    RKProduct *product = collection->products;
+
+    const uint32_t rayCount = product->header.rayCount;
+    const uint32_t gateCount = product->header.gateCount;
+    const size_t halfSize = rayCount * sizeof(RKFloat);
+    const size_t fullSize = rayCount * sizeof(double);
+    const size_t rawSize = (size_t)rayCount * gateCount * sizeof(RKFloat);
+
+    if (collection->count == 0 || rayCount == 0 || gateCount == 0) {
+        RKLog("%s Error. Product dimensions are zero.\n", name);
+        return RKResultProductDimensionsNotSet;
+    }
+    for (p = 1; p < collection->count; p++) {
+        if (collection->products[p].header.rayCount != rayCount || collection->products[p].header.gateCount != gateCount) {
+            RKLog("%s Error. Products must have the same dimensions.\n", name);
+            return RKResultProductDimensionsNotSet;
+        }
+    }
+
+    RKProductFileHeader *fileHeader = (RKProductFileHeader *)malloc(sizeof(RKProductFileHeader));
+    RKProductFileBlock *blocks = (RKProductFileBlock *)malloc(collection->count * sizeof(RKProductFileBlock));
+    uint8_t *metadata = (uint8_t *)malloc(4 * halfSize + 2 * fullSize);
+    RKFloat *scratch = (RKFloat *)malloc(rawSize);
+    Bytef *deflated = options & RKWriterOptionDeflateFields ? (Bytef *)malloc(compressBound((uLong)rawSize)) : NULL;
+    if (fileHeader == NULL || blocks == NULL || metadata == NULL || scratch == NULL ||
+        (options & RKWriterOptionDeflateFields && deflated == NULL)) {
+        RKLog("%s Error. Unable to allocate memory.\n", name);
+        exit(EXIT_FAILURE);
+    }
+    memset(fileHeader, 0, sizeof(RKProductFileHeader));
+    memset(blocks, 0, collection->count * sizeof(RKProductFileBlock));
+
+    sprintf(fileHeader->preface, RKProductFilePreface);
+    fileHeader->format = RKProductFileFormat;
+    fileHeader->productCount = collection->count;
+    fileHeader->rayCount = rayCount;
+    fileHeader->gateCount = gateCount;
+    fileHeader->metadataOffset = align_product_file_offset(sizeof(RKProductFileHeader) + collection->count * sizeof(RKProductFileBlock));
+    fileHeader->metadataSize = 4 * halfSize + 2 * fullSize;
+    fileHeader->header = product->header;
+
+    // Per-ray metadata, the doubles go first to keep everything naturally aligned
+    memcpy(metadata, product->startTime, fullSize);
+    memcpy(metadata + fullSize, product->endTime, fullSize);
+    memcpy(metadata + 2 * fullSize, product->startAzimuth, halfSize);
+    memcpy(metadata + 2 * fullSize + halfSize, product->endAzimuth, halfSize);
+    memcpy(metadata + 2 * fullSize + 2 * halfSize, product->startElevation, halfSize);
+    memcpy(metadata + 2 * fullSize + 3 * halfSize, product->endElevation, halfSize);
+
+    RKPreparePath(filename);
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        RKLog("%s Error. Unable to create %s   errno = %d\n", name, filename, errno);
+        free(deflated);
+        free(scratch);
+        free(metadata);
+        free(blocks);
+        free(fileHeader);
+        return RKResultFailedToOpenFileForProduct;
+    }
+
+    bool okay = write_product_file_block(fd, metadata, fileHeader->metadataSize, fileHeader->metadataOffset) == fileHeader->metadataSize;
+    off_t offset = align_product_file_offset(fileHeader->metadataOffset + fileHeader->metadataSize);
+    for (p = 0; okay && p < collection->count; p++) {
+        product = &collection->products[p];
+        const RKFloat *data = product->data;
+        if (product->flag & RKProductStatusRayView) {
+            for (k = 0; k < rayCount; k++) {
+                const RKFloat *x = RKProductGetDataOfRay(product, k);
+                if (x == NULL) {
+                    for (j = 0; j < gateCount; j++) {
+                        scratch[k * gateCount + j] = NAN;
+                    }
+                    continue;
+                }
+                memcpy(scratch + k * gateCount, x, gateCount * sizeof(RKFloat));
+            }
+            data = scratch;
+        }
+        blocks[p].desc = product->desc;
+        blocks[p].offset = offset;
+        blocks[p].rawSize = rawSize;
+        blocks[p].compression = RKProductFileCompressionNone;
+        blocks[p].size = rawSize;
+        if (deflated) {
+            size = compressBound((uLong)rawSize);
+            k = compress2(deflated, &size, (const Bytef *)data, (uLong)rawSize, Z_BEST_SPEED);
+            if (k == Z_OK && size < rawSize) {
+                blocks[p].compression = RKProductFileCompressionDeflate;
+                blocks[p].size = size;
+                data = (const RKFloat *)deflated;
+            }
+        }
+        n = write_product_file_block(fd, data, blocks[p].size, offset);
+        okay = n == blocks[p].size;
+        offset = align_product_file_offset(offset + blocks[p].size);
+    }
+    // The header and block table go last, a file that was cut short cannot pass as a valid one
+    if (okay) {
+        okay = write_product_file_block(fd, fileHeader, sizeof(RKProductFileHeader), 0) == sizeof(RKProductFileHeader)
+            && write_product_file_block(fd, blocks, collection->count * sizeof(RKProductFileBlock), sizeof(RKProductFileHeader))
+               == collection->count * sizeof(RKProductFileBlock);
+    }
+    close(fd);
+
+    free(deflated);
+    free(scratch);
+    free(metadata);
+    free(blocks);
+    free(fileHeader);
+
+    if (!okay) {
+        RKLog("%s Error. Unable to write %s   errno = %d\n", name, filename, errno);
+        remove(filename);
+        return RKResultFailedToWriteProduct;
+    }
+    return RKResultSuccess;
+}
+
 int RKProductCollectionStandardizeForWDSSII(RKProductCollection *collection) {
     RKLog("Warning. This method has not been implemented yet.\n");
     return RKResultSuccess;
@@ -1764,6 +2085,8 @@ int RKProductCollectionStandardizeForCFRadial(RKProductCollection *collection) {
                 break;
             case RKProductIndexP:
                 if (!strncasecmp(product->desc.unit, "radian", 6)) {
+                    // Values are converted in place, which is not allowed on the ray buffer
+                    RKProductFlatten(product);
                     float *x = product->data;
                     #ifdef DEBUG_SHOW_MIN_MAX_PHIDP
                     float minValue = 180.0f, maxValue = -180.0f;
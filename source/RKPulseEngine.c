@@ -530,7 +530,8 @@ static void *pulseEngineCore(void *_in) {
         me->cid = scratch->config->i;
         me->lag = RKModuloLag(*engine->pulseIndex, i0, engine->radarDescription->pulseBufferDepth) / (float)engine->radarDescription->pulseBufferDepth;
 
-        pulse->header.s |= RKPulseStatusProcessed;
+        // Samples before the status, readers of the shared memory take the status with an acquire load
+        __atomic_fetch_or(&pulse->header.s, RKPulseStatusProcessed, __ATOMIC_RELEASE);
 
         // Done processing, get the time
         gettimeofday(&t0, NULL);
@@ -1387,12 +1388,13 @@ RKPulse *RKPulseEngineGetVacantPulse(RKPulseEngine *engine, const RKPulseStatus
     pulse->header.s = RKPulseStatusVacant;
     // Current pulse
     pulse = RKGetPulseFromBuffer(engine->pulseBuffer, *engine->pulseIndex);
+    pulse->header.s = RKPulseStatusVacant;
     pulse->header.timeDouble = 0.0;
     pulse->header.time.tv_sec = 0;
     pulse->header.time.tv_usec = 0;
     pulse->header.positionIndex = (uint32_t)-1;
-    pulse->header.i += engine->radarDescription->pulseBufferDepth;
-    pulse->header.s = RKPulseStatusVacant;
+    // Vacant before the new identifier is visible, see RKGetVacantPulseFromBuffer()
+    __atomic_store_n(&pulse->header.i, pulse->header.i + engine->radarDescription->pulseBufferDepth, __ATOMIC_RELEASE);
     *engine->pulseIndex = RKNextModuloS(*engine->pulseIndex, engine->radarDescription->pulseBufferDepth);
     return pulse;
 }
@@ -417,7 +417,7 @@ static void *ringFilterCore(void *_in) {
 static void *pulseRingWatcher(void *_in) {
     RKPulseRingFilterEngine *engine = (RKPulseRingFilterEngine *)_in;
 
-    int c, i, j, k, s;
+    int c, i, j, k, o, s;
 	struct timeval t0, t1;
 
 	sem_t *sem[engine->coreCount];
@@ -629,6 +629,7 @@ static void *pulseRingWatcher(void *_in) {
         }
 
 		// Now we check on and catch up with the pulses that are done
+        o = j;
         allDone = true;
         while (j != k && allDone) {
             // Decide whether the pulse has been processed by FIR/IIR filter
@@ -649,6 +650,9 @@ static void *pulseRingWatcher(void *_in) {
                 j = RKNextModuloS(j, engine->radarDescription->pulseBufferDepth);
             }
         }
+        if (j != o && engine->processedHandler) {
+            engine->processedHandler(engine->processedHandlerInput);
+        }
 
 		engine->tic++;
     }
@@ -675,7 +679,7 @@ static void *pulseRingWatcher(void *_in) {
 static void *pulseRingWatcherV1(void *_in) {
     RKPulseRingFilterEngine *engine = (RKPulseRingFilterEngine *)_in;
 
-    int c, i, j, k, s;
+    int c, i, j, k, o, s;
 	struct timeval t0, t1;
 	float lag;
 
@@ -786,6 +790,7 @@ static void *pulseRingWatcherV1(void *_in) {
             }
 
             // Check finished pulses
+            o = j;
             allDone = true;
             while (j != k && allDone) {
                 // Decide whether the pulse has been processed by FIR/IIR filter
@@ -802,6 +807,9 @@ static void *pulseRingWatcherV1(void *_in) {
                     j = RKNextModuloS(j, engine->radarDescription->pulseBufferDepth);
                 }
             }
+            if (j != o && engine->processedHandler) {
+                engine->processedHandler(engine->processedHandlerInput);
+            }
         }
         engine->state ^= RKEngineStateSleep1;
         engine->state |= RKEngineStateSleep2;
@@ -892,6 +900,7 @@ static void *pulseRingWatcherV1(void *_in) {
 
 		// Now we check on and catch up with the pulses that are done
         // updateDonePulses(engine, &j, i, k);
+        o = j;
         allDone = true;
         while (j != k && allDone) {
             // Decide whether the pulse has been processed by FIR/IIR filter
@@ -912,6 +921,9 @@ static void *pulseRingWatcherV1(void *_in) {
                 j = RKNextModuloS(j, engine->radarDescription->pulseBufferDepth);
             }
         }
+        if (j != o && engine->processedHandler) {
+            engine->processedHandler(engine->processedHandlerInput);
+        }
 
         // Log a message if it has been a while
         gettimeofday(&t0, NULL);
@@ -1014,6 +1026,11 @@ void RKPulseRingFilterEngineSetCoreOrigin(RKPulseRingFilterEngine *engine, const
     engine->coreOrigin = origin;
 }
 
+void RKPulseRingFilterEngineSetProcessedHandler(RKPulseRingFilterEngine *engine, void (*handler)(void *), void *input) {
+    engine->processedHandler = handler;
+    engine->processedHandlerInput = input;
+}
+
 void RKPulseRingFilterEngineEnableFilter(RKPulseRingFilterEngine *engine) {
     engine->useFilter = true;
     if (engine->state & RKEngineStateActive) {
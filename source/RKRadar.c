@@ -145,8 +145,9 @@ static void *systemInspectorRunLoop(void *in) {
     uint32_t tweetaIndex = radar->desc.initFlags & RKInitFlagSignalProcessor ? radar->healthNodes[RKHealthNodeTweeta].index : 0;
 
     bool transceiverOkay, pedestalOkay, healthOkay, networkOkay, anyCritical;
-    RKStatusEnum networkEnum, transceiverEnum, pedestalEnum, healthEnum;
+    RKStatusEnum networkEnum, transceiverEnum, pedestalEnum, healthEnum, recorderEnum;
     char FFTPlanUsage[RKStatusStringLength];
+    char recorderValue[RKNameLength];
     RKName criticalKey, criticalValue;
     int criticalCount = 0;
 
@@ -261,8 +262,8 @@ static void *systemInspectorRunLoop(void *in) {
             } else {
                 // Position active / standby
                 health = RKGetLatestHealthOfNode(radar, RKHealthNodePedestal);
-                if (RKFindCondition(health->string, RKStatusEnumTooHigh, false, NULL, NULL) ||
-                    RKFindCondition(health->string, RKStatusEnumHigh, false, NULL, NULL)) {
+                if (health->record.count > 0 ? RKHealthRecordHasStatus(&health->record, RKStatusEnumTooHigh) || RKHealthRecordHasStatus(&health->record, RKStatusEnumHigh)
+                                             : RKFindCondition(health->string, RKStatusEnumTooHigh, false, NULL, NULL) || RKFindCondition(health->string, RKStatusEnumHigh, false, NULL, NULL)) {
                     pedestalEnum = RKStatusEnumStandby;
                 } else {
                     if (RKGetMinorSectorInDegrees(position0->azimuthDegrees, position1->azimuthDegrees) > 0.1f ||
@@ -291,8 +292,8 @@ static void *systemInspectorRunLoop(void *in) {
 
             // Transceiver health
             health = RKGetLatestHealthOfNode(radar, RKHealthNodeTransceiver);
-            if (RKFindCondition(health->string, RKStatusEnumTooHigh, false, NULL, NULL) ||
-                RKFindCondition(health->string, RKStatusEnumHigh, false, NULL, NULL)) {
+            if (health->record.count > 0 ? RKHealthRecordHasStatus(&health->record, RKStatusEnumTooHigh) || RKHealthRecordHasStatus(&health->record, RKStatusEnumHigh)
+                                         : RKFindCondition(health->string, RKStatusEnumTooHigh, false, NULL, NULL) || RKFindCondition(health->string, RKStatusEnumHigh, false, NULL, NULL)) {
                 transceiverEnum = RKStatusEnumStandby;
             } else {
                 transceiverEnum = RKStatusEnumNormal;
@@ -300,13 +301,24 @@ static void *systemInspectorRunLoop(void *in) {
 
             // Tweeta health
             health = RKGetLatestHealthOfNode(radar, RKHealthNodeTweeta);
-            if (RKFindCondition(health->string, RKStatusEnumTooHigh, false, NULL, NULL) ||
-                RKFindCondition(health->string, RKStatusEnumHigh, false, NULL, NULL)) {
+            if (health->record.count > 0 ? RKHealthRecordHasStatus(&health->record, RKStatusEnumTooHigh) || RKHealthRecordHasStatus(&health->record, RKStatusEnumHigh)
+                                         : RKFindCondition(health->string, RKStatusEnumTooHigh, false, NULL, NULL) || RKFindCondition(health->string, RKStatusEnumHigh, false, NULL, NULL)) {
                 healthEnum = RKStatusEnumStandby;
             } else {
                 healthEnum = RKStatusEnumNormal;
             }
 
+            // Recorder health, a string value with the drop count if it is in degraded mode
+            if (__atomic_load_n(&radar->rawDataRecorder->degraded, __ATOMIC_ACQUIRE)) {
+                snprintf(recorderValue, sizeof(recorderValue), "\"Degraded (%s, %s dropped)\"",
+                         strerror(radar->rawDataRecorder->lastErrno),
+                         RKIntegerToCommaStyleString(__atomic_load_n(&radar->rawDataRecorder->droppedPulseCount, __ATOMIC_RELAXED)));
+                recorderEnum = RKStatusEnumFault;
+            } else {
+                snprintf(recorderValue, sizeof(recorderValue), "%s", radar->rawDataRecorder->record ? "true" : "false");
+                recorderEnum = radar->rawDataRecorder->record ? RKStatusEnumNormal : RKStatusEnumStandby;
+            }
+
             // Report a health status
             health = RKGetVacantHealth(radar, RKHealthNodeRadarKit);
             if (health) {
@@ -333,19 +345,21 @@ static void *systemInspectorRunLoop(void *in) {
                         "\"Position Rate\":{\"Value\":\"%s Hz\",\"Enum\":0}, "
                         "\"Noise\":[%.3f,%.3f], "
                         "\"rayRate\":%.3f, "
-                        "\"FFTPlanUsage\":%s"
+                        "\"FFTPlanUsage\":%s, "
+                        "\"HostLatency\":%s"
                         "}",
                         transceiverOkay ? "true" : "false", transceiverOkay ? transceiverEnum : RKStatusEnumFault,
                         pedestalOkay ? "true" : "false", pedestalOkay ? pedestalEnum : RKStatusEnumFault,
                         healthOkay ? "true" : "false", radar->healthRelay ? (healthOkay ? healthEnum : RKStatusEnumFault) : RKStatusEnumNotWired,
                         networkOkay ? "true" : "false", networkEnum,
-                        radar->rawDataRecorder->record ? "true" : "false", radar->rawDataRecorder->record ? RKStatusEnumNormal : RKStatusEnumStandby,
+                        recorderValue, recorderEnum,
                         radar->pulseRingFilterEngine->useFilter ? "true" : "false", radar->pulseRingFilterEngine->useFilter ? RKStatusEnumNormal : RKStatusEnumStandby,
                         RKIntegerToCommaStyleString((long)round(pulseRate)), fabs(pulseRate - 1.0f / config->prt[0]) * config->prt[0] < 0.1f ? RKStatusEnumNormal : RKStatusEnumStandby,
                         RKIntegerToCommaStyleString((long)round(positionRate)),
                         config->noise[0], config->noise[1],
                         rayRate,
-                        FFTPlanUsage
+                        FFTPlanUsage,
+                        RKHostMonitorLatencyString(radar->hostMonitor)
                         );
                 RKSetHealthReady(radar, health);
             }
@@ -433,6 +447,11 @@ void *radarCoPilot(void *in) {
     return NULL;
 }
 
+// The ring filter has marked some pulses RKPulseStatusRingProcessed, they are ready for tagging
+static void RKRadarNotifyPositionEngine(void *in) {
+    RKPositionEngineNotify((RKPositionEngine *)in);
+}
+
 void *masterControllerExecuteInBackground(void *in) {
     RKRadarCommand *radarCommand = (RKRadarCommand *)in;
     if (radarCommand->radar->masterController) {
@@ -621,8 +640,9 @@ RKRadar *RKInitWithDesc(const RKRadarDesc desc) {
               RKUIntegerToCommaStyleString(radar->desc.configBufferSize),
               RKIntegerToCommaStyleString(radar->desc.configBufferDepth));
         memset(radar->configs, 0, bytes);
+        // Identifiers start around 1000 and are aligned to the depth so that RKConfigWithId() can address them directly
         for (i = 0; i < radar->desc.configBufferDepth; i++) {
-            radar->configs[i].i = -(uint64_t)radar->desc.configBufferDepth + i + 1000;
+            radar->configs[i].i = -(uint64_t)radar->desc.configBufferDepth + i + 1000 / radar->desc.configBufferDepth * radar->desc.configBufferDepth;
         }
         radar->state |= RKRadarStateConfigBufferAllocated;
     }
@@ -709,9 +729,34 @@ RKRadar *RKInitWithDesc(const RKRadarDesc desc) {
         radar->state |= RKRadarStatePositionBufferAllocated;
     }
 
+    // Gate capacity of the rays
+    const uint32_t rayCapacity = ((int)ceilf((float)(radar->desc.pulseCapacity / radar->desc.pulseToRayRatio) * sizeof(RKFloat) / (float)RKMemoryAlignSize)) * RKMemoryAlignSize / sizeof(RKFloat);
+
+    // Pulse and ray buffers in shared memory for the local consumers
+    if (radar->desc.initFlags & RKInitFlagExportSharedMemory) {
+        char name[RKSharedMemoryNameLength];
+        RKSharedMemoryMakeName(name, radar->desc.name);
+        radar->sharedMemory = RKSharedMemoryInit(name, &radar->desc,
+                                                 radar->desc.pulseCapacity,
+                                                 radar->desc.initFlags & RKInitFlagAllocRawIQBuffer ? radar->desc.pulseBufferDepth : 0,
+                                                 rayCapacity,
+                                                 radar->desc.initFlags & RKInitFlagAllocMomentBuffer ? radar->desc.rayBufferDepth : 0);
+        if (radar->sharedMemory == NULL) {
+            RKLog("Error. Unable to export the buffers through shared memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        radar->memoryUsage += sizeof(RKSharedMemoryHeader);
+        radar->state |= RKRadarStateSharedMemoryAllocated;
+    }
+
     // Pulse (IQ) buffer
     if (radar->desc.initFlags & RKInitFlagAllocRawIQBuffer) {
-        bytes = RKPulseBufferAlloc(&radar->pulses, radar->desc.pulseCapacity, radar->desc.pulseBufferDepth);
+        if (radar->sharedMemory) {
+            radar->pulses = radar->sharedMemory->pulses;
+            bytes = radar->sharedMemory->header->pulseBufferSize;
+        } else {
+            bytes = RKPulseBufferAlloc(&radar->pulses, radar->desc.pulseCapacity, radar->desc.pulseBufferDepth);
+        }
         if (bytes == 0 || radar->pulses == NULL) {
             RKLog("Error. Unable to allocate memory for I/Q pulses.\n");
             exit(EXIT_FAILURE);
@@ -734,8 +779,13 @@ RKRadar *RKInitWithDesc(const RKRadarDesc desc) {
 
     // Ray (moment) and product buffers
     if (radar->desc.initFlags & RKInitFlagAllocMomentBuffer) {
-        k = ((int)ceilf((float)(radar->desc.pulseCapacity / radar->desc.pulseToRayRatio) * sizeof(RKFloat) / (float)RKMemoryAlignSize)) * RKMemoryAlignSize / sizeof(RKFloat);
-        bytes = RKRayBufferAlloc(&radar->rays, k, radar->desc.rayBufferDepth);
+        k = rayCapacity;
+        if (radar->sharedMemory) {
+            radar->rays = radar->sharedMemory->rays;
+            bytes = radar->sharedMemory->header->rayBufferSize;
+        } else {
+            bytes = RKRayBufferAlloc(&radar->rays, k, radar->desc.rayBufferDepth);
+        }
         if (bytes == 0 || radar->rays == NULL) {
             RKLog("Error. Unable to allocate memory for rays.\n");
             exit(EXIT_FAILURE);
@@ -882,6 +932,9 @@ RKRadar *RKInitWithDesc(const RKRadarDesc desc) {
         RKPulseRingFilterEngineSetEssentials(radar->pulseRingFilterEngine, &radar->desc,
                                              radar->configs, &radar->configIndex,
                                              radar->pulses, &radar->pulseIndex);
+        if (radar->positionEngine) {
+            RKPulseRingFilterEngineSetProcessedHandler(radar->pulseRingFilterEngine, RKRadarNotifyPositionEngine, radar->positionEngine);
+        }
         radar->memoryUsage += radar->pulseRingFilterEngine->memoryUsage;
         radar->state |= RKRadarStatePulseRingFilterEngineInitialized;
 
@@ -1188,11 +1241,15 @@ int RKFree(RKRadar *radar) {
     if (radar->state & RKRadarStatePositionBufferAllocated) {
         free(radar->positions);
     }
-    if (radar->state & RKRadarStateRawIQBufferAllocated) {
-        free(radar->pulses);
-    }
-    if (radar->state & RKRadarStateRayBufferAllocated) {
-        free(radar->rays);
+    if (radar->state & RKRadarStateSharedMemoryAllocated) {
+        RKSharedMemoryFree(radar->sharedMemory);
+    } else {
+        if (radar->state & RKRadarStateRawIQBufferAllocated) {
+            free(radar->pulses);
+        }
+        if (radar->state & RKRadarStateRayBufferAllocated) {
+            free(radar->rays);
+        }
     }
     if (radar->state & RKRadarStateControlsAllocated) {
         free(radar->controls);
@@ -1288,6 +1345,18 @@ int RKSetProcessingCoreCounts(RKRadar *radar,
     return RKResultSuccess;
 }
 
+// Order 1 or 2 tags the pulses with a local polynomial fit of the positions, see RKPositionModel.h
+int RKSetPositionModel(RKRadar *radar, const uint8_t order, const double maximumExtrapolation) {
+    if (radar->positionEngine == NULL) {
+        return RKResultNoPositionEngine;
+    }
+    if (radar->state & RKRadarStateLive) {
+        return RKResultFailedToExecuteCommand;
+    }
+    RKPositionEngineSetPositionModel(radar->positionEngine, order, maximumExtrapolation);
+    return RKResultSuccess;
+}
+
 #pragma mark - Properties
 
 //
@@ -1548,7 +1617,7 @@ int RKSetWaveformToImpulse(RKRadar *radar) {
 }
 
 int RKSetPRF(RKRadar *radar, const uint32_t prf) {
-    RKAddConfig(radar, RKConfigKeyPRF, prf, RKConfigKeyNull);
+    RKAddConfig(radar, RKConfigKeyPRF, (double)prf, RKConfigKeyNull);
     return RKResultSuccess;
 }
 
@@ -1568,6 +1637,15 @@ void RKSetPositionTicsPerSeconds(RKRadar *radar, const double delta) {
     RKClockSetDxDu(radar->positionClock, 1.0 / delta);
 }
 
+void RKSetClockSource(RKRadar *radar, const RKClockSource source) {
+    if (radar->pulseClock) {
+        RKClockSetSource(radar->pulseClock, source);
+    }
+    if (radar->positionClock) {
+        RKClockSetSource(radar->positionClock, source);
+    }
+}
+
 // int RKSetFilterArrayInit(RKRadar *radar, void (*callback)(RKCompressionScratch *)) {
 //     if (radar->pulseEngine == NULL) {
 //         return RKResultNoPulseCompressionEngine;
@@ -1787,7 +1865,7 @@ int RKGoLive(RKRadar *radar) {
     // Add a dummy config to get things started if there has not been one from the user
     if (radar->configIndex == 0) {
         RKAddConfig(radar,
-                    RKConfigKeyPRF, 1000,
+                    RKConfigKeyPRF, 1000.0,
                     RKConfigKeySystemNoise, 0.1, 0.1,
                     RKConfigKeySystemZCal, -27.0, -27.0,
                     RKConfigKeySystemDCal, -0.01,
@@ -2759,7 +2837,7 @@ void RKAddConfig(RKRadar *radar, ...) {
 }
 
 RKConfig *RKGetLatestConfig(RKRadar *radar) {
-    return &radar->configs[RKPreviousModuloS(radar->configIndex, radar->desc.configBufferDepth)];
+    return &radar->configs[RKPreviousModuloS(__atomic_load_n(&radar->configIndex, __ATOMIC_ACQUIRE), radar->desc.configBufferDepth)];
 }
 
 #pragma mark - Healths
@@ -2803,6 +2881,7 @@ RKHealth *RKGetVacantHealth(RKRadar *radar, const RKHealthNode node) {
         index = RKNextModuloS(index, radar->desc.healthBufferDepth);
         radar->healthNodes[node].healths[index].flag = RKHealthFlagVacant;
         radar->healthNodes[node].healths[index].string[0] = '\0';
+        radar->healthNodes[node].healths[index].record.count = 0;
         radar->healthNodes[node].index = index;
     }
     return health;
@@ -2883,6 +2962,7 @@ void RKSetPositionReady(RKRadar *radar, RKPosition *position) {
     }
     position->flag |= RKPositionFlagReady;
     radar->positionIndex = RKNextModuloS(radar->positionIndex, radar->desc.positionBufferDepth);
+    RKPositionEngineNotify(radar->positionEngine);
     return;
 }
 
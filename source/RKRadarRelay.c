@@ -12,6 +12,25 @@
 
 #pragma mark - Internal Functions
 
+// The command for relay frames that continues every channel from where the previous connection left off
+static int RKRadarRelayMakeRelayCommand(RKRadarRelay *engine, char *command) {
+    int k;
+    int size = sprintf(command, "R ");
+    size += RKStringFromStream(command + size, engine->streams);
+    size += sprintf(command + size, " %d ", engine->codec);
+    for (k = 0; k < RKRelayChannelCount; k++) {
+        size += sprintf(command + size, "%u", engine->priorities[k]);
+    }
+    for (k = 0; k < RKRelayChannelCount; k++) {
+        if (engine->frameCounts[k]) {
+            size += sprintf(command + size, "%c%llu", k ? ',' : ' ', (unsigned long long)engine->sequences[k]);
+        } else {
+            size += sprintf(command + size, "%c-", k ? ',' : ' ');
+        }
+    }
+    return size;
+}
+
 static int RKRadarRelayGreet(RKClient *client) {
     // The shared user resource pointer
     RKRadarRelay *engine = (RKRadarRelay *)client->userResource;
@@ -20,6 +39,10 @@ static int RKRadarRelayGreet(RKClient *client) {
 
     pthread_mutex_lock(&engine->client->lock);
 
+    // A small receive buffer, otherwise the kernel queues up seconds of frames ahead of the higher priority channels
+    int bufferSize = RKRadarRelayReceiveBufferSize;
+    setsockopt(engine->client->sd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(int));
+
     uint32_t size = sprintf(command, "a RKRadarRelay nopassword" RKEOL);
     ssize_t sentSize = RKNetworkSendPackets(engine->client->sd, command, size, NULL);
     if (sentSize < 0) {
@@ -30,8 +53,7 @@ static int RKRadarRelayGreet(RKClient *client) {
         if (engine->verbose) {
             RKLog("%s Resuming stream ...\n", engine->name);
         }
-        size = sprintf(command, "s");
-        size += RKStringFromStream(command + size, engine->streams);
+        size = RKRadarRelayMakeRelayCommand(engine, command);
         size += sprintf(command + size, RKEOL);
         RKNetworkSendPackets(engine->client->sd, command, size, NULL);
     }
@@ -41,10 +63,8 @@ static int RKRadarRelayGreet(RKClient *client) {
     return RKResultSuccess;
 }
 
-static int RKRadarRelayRead(RKClient *client) {
-    // The shared user resource pointer
-    RKRadarRelay *engine = (RKRadarRelay *)client->userResource;
-
+// Put a payload of a legacy packet or of a relay frame into the buffers
+static int RKRadarRelayHandlePayload(RKRadarRelay *engine, const RKNetworkPacketType type, void *payload, const uint32_t payloadSize) {
     int j, k;
     RKHealth *health;
     RKStatus *status;
@@ -55,6 +75,7 @@ static int RKRadarRelayRead(RKClient *client) {
     uint32_t productList;
     uint32_t productCount;
     uint32_t rxGateCount = 0;
+    RKProductIndex productIndex;
 
     const uint32_t localRayCapacity = ray->header.capacity;
     const uint32_t localPulseCapacity = pulse->header.capacity;
@@ -64,7 +85,7 @@ static int RKRadarRelayRead(RKClient *client) {
     RKPulseStatus pulseStatus = RKPulseStatusVacant;
     uint32_t pulseSize = 0;
 
-    switch (client->netDelimiter.type) {
+    switch (type) {
         case RKNetworkPacketTypeBeacon:
             // Ignore beacon
             if (engine->verbose > 1) {
@@ -76,8 +97,8 @@ static int RKRadarRelayRead(RKClient *client) {
             // Queue up the status
             k = *engine->statusIndex;
             status = &engine->statusBuffer[k];
-            ((RKStatus *)(client->userPayload))->flag = status->flag;
-            memcpy(status, client->userPayload, sizeof(RKStatus));
+            ((RKStatus *)payload)->flag = status->flag;
+            memcpy(status, payload, sizeof(RKStatus));
             status->flag = RKStatusFlagReady;
             k = RKNextModuloS(k, engine->radarDescription->statusBufferDepth);
             status = &engine->statusBuffer[k];
@@ -92,7 +113,8 @@ static int RKRadarRelayRead(RKClient *client) {
             // Queue up the health
             k = *engine->healthIndex;
             health = &engine->healthBuffer[k];
-            strncpy(health->string, client->userPayload, RKMaximumStringLength - 1);
+            strncpy(health->string, payload, RKMaximumStringLength - 1);
+            health->i += engine->radarDescription->healthBufferDepth;
             health->flag = RKHealthFlagReady;
             k = RKNextModuloS(k, engine->radarDescription->healthBufferDepth);
             health = &engine->healthBuffer[k];
@@ -109,9 +131,14 @@ static int RKRadarRelayRead(RKClient *client) {
 
         case RKNetworkPacketTypePulseData:
             // Override the status of the payload
-            pulse = (RKPulse *)client->userPayload;
+            pulse = (RKPulse *)payload;
             pulseStatus = pulse->header.s;
-            //rxGateCount = pulse->header.capacity;
+            rxGateCount = pulse->header.gateCount;
+            if (payloadSize < sizeof(RKPulseHeader) + 2 * rxGateCount * sizeof(RKInt16C)) {
+                RKLog("%s Error. Pulse of %s B is too short for %s gates.\n", engine->name,
+                      RKIntegerToCommaStyleString(payloadSize), RKIntegerToCommaStyleString(rxGateCount));
+                break;
+            }
 
             //printf("%s Pulse packet -> %d (remote/local capacity %d / %d).\n", engine->name, *engine->pulseIndex, pulse->header.capacity, localPulseCapacity);
 
@@ -125,15 +152,16 @@ static int RKRadarRelayRead(RKClient *client) {
 
             // Now we get a slot to fill it in
             pulse = RKGetPulseFromBuffer(engine->pulseBuffer, *engine->pulseIndex);
-            memcpy(&pulse->header, client->userPayload, sizeof(RKPulseHeader));
+            memcpy(&pulse->header, payload, sizeof(RKPulseHeader));
 
             pulseSize = pulse->header.gateCount * sizeof(RKInt16C);
 
             c16DataH = RKGetInt16CDataFromPulse(pulse, 0);
             c16DataV = RKGetInt16CDataFromPulse(pulse, 1);
 
-            memcpy(c16DataH, client->userPayload + sizeof(RKPulseHeader), pulseSize);
-            memcpy(c16DataV, client->userPayload + sizeof(RKPulseHeader) + pulseSize, pulseSize);
+            // The V samples follow all of the remote H samples
+            memcpy(c16DataH, payload + sizeof(RKPulseHeader), pulseSize);
+            memcpy(c16DataV, payload + sizeof(RKPulseHeader) + rxGateCount * sizeof(RKInt16C), pulseSize);
 
             // Restore the pulse status
             pulse->header.s = pulseStatus;
@@ -145,8 +173,15 @@ static int RKRadarRelayRead(RKClient *client) {
 
         case RKNetworkPacketTypeRayDisplay:
             // Override the status of the payload
-            ray = (RKRay *)client->userPayload;
+            ray = (RKRay *)payload;
             rxGateCount = ray->header.gateCount;
+            productList = ray->header.productList & RKProductListUInt8ZVWDPRKSQ;
+            productCount = __builtin_popcount(productList);
+            if (payloadSize < sizeof(RKRayHeader) + productCount * rxGateCount * sizeof(uint8_t)) {
+                RKLog("%s Error. Ray of %s B is too short for %d x %s gates.\n", engine->name,
+                      RKIntegerToCommaStyleString(payloadSize), productCount, RKIntegerToCommaStyleString(rxGateCount));
+                break;
+            }
 
             //printf("%s Display packet -> %d (remote/local capacity %d / %d).\n", engine->name, *engine->rayIndex, ray->header.capacity, localRayCapacity);
 
@@ -158,45 +193,14 @@ static int RKRadarRelayRead(RKClient *client) {
 
             // Now we get a slot to fill it in
             ray = RKGetRayFromBuffer(engine->rayBuffer, *engine->rayIndex);
-            memcpy(&ray->header, client->userPayload, sizeof(RKRayHeader));
-
-            productList = ray->header.productList;
-            productCount = __builtin_popcount(productList);
-            for (j = 0; j < productCount; j++) {
-                if (productList & RKProductListUInt8Z) {
-                    productList ^= RKProductListUInt8Z;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexZ);
-                } else if (productList & RKProductListUInt8V) {
-                    productList ^= RKProductListUInt8V;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexV);
-                } else if (productList & RKProductListUInt8W) {
-                    productList ^= RKProductListUInt8W;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexW);
-                } else if (productList & RKProductListUInt8D) {
-                    productList ^= RKProductListUInt8D;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexD);
-                } else if (productList & RKProductListUInt8P) {
-                    productList ^= RKProductListUInt8P;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexP);
-                } else if (productList & RKProductListUInt8R) {
-                    productList ^= RKProductListUInt8R;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexR);
-                } else if (productList & RKProductListUInt8K) {
-                    productList ^= RKProductListUInt8K;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexK);
-                } else if (productList & RKProductListUInt8Sh) {
-                    productList ^= RKProductListUInt8Sh;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexSh);
-                } else if (productList & RKProductListUInt8Sv) {
-                    productList ^= RKProductListUInt8Sv;
-                    u8Data = RKGetUInt8DataFromRay(ray, RKProductIndexSv);
-                } else {
-                    u8Data = NULL;
-                }
-
-                if (u8Data) {
-                    memcpy(u8Data, client->userPayload + sizeof(RKRayHeader) + j * rxGateCount * sizeof(uint8_t), ray->header.gateCount * sizeof(uint8_t));
-                }
+            memcpy(&ray->header, payload, sizeof(RKRayHeader));
+
+            // The products are in the order of productList, bit k is RKProductIndex k
+            for (j = 0; productList; j++) {
+                productIndex = (RKProductIndex)__builtin_ctz(productList);
+                productList &= productList - 1;
+                u8Data = RKGetUInt8DataFromRay(ray, productIndex);
+                memcpy(u8Data, payload + sizeof(RKRayHeader) + j * rxGateCount * sizeof(uint8_t), ray->header.gateCount * sizeof(uint8_t));
             }
             ray->header.s = RKRayStatusProcessed | RKRayStatusReady;
 
@@ -211,13 +215,18 @@ static int RKRadarRelayRead(RKClient *client) {
         case RKNetworkPacketTypeCommandResponse:
         case RKNetworkPacketTypeControls:
             // Queue up the feedback
-            strncpy(engine->responses[engine->responseIndex], client->userPayload, RKRadarRelayFeedbackCapacity - 1);
+            pthread_mutex_lock(&engine->responseMutex);
+            k = MIN(payloadSize, RKRadarRelayFeedbackCapacity - 1);
+            memcpy(engine->responses[engine->responseIndex], payload, k);
+            engine->responses[engine->responseIndex][k] = '\0';
             engine->responseIndex = RKNextModuloS(engine->responseIndex, RKRadarRelayFeedbackDepth);
+            pthread_cond_broadcast(&engine->responded);
+            pthread_mutex_unlock(&engine->responseMutex);
             break;
 
         case RKNetworkPacketTypeSweepHeader:
             gettimeofday(&engine->sweepTic, NULL);
-            memcpy(&engine->sweepHeaderCache, client->userPayload, sizeof(RKSweepHeader));
+            memcpy(&engine->sweepHeaderCache, payload, sizeof(RKSweepHeader));
             memcpy(&engine->configBuffer[*engine->configIndex], &engine->sweepHeaderCache.config, sizeof(RKConfig));
             *engine->configIndex = RKNextModuloS(*engine->configIndex, engine->radarDescription->configBufferDepth);
             engine->sweepRayIndex = 0;
@@ -240,7 +249,7 @@ static int RKRadarRelayRead(RKClient *client) {
             break;
 
         default:
-            RKLog("%s New type %d of size %s\n", engine->name, client->netDelimiter.type, RKIntegerToCommaStyleString(client->netDelimiter.size));
+            RKLog("%s New type %d of size %s\n", engine->name, type, RKIntegerToCommaStyleString(payloadSize));
             break;
     }
 
@@ -249,6 +258,50 @@ static int RKRadarRelayRead(RKClient *client) {
     return RKResultSuccess;
 }
 
+// Unpack a relay frame, keep track of the sequence of its channel and handle the payload
+static int RKRadarRelayHandleFrame(RKRadarRelay *engine, void *frameData, const uint32_t frameSize) {
+    RKRelayFrameHeader *frame = (RKRelayFrameHeader *)frameData;
+    uint8_t *payload = (uint8_t *)frameData + sizeof(RKRelayFrameHeader);
+    uint32_t payloadSize = frameSize - sizeof(RKRelayFrameHeader);
+
+    if (frameSize < sizeof(RKRelayFrameHeader) || frame->channel >= RKRelayChannelCount) {
+        RKLog("%s Error. Invalid relay frame of %s B.\n", engine->name, RKIntegerToCommaStyleString(frameSize));
+        return RKResultIncompleteReceive;
+    }
+    if (frame->codec != RKNetworkCodecNone) {
+        if (RKNetworkDecode(engine->decodedPayload, RKMaximumPacketSize, payload, payloadSize, frame->stride, frame->codec) != frame->decodedSize) {
+            RKLog("%s Error. Unable to decode a frame of channel %d (%s).\n", engine->name, frame->channel, RKNetworkCodecString(frame->codec));
+            return RKResultIncompleteReceive;
+        }
+        payload = engine->decodedPayload;
+        payloadSize = frame->decodedSize;
+    }
+    const RKRelayChannel c = frame->channel;
+    if (engine->frameCounts[c] && frame->sequence != engine->sequences[c]) {
+        const int64_t gap = (int64_t)(frame->sequence - engine->sequences[c]);
+        if (gap > 0) {
+            engine->gapCounts[c] += gap;
+        }
+        if (engine->verbose > 1) {
+            RKLog("%s Channel %d expected %llu, got %llu.\n", engine->name, c,
+                  (unsigned long long)engine->sequences[c], (unsigned long long)frame->sequence);
+        }
+    }
+    engine->sequences[c] = frame->sequence + 1;
+    engine->frameCounts[c]++;
+    return RKRadarRelayHandlePayload(engine, frame->type, payload, payloadSize);
+}
+
+static int RKRadarRelayRead(RKClient *client) {
+    // The shared user resource pointer
+    RKRadarRelay *engine = (RKRadarRelay *)client->userResource;
+
+    if (client->netDelimiter.type == RKNetworkPacketTypeRelayFrame) {
+        return RKRadarRelayHandleFrame(engine, client->userPayload, client->netDelimiter.size);
+    }
+    return RKRadarRelayHandlePayload(engine, client->netDelimiter.type, client->userPayload, client->netDelimiter.size);
+}
+
 #pragma mark - Delegate Workers
 
 static void *radarRelay(void *in) {
@@ -316,13 +369,27 @@ RKRadarRelay *RKRadarRelayInit(void) {
     sprintf(engine->name, "%s<SmartRadarRelay>%s",
             rkGlobalParameters.showColor ? RKGetBackgroundColorOfIndex(RKEngineColorRadarRelay) : "",
             rkGlobalParameters.showColor ? RKNoColor : "");
-    engine->memoryUsage += sizeof(RKRadarRelay);
+    engine->decodedPayload = (uint8_t *)malloc(RKMaximumPacketSize);
+    if (engine->decodedPayload == NULL) {
+        RKLog("Error. Unable to allocate a buffer for the radar relay.\n");
+        free(engine);
+        return NULL;
+    }
+    for (int k = 0; k < RKRelayChannelCount; k++) {
+        engine->priorities[k] = k;
+    }
+    pthread_mutex_init(&engine->responseMutex, NULL);
+    pthread_cond_init(&engine->responded, NULL);
+    engine->memoryUsage += sizeof(RKRadarRelay) + RKMaximumPacketSize;
     engine->state = RKEngineStateAllocated;
 
     return (RKRadarRelay *)engine;
 }
 
 void RKRadarRelayFree(RKRadarRelay *engine) {
+    pthread_cond_destroy(&engine->responded);
+    pthread_mutex_destroy(&engine->responseMutex);
+    free(engine->decodedPayload);
     free(engine);
 }
 
@@ -357,6 +424,16 @@ void RKRadarRelaySetHost(RKRadarRelay *engine, const char *hostname) {
     strncpy(engine->host, hostname, RKNameLength - 1);
 }
 
+void RKRadarRelaySetCodec(RKRadarRelay *engine, const RKNetworkCodec codec) {
+    engine->codec = codec < RKNetworkCodecCount ? codec : RKNetworkCodecNone;
+}
+
+void RKRadarRelaySetChannelPriority(RKRadarRelay *engine, const RKRelayChannel channel, const uint8_t priority) {
+    if (channel < RKRelayChannelCount) {
+        engine->priorities[channel] = MIN(priority, RKRelayChannelCount - 1);
+    }
+}
+
 #pragma mark - Interactions
 
 int RKRadarRelayStart(RKRadarRelay *engine) {
@@ -395,7 +472,15 @@ int RKRadarRelayStop(RKRadarRelay *engine) {
     pthread_join(engine->tidBackground, NULL);
     engine->state ^= RKEngineStateDeactivating;
     if (engine->verbose) {
-        RKLog("%s Stopped.\n", engine->name);
+        RKLog("%s Stopped.   frames = %s / %s / %s / %s   gaps = %s / %s / %s / %s\n", engine->name,
+              RKUIntegerToCommaStyleString(engine->frameCounts[RKRelayChannelStatus]),
+              RKUIntegerToCommaStyleString(engine->frameCounts[RKRelayChannelHealth]),
+              RKUIntegerToCommaStyleString(engine->frameCounts[RKRelayChannelRay]),
+              RKUIntegerToCommaStyleString(engine->frameCounts[RKRelayChannelPulse]),
+              RKUIntegerToCommaStyleString(engine->gapCounts[RKRelayChannelStatus]),
+              RKUIntegerToCommaStyleString(engine->gapCounts[RKRelayChannelHealth]),
+              RKUIntegerToCommaStyleString(engine->gapCounts[RKRelayChannelRay]),
+              RKUIntegerToCommaStyleString(engine->gapCounts[RKRelayChannelPulse]));
     }
     if (engine->state != (RKEngineStateAllocated | RKEngineStateProperlyWired)) {
         RKLog("%s Inconsistent state 0x%04x\n", engine->name, engine->state);
@@ -420,21 +505,21 @@ int RKRadarRelayExec(RKRadarRelay *engine, const char *command, char *response)
             }
             return RKResultIncompleteReceive;
         }
-        int s = 0;
+        int r = 0;
+        struct timespec deadline;
+        pthread_mutex_lock(&engine->responseMutex);
         uint32_t responseIndex = engine->responseIndex;
         uint32_t size = snprintf(engine->latestCommand, RKMaximumCommandLength, "%s" RKEOL, command);
         RKNetworkSendPackets(client->sd, engine->latestCommand, size, NULL);
-        while (responseIndex == engine->responseIndex) {
-            usleep(10000);
-            if (++s % 100 == 0) {
-                RKLog("%s Waited %.2f s for response.\n", client->name, (float)s * 0.01f);
-            }
-            if ((float)s * 0.01f >= 3.0f) {
-                RKLog("%s should time out.\n", client->name);
-                break;
-            }
+        // The reader signals as soon as the response is queued
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += RKRadarRelayResponseTimeout;
+        while (responseIndex == engine->responseIndex && r == 0) {
+            r = pthread_cond_timedwait(&engine->responded, &engine->responseMutex, &deadline);
         }
         if (responseIndex == engine->responseIndex) {
+            pthread_mutex_unlock(&engine->responseMutex);
+            RKLog("%s No response to '%s' in %d s.\n", client->name, command, RKRadarRelayResponseTimeout);
             if (response != NULL) {
                 sprintf(response, "NAK. Timeout." RKEOL);
             }
@@ -443,6 +528,7 @@ int RKRadarRelayExec(RKRadarRelay *engine, const char *command, char *response)
         if (response != NULL) {
             strcpy(response, engine->responses[responseIndex]);
         }
+        pthread_mutex_unlock(&engine->responseMutex);
     }
     return RKResultSuccess;
 }
@@ -451,7 +537,7 @@ int RKRadarRelayUpdateStreams(RKRadarRelay *engine, RKStream newStream) {
     char command[RKMaximumStringLength];
     if (engine->streams != newStream) {
         engine->streams = newStream;
-        sprintf(command, "s%s", RKStringOfStream(newStream));
+        RKRadarRelayMakeRelayCommand(engine, command);
         RKRadarRelayExec(engine, command, NULL);
     }
     return RKResultSuccess;
@@ -11,6 +11,7 @@
 // Internal Functions
 
 static void RKRawDataRecorderUpdateStatusString(RKRawDataRecorder *);
+static void RKRawDataRecorderEnterDegradedMode(RKRawDataRecorder *, const ssize_t, const size_t);
 static void *pulseRecorder(void *);
 
 #pragma mark - Helper Functions
@@ -29,16 +30,51 @@ static void RKRawDataRecorderUpdateStatusString(RKRawDataRecorder *engine) {
     // Use RKStatusBarWidth characters to draw a bar
     i = *engine->pulseIndex * RKStatusBarWidth / engine->radarDescription->pulseBufferDepth;
     memset(string, '.', RKStatusBarWidth);
-    string[i] = 'F';
+    string[i] = __atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE) ? 'X' : 'F';
 
     // Engine lag
-    snprintf(string + RKStatusBarWidth, RKStatusStringLength - RKStatusBarWidth, " %s%02.0f%s",
-             rkGlobalParameters.showColor ? RKColorLag(engine->lag) : "",
-             99.49f * engine->lag,
-             rkGlobalParameters.showColor ? RKNoColor : "");
+    i = RKStatusBarWidth;
+    i += snprintf(string + i, RKStatusStringLength - i, " %s%02.0f%s",
+                  rkGlobalParameters.showColor ? RKColorLag(engine->lag) : "",
+                  99.49f * engine->lag,
+                  rkGlobalParameters.showColor ? RKNoColor : "");
+
+    // Dropped pulses while degraded
+    if (__atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE)) {
+        snprintf(string + i, RKStatusStringLength - i, " %sD%s%s",
+                 rkGlobalParameters.showColor ? RKBaseRedColor : "",
+                 RKIntegerToCommaStyleString(engine->droppedPulseCount),
+                 rkGlobalParameters.showColor ? RKNoColor : "");
+    }
     engine->statusBufferIndex = RKNextModuloS(engine->statusBufferIndex, RKBufferSSlotCount);
 }
 
+static void RKRawDataRecorderEnterDegradedMode(RKRawDataRecorder *engine, const ssize_t writtenSize, const size_t size) {
+    // A short write to a regular file without an error is almost always a full disk
+    engine->lastErrno = writtenSize < 0 ? errno : ENOSPC;
+    engine->writeErrorCount++;
+    engine->cacheWriteIndex = 0;
+    gettimeofday(&engine->degradedTime, NULL);
+    if (engine->fileManager) {
+        engine->fileManagerRemoveCount = __atomic_load_n(&engine->fileManager->removeCount, __ATOMIC_ACQUIRE);
+    }
+    if (engine->fd > 0) {
+        engine->filePartial = true;
+    }
+    if (__atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_store_n(&engine->degraded, true, __ATOMIC_RELEASE);
+    RKLog("%s Error in write().   writtenSize = %s / %s   errno = %s\n", engine->name,
+          RKIntegerToCommaStyleString((long long)writtenSize),
+          RKIntegerToCommaStyleString((long long)size),
+          strerror(engine->lastErrno));
+    RKLog("%s %sDegraded%s. Pulses will be dropped until writing succeeds again (retry in %.1f s).\n", engine->name,
+          rkGlobalParameters.showColor ? RKOrangeColor : "",
+          rkGlobalParameters.showColor ? RKNoColor : "",
+          engine->retryPeriod);
+}
+
 #pragma mark - Delegate Workers
 
 static void *pulseRecorder(void *in) {
@@ -129,6 +165,11 @@ static void *pulseRecorder(void *in) {
         // Consider we are writing to a file at this point
         engine->state |= RKEngineStateWritingFile;
 
+        // While degraded, try again after a while or when the file manager has freed up some space; start a new file if so
+        if (__atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE) && RKRawDataRecorderTryRecover(engine)) {
+            n = (int)engine->maximumRecordDepth;
+        }
+
         // Assess the configIndex, or if we reached the maximum pulse count for a file; or when user just decided to start/stop recording
         if (j != pulse->header.configIndex || n >= engine->maximumRecordDepth || record != engine->record) {
             j = pulse->header.configIndex;
@@ -140,9 +181,9 @@ static void *pulseRecorder(void *in) {
                 len += RKRawDataRecorderCacheFlush(engine);
                 RKRawDataRecorderCloseFile(engine);
                 // RKLog("%s len = %s\n", engine->name, RKIntegerToCommaStyleString(len));
-                // Notify file manager of a new addition
-                if (engine->fileManager) {
-                    RKFileManagerAddFile(engine->fileManager, filename, RKFileTypeIQ);
+                // Notify file manager of a new addition, a partial file has been renamed
+                if (engine->fileManager && engine->fileWriteCount) {
+                    RKFileManagerAddFile(engine->fileManager, engine->filename, RKFileTypeIQ);
                 }
             } else {
                 if (strlen(filename)) {
@@ -201,7 +242,8 @@ static void *pulseRecorder(void *in) {
                 }
             } else {
                 len = sizeof(RKFileHeader) + sizeof(RKWaveFileGlobalHeader);
-                for (i = 0; i < waveform->count; i++) {
+                // A relay has no waveform of its own
+                for (i = 0; waveform && i < waveform->count; i++) {
                     len += waveform->filterCounts[i] * sizeof(RKFilterAnchor);
                     len += waveform->depth * sizeof(RKComplex);
                     len += waveform->depth * sizeof(RKInt16C);
@@ -210,7 +252,9 @@ static void *pulseRecorder(void *in) {
         }
 
         // Pulse to write cache
-        if (engine->record && engine->fd) {
+        if (engine->record && __atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE)) {
+            __atomic_add_fetch(&engine->droppedPulseCount, 1, __ATOMIC_RELAXED);
+        } else if (engine->record && engine->fd) {
             if (fileHeader->dataType == RKRawDataTypeFromTransceiver) {
                 len += RKRawDataRecorderCacheWrite(engine, &pulse->header, sizeof(RKPulseHeader));
                 len += RKRawDataRecorderCacheWrite(engine, RKGetInt16CDataFromPulse(pulse, 0), pulse->header.gateCount * sizeof(RKInt16C));
@@ -291,6 +335,7 @@ RKRawDataRecorder *RKRawDataRecorderInit(void) {
     engine->state = RKEngineStateAllocated;
     engine->rawDataType = RKRawDataTypeAfterMatchedFilter;
     engine->maximumRecordDepth = RKRawDataRecorderDefaultMaximumRecorderDepth;
+    engine->retryPeriod = RKRawDataRecorderDefaultRetryPeriod;
     engine->memoryUsage = sizeof(RKRawDataRecorder) + engine->cacheSize;
     return engine;
 }
@@ -333,6 +378,10 @@ void RKRawDataRecorderSetMaximumRecordDepth(RKRawDataRecorder *engine, const uin
     engine->maximumRecordDepth = depth;
 }
 
+void RKRawDataRecorderSetRetryPeriod(RKRawDataRecorder *engine, const double period) {
+    engine->retryPeriod = period;
+}
+
 void RKRawDataRecorderSetCacheSize(RKRawDataRecorder *engine, uint32_t size) {
     if (engine->cacheSize == size) {
         return;
@@ -414,12 +463,15 @@ int RKRawDataRecorderNewFile(RKRawDataRecorder *engine, const char *filename) {
     engine->fd = open(engine->filename, O_CREAT | O_WRONLY, 0000644);
     if (engine->fd < 0) {
         RKLog("%s Error. Failed to open file %s\n", engine->name, engine->filename);
+        RKRawDataRecorderEnterDegradedMode(engine, -1, 0);
+        engine->fd = 0;
         return RKResultFailedToOpenFile;
     }
     engine->fileWriteSize = 0;
     engine->filePulseCount = 0;
     engine->fileWriteCount = 0;
     engine->cacheWriteIndex = 0;
+    engine->filePartial = false;
     return RKResultSuccess;
 }
 
@@ -443,6 +495,17 @@ int RKRawDataRecorderCloseFileVerbose(RKRawDataRecorder *engine, int verbose) {
     }
     if (engine->fileWriteCount == 0) {
         remove(engine->filename);
+    } else if (engine->filePartial) {
+        // A file that has lost data should not look like a complete one
+        char partname[sizeof(engine->filename) + 8];
+        snprintf(partname, sizeof(partname), "%s.part", engine->filename);
+        if (strlen(partname) < sizeof(engine->filename) && rename(engine->filename, partname) == 0) {
+            RKLog("%s Warning. Incomplete file renamed to %s\n", engine->name, partname);
+            memcpy(engine->filename, partname, strlen(partname) + 1);
+        } else {
+            RKLog("%s Error. Unable to rename incomplete file %s   errno = %d\n", engine->name, engine->filename, errno);
+        }
+        engine->filePartial = false;
     }
     return RKResultSuccess;
 }
@@ -461,7 +524,7 @@ int RKRawDataRecorderIncreasePulseCount(RKRawDataRecorder *engine) {
 }
 
 size_t RKRawDataRecorderCacheWrite(RKRawDataRecorder *engine, const void *payload, const size_t size) {
-    if (size == 0) {
+    if (size == 0 || __atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE)) {
         return 0;
     }
     size_t remainingSize = size;
@@ -475,24 +538,29 @@ size_t RKRawDataRecorderCacheWrite(RKRawDataRecorder *engine, const void *payloa
     // Then, the last part of the payload (starting lastChunkSize) should go into the cache. Otherwise, just
     // write out the remainig payload entirely, leaving the cache empty.
     //
+    // Write errors do not terminate the process. The engine enters the degraded mode, the cache is discarded
+    // and subsequent writes are skipped until RKRawDataRecorderTryRecover() allows another attempt.
+    //
     if (engine->cacheWriteIndex + remainingSize >= engine->cacheSize) {
         lastChunkSize = engine->cacheSize - engine->cacheWriteIndex;
         memcpy(engine->cache + engine->cacheWriteIndex, payload, lastChunkSize);
         remainingSize = size - lastChunkSize;
         returnSize = write(engine->fd, engine->cache, engine->cacheSize);
-        if (returnSize < 0) {
-            RKLog("%s Error in write().   writtenSize = %s / %s   errno = %s\n", engine->name,
-                RKIntegerToCommaStyleString((long long)writtenSize),
-                RKIntegerToCommaStyleString((long long)engine->cacheSize),
-                strerror(errno));
-            exit(EXIT_FAILURE);
+        if (returnSize < (ssize_t)engine->cacheSize) {
+            RKRawDataRecorderEnterDegradedMode(engine, returnSize, engine->cacheSize);
+            return 0;
         }
         writtenSize = returnSize;
         engine->fileWriteCount++;
         engine->cacheFlushCount++;
         engine->cacheWriteIndex = 0;
         if (remainingSize >= engine->cacheSize) {
-            writtenSize += write(engine->fd, (char *)(payload + lastChunkSize), remainingSize);
+            returnSize = write(engine->fd, (char *)(payload + lastChunkSize), remainingSize);
+            if (returnSize < (ssize_t)remainingSize) {
+                RKRawDataRecorderEnterDegradedMode(engine, returnSize, remainingSize);
+                return writtenSize;
+            }
+            writtenSize += returnSize;
             engine->fileWriteCount++;
             return writtenSize;
         }
@@ -504,7 +572,7 @@ size_t RKRawDataRecorderCacheWrite(RKRawDataRecorder *engine, const void *payloa
 }
 
 size_t RKRawDataRecorderCacheFlush(RKRawDataRecorder *engine) {
-    if (engine->cacheWriteIndex == 0) {
+    if (engine->cacheWriteIndex == 0 || __atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE)) {
         return 0;
     }
     if (engine->fd <= 0) {
@@ -512,15 +580,31 @@ size_t RKRawDataRecorderCacheFlush(RKRawDataRecorder *engine) {
         return 0;
     }
     ssize_t writtenSize = write(engine->fd, engine->cache, engine->cacheWriteIndex);
-    if (writtenSize < 0) {
-        RKLog("%s Error in write().   writtenSize = %s / %s   errno = %s\n", engine->name,
-              RKIntegerToCommaStyleString((long long)writtenSize),
-              RKIntegerToCommaStyleString((long long)engine->cacheWriteIndex),
-              strerror(errno));
-        exit(EXIT_FAILURE);
+    if (writtenSize < (ssize_t)engine->cacheWriteIndex) {
+        RKRawDataRecorderEnterDegradedMode(engine, writtenSize, engine->cacheWriteIndex);
+        return 0;
     }
     engine->fileWriteSize += writtenSize;
     engine->cacheWriteIndex = 0;
     engine->fileWriteCount++;
     return writtenSize;
 }
+
+bool RKRawDataRecorderTryRecover(RKRawDataRecorder *engine) {
+    if (!__atomic_load_n(&engine->degraded, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    bool spaceFreed = engine->fileManager && __atomic_load_n(&engine->fileManager->removeCount, __ATOMIC_ACQUIRE) != engine->fileManagerRemoveCount;
+    if (!spaceFreed && RKTimevalDiff(now, engine->degradedTime) < engine->retryPeriod) {
+        return false;
+    }
+    RKLog("%s Retrying%s ...   errors = %s   dropped = %s pulses\n", engine->name,
+          spaceFreed ? " after file removal" : "",
+          RKIntegerToCommaStyleString(engine->writeErrorCount),
+          RKIntegerToCommaStyleString(engine->droppedPulseCount));
+    engine->cacheWriteIndex = 0;
+    __atomic_store_n(&engine->degraded, false, __ATOMIC_RELEASE);
+    return true;
+}
@@ -9,13 +9,20 @@
 //
 
 #include <RadarKit/RKServer.h>
+#include <RadarKit/RKWebSocket.h>
+#if defined(RKServerHasZeroCopy)
+#include <linux/errqueue.h>
+#endif
+
+#define RKServerEventKeyListen            UINT64_MAX
+#define RKServerEventKeyWake              (UINT64_MAX - 1)
+#define RKServerEventKeyListenWebSocket   (UINT64_MAX - 2)
 
 // Internal function definitions
 
 void *RKServerRoutine(void *);
-void *RKOperatorRoutine(void *);
-void *RKOperatorCommandRoutine(void *);
-RKOperator *RKOperatorCreate(RKServer *, int, const char *);
+void *RKServerWorkerRoutine(void *);
+RKOperator *RKOperatorCreate(RKServer *, int, const char *, const bool);
 void RKOperatorFree(RKOperator *);
 int RKDefaultWelcomeHandler(RKOperator *);
 int RKDefaultTerminateHandler(RKOperator *);
@@ -25,320 +32,922 @@ int RKDefaultTerminateHandler(RKOperator *);
 #pragma mark -
 #pragma mark Private functions
 
-void *RKServerRoutine(void *in) {
-    RKServer *M = (RKServer *)in;
+static int RKServerSetNonBlocking(const int sd) {
+    int flags = fcntl(sd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(sd, F_SETFL, flags | O_NONBLOCK);
+}
 
-    M->state = RKServerStateOpening;
+// Keep the backlog of a slow client in the write queue, where the handlers can see it, rather than in the kernel
+static void RKServerSetNotSentLowWater(const int sd) {
+    #if defined(TCP_NOTSENT_LOWAT)
+    const int bytes = RKServerNotSentLowWater;
+    setsockopt(sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &bytes, sizeof(bytes));
+    #endif
+}
 
-    // Create the socket
-    if ((M->sd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        RKLog("%s failed at socket().\n", M->name);
-        M->state = RKServerStateNull;
-        return NULL;
+// Let the socket take MSG_ZEROCOPY, returns true if it does
+static bool RKServerSetZeroCopy(const int sd) {
+    #if defined(RKServerHasZeroCopy)
+    const int one = 1;
+    return setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+    #else
+    return false;
+    #endif
+}
+
+// Collect the completions of the zero-copy sends from the error queue of the socket, returns true if
+// the socket has no other error. The caller must hold O->lock
+static bool RKOperatorReapZeroCopyLocked(RKOperator *O) {
+    #if defined(RKServerHasZeroCopy)
+    int error = 0;
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct sock_extended_err *ee;
+    socklen_t size = sizeof(error);
+    while (O->zeroCopySent != O->zeroCopyDone) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(O->sid, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+            ee = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // Notifications cover the range [ee_info, ee_data] of the send calls
+            O->zeroCopyDone = ee->ee_data + 1;
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                // The kernel copied anyway, e.g., loopback, the notifications are pure overhead
+                O->zeroCopy = false;
+            }
+        }
     }
+    return getsockopt(O->sid, SOL_SOCKET, SO_ERROR, &error, &size) == 0 && error == 0;
+    #else
+    return false;
+    #endif
+}
 
-    int ii, k;
-    struct sockaddr_in sa;
-    socklen_t sa_len = sizeof(struct sockaddr_in);
+static inline uint64_t RKServerEventKeyOfOperator(const RKOperator *O) {
+    return (uint64_t)O->sid << 32 | (uint32_t)O->iid;
+}
 
-    sa.sin_family = AF_INET;
-    sa.sin_addr.s_addr = INADDR_ANY;
-    sa.sin_port = htons(M->port);
+// Wake up the event loop, e.g., a write queue has something new or a stalled receive buffer has room again
+static void RKServerWake(RKServer *M) {
+    const uint8_t c = 1;
+    if (write(M->wakeFds[1], &c, 1) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        RKLog("%s Error. Unable to wake up the event loop.   errno = %d (%s)\n", M->name, errno, RKErrnoString(errno));
+    }
+}
 
-    // Avoid "Address already in use" error
-    ii = 1;
-    if (setsockopt(M->sd, SOL_SOCKET, SO_REUSEADDR, &ii, sizeof(ii)) == -1) {
-        RKLog("%s Error. Failed at setsockopt().\n", M->name);
-        M->state = RKServerStateNull;
-        return NULL;
+// Wake up the workers, e.g., new bytes have arrived or a write queue has been drained
+static void RKServerPostWork(RKServer *M) {
+    pthread_mutex_lock(&M->workLock);
+    pthread_cond_broadcast(&M->workPosted);
+    pthread_mutex_unlock(&M->workLock);
+}
+
+static int RKServerWatch(RKServer *M, RKOperator *O) {
+#if defined(__linux__)
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.u64 = RKServerEventKeyOfOperator(O)
+    };
+    return epoll_ctl(M->efd, EPOLL_CTL_ADD, O->sid, &event);
+#else
+    // The poll() set is rebuilt from the operators every cycle
+    return 0;
+#endif
+}
+
+static void RKServerUnwatch(RKServer *M, RKOperator *O) {
+#if defined(__linux__)
+    struct epoll_event event;
+    epoll_ctl(M->efd, EPOLL_CTL_DEL, O->sid, &event);
+#endif
+}
+
+static int RKOperatorQueueLocked(RKOperator *, const void *, const size_t);
+static void RKOperatorFlushLocked(RKOperator *);
+
+// Number of bytes in the receive buffer that the handlers may take. The caller must hold O->lock
+static inline size_t RKOperatorAvailableLocked(const RKOperator *O) {
+    return O->webSocket ? O->rxDecoded : O->rxSize;
+}
+
+// Remove the first size bytes from the receive buffer. The caller must hold O->lock
+static void RKOperatorConsumeLocked(RKOperator *O, const size_t size) {
+    O->rxSize -= size;
+    memmove(O->rx, O->rx + size, O->rxSize);
+    if (O->webSocket) {
+        O->rxDecoded -= size;
+    }
+    if (O->rxStalled) {
+        O->rxStalled = false;
+        RKServerWake(O->M);
     }
+}
 
-    // Bind
-    if (bind(M->sd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
-        RKLog("%s Error. Failed at bind().\n", M->name);
-        M->state = RKServerStateNull;
-        close(M->sd);
-        return NULL;
+// Header of an unmasked, final frame from the server, returns the header length
+static size_t RKServerFrameHeader(uint8_t *header, const RFC6455_OPCODE opcode, const size_t size) {
+    size_t k = 2;
+    header[0] = 0x80 | opcode;
+    if (size < 126) {
+        header[1] = (uint8_t)size;
+    } else if (size < 65536) {
+        header[1] = 126;
+        header[2] = (uint8_t)(size >> 8);
+        header[3] = (uint8_t)size;
+        k = 4;
+    } else {
+        header[1] = 127;
+        for (k = 2; k < 10; k++) {
+            header[k] = (uint8_t)(size >> (8 * (9 - k)));
+        }
     }
+    return k;
+}
 
-    // Listen
-    if (listen(M->sd, M->maxClient + 1) < 0) {
-        RKLog("%s Error. Failed at listen().\n", M->name);
-        M->state = RKServerStateNull;
-        return NULL;
+// Queue a frame from the server. The caller must hold O->lock
+static int RKOperatorQueueFrameLocked(RKOperator *O, const RFC6455_OPCODE opcode, const void *payload, const size_t size) {
+    uint8_t header[RKWebSocketFrameHeaderSize];
+    size_t k = RKServerFrameHeader(header, opcode, size);
+    if (RKOperatorQueueLocked(O, header, k) != RKResultSuccess ||
+        (size && RKOperatorQueueLocked(O, payload, size) != RKResultSuccess)) {
+        return RKResultIncompleteSend;
     }
+    return RKResultSuccess;
+}
 
-    if (M->verbose) {
-        RKLog("%s sd = %d   port = %d\n", M->name, M->sd, M->port);
-    } else {
-        RKLog("%s listening to port %d\n", M->name, M->port);
+// Answer the upgrade request once it is complete. The caller must hold O->lock
+static void RKOperatorHandshakeLocked(RKOperator *O) {
+    RKServer *M = O->M;
+    char request[RKServerHandshakeSize + 1];
+    char response[256];
+    char digest[64];
+    char key[64];
+    char *c, *e;
+    size_t k;
+
+    e = memmem(O->rx, O->rxSize, "\r\n\r\n", 4);
+    if (e == NULL) {
+        if (O->rxSize >= RKServerHandshakeSize) {
+            RKLog("%s %s Error. WebSocket request is too long.\n", M->name, O->name);
+            O->peerClosed = true;
+        }
+        return;
+    }
+    k = e - (char *)O->rx + 4;
+    if (k > RKServerHandshakeSize) {
+        RKLog("%s %s Error. WebSocket request is too long.\n", M->name, O->name);
+        O->peerClosed = true;
+        return;
+    }
+    memcpy(request, O->rx, k);
+    request[k] = '\0';
+    O->rxSize -= k;
+    memmove(O->rx, O->rx + k, O->rxSize);
+
+    key[0] = '\0';
+    if (strncmp(request, "GET ", 4) == 0 && (c = strcasestr(request, "Sec-WebSocket-Key:")) != NULL) {
+        c += 18;
+        while (*c == ' ') {
+            c++;
+        }
+        k = strcspn(c, " \r\n");
+        // The key is 16 bytes in base64 (RFC 6455 4.2.1), i.e., 22 characters and "=="
+        if (k == 24 && strspn(c, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/") == 22 && !strncmp(c + 22, "==", 2)) {
+            memcpy(key, c, k);
+            key[k] = '\0';
+        }
+    }
+    if (key[0] == '\0') {
+        const char reply[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        RKLog("%s %s Error. Not a WebSocket request or a bad Sec-WebSocket-Key.\n", M->name, O->name);
+        RKOperatorQueueLocked(O, reply, sizeof(reply) - 1);
+        RKOperatorFlushLocked(O);
+        O->peerClosed = true;
+        return;
+    }
+    RKWebSocketMakeAcceptKey(digest, key);
+    k = snprintf(response, sizeof(response),
+                 "HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: %s\r\n\r\n", digest);
+    RKOperatorQueueLocked(O, response, k);
+    RKOperatorFlushLocked(O);
+    O->webSocketOpen = true;
+    if (M->verbose > 1) {
+        RKLog(">%s %s WebSocket handshake completed.\n", M->name, O->name);
+    }
+}
 
+// Unframe the WebSocket messages in place: the payloads are moved to the region [0, rxDecoded)
+// of the receive buffer, which is what the handlers see. A text message is terminated with a
+// new line character so that it can be read as a command. Control frames are answered here.
+// The caller must hold O->lock
+static void RKOperatorUnframeLocked(RKOperator *O) {
+    RKServer *M = O->M;
+    uint8_t *frame, *payload;
+    uint8_t opcode, mask[4];
+    uint16_t code;
+    bool final;
+    uint64_t size;
+    size_t r = O->rxDecoded, k, header;
+
+    if (!O->webSocketOpen) {
+        RKOperatorHandshakeLocked(O);
+        if (!O->webSocketOpen) {
+            return;
+        }
+    }
+    while (!O->peerClosed && O->rxSize - r >= 2) {
+        frame = O->rx + r;
+        opcode = frame[0] & 0x0f;
+        final = frame[0] & 0x80;
+        size = frame[1] & 0x7f;
+        header = 2;
+        if (size == 126) {
+            header = 4;
+        } else if (size == 127) {
+            header = 10;
+        }
+        if (O->rxSize - r < header + 4) {
+            break;
+        }
+        if (header == 4) {
+            size = (uint64_t)frame[2] << 8 | frame[3];
+        } else if (header == 10) {
+            for (size = 0, k = 2; k < 10; k++) {
+                size = size << 8 | frame[k];
+            }
+        }
+        if ((frame[0] & 0x70) || !(frame[1] & 0x80) || size > RKServerReceiveBufferSize - header - 4 ||
+            (opcode >= RFC6455_OPCODE_CLOSE && (size > 125 || !final))) {
+            // Reserved bits without extension, unmasked frame, fragmented control frame, or more than the buffer holds
+            RKLog("%s %s Error. Unexpected WebSocket frame %02x %02x (%s B).\n", M->name, O->name,
+                  frame[0], frame[1], RKIntegerToCommaStyleString(size));
+            code = htons(1002);
+            RKOperatorQueueFrameLocked(O, RFC6455_OPCODE_CLOSE, &code, 2);
+            O->peerClosed = true;
+            break;
+        }
+        memcpy(mask, frame + header, 4);
+        header += 4;
+        if (O->rxSize - r < header + size) {
+            break;
+        }
+        payload = frame + header;
+        for (k = 0; k < size; k++) {
+            payload[k] ^= mask[k & 3];
+        }
+        switch (opcode) {
+            case RFC6455_OPCODE_TEXT:
+            case RFC6455_OPCODE_BINARY:
+                O->rxOpcode = opcode;
+                // fall through
+            case RFC6455_OPCODE_CONTINUATION:
+                // The decoded region always ends before the frame header, so this never overlaps what is next
+                // but it may overwrite this header, which is why the final bit was kept
+                memmove(O->rx + O->rxDecoded, payload, size);
+                O->rxDecoded += size;
+                if (final && O->rxOpcode == RFC6455_OPCODE_TEXT) {
+                    O->rx[O->rxDecoded++] = '\n';
+                }
+                break;
+            case RFC6455_OPCODE_PING:
+                RKOperatorQueueFrameLocked(O, RFC6455_OPCODE_PONG, payload, size);
+                break;
+            case RFC6455_OPCODE_PONG:
+                break;
+            case RFC6455_OPCODE_CLOSE:
+                RKOperatorQueueFrameLocked(O, RFC6455_OPCODE_CLOSE, payload, MIN(size, 2));
+                O->peerClosed = true;
+                break;
+            default:
+                RKLog("%s %s Error. Unknown WebSocket opcode %d.\n", M->name, O->name, opcode);
+                code = htons(1002);
+                RKOperatorQueueFrameLocked(O, RFC6455_OPCODE_CLOSE, &code, 2);
+                O->peerClosed = true;
+                break;
+        }
+        r += header + size;
+    }
+    k = O->rxSize - r;
+    memmove(O->rx + O->rxDecoded, O->rx + r, k);
+    O->rxSize = O->rxDecoded + k;
+    if (O->txSize) {
+        RKOperatorFlushLocked(O);
     }
+}
 
-    M->state = RKServerStateActive;
+// Read everything available from the socket into the receive buffer. Called from the event loop
+static void RKOperatorIngest(RKOperator *O) {
+    ssize_t r;
+    bool received = false;
 
-    int             sid;
-    fd_set          rfd;
-    struct timeval  timeout;
-    const char      busy_msg[] = "Server busy." RKEOL;
-    int             nclient;
+    pthread_mutex_lock(&O->lock);
+    O->rxStalled = false;
+    if (O->webSocket) {
+        // Frames that were waiting for room in the receive buffer
+        RKOperatorUnframeLocked(O);
+    }
+    while (!O->peerClosed) {
+        if (O->rxSize == RKServerReceiveBufferSize) {
+            // Leave the rest in the socket until a worker consumes the buffer
+            O->rxStalled = true;
+            break;
+        }
+        r = recv(O->sid, O->rx + O->rxSize, RKServerReceiveBufferSize - O->rxSize, 0);
+        if (r > 0) {
+            O->rxSize += r;
+            received = true;
+            if (O->webSocket) {
+                RKOperatorUnframeLocked(O);
+            }
+        } else if (r == 0) {
+            O->peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                O->peerClosed = true;
+            }
+            break;
+        }
+    }
+    if (received) {
+        gettimeofday(&O->latestReadTime, NULL);
+    }
+    if (received || O->peerClosed) {
+        pthread_cond_broadcast(&O->received);
+    }
+    pthread_mutex_unlock(&O->lock);
+}
 
-    // Accept connection requests and create and assign an operator for the client
-    while (M->state == RKServerStateActive) {
-        // Use select to prevent accept() from blocking
-        FD_ZERO(&rfd);
-        FD_SET(M->sd, &rfd);
-        timeout.tv_sec = 0; timeout.tv_usec = 100000;
-        ii = select(M->sd + 1, &rfd, NULL, NULL, &timeout);
-        if (ii > 0 && FD_ISSET(M->sd, &rfd)) {
-            // Accept a connection, this part should not be blocked. Reuse sa since we no longer need it
-            if ((sid = accept(M->sd, (struct sockaddr *)&sa, &sa_len)) == -1) {
-                RKLog("%s Error. Failed at accept().\n", M->name);
-                break;
+// Send as much of the write queue as the socket takes. The caller must hold O->lock
+static void RKOperatorFlushLocked(RKOperator *O) {
+    ssize_t r;
+    while (O->txSize > 0) {
+        r = send(O->sid, O->tx + O->txHead, O->txSize, 0);
+        if (r > 0) {
+            O->txHead += r;
+            O->txSize -= r;
+            gettimeofday(&O->latestWriteTime, NULL);
+        } else if (r < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                // Nobody is going to read the rest
+                O->peerClosed = true;
+                O->txSize = 0;
+            }
+            break;
+        }
+    }
+    if (O->txSize == 0) {
+        O->txHead = 0;
+        // Give back the memory of a queue that had to grow for a slow moment of the client
+        if (O->txCapacity > RKServerStreamQueueLimit) {
+            uint8_t *tx = (uint8_t *)realloc(O->tx, RKServerWriteQueueSize);
+            if (tx) {
+                O->tx = tx;
+                O->txCapacity = RKServerWriteQueueSize;
+            }
+        }
+    }
+}
+
+// Append to the write queue. The caller must hold O->lock
+static int RKOperatorQueueLocked(RKOperator *O, const void *payload, const size_t size) {
+    if (O->txHead + O->txSize + size > O->txCapacity) {
+        if (O->txHead) {
+            memmove(O->tx, O->tx + O->txHead, O->txSize);
+            O->txHead = 0;
+        }
+        if (O->txSize + size > O->txCapacity) {
+            size_t capacity = O->txCapacity;
+            while (capacity < O->txSize + size) {
+                capacity *= 2;
+            }
+            if (capacity > RKServerWriteQueueLimit) {
+                return RKResultIncompleteSend;
+            }
+            uint8_t *tx = (uint8_t *)realloc(O->tx, capacity);
+            if (tx == NULL) {
+                return RKResultIncompleteSend;
             }
-            // Count the number of clients, or operators that are busy
-            nclient = 0;
-            for (k = 0; k < M->maxClient; k++) {
-                if (M->busy[k]) {
-                    nclient++;
+            O->tx = tx;
+            O->txCapacity = capacity;
+        }
+    }
+    if (O->txSize == 0) {
+        gettimeofday(&O->latestWriteTime, NULL);
+    }
+    memcpy(O->tx + O->txHead + O->txSize, payload, size);
+    O->txSize += size;
+    return RKResultSuccess;
+}
+
+// Take up to size bytes from the receive buffer, waiting up to timeoutSeconds for them to arrive
+static size_t RKOperatorReceive(RKOperator *O, void *buffer, const size_t size, const int timeoutSeconds) {
+    size_t k = 0, n;
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutSeconds;
+
+    pthread_mutex_lock(&O->lock);
+    while (k < size) {
+        if ((n = RKOperatorAvailableLocked(O)) > 0) {
+            n = MIN(n, size - k);
+            memcpy((uint8_t *)buffer + k, O->rx, n);
+            RKOperatorConsumeLocked(O, n);
+            k += n;
+        } else if (O->peerClosed || pthread_cond_timedwait(&O->received, &O->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&O->lock);
+
+    return k;
+}
+
+// Move the next line of the receive buffer into the command buffer
+static bool RKOperatorGetLine(RKOperator *O) {
+    size_t k, length, available;
+    uint8_t *e;
+    char *str = O->commands[O->commandIndexWrite];
+
+    pthread_mutex_lock(&O->lock);
+    available = RKOperatorAvailableLocked(O);
+    e = (uint8_t *)memchr(O->rx, '\n', available);
+    if (e == NULL && available > 0 && (O->peerClosed || O->rxSize == RKServerReceiveBufferSize)) {
+        // The last line without a new line character, or a line longer than the buffer
+        e = O->rx + available - 1;
+    }
+    if (e == NULL) {
+        pthread_mutex_unlock(&O->lock);
+        return false;
+    }
+    k = e - O->rx + 1;
+    length = MIN(k, RKMaximumCommandLength - 1);
+    memcpy(str, O->rx, length);
+    str[length] = '\0';
+    RKOperatorConsumeLocked(O, k);
+    pthread_mutex_unlock(&O->lock);
+
+    RKStripTail(str);
+    O->commandIndexWrite = O->commandIndexWrite == RKServerBufferDepth - 1 ? 0 : O->commandIndexWrite + 1;
+    memset(O->commands[O->commandIndexWrite], 0, RKMaximumCommandLength);
+    return true;
+}
+
+// Run the handlers of an operator, called from the worker the operator is assigned to
+static void RKOperatorService(RKOperator *O) {
+    RKServer *M = O->M;
+    struct timeval now;
+
+    if (O->state == RKOperatorStateAllocated) {
+        if (O->webSocket && !O->webSocketOpen) {
+            // Nothing for the handlers until the handshake is done, an incomplete one is just dropped
+            gettimeofday(&now, NULL);
+            if (O->peerClosed || RKTimevalDiff(now, O->latestWriteTime) > (double)M->timeoutSeconds) {
+                if (M->verbose) {
+                    RKLog("%s %s WebSocket handshake incomplete.\n", M->name, O->name);
                 }
+                O->state = RKOperatorStateHungUp;
+                RKOperatorFree(O);
             }
-            if (M->verbose) {
-                RKLog("%s Answering %s:%d  (nclient = %d  sd = %d)\n",
-                      M->name, inet_ntoa(sa.sin_addr), sa.sin_port, nclient, sid);
+            return;
+        }
+        O->state = RKOperatorStateActive;
+        RKLog("%s %s Started.   ireq = %d\n", M->name, O->name, M->ireq++);
+        // Greet with welcome function
+        if (M->w != NULL) {
+            M->w(O);
+        }
+    }
+
+    // Command queue, a deferred command stays at the head and is handed to the command handler again next time
+    while (O->state == RKOperatorStateActive && (O->commandIndexRead != O->commandIndexWrite || RKOperatorGetLine(O))) {
+        O->cmd = O->commands[O->commandIndexRead];
+        if (M->c) {
+            if (M->c(O) == RKResultCommandDeferred) {
+                break;
             }
-            if (nclient >= M->maxClient) {
-                RKLog("%s Busy (nclient = #%d)\n", M->name, nclient);
-                send(sid, busy_msg, strlen(busy_msg), 0);
-                close(sid);
-            } else {
-                RKOperator *O = RKOperatorCreate(M, sid, inet_ntoa(sa.sin_addr));
-                M->operators[O->iid] = O;
-            }
-        } else if (ii == 0) {
-            // Not really an error, just mean no one is connecting & timeout...
-            usleep(1000);
-        } else if (ii == -1) {
-            RKLog("%s Error. Failed at select().\n", M->name);
         } else {
-            RKLog("%s Error. At an unknown state.\n", M->name);
+            RKLog("%s No command handler. cmd '%s' from Op-%03d (%s)\n", M->name, O->cmd, O->iid, O->ip);
+        }
+        O->commandIndexRead = O->commandIndexRead == RKServerBufferDepth - 1 ? 0 : O->commandIndexRead + 1;
+    }
+
+    // Stream worker, only when the client has been keeping up
+    if (O->state == RKOperatorStateActive && M->s != NULL && !O->peerClosed && O->txSize < RKServerStreamQueueLimit) {
+        M->s(O);
+    }
+
+    if (O->state == RKOperatorStateActive) {
+        gettimeofday(&now, NULL);
+        if (O->peerClosed) {
+            // When the socket has been disconnected by the client
+            O->cmd = NULL;
+            RKLog("%s %s Client disconnected.\n", M->name, O->name);
+        } else if ((O->txSize > 0 && RKTimevalDiff(now, O->latestWriteTime) > (double)M->timeoutSeconds) ||
+                   ((M->options & RKServerOptionExpectBeacon) && RKTimevalDiff(now, O->latestReadTime) > (double)M->timeoutSeconds)) {
+            RKLog("%s %s Encountered a timeout (%d seconds).\n", M->name, O->name, M->timeoutSeconds);
+        } else {
+            return;
         }
+    } else if (O->state != RKOperatorStateClosing) {
+        return;
+    }
+
+    // Dismiss with a terminate function, the state could also be changed deliberately by RKOperatorHangUp()
+    if (M->t != NULL) {
+        M->t(O);
+    }
+    O->state = RKOperatorStateHungUp;
+    RKOperatorFree(O);
+}
+
+static void RKServerAccept(RKServer *M, const bool webSocket) {
+    int k, sid, nclient;
+    struct sockaddr_in sa;
+    socklen_t sa_len = sizeof(struct sockaddr_in);
+    const char busy_msg[] = "Server busy." RKEOL;
 
-        // Go through all operator to see which one should be freed
+    while (true) {
+        if ((sid = accept(webSocket ? M->webSocketSd : M->sd, (struct sockaddr *)&sa, &sa_len)) == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                RKLog("%s Error. Failed at accept().   errno = %d (%s)\n", M->name, errno, RKErrnoString(errno));
+            }
+            break;
+        }
+        // Count the number of clients, or operators that are busy
+        nclient = 0;
         for (k = 0; k < M->maxClient; k++) {
             if (M->busy[k]) {
-                RKOperator *O = M->operators[k];
-                if (O != NULL && O->state == RKOperatorStateHungUp) {
-                    RKOperatorFree(O);
-                    M->operators[k] = NULL;
-                }
+                nclient++;
             }
         }
-    } // while (M->state == RKServerStateActive) ...
+        if (M->verbose) {
+            RKLog("%s Answering %s:%d%s  (nclient = %d  sd = %d)\n",
+                  M->name, inet_ntoa(sa.sin_addr), sa.sin_port, webSocket ? " (WebSocket)" : "", nclient, sid);
+        }
+        if (nclient >= M->maxClient) {
+            RKLog("%s Busy (nclient = #%d)\n", M->name, nclient);
+            if (!webSocket) {
+                send(sid, busy_msg, strlen(busy_msg), 0);
+            }
+            close(sid);
+        } else {
+            RKServerSetNotSentLowWater(sid);
+            if (M->zeroCopyThreshold) {
+                RKServerSetZeroCopy(sid);
+            }
+            if (RKServerSetNonBlocking(sid) < 0 || RKOperatorCreate(M, sid, inet_ntoa(sa.sin_addr), webSocket) == NULL) {
+                close(sid);
+            }
+        }
+        sa_len = sizeof(struct sockaddr_in);
+    }
+}
 
-    if (M->verbose > 1) {
-        RKLog("%s Returning ...\n", M->name);
+static void RKServerHandleEvent(RKServer *M, const uint64_t key, const bool readable, const bool writable, const bool failed) {
+    int k;
+    uint8_t bytes[64];
+    RKOperator *O;
+
+    if (key == RKServerEventKeyListen || key == RKServerEventKeyListenWebSocket) {
+        RKServerAccept(M, key == RKServerEventKeyListenWebSocket);
+        return;
+    } else if (key == RKServerEventKeyWake) {
+        while (read(M->wakeFds[0], bytes, sizeof(bytes)) > 0) {
+            continue;
+        }
+        // Pick up the stalled receive buffers and the new write queues
+        pthread_mutex_lock(&M->lock);
+        for (k = 0; k < M->maxClient; k++) {
+            if ((O = M->operators[k]) == NULL) {
+                continue;
+            }
+            if (O->rxStalled) {
+                RKOperatorIngest(O);
+            }
+            pthread_mutex_lock(&O->lock);
+            RKOperatorFlushLocked(O);
+            pthread_mutex_unlock(&O->lock);
+        }
+        pthread_mutex_unlock(&M->lock);
+    } else {
+        // The operator could have been freed and the slot reused since the event was queued
+        k = (int)(key & 0xffffffff);
+        pthread_mutex_lock(&M->lock);
+        O = M->operators[k];
+        if (O != NULL && RKServerEventKeyOfOperator(O) == key) {
+            if (readable) {
+                RKOperatorIngest(O);
+            }
+            pthread_mutex_lock(&O->lock);
+            if (writable) {
+                RKOperatorFlushLocked(O);
+            }
+            // The completions of the zero-copy sends also come as an error event
+            if (failed && !(O->zeroCopySent && RKOperatorReapZeroCopyLocked(O))) {
+                O->peerClosed = true;
+                pthread_cond_broadcast(&O->received);
+            }
+            pthread_mutex_unlock(&O->lock);
+        }
+        pthread_mutex_unlock(&M->lock);
     }
+    RKServerPostWork(M);
+}
 
-    M->state = RKServerStateFree;
+// Create a non-blocking socket that listens to a port, returns the socket descriptor or -1
+static int RKServerListen(RKServer *M, const int port) {
+    int sd, ii;
+    struct sockaddr_in sa;
 
-    return NULL;
-}
+    // Create the socket
+    if ((sd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        RKLog("%s failed at socket().\n", M->name);
+        return -1;
+    }
 
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = INADDR_ANY;
+    sa.sin_port = htons(port);
 
-void *RKOperatorRoutine(void *in) {
+    // Avoid "Address already in use" error
+    ii = 1;
+    if (setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &ii, sizeof(ii)) == -1) {
+        RKLog("%s Error. Failed at setsockopt().\n", M->name);
+        close(sd);
+        return -1;
+    }
 
-    RKOperator      *O = (RKOperator *)in;
-    RKServer        *M = O->M;
+    // Bind
+    if (bind(sd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        RKLog("%s Error. Failed at bind().   port = %d\n", M->name, port);
+        close(sd);
+        return -1;
+    }
 
-    int             r;
+    // Listen
+    if (listen(sd, M->maxClient + 1) < 0 || RKServerSetNonBlocking(sd) < 0) {
+        RKLog("%s Error. Failed at listen().\n", M->name);
+        close(sd);
+        return -1;
+    }
 
-    FILE            *fp;
-    fd_set          rfd;
-    fd_set          wfd;
-    fd_set          efd;
+    return sd;
+}
 
-    char            *str;
+void *RKServerRoutine(void *in) {
+    RKServer *M = (RKServer *)in;
 
-    struct timeval  timeout;
-    struct timeval  user_timeout = {M->timeoutSeconds, 0};
-    struct timeval  latestReadTime;
-    struct timeval  latestWriteTime;
+    int ii, k;
 
-    pthread_mutex_init(&O->lock, NULL);
+    M->state = RKServerStateOpening;
 
-    O->state = RKOperatorStateActive;
+    if ((M->sd = RKServerListen(M, M->port)) < 0) {
+        M->state = RKServerStateNull;
+        return NULL;
+    }
+    M->webSocketSd = -1;
+    if (M->webSocketPort > 0 && (M->webSocketSd = RKServerListen(M, M->webSocketPort)) < 0) {
+        M->state = RKServerStateNull;
+        close(M->sd);
+        return NULL;
+    }
 
-    if (pthread_create(&O->tidExecute, NULL, RKOperatorCommandRoutine, O)) {
-        RKLog("%s Error. Failed to create RKOperatorCommandRoutine().\n", M->name);
-        return (void *)RKResultErrorCreatingOperatorCommandRoutine;
+    // Event sources: the listening sockets, a pipe to wake up the loop and, later, the clients
+    if (pipe(M->wakeFds) < 0 || RKServerSetNonBlocking(M->wakeFds[0]) < 0 || RKServerSetNonBlocking(M->wakeFds[1]) < 0) {
+        RKLog("%s Error. Failed to set up the event sources.\n", M->name);
+        M->state = RKServerStateNull;
+        close(M->sd);
+        if (M->webSocketSd >= 0) {
+            close(M->webSocketSd);
+        }
+        return NULL;
     }
 
-    RKLog("%s %s Started.   ireq = %d\n", M->name, O->name, M->ireq++);
+    #if defined(__linux__)
+
+    struct epoll_event events[RKServerEventCount];
+    struct epoll_event event = {.events = EPOLLIN};
 
-    // Greet with welcome function
-    if (M->w != NULL) {
-        M->w(O);
+    if ((M->efd = epoll_create1(0)) < 0) {
+        RKLog("%s Error. Failed at epoll_create1().\n", M->name);
+        M->state = RKServerStateNull;
+        close(M->sd);
+        if (M->webSocketSd >= 0) {
+            close(M->webSocketSd);
+        }
+        return NULL;
     }
+    event.data.u64 = RKServerEventKeyListen;
+    epoll_ctl(M->efd, EPOLL_CTL_ADD, M->sd, &event);
+    if (M->webSocketSd >= 0) {
+        event.data.u64 = RKServerEventKeyListenWebSocket;
+        epoll_ctl(M->efd, EPOLL_CTL_ADD, M->webSocketSd, &event);
+    }
+    event.data.u64 = RKServerEventKeyWake;
+    epoll_ctl(M->efd, EPOLL_CTL_ADD, M->wakeFds[0], &event);
+
+    #else
+
+    RKOperator *O;
+    struct pollfd fds[RKServerMaximumOperators + 3];
+    uint64_t keys[RKServerMaximumOperators + 3];
 
-    // Initialize some time values
-    gettimeofday(&latestReadTime, NULL);
-    gettimeofday(&latestWriteTime, NULL);
+    #endif
 
-    // Get a file descriptor for get line
-    fp = fdopen(O->sid, "r");
-    if (fp == NULL) {
-        RKLog("%s unable to get a file descriptor fro socket descriptor.\n", M->name);
-        return (void *)RKResultSDToFDError;
+    if (M->verbose) {
+        RKLog("%s sd = %d   port = %d   workers = %d\n", M->name, M->sd, M->port, M->workerCount);
+    } else {
+        RKLog("%s listening to port %d\n", M->name, M->port);
+    }
+    if (M->webSocketSd >= 0) {
+        RKLog("%s listening to port %d for WebSocket clients\n", M->name, M->webSocketPort);
     }
 
-    // Run loop for the read/write
-    while (M->state == RKServerStateActive && O->state == RKOperatorStateActive) {
-        //
-        //  Stream worker
-        //
-        FD_ZERO(&wfd);
-        FD_ZERO(&efd);
-        FD_SET(O->sid, &wfd);
-        FD_SET(O->sid, &efd);
-        if (M->s != NULL) {
-            timeout.tv_sec = 0;
-            timeout.tv_usec = RKServerSelectTimeoutUs;
-            r = select(O->sid + 1, NULL, &wfd, &efd, &timeout);
-            if (r > 0) {
-                if (FD_ISSET(O->sid, &efd)) {
-                    // Exceptions
-                    RKLog("%s encountered an exception error.\n", M->name);
-                    break;
-                } else if (FD_ISSET(O->sid, &wfd)) {
-                    // Ready to write (stream)
-                    gettimeofday(&latestWriteTime, NULL);
-                    M->s(O);
-                }
-            } else if (r < 0) {
-                // Errors
-                RKLog("%s Error. Encountered something bad.\n", M->name);
-                break;
-            } else {
-                // Timeout (r == 0)
-                gettimeofday(&timeout, NULL);
-                timersub(&timeout, &user_timeout, &timeout);
-                if (timercmp(&timeout, &latestWriteTime, >=)) {
-                    // Dismiss with a terminate function
-                    RKLog("%s %s Encountered a timeout (%d seconds).\n", M->name, O->name, M->timeoutSeconds);
-                    if (M->t != NULL) {
-                        M->t(O);
-                    }
-                    break;
-                }
-            }
+    // Workers that run the handlers
+    M->workers = (RKServerWorker *)malloc(M->workerCount * sizeof(RKServerWorker));
+    if (M->workers == NULL) {
+        RKLog("%s Error. Unable to allocate the workers.\n", M->name);
+        M->state = RKServerStateNull;
+        #if defined(__linux__)
+        close(M->efd);
+        M->efd = -1;
+        #endif
+        close(M->wakeFds[0]);
+        close(M->wakeFds[1]);
+        close(M->sd);
+        if (M->webSocketSd >= 0) {
+            close(M->webSocketSd);
+            M->webSocketSd = -1;
         }
-        //
-        //  Command queue
-        //
-        FD_ZERO(&rfd);
-        FD_ZERO(&efd);
-        FD_SET(O->sid, &rfd);
-        FD_SET(O->sid, &efd);
-        timeout.tv_sec = 0;
-        timeout.tv_usec = RKServerSelectTimeoutUs;
-        r = select(O->sid + 1, &rfd, NULL, &efd, &timeout);
-        if (r > 0) {
-            if (FD_ISSET(O->sid, &efd)) {
-                // Exceptions
-                RKLog("%s %s Encountered an exception error.\n", M->name, O->name);
-                break;
-            } else if (FD_ISSET(O->sid, &rfd)) {
-                // Ready to read (command)
-                gettimeofday(&latestReadTime, NULL);
-                str = O->commands[O->commandIndexWrite];
-                if (fgets(str, RKMaximumCommandLength - 1, fp) == NULL) {
-                    // When the socket has been disconnected by the client
-                    O->cmd = NULL;
-                    RKLog("%s %s Client disconnected.\n", M->name, O->name);
-                    if (M->t != NULL) {
-                        M->t(O);
-                    }
-                    break;
-                }
-                RKStripTail(str);
-                O->commandIndexWrite = O->commandIndexWrite == RKServerBufferDepth - 1 ? 0 : O->commandIndexWrite + 1;
-                memset(O->commands[O->commandIndexWrite], 0, RKMaximumCommandLength);
-            }
-        } else if (r < 0) {
-            // Errors
-            RKLog("%s %s Error. Encountered an unexpected error.\n", M->name, O->name);
+        return NULL;
+    }
+    memset(M->workers, 0, M->workerCount * sizeof(RKServerWorker));
+
+    M->state = RKServerStateActive;
+
+    for (k = 0; k < M->workerCount; k++) {
+        RKServerWorker *worker = &M->workers[k];
+        worker->id = k;
+        worker->parent = M;
+        snprintf(worker->name, sizeof(RKChildName), "%s %sW%d%s", M->name,
+                 rkGlobalParameters.showColor ? RKGetColorOfIndex(k) : "", k,
+                 rkGlobalParameters.showColor ? RKNoColor : "");
+        if (pthread_create(&worker->tid, NULL, RKServerWorkerRoutine, worker)) {
+            RKLog("%s Error. Failed to create a worker.\n", M->name);
+            M->workerCount = k;
             break;
-        } else if (M->options & RKServerOptionExpectBeacon) {
-            // Timeout (r == 0)
-            gettimeofday(&timeout, NULL);
-            timersub(&timeout, &user_timeout, &timeout);
-            if (timercmp(&timeout, &latestReadTime, >=)) {
-                // Dismiss with a terminate function
-                RKLog("%s %s Encountered a timeout (%d seconds).\n", M->name, O->name, M->timeoutSeconds);
-                if (M->t != NULL) {
-                    M->t(O);
-                }
-                break;
-            }
         }
-    } // while () ...
+    }
 
-    // If the state was changed deliberately by RKOperatorHangUp()
-    if (O->state == RKOperatorStateClosing) {
-        if (M->t != NULL) {
-            M->t(O);
+    // Move bytes between the sockets and the operators, accept connection requests
+    while (M->state == RKServerStateActive) {
+
+        #if defined(__linux__)
+
+        ii = epoll_wait(M->efd, events, RKServerEventCount, 100);
+        for (k = 0; k < ii; k++) {
+            RKServerHandleEvent(M, events[k].data.u64,
+                                events[k].events & (EPOLLIN | EPOLLRDHUP),
+                                events[k].events & EPOLLOUT,
+                                events[k].events & (EPOLLHUP | EPOLLERR));
         }
-    }
 
-    // Set the state if all the 'break' conditions signals the RKOperatorCommandRoutine to quit as well.
-    O->state = RKOperatorStateClosing;
+        #else
 
-    pthread_join(O->tidExecute, NULL);
-    pthread_mutex_destroy(&O->lock);
-    fclose(fp);
+        int count = 0;
+        fds[count].fd = M->sd; fds[count].events = POLLIN; keys[count++] = RKServerEventKeyListen;
+        fds[count].fd = M->wakeFds[0]; fds[count].events = POLLIN; keys[count++] = RKServerEventKeyWake;
+        if (M->webSocketSd >= 0) {
+            fds[count].fd = M->webSocketSd; fds[count].events = POLLIN; keys[count++] = RKServerEventKeyListenWebSocket;
+        }
+        pthread_mutex_lock(&M->lock);
+        for (k = 0; k < M->maxClient; k++) {
+            if ((O = M->operators[k]) != NULL && !O->peerClosed) {
+                fds[count].fd = O->sid;
+                fds[count].events = (O->rxStalled ? 0 : POLLIN) | (O->txSize ? POLLOUT : 0);
+                keys[count++] = RKServerEventKeyOfOperator(O);
+            }
+        }
+        pthread_mutex_unlock(&M->lock);
+        ii = poll(fds, count, 100);
+        for (k = 0; k < count && ii > 0; k++) {
+            if (fds[k].revents) {
+                RKServerHandleEvent(M, keys[k],
+                                    fds[k].revents & POLLIN,
+                                    fds[k].revents & POLLOUT,
+                                    fds[k].revents & (POLLHUP | POLLERR | POLLNVAL));
+            }
+        }
 
-    O->state = RKOperatorStateHungUp;
+        #endif
+
+        if (ii < 0 && errno != EINTR) {
+            RKLog("%s Error. Failed to wait for events.   errno = %d (%s)\n", M->name, errno, RKErrnoString(errno));
+            usleep(100000);
+        }
+    } // while (M->state == RKServerStateActive) ...
+
+    // Workers hang up the remaining operators on their way out
+    RKServerPostWork(M);
+    for (k = 0; k < M->workerCount; k++) {
+        pthread_join(M->workers[k].tid, NULL);
+    }
+    free(M->workers);
+    M->workers = NULL;
+
+    #if defined(__linux__)
+    close(M->efd);
+    M->efd = -1;
+    #endif
+    close(M->wakeFds[0]);
+    close(M->wakeFds[1]);
+    close(M->sd);
+    if (M->webSocketSd >= 0) {
+        close(M->webSocketSd);
+        M->webSocketSd = -1;
+    }
 
     if (M->verbose > 1) {
-        RKLog(">%s %s Operator routine returning ...\n", M->name, O->name);
+        RKLog("%s Returning ...\n", M->name);
     }
 
+    M->state = RKServerStateFree;
+
     return NULL;
 }
 
 
-void *RKOperatorCommandRoutine(void *in) {
+void *RKServerWorkerRoutine(void *in) {
+    RKServerWorker *me = (RKServerWorker *)in;
+    RKServer *M = me->parent;
 
-    RKOperator      *O = (RKOperator *)in;
-    RKServer        *M = O->M;
+    int k;
+    RKOperator *O;
+    struct timespec deadline;
 
-    while (true) {
-        while (O->commandIndexRead == O->commandIndexWrite && M->state == RKServerStateActive && O->state == RKOperatorStateActive) {
-            usleep(10000);
+    if (M->verbose > 1) {
+        RKLog(">%s Started.\n", me->name);
+    }
+
+    // Operators are assigned by their slot, only this worker frees the operators of these slots
+    while (M->state == RKServerStateActive) {
+        for (k = me->id; k < M->maxClient; k += M->workerCount) {
+            pthread_mutex_lock(&M->lock);
+            O = M->operators[k];
+            pthread_mutex_unlock(&M->lock);
+            if (O != NULL) {
+                RKOperatorService(O);
+            }
         }
-        if (M->state != RKServerStateActive || O->state != RKOperatorStateActive) {
-            break;
+        me->tic++;
+        // Sleep until the event loop posts something, or a short period for the stream handlers
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += RKServerWorkerPeriodUs * 1000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
         }
-        // The command to execute
-        O->cmd = O->commands[O->commandIndexRead];
-        if (M->c) {
-            M->c(O);
-        } else {
-            RKLog("%s No command handler. cmd '%s' from Op-%03d (%s)\n", M->name, O->cmd, O->iid, O->ip);
+        pthread_mutex_lock(&M->workLock);
+        pthread_cond_timedwait(&M->workPosted, &M->workLock, &deadline);
+        pthread_mutex_unlock(&M->workLock);
+    }
+
+    for (k = me->id; k < M->maxClient; k += M->workerCount) {
+        if ((O = M->operators[k]) != NULL) {
+            O->state = RKOperatorStateHungUp;
+            RKOperatorFree(O);
         }
-        O->commandIndexRead = O->commandIndexRead == RKServerBufferDepth - 1 ? 0 : O->commandIndexRead + 1;
     }
 
     if (M->verbose > 1) {
-        RKLog(">%s %s Command routine returning ...\n", M->name, O->name);
+        RKLog(">%s Returning ...\n", me->name);
     }
 
     return NULL;
 }
 
 
-RKOperator *RKOperatorCreate(RKServer *M, int sid, const char *ip) {
+RKOperator *RKOperatorCreate(RKServer *M, int sid, const char *ip, const bool webSocket) {
 
     RKOperator *O = (RKOperator *)malloc(sizeof(RKOperator));
     if (O == NULL) {
@@ -346,6 +955,18 @@ RKOperator *RKOperatorCreate(RKServer *M, int sid, const char *ip) {
         return NULL;
     }
     memset(O, 0, sizeof(RKOperator));
+    O->rx = (uint8_t *)malloc(RKServerReceiveBufferSize);
+    O->tx = (uint8_t *)malloc(RKServerWriteQueueSize);
+    if (O->rx == NULL || O->tx == NULL) {
+        RKLog("%s failed to allocate the buffers of an operator.\n", M->name);
+        free(O->rx);
+        free(O->tx);
+        free(O);
+        return NULL;
+    }
+    O->txCapacity = RKServerWriteQueueSize;
+    pthread_mutex_init(&O->lock, NULL);
+    pthread_cond_init(&O->received, NULL);
 
     pthread_mutex_lock(&M->lock);
 
@@ -353,15 +974,18 @@ RKOperator *RKOperatorCreate(RKServer *M, int sid, const char *ip) {
     while (M->busy[k]) {
         k++;
     }
-    M->busy[k] = true;
 
     // Default operator parameters that should not be 0
     O->M = M;
     O->iid = k;
     O->sid = sid;
     O->state = RKOperatorStateAllocated;
+    O->webSocket = webSocket;
+    O->zeroCopy = M->zeroCopyThreshold > 0 && !webSocket && RKServerSetZeroCopy(sid);
     O->timeoutSeconds = 30;
     O->userResource = M->userResource;
+    gettimeofday(&O->latestReadTime, NULL);
+    O->latestWriteTime = O->latestReadTime;
     snprintf(O->ip, 48, "%s", ip);
     snprintf(O->name, sizeof(O->name), "%sO%d%s:%s",
              rkGlobalParameters.showColor ? RKGetColorOfIndex(O->iid) : "",
@@ -381,14 +1005,23 @@ RKOperator *RKOperatorCreate(RKServer *M, int sid, const char *ip) {
     O->delimTx.type = RKNetworkPacketTypeBytes;
     O->beacon.type = RKNetworkPacketTypeBeacon;
 
-    if (pthread_create(&O->tidRead, NULL, RKOperatorRoutine, O)) {
-        RKLog("%s Error. Failed to create RKOperatorRoutine().\n", M->name);
+    if (RKServerWatch(M, O)) {
+        RKLog("%s Error. Failed to watch the socket of %s.\n", M->name, O->name);
         pthread_mutex_unlock(&M->lock);
+        pthread_cond_destroy(&O->received);
+        pthread_mutex_destroy(&O->lock);
+        free(O->rx);
+        free(O->tx);
+        free(O);
         return NULL;
     }
+    M->busy[k] = true;
+    M->operators[k] = O;
 
     pthread_mutex_unlock(&M->lock);
 
+    RKServerPostWork(M);
+
     return O;
 }
 
@@ -397,14 +1030,27 @@ void RKOperatorFree(RKOperator *O) {
     RKServer *M = O->M;
     const int k = O->iid;
 
-    pthread_join(O->tidRead, NULL);
+    pthread_mutex_lock(&M->lock);
+    // Last chance for whatever the terminate handler has queued
+    pthread_mutex_lock(&O->lock);
+    RKOperatorFlushLocked(O);
+    pthread_mutex_unlock(&O->lock);
+    RKServerUnwatch(M, O);
     close(O->sid);
-    free(O);
-
     M->busy[k] = false;
     M->operators[k] = NULL;
-}
+    pthread_mutex_unlock(&M->lock);
+
+    if (M->verbose > 1) {
+        RKLog(">%s %s Operator freed.\n", M->name, O->name);
+    }
 
+    pthread_cond_destroy(&O->received);
+    pthread_mutex_destroy(&O->lock);
+    free(O->rx);
+    free(O->tx);
+    free(O);
+}
 
 int RKDefaultWelcomeHandler(RKOperator *O) {
 
@@ -457,14 +1103,14 @@ int RKDefaultWelcomeHandler(RKOperator *O) {
             "What can I do for you?" RKEOL,
             border,
             O->name);
-    send(O->sid, msg, strlen(msg), 0);
+    RKOperatorSendString(O, msg);
     return 0;
 }
 
 
 int RKDefaultTerminateHandler(RKOperator *O) {
     char str[] = "You are boring. I'm disconnecting you...\nBye." RKEOL;
-    send(O->sid, str, strlen(str), 0);
+    RKOperatorSendString(O, str);
     return 0;
 }
 
@@ -481,9 +1127,16 @@ RKServer *RKServerInit(void) {
     M->port = 10000;
     M->maxClient = RKServerMaximumOperators;
     M->timeoutSeconds = 5;
+    M->workerCount = RKServerDefaultWorkerCount;
+    M->webSocketSd = -1;
+    M->efd = -1;
+    M->wakeFds[0] = -1;
+    M->wakeFds[1] = -1;
     M->w = &RKDefaultWelcomeHandler;
     M->t = &RKDefaultTerminateHandler;
     pthread_mutex_init(&M->lock, NULL);
+    pthread_mutex_init(&M->workLock, NULL);
+    pthread_cond_init(&M->workPosted, NULL);
 
     // Ignore broken pipe for clients that disconnect unexpectedly
     signal(SIGPIPE, SIG_IGN);
@@ -496,6 +1149,9 @@ void RKServerFree(RKServer *M) {
     while (M->state > RKServerStateFree) {
         usleep(100000);
     }
+    pthread_cond_destroy(&M->workPosted);
+    pthread_mutex_destroy(&M->workLock);
+    pthread_mutex_destroy(&M->lock);
     free(M);
 }
 
@@ -510,6 +1166,28 @@ void RKServerSetPort(RKServer *M, const int port) {
     M->port = port;
 }
 
+void RKServerSetWebSocketPort(RKServer *M, const int port) {
+    M->webSocketPort = port;
+}
+
+void RKServerSetWorkerCount(RKServer *M, const int count) {
+    if (M->state != RKServerStateNull && M->state != RKServerStateFree) {
+        RKLog("%s Error. Worker count can only be changed before the server starts.\n", M->name);
+        return;
+    }
+    M->workerCount = MAX(1, MIN(RKServerMaximumWorkers, count));
+}
+
+void RKServerSetZeroCopyThreshold(RKServer *M, const size_t size) {
+    #if defined(RKServerHasZeroCopy)
+    M->zeroCopyThreshold = size;
+    #else
+    if (size) {
+        RKLog("%s Warning. MSG_ZEROCOPY is not available.\n", M->name);
+    }
+    #endif
+}
+
 void RKServerSetWelcomeHandler(RKServer *M, int (*function)(RKOperator *)) {
     M->w = function;
 }
@@ -577,54 +1255,23 @@ void RKServerStop(RKServer *M) {
 #pragma mark - Miscellaneous functions
 
 ssize_t RKServerReceiveUserPayload(RKOperator *O, void *buffer, RKNetworkMessageFormat format) {
-    int k = 0;
-    fd_set rfd;
-    fd_set efd;
-    ssize_t r = -1;
-    int readCount;
+    size_t k = 0;
     bool readOkay = false;
 
-    FD_ZERO(&rfd);
-    FD_ZERO(&efd);
-    FD_SET(O->sid, &rfd);
-    FD_SET(O->sid, &efd);
-
     RKNetDelimiter *delimiter = &O->delimRx;
 
     RKServer *M = O->M;
 
     const int blockLength = 4;
 
+    // Bytes are collected into the receive buffer by the event loop, this only waits for them
     switch (format) {
 
         case RKNetworkMessageFormatHeaderDefinedSize:
-            //RKNetworkread
-            k = 0;
-            readCount = 0;
-            while (readCount++ < O->timeoutSeconds * 100) {
-                if ((r = read(O->sid, delimiter + k, sizeof(RKNetDelimiter) - k)) > 0) {
-                    if (r) {
-                        k += r;
-                        if (k == sizeof(RKNetDelimiter)) {
-                            break;
-                        } else if (k > sizeof(RKNetDelimiter)) {
-                            RKLog("%s %s Error. Should not read larger than sizeof(RKNetDelimiter) = %zu\n", M->name, O->name, sizeof(RKNetDelimiter));
-                            break;
-                        }
-                    } else {
-                        usleep(10000);
-                    }
-                } else if (errno != EAGAIN) {
-                    RKLog("%s %s Error. RKMessageFormatFixedHeaderVariableBlock   r = %d   k = %d   errno = %d (%s)\n",
-                              M->name, O->name, r, k, errno, RKErrnoString(errno));
-                    break;
-                } else {
-                    usleep(10000);
-                }
-            }
-            if (k != sizeof(RKNetDelimiter) || readCount > O->timeoutSeconds * 100) {
-                if (errno != ECONNREFUSED) {
-                    RKLog("%s %s Error. Incomplete read().   errno = %d (%s)\n", M->name, O->name, errno, RKErrnoString(errno));
+            k = RKOperatorReceive(O, delimiter, sizeof(RKNetDelimiter), O->timeoutSeconds);
+            if (k != sizeof(RKNetDelimiter)) {
+                if (!O->peerClosed) {
+                    RKLog("%s %s Error. Incomplete read().   k = %zu\n", M->name, O->name, k);
                 }
                 break;
             }
@@ -643,33 +1290,10 @@ ssize_t RKServerReceiveUserPayload(RKOperator *O, void *buffer, RKNetworkMessage
                 break;
             }
             // Now the actual payload
-            k = 0;
-            readCount = 0;
-            while (readCount++ < M->timeoutSeconds * 100) {
-                if ((r = (int)read(O->sid, buffer + k, delimiter->size - k)) > 0) {
-                    k += r;
-                    if (k >= delimiter->size) {
-                        break;
-                    } else {
-                        usleep(10000);
-                    }
-                } else if (errno != EAGAIN) {
-                    if (M->verbose > 1) {
-                        RKLog("%s Error. RKMessageFormatFixedBlock   r=%d  k=%d  errno=%d (%s)  %d\n",
-                              O->name, r, k, errno, RKErrnoString(errno), readCount);
-                    }
-                    readCount = O->timeoutSeconds * 10000;
-                    break;
-                } else {
-                    usleep(10000);
-                }
-                if (M->verbose > 1) {
-                    RKLog("... errno = %d ...\n", errno);
-                }
-            }
-            if (readCount >= O->timeoutSeconds * 100) {
+            k = RKOperatorReceive(O, buffer, delimiter->size, M->timeoutSeconds);
+            if (k < delimiter->size) {
                 if (M->verbose > 1) {
-                    RKLog("%s Not a proper frame.  timeoutCount = %d  errno = %d\n", O->name, readCount, errno);
+                    RKLog("%s Not a proper frame.  k = %zu / %u\n", O->name, k, delimiter->size);
                 }
                 break;
             }
@@ -680,33 +1304,10 @@ ssize_t RKServerReceiveUserPayload(RKOperator *O, void *buffer, RKNetworkMessage
             break;
 
         case RKNetworkMessageFormatConstantSize:
-            k = 0;
-            readCount = 0;
-            while (readCount++ < M->timeoutSeconds * 100) {
-                if ((r = (int)read(O->sid, buffer + k, blockLength - k)) > 0) {
-                    k += r;
-                    if (k >= blockLength) {
-                        break;
-                    } else {
-                        usleep(10000);
-                    }
-                } else if (errno != EAGAIN) {
-                    if (M->verbose > 1) {
-                        RKLog("%s Error. RKMessageFormatFixedBlock   r=%d  k=%d  errno=%d (%s)  %d\n",
-                              O->name, r, k, errno, RKErrnoString(errno), readCount);
-                    }
-                    readCount = O->timeoutSeconds * 10000;
-                    break;
-                } else {
-                    usleep(10000);
-                }
+            k = RKOperatorReceive(O, buffer, blockLength, M->timeoutSeconds);
+            if (k < blockLength) {
                 if (M->verbose > 1) {
-                    RKLog("... errno = %d ...\n", errno);
-                }
-            }
-            if (readCount >= O->timeoutSeconds * 100) {
-                if (M->verbose > 1) {
-                    RKLog("%s Not a proper frame.  timeoutCount = %d  errno = %d\n", O->name, readCount, errno);
+                    RKLog("%s Not a proper frame.  k = %zu / %d\n", O->name, k, blockLength);
                 }
                 break;
             }
@@ -727,60 +1328,231 @@ ssize_t RKServerReceiveUserPayload(RKOperator *O, void *buffer, RKNetworkMessage
     return -1;
 }
 
-// In counts of 10ms, should be plenty, in-transit buffer should be able to hold it
-#define RKSocketTimeCountOf10ms  10
+// Take whatever has arrived of a frame without waiting. The same buffer must be given until the frame is complete,
+// returns the payload size then, RKServerPayloadIncomplete while more is to come or -1 on error
+ssize_t RKServerReceiveUserPayloadNonBlocking(RKOperator *O, void *buffer, RKNetworkMessageFormat format) {
+    size_t n, offset, size;
+    uint8_t *target;
+    ssize_t r = RKServerPayloadIncomplete;
 
-// Use as:
-// RKOperatorSendPackets(operator, payload, size, payload, size, ..., NULL);
+    RKNetDelimiter *delimiter = &O->delimRx;
 
-ssize_t RKOperatorSendPackets(RKOperator *O, ...) {
+    RKServer *M = O->M;
+
+    if (format != RKNetworkMessageFormatHeaderDefinedSize && format != RKNetworkMessageFormatConstantSize) {
+        return -1;
+    }
+
+    const size_t delimiterSize = format == RKNetworkMessageFormatHeaderDefinedSize ? sizeof(RKNetDelimiter) : 0;
+
+    pthread_mutex_lock(&O->lock);
+    while (true) {
+        if (O->rxTaken < delimiterSize) {
+            target = (uint8_t *)delimiter + O->rxTaken;
+            n = delimiterSize - O->rxTaken;
+        } else {
+            size = delimiterSize ? delimiter->size : 4;
+            if (size > RKMaximumPacketSize) {
+                RKLog("%s Error. Payload size = %s (type %d) is more than what I can handle.\n",
+                      M->name, RKIntegerToCommaStyleString(size), delimiter->type);
+                r = -1;
+                break;
+            }
+            offset = O->rxTaken - delimiterSize;
+            if (offset == size) {
+                if (size < RKMaximumPacketSize) {
+                    *((char *)buffer + size) = '\0';
+                }
+                r = (ssize_t)size;
+                break;
+            }
+            target = (uint8_t *)buffer + offset;
+            n = size - offset;
+        }
+        n = MIN(n, RKOperatorAvailableLocked(O));
+        if (n == 0) {
+            if (O->peerClosed) {
+                r = -1;
+            }
+            break;
+        }
+        memcpy(target, O->rx, n);
+        RKOperatorConsumeLocked(O, n);
+        O->rxTaken += n;
+    }
+    if (r != RKServerPayloadIncomplete) {
+        O->rxTaken = 0;
+    }
+    pthread_mutex_unlock(&O->lock);
+
+    return r;
+}
+
+// Send the pieces straight to the socket when nothing is waiting, queue whatever the socket does not take.
+// All pieces of a run go out with one sendmsg(), pieces of at least zeroCopyThreshold bytes form their own
+// runs with MSG_ZEROCOPY if allowed. The caller must hold O->lock
+static int RKOperatorSendOrQueueVectorLocked(RKOperator *O, struct iovec *vectors, const int count, const bool zeroCopy) {
+    int k = 0, e, flags;
+    ssize_t r;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    while (O->txSize == 0 && k < count) {
+        // A run of pieces that are all sent the same way
+        flags = 0;
+        e = count;
+        #if defined(RKServerHasZeroCopy)
+        if (zeroCopy && O->zeroCopy) {
+            const bool large = vectors[k].iov_len >= O->M->zeroCopyThreshold;
+            for (e = k + 1; e < count && (vectors[e].iov_len >= O->M->zeroCopyThreshold) == large; e++) {
+                continue;
+            }
+            flags = large ? MSG_ZEROCOPY : 0;
+        }
+        #endif
+        msg.msg_iov = vectors + k;
+        msg.msg_iovlen = e - k;
+        if ((r = sendmsg(O->sid, &msg, flags)) > 0) {
+            #if defined(RKServerHasZeroCopy)
+            if (flags & MSG_ZEROCOPY) {
+                O->zeroCopySent++;
+            }
+            #endif
+            // Skip the pieces the socket took, trim the one it took partially
+            while (k < count && (size_t)r >= vectors[k].iov_len) {
+                r -= vectors[k].iov_len;
+                k++;
+            }
+            if (r > 0) {
+                vectors[k].iov_base = (uint8_t *)vectors[k].iov_base + r;
+                vectors[k].iov_len -= r;
+            }
+        } else if (r < 0 && errno == EINTR) {
+            continue;
+        #if defined(RKServerHasZeroCopy)
+        } else if (r < 0 && errno == ENOBUFS && flags) {
+            // Out of option memory to pin the pages, copy this time
+            O->zeroCopy = false;
+            continue;
+        #endif
+        } else {
+            if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                return RKResultClientNotConnected;
+            }
+            break;
+        }
+    }
+    for (; k < count; k++) {
+        if ((e = RKOperatorQueueLocked(O, vectors[k].iov_base, vectors[k].iov_len)) != RKResultSuccess) {
+            return e;
+        }
+    }
+    return RKResultSuccess;
+}
+
+// Send the pieces in vectors as one packet, e.g., for a header and the data that follow from where they are.
+// Set zeroCopy only if the buffers stay untouched until RKOperatorZeroCopyReleased() returns true.
+// For a WebSocket client, the pieces are sent as one binary message.
+ssize_t RKOperatorSendVector(RKOperator *O, const struct iovec *vectors, const int count, const bool zeroCopy) {
 
-    va_list   arg;
+    struct iovec  pieces[RKServerMaximumVectors + 1];
+    uint8_t       header[RKWebSocketFrameHeaderSize];
 
-    void      *payload;
-    ssize_t   payloadSize = 1;
+    size_t        total = 0;
+    int           k, n = 0;
 
-    ssize_t   grandTotalSentSize = 0;
-    ssize_t   totalSentSize = 0;
-    ssize_t   sentSize = 0;
+    bool          wasEmpty;
+    int           r;
 
-    int timeout_count = 0;
+    if (count > RKServerMaximumVectors) {
+        RKLog("%s %s Error. Too many pieces (%d > %d) in a send.\n", O->M->name, O->name, count, RKServerMaximumVectors);
+        return RKResultTooBig;
+    }
+
+    for (k = 0; k < count; k++) {
+        total += vectors[k].iov_len;
+    }
 
     pthread_mutex_lock(&O->lock);
 
+    if (O->webSocket && (!O->webSocketOpen || O->peerClosed)) {
+        // Nothing goes out before the handshake or after a close frame
+        pthread_mutex_unlock(&O->lock);
+        return RKResultClientNotConnected;
+    }
+
+    if (O->webSocket) {
+        // Frame header with the total size of all pieces
+        pieces[n].iov_base = header;
+        pieces[n++].iov_len = RKServerFrameHeader(header, RFC6455_OPCODE_BINARY, total);
+    }
+    for (k = 0; k < count; k++) {
+        pieces[n++] = vectors[k];
+    }
+
+    wasEmpty = O->txSize == 0;
+
+    r = RKOperatorSendOrQueueVectorLocked(O, pieces, n, zeroCopy);
+
+    if (r == RKResultSuccess) {
+        O->txByteCount += total;
+    }
+
+    if (wasEmpty && O->txSize > 0) {
+        RKServerWake(O->M);
+    }
+
+    if (r == RKResultClientNotConnected) {
+        O->peerClosed = true;
+        pthread_cond_broadcast(&O->received);
+    }
+
+    pthread_mutex_unlock(&O->lock);
+
+    if (r == RKResultClientNotConnected) {
+        return RKResultIncompleteSend;
+    } else if (r != RKResultSuccess) {
+        RKLog("%s %s Write queue exceeds %s B. Hanging up ...\n", O->M->name, O->name, RKIntegerToCommaStyleString(RKServerWriteQueueLimit));
+        RKOperatorHangUp(O);
+        return RKResultIncompleteSend;
+    }
+
+    return (ssize_t)total;
+}
+
+// Use as:
+// RKOperatorSendPackets(operator, payload, size, payload, size, ..., NULL);
+//
+// Payloads go straight to the socket when nothing is waiting, whatever the socket does not
+// take right away is queued and sent by the event loop. This never blocks on a slow client.
+// For a WebSocket client, the payloads of one call are sent as one binary message.
+
+ssize_t RKOperatorSendPackets(RKOperator *O, ...) {
+
+    va_list       arg;
+
+    struct iovec  vectors[RKServerMaximumVectors];
+    void          *payload;
+    int           count = 0;
+
     va_start(arg, O);
 
     // Parse the input arguments until payload = NULL (last input)
     payload = va_arg(arg, void *);
     while (payload != NULL) {
-        payloadSize = va_arg(arg, ssize_t);
-        //printf("size %d @ %p\n", (int)payloadSize, payload);
-        sentSize = 0;
-        totalSentSize = 0;
-        while (totalSentSize < payloadSize && timeout_count++ < RKSocketTimeCountOf10ms) {
-            if ((sentSize = send(O->sid, payload + sentSize, payloadSize - sentSize, 0)) > 0) {
-                totalSentSize += sentSize;
-            }
-            if (totalSentSize < payloadSize) {
-                usleep(1000);
-            } else if (sentSize < 0) {
-                pthread_mutex_unlock(&O->lock);
-                return RKResultIncompleteSend;
-            }
+        if (count == RKServerMaximumVectors) {
+            va_end(arg);
+            RKLog("%s %s Error. Too many payloads in a send.\n", O->M->name, O->name);
+            return RKResultTooBig;
         }
-        grandTotalSentSize += totalSentSize;
+        vectors[count].iov_base = payload;
+        vectors[count++].iov_len = (size_t)va_arg(arg, ssize_t);
         payload = va_arg(arg, void *);
     }
 
     va_end(arg);
 
-    pthread_mutex_unlock(&O->lock);
-
-    if (timeout_count >= RKSocketTimeCountOf10ms) {
-        return RKResultTimeout;
-    }
-
-    return grandTotalSentSize;
+    return RKOperatorSendVector(O, vectors, count, false);
 }
 
 ssize_t RKOperatorSendString(RKOperator *O, const char *string) {
@@ -804,6 +1576,48 @@ ssize_t RKOperatorSendBeacon(RKOperator *O) {
     return s;
 }
 
+// Number of bytes waiting in the write queue
+size_t RKOperatorGetQueueDepth(RKOperator *O) {
+    size_t depth;
+    pthread_mutex_lock(&O->lock);
+    depth = O->txSize;
+    pthread_mutex_unlock(&O->lock);
+    return depth;
+}
+
+// Number of bytes the peer has not taken yet, the write queue and what is still in the socket
+size_t RKOperatorGetUnsentSize(RKOperator *O) {
+    int unsent = 0;
+    #if defined(__linux__)
+    if (ioctl(O->sid, TIOCOUTQ, &unsent) < 0) {
+        unsent = 0;
+    }
+    #elif defined(SO_NWRITE)
+    socklen_t length = sizeof(int);
+    if (getsockopt(O->sid, SOL_SOCKET, SO_NWRITE, &unsent, &length) < 0) {
+        unsent = 0;
+    }
+    #endif
+    return RKOperatorGetQueueDepth(O) + (size_t)MAX(0, unsent);
+}
+
+// Check, without waiting, whether the kernel has released the buffers of the zero-copy sends. A stream
+// handler that gets false leaves those buffers alone and tries again on its next turn
+bool RKOperatorZeroCopyReleased(RKOperator *O) {
+    #if defined(RKServerHasZeroCopy)
+    bool done;
+    pthread_mutex_lock(&O->lock);
+    if (O->zeroCopySent != O->zeroCopyDone) {
+        RKOperatorReapZeroCopyLocked(O);
+    }
+    done = O->zeroCopySent == O->zeroCopyDone || O->peerClosed;
+    pthread_mutex_unlock(&O->lock);
+    return done;
+    #else
+    return true;
+    #endif
+}
+
 void RKOperatorHangUp(RKOperator *O) {
     O->state = RKOperatorStateClosing;
     return;
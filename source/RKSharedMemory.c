@@ -0,0 +1,307 @@
+//
+//  RKSharedMemory.c
+//  RadarKit
+//
+//  Created by agent on 10/19/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <RadarKit/RKSharedMemory.h>
+#include <ctype.h>
+
+#pragma mark - Helper Functions
+
+// Identifier of the newest pulse / ray that is ready, the reader starts after it
+static uint64_t RKSharedMemoryLatestIdentifier(RKBuffer buffer, const uint32_t depth, const bool isRay) {
+    uint32_t k;
+    uint64_t i, s;
+    int64_t latest = -1;
+    for (k = 0; k < depth; k++) {
+        if (isRay) {
+            RKRay *ray = RKGetRayFromBuffer(buffer, k);
+            i = __atomic_load_n(&ray->header.i, __ATOMIC_ACQUIRE);
+            s = __atomic_load_n(&ray->header.s, __ATOMIC_ACQUIRE) & RKRayStatusReady;
+        } else {
+            RKPulse *pulse = RKGetPulseFromBuffer(buffer, k);
+            i = __atomic_load_n(&pulse->header.i, __ATOMIC_ACQUIRE);
+            s = __atomic_load_n(&pulse->header.s, __ATOMIC_ACQUIRE) & RKPulseStatusProcessed;
+        }
+        if (s && (int64_t)i > latest) {
+            latest = (int64_t)i;
+        }
+    }
+    return (uint64_t)(latest + 1);
+}
+
+// Follow the identifier of the next item at its slot, returns true if the item is ready to be read
+static bool RKSharedMemoryFollow(uint64_t *id, uint64_t *dropCount, const uint64_t i, const bool ready, const uint32_t depth) {
+    const int64_t ahead = (int64_t)(i - *id);
+    if (ahead > (int64_t)depth * 2 || ahead < -(int64_t)depth * 2) {
+        // The producer has restarted with new identifiers
+        *id = i;
+    } else if (ahead > 0) {
+        // The producer has lapped the reader, those in between are gone
+        *dropCount += ahead;
+        *id = i;
+    } else if (ahead < 0) {
+        // The producer has not reached this slot yet
+        return false;
+    }
+    if (ready) {
+        *id += 1;
+        return true;
+    }
+    return false;
+}
+
+// A segment of this name is left behind by a producer that is gone: closed, or its process no longer exists.
+// Anything that cannot be identified is assumed to be in use
+static bool RKSharedMemoryIsStale(const char *name, pid_t *pid) {
+    struct stat st;
+    bool stale = false;
+    *pid = 0;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        // Removed since
+        return errno == ENOENT;
+    }
+    if (fstat(fd, &st) == 0 && st.st_size >= RKSharedMemoryHeaderSize) {
+        const RKSharedMemoryHeader *header = (const RKSharedMemoryHeader *)mmap(NULL, RKSharedMemoryHeaderSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (header != MAP_FAILED) {
+            if (header->magic == RKSharedMemoryMagic && __atomic_load_n(&header->state, __ATOMIC_ACQUIRE) != RKSharedMemoryStateNull) {
+                *pid = header->pid;
+                stale = __atomic_load_n(&header->state, __ATOMIC_ACQUIRE) == RKSharedMemoryStateClosed ||
+                        (*pid > 0 && kill(*pid, 0) < 0 && errno == ESRCH);
+            }
+            munmap((void *)header, RKSharedMemoryHeaderSize);
+        }
+    }
+    close(fd);
+    return stale;
+}
+
+#pragma mark - Producer
+
+// Make a name for shm_open() from the radar name, e.g., "PX-1000" -> "/radarkit-px-1000"
+void RKSharedMemoryMakeName(char *name, const char *radarName) {
+    int k = snprintf(name, RKSharedMemoryNameLength, "/radarkit-");
+    const char *c = radarName;
+    while (*c != '\0' && k < RKSharedMemoryNameLength - 1) {
+        if (isalnum(*c) || *c == '-' || *c == '_') {
+            name[k++] = tolower(*c);
+        } else if (k > 0 && name[k - 1] != '-') {
+            name[k++] = '-';
+        }
+        c++;
+    }
+    if (name[k - 1] == '-') {
+        k--;
+    }
+    name[k] = '\0';
+}
+
+RKSharedMemory *RKSharedMemoryInit(const char *name,
+                                   const RKRadarDesc *desc,
+                                   const uint32_t pulseCapacity, const uint32_t pulseBufferDepth,
+                                   const uint32_t rayCapacity, const uint32_t rayBufferDepth) {
+    RKSharedMemory *memory = (RKSharedMemory *)malloc(sizeof(RKSharedMemory));
+    if (memory == NULL) {
+        RKLog("Error. Unable to allocate RKSharedMemory.\n");
+        return NULL;
+    }
+    memset(memory, 0, sizeof(RKSharedMemory));
+    snprintf(memory->name, RKSharedMemoryNameLength, "%s", name);
+
+    const size_t pulseBufferSize = pulseBufferDepth ? RKPulseBufferSize(pulseCapacity, pulseBufferDepth) : 0;
+    const size_t rayBufferSize = rayBufferDepth ? RKRayBufferSize(rayCapacity, rayBufferDepth) : 0;
+    if ((pulseBufferDepth && pulseBufferSize == 0) || (rayBufferDepth && rayBufferSize == 0)) {
+        free(memory);
+        return NULL;
+    }
+    memory->size = RKSharedMemoryHeaderSize + pulseBufferSize + rayBufferSize;
+
+    // Never take over the segment of another producer, only the one left behind by a producer that is gone
+    int error = 0;
+    pid_t pid = 0;
+    if ((memory->fd = shm_open(memory->name, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0 &&
+        (error = errno) == EEXIST && RKSharedMemoryIsStale(memory->name, &pid)) {
+        RKLog("Removing stale shared memory %s of process %d.\n", memory->name, pid);
+        shm_unlink(memory->name);
+        if ((memory->fd = shm_open(memory->name, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0) {
+            error = errno;
+        }
+    }
+    if (memory->fd < 0) {
+        if (error == EEXIST && pid > 0) {
+            RKLog("Error. Shared memory %s is in use by process %d.\n", memory->name, pid);
+        } else if (error == EEXIST) {
+            RKLog("Error. Shared memory %s exists but is not a live RadarKit segment, remove /dev/shm%s if it is not in use.\n", memory->name, memory->name);
+        } else {
+            RKLog("Error. Unable to create shared memory %s.   errno = %d (%s)\n", memory->name, error, RKErrnoString(error));
+        }
+        free(memory);
+        return NULL;
+    }
+    if (ftruncate(memory->fd, (off_t)memory->size) < 0) {
+        RKLog("Error. Unable to size shared memory %s to %s B.\n", memory->name, RKUIntegerToCommaStyleString(memory->size));
+        close(memory->fd);
+        shm_unlink(memory->name);
+        free(memory);
+        return NULL;
+    }
+    memory->header = (RKSharedMemoryHeader *)mmap(NULL, memory->size, PROT_READ | PROT_WRITE, MAP_SHARED, memory->fd, 0);
+    if (memory->header == MAP_FAILED) {
+        RKLog("Error. Unable to map shared memory %s.   errno = %d (%s)\n", memory->name, errno, RKErrnoString(errno));
+        close(memory->fd);
+        shm_unlink(memory->name);
+        free(memory);
+        return NULL;
+    }
+
+    RKSharedMemoryHeader *header = memory->header;
+    memset(header, 0, sizeof(RKSharedMemoryHeader));
+    header->magic = RKSharedMemoryMagic;
+    header->version = RKSharedMemoryVersion;
+    header->pid = getpid();
+    header->pulseCapacity = pulseCapacity;
+    header->pulseBufferDepth = pulseBufferDepth;
+    header->pulseOffset = RKSharedMemoryHeaderSize;
+    header->pulseBufferSize = pulseBufferSize;
+    header->rayCapacity = rayCapacity;
+    header->rayBufferDepth = rayBufferDepth;
+    header->rayOffset = RKSharedMemoryHeaderSize + pulseBufferSize;
+    header->rayBufferSize = rayBufferSize;
+    memcpy(&header->desc, desc, sizeof(RKRadarDesc));
+    if (pulseBufferDepth) {
+        memory->pulses = (RKBuffer)header + header->pulseOffset;
+        RKPulseBufferInit(memory->pulses, pulseCapacity, pulseBufferDepth);
+    }
+    if (rayBufferDepth) {
+        memory->rays = (RKBuffer)header + header->rayOffset;
+        RKRayBufferInit(memory->rays, rayCapacity, rayBufferDepth);
+    }
+    __atomic_store_n(&header->state, RKSharedMemoryStateLive, __ATOMIC_RELEASE);
+
+    RKLog("Shared memory %s occupies %s B\n", memory->name, RKUIntegerToCommaStyleString(memory->size));
+    return memory;
+}
+
+void RKSharedMemoryFree(RKSharedMemory *memory) {
+    if (memory == NULL) {
+        return;
+    }
+    // The readers that still have it mapped see the producer is gone
+    __atomic_store_n(&memory->header->state, RKSharedMemoryStateClosed, __ATOMIC_RELEASE);
+    munmap(memory->header, memory->size);
+    close(memory->fd);
+    shm_unlink(memory->name);
+    free(memory);
+}
+
+#pragma mark - Consumer
+
+RKSharedMemoryReader *RKSharedMemoryReaderInit(const char *name) {
+    struct stat st;
+    RKSharedMemoryReader *reader = (RKSharedMemoryReader *)malloc(sizeof(RKSharedMemoryReader));
+    if (reader == NULL) {
+        RKLog("Error. Unable to allocate RKSharedMemoryReader.\n");
+        return NULL;
+    }
+    memset(reader, 0, sizeof(RKSharedMemoryReader));
+    snprintf(reader->name, RKSharedMemoryNameLength, "%s", name);
+
+    if ((reader->fd = shm_open(reader->name, O_RDONLY, 0)) < 0) {
+        RKLog("Error. Unable to open shared memory %s.   errno = %d (%s)\n", reader->name, errno, RKErrnoString(errno));
+        free(reader);
+        return NULL;
+    }
+    if (fstat(reader->fd, &st) < 0 || st.st_size < RKSharedMemoryHeaderSize) {
+        RKLog("Error. Shared memory %s is not from RadarKit.\n", reader->name);
+        close(reader->fd);
+        free(reader);
+        return NULL;
+    }
+    reader->size = (size_t)st.st_size;
+    reader->header = (const RKSharedMemoryHeader *)mmap(NULL, reader->size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (reader->header == MAP_FAILED) {
+        RKLog("Error. Unable to map shared memory %s.   errno = %d (%s)\n", reader->name, errno, RKErrnoString(errno));
+        close(reader->fd);
+        free(reader);
+        return NULL;
+    }
+    const RKSharedMemoryHeader *header = reader->header;
+    if (header->magic != RKSharedMemoryMagic || header->version != RKSharedMemoryVersion ||
+        __atomic_load_n(&header->state, __ATOMIC_ACQUIRE) != RKSharedMemoryStateLive ||
+        header->rayOffset + header->rayBufferSize > reader->size) {
+        RKLog("Error. Shared memory %s is not live or from a different version.\n", reader->name);
+        RKSharedMemoryReaderFree(reader);
+        return NULL;
+    }
+    if (header->pulseBufferDepth) {
+        reader->pulses = (RKBuffer)header + header->pulseOffset;
+        reader->pulseId = RKSharedMemoryLatestIdentifier(reader->pulses, header->pulseBufferDepth, false);
+    }
+    if (header->rayBufferDepth) {
+        reader->rays = (RKBuffer)header + header->rayOffset;
+        reader->rayId = RKSharedMemoryLatestIdentifier(reader->rays, header->rayBufferDepth, true);
+    }
+    return reader;
+}
+
+void RKSharedMemoryReaderFree(RKSharedMemoryReader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+    munmap((void *)reader->header, reader->size);
+    close(reader->fd);
+    free(reader);
+}
+
+bool RKSharedMemoryReaderIsLive(RKSharedMemoryReader *reader) {
+    return __atomic_load_n(&reader->header->state, __ATOMIC_ACQUIRE) == RKSharedMemoryStateLive;
+}
+
+// The next pulse that has been processed, NULL if there is none yet
+RKPulse *RKSharedMemoryReaderGetPulse(RKSharedMemoryReader *reader) {
+    if (reader->pulses == NULL) {
+        return NULL;
+    }
+    const uint32_t depth = reader->header->pulseBufferDepth;
+    RKPulse *pulse = RKGetPulseFromBuffer(reader->pulses, (uint32_t)(reader->pulseId % depth));
+    // The producer marks a slot vacant before it changes the identifier, so read the identifier first
+    const uint64_t i = __atomic_load_n(&pulse->header.i, __ATOMIC_ACQUIRE);
+    const bool ready = __atomic_load_n(&pulse->header.s, __ATOMIC_ACQUIRE) & RKPulseStatusProcessed;
+    if (RKSharedMemoryFollow(&reader->pulseId, &reader->pulseDropCount, i, ready, depth)) {
+        return pulse;
+    }
+    return NULL;
+}
+
+// The next ray that is ready, NULL if there is none yet
+RKRay *RKSharedMemoryReaderGetRay(RKSharedMemoryReader *reader) {
+    if (reader->rays == NULL) {
+        return NULL;
+    }
+    const uint32_t depth = reader->header->rayBufferDepth;
+    RKRay *ray = RKGetRayFromBuffer(reader->rays, (uint32_t)(reader->rayId % depth));
+    const uint64_t i = __atomic_load_n(&ray->header.i, __ATOMIC_ACQUIRE);
+    const bool ready = __atomic_load_n(&ray->header.s, __ATOMIC_ACQUIRE) & RKRayStatusReady;
+    if (RKSharedMemoryFollow(&reader->rayId, &reader->rayDropCount, i, ready, depth)) {
+        return ray;
+    }
+    return NULL;
+}
+
+// Check after use that the latest pulse from RKSharedMemoryReaderGetPulse() has not been overwritten meanwhile
+bool RKSharedMemoryReaderIsPulseIntact(RKSharedMemoryReader *reader, const RKPulse *pulse) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(&pulse->header.s, __ATOMIC_ACQUIRE) & RKPulseStatusProcessed) &&
+           __atomic_load_n(&pulse->header.i, __ATOMIC_ACQUIRE) == reader->pulseId - 1;
+}
+
+// Check after use that the latest ray from RKSharedMemoryReaderGetRay() has not been overwritten meanwhile
+bool RKSharedMemoryReaderIsRayIntact(RKSharedMemoryReader *reader, const RKRay *ray) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(&ray->header.s, __ATOMIC_ACQUIRE) & RKRayStatusReady) &&
+           __atomic_load_n(&ray->header.i, __ATOMIC_ACQUIRE) == reader->rayId - 1;
+}
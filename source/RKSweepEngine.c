@@ -11,6 +11,10 @@
 // Internal Functions
 
 static void RKSweepEngineUpdateStatusString(RKSweepEngine *);
+static void RKSweepEnginePostJob(RKSweepEngine *, RKProduct *, RKProductCollection *, const char *);
+static void RKSweepEngineWaitForJobs(RKSweepEngine *);
+static uint32_t RKSweepEngineCountRecycledRays(const RKSweepWriterJob *);
+static void RKSweepEngineRunFileHandlingScript(RKSweepEngine *, const char *, const char *);
 
 #pragma mark - Helper Functions
 
@@ -30,14 +34,77 @@ static void RKSweepEngineUpdateStatusString(RKSweepEngine *engine) {
     memset(string, '.', RKStatusBarWidth);
     string[i] = 'S';
 
-    // Engine lag
-    snprintf(string + RKStatusBarWidth, RKStatusStringLength - RKStatusBarWidth, " %s%02.0f%s",
+    // Engine lag, sweeps and product files in the queues, time spent on the latest file
+    snprintf(string + RKStatusBarWidth, RKStatusStringLength - RKStatusBarWidth, " %s%02.0f%s Q%u/%u %.0fms",
              rkGlobalParameters.showColor ? RKColorLag(engine->lag) : "",
              99.49f * engine->lag,
-             rkGlobalParameters.showColor ? RKNoColor : "");
+             rkGlobalParameters.showColor ? RKNoColor : "",
+             engine->sweepPostCount - engine->sweepDoneCount,
+             engine->jobPostCount - engine->jobDoneCount,
+             1.0e3f * engine->writeTime);
     engine->statusBufferIndex = RKNextModuloS(engine->statusBufferIndex, RKBufferSSlotCount);
 }
 
+static void RKSweepEnginePostJob(RKSweepEngine *engine, RKProduct *product, RKProductCollection *collection, const char *filename) {
+    pthread_mutex_lock(&engine->queueMutex);
+    // Back-pressure: wait for a writer to take a job if the queue is full
+    while (engine->jobPostCount - engine->jobTakeCount >= RKSweepEngineJobQueueDepth) {
+        pthread_cond_wait(&engine->jobTaken, &engine->queueMutex);
+    }
+    RKSweepWriterJob *job = &engine->jobs[engine->jobPostCount % RKSweepEngineJobQueueDepth];
+    job->product = product;
+    if (collection) {
+        job->collection = *collection;
+    } else {
+        memset(&job->collection, 0, sizeof(RKProductCollection));
+    }
+    strncpy(job->filename, filename, RKMaximumPathLength - 1);
+    job->filename[RKMaximumPathLength - 1] = '\0';
+    engine->jobPostCount++;
+    pthread_cond_signal(&engine->jobPosted);
+    pthread_mutex_unlock(&engine->queueMutex);
+}
+
+static void RKSweepEngineWaitForJobs(RKSweepEngine *engine) {
+    pthread_mutex_lock(&engine->queueMutex);
+    while (engine->jobDoneCount != engine->jobPostCount) {
+        pthread_cond_wait(&engine->jobDone, &engine->queueMutex);
+    }
+    pthread_mutex_unlock(&engine->queueMutex);
+}
+
+// Products reference the rays of a sweep directly (RKProductInitViewFromSweep). The sweep queue holds the ray
+// gatherer, and in turn the rayReleaser, back until the writers are done but nothing can hold the moment engine
+// back. Count the rays it has taken since the views were made, i.e., the ones that can no longer be trusted.
+static uint32_t RKSweepEngineCountRecycledRays(const RKSweepWriterJob *job) {
+    uint32_t p, n = 0;
+    if (job->product) {
+        return RKProductCountRecycledViews(job->product);
+    }
+    for (p = 0; p < job->collection.count; p++) {
+        n = MAX(n, RKProductCountRecycledViews(&job->collection.products[p]));
+    }
+    return n;
+}
+
+// Called from a hook worker once the file handling script exits
+static void fileHandlingScriptDone(RKHookJob *job) {
+    RKSweepEngine *engine = (RKSweepEngine *)job->userResource;
+    if (job->output[0] != '\0' && engine->fileManager && RKFilenameExists(job->output)) {
+        RKFileManagerAddFile(engine->fileManager, job->output, RKFileTypeMoment);
+    }
+}
+
+// The script runs in a child process through the hook runner so the sweep manager can move on to the next sweep
+static void RKSweepEngineRunFileHandlingScript(RKSweepEngine *engine, const char *filelist, const char *archive) {
+    if (engine->verbose > 1) {
+        RKLog("%s CMD: %s\n", engine->name, filelist);
+    }
+    if (RKHookRunnerSubmit(engine->hookRunner, filelist, archive, fileHandlingScriptDone, engine) != RKResultSuccess) {
+        RKLog("%s Error. Unable to run CMD: %s\n", engine->name, filelist);
+    }
+}
+
 static void *rayReleaser(void *in) {
     RKSweepEngine *engine = (RKSweepEngine *)in;
 
@@ -85,30 +152,19 @@ static void *rayReleaser(void *in) {
     return NULL;
 }
 
-static void *sweepManagerV1(void *in) {
-    RKSweepEngine *engine = (RKSweepEngine *)in;
-
-    int i, j, p;
-
-    // Grab the anchor reference as soon as possible
-    const uint8_t index = engine->scratchSpaceIndex;
+static void sweepHandlerV1(RKSweepEngine *engine, const uint8_t index) {
+    int j, p;
 
     // Local copy of the record flag, which may change under certain conditions
     bool record = engine->record;
 
-    // Notify the thread creator that I have grabbed the parameter
-    engine->tic++;
-
     // Collect rays that belong to a sweep to a scratch space
     RKSweep *sweep = RKSweepCollect(engine, index);
     if (sweep == NULL) {
         if (engine->verbose > 1) {
-            RKLog("%s Empty sweep   scratchSpaceIndex = %d\n", index);
+            RKLog("%s Empty sweep   scratchSpaceIndex = %d\n", engine->name, index);
         }
-        pthread_mutex_lock(&engine->productMutex);
-        engine->business--;
-        pthread_mutex_unlock(&engine->productMutex);
-        return NULL;
+        return;
     }
     RKRay *S = sweep->rays[0];
     RKRay *E = sweep->rays[sweep->header.rayCount - 1];
@@ -156,7 +212,7 @@ static void *sweepManagerV1(void *in) {
                 RKLog("Error. Unable to get a product slot   p = %d   pid = %d.\n", p, engine->productIds[p]);
                 continue;
             }
-            RKProductInitFromSweep(product, sweep);
+            RKProductInitViewFromSweep(product, sweep);
             RKSweepEngineSetProductComplete(engine, sweep, product);
             productMemoryUsage += product->totalBufferSize;
         }
@@ -165,21 +221,10 @@ static void *sweepManagerV1(void *in) {
 
     if (engine->productBuffer == NULL) {
         RKLog("%s Unexpected NULL productBuffer.\n", engine->name);
-        pthread_mutex_lock(&engine->productMutex);
-        engine->business--;
-        pthread_mutex_unlock(&engine->productMutex);
-        return NULL;
-    }
-
-    if (!(engine->state & RKEngineStateWantActive)) {
-        pthread_mutex_lock(&engine->productMutex);
-        engine->business--;
-        pthread_mutex_unlock(&engine->productMutex);
+        RKSweepFree(sweep);
+        return;
     }
 
-    // Mark the state
-    engine->state |= RKEngineStateWritingFile;
-
     // Initiate a system command with handleFileScript
     if (engine->hasFileHandlingScript) {
         strncpy(filelist, engine->fileHandlingScript, RKMaximumPathLength);
@@ -228,21 +273,9 @@ static void *sweepManagerV1(void *in) {
         //      sprintf(product->desc.unit, "Degrees");
         //  }
 
-        // Call a product writer only if the engine is set to record and the is a valid product recorder
+        // Hand the product to a writer only if the engine is set to record and the is a valid product recorder
         if (record && engine->productRecorder) {
-            if (engine->verbose > 1) {
-                RKLog("%s Creating %s ...\n", engine->name, filename);
-            }
-            RKPreparePath(filename);
-            i = engine->productRecorder(product, filename);
-            if (i == RKResultSuccess) {
-                // Notify file manager of a new addition if the file handling script does not remove them
-                if (engine->fileManager && !(engine->fileHandlingScriptProperties & RKScriptPropertyRemoveNCFiles)) {
-                    RKFileManagerAddFile(engine->fileManager, filename, RKFileTypeMoment);
-                }
-            } else {
-                RKLog("%s Error creating %s\n", engine->name, filename);
-            }
+            RKSweepEnginePostJob(engine, product, NULL, filename);
         } else if (engine->verbose > 1) {
             RKLog("%s Skipping %s ...\n", engine->name, filename);
         }
@@ -265,12 +298,12 @@ static void *sweepManagerV1(void *in) {
         }
     }
 
+    // Products of this sweep are written in parallel, wait for all of them before reusing the product buffer
+    RKSweepEngineWaitForJobs(engine);
+
     // Save a copy of the last recorded scratch space index
     engine->lastRecordedScratchSpaceIndex = index;
 
-    // Unmark the state
-    engine->state ^= RKEngineStateWritingFile;
-
     // We are done with the sweep
     RKSweepFree(sweep);
 
@@ -280,14 +313,6 @@ static void *sweepManagerV1(void *in) {
     }
 
     if (record && engine->hasFileHandlingScript) {
-        if (engine->verbose > 1) {
-            RKLog("%s CMD: %s\n", engine->name, filelist);
-        }
-        j = system(filelist);
-        if (j) {
-            RKLog("%s Error. CMD: %s", engine->name, filelist);
-            RKLog("%s Error. Failed using system() -> %d   errno = %d\n", engine->name, j, errno);
-        }
         // Potential filenames that may be generated by the custom command. Need to notify file manager about them.
         RKReplaceFileExtension(filename, strrchr(filename, '-'), ".__");
         if (engine->fileHandlingScriptProperties & RKScriptPropertyProduceArchive) {
@@ -301,43 +326,27 @@ static void *sweepManagerV1(void *in) {
                 RKReplaceFileExtension(filename, "__", "zip");
             }
             RKLog("%s %s", engine->name, filename);
-            if (engine->fileManager && RKFilenameExists(filename)) {
-                RKFileManagerAddFile(engine->fileManager, filename, RKFileTypeMoment);
-            }
+            RKSweepEngineRunFileHandlingScript(engine, filelist, filename);
+        } else {
+            RKSweepEngineRunFileHandlingScript(engine, filelist, NULL);
         }
     }
 
-    pthread_mutex_lock(&engine->productMutex);
-    engine->business--;
-    pthread_mutex_unlock(&engine->productMutex);
-
-    return NULL;
 }
 
-static void *sweepManager(void *in) {
-    RKSweepEngine *engine = (RKSweepEngine *)in;
-
-    int i, j, p;
-
-    // Grab the anchor reference as soon as possible
-    const uint8_t index = engine->scratchSpaceIndex;
+static void sweepHandler(RKSweepEngine *engine, const uint8_t index) {
+    int j, p;
 
     // Local copy of the record flag, which may change under certain conditions
     bool record = engine->record;
 
-    // Notify the thread creator that I have grabbed the parameter
-    engine->tic++;
-
     // Collect rays that belong to a sweep to a scratch space
     RKSweep *sweep = RKSweepCollect(engine, index);
     if (sweep == NULL) {
         if (engine->verbose > 1) {
-            RKLog("%s Empty sweep   scratchSpaceIndex = %d\n", index);
+            RKLog("%s Empty sweep   scratchSpaceIndex = %d\n", engine->name, index);
         }
-        pthread_mutex_lock(&engine->productMutex);
-        engine->business--;
-        pthread_mutex_unlock(&engine->productMutex);
-        return NULL;
+        return;
     }
     RKRay *S = sweep->rays[0];
     RKRay *E = sweep->rays[sweep->header.rayCount - 1];
@@ -391,7 +400,7 @@ static void *sweepManager(void *in) {
                 RKLog("Error. Unable to get a product slot   p = %d   pid = %d.\n", p, engine->productIds[p]);
                 continue;
             }
-            RKProductInitFromSweep(product, sweep);
+            RKProductInitViewFromSweep(product, sweep);
             RKSweepEngineSetProductComplete(engine, sweep, product);
             productMemoryUsage += product->totalBufferSize;
         }
@@ -400,21 +409,10 @@ static void *sweepManager(void *in) {
 
     if (engine->productBuffer == NULL) {
         RKLog("%s Unexpected NULL productBuffer.\n", engine->name);
-        pthread_mutex_lock(&engine->productMutex);
-        engine->business--;
-        pthread_mutex_unlock(&engine->productMutex);
-        return NULL;
-    }
-
-    if (!(engine->state & RKEngineStateWantActive)) {
-        pthread_mutex_lock(&engine->productMutex);
-        engine->business--;
-        pthread_mutex_unlock(&engine->productMutex);
+        RKSweepFree(sweep);
+        return;
     }
 
-    // Mark the state
-    engine->state |= RKEngineStateWritingFile;
-
     // Initiate a system command with handleFileScript
     if (engine->hasFileHandlingScript) {
         strncpy(filelist, engine->fileHandlingScript, RKMaximumPathLength);
@@ -456,28 +454,10 @@ static void *sweepManager(void *in) {
         filelistLength += snprintf(filelist + filelistLength, RKMaximumListLength - filelistLength, " %s", filename);
     }
 
-    // Call a product writer only if the engine is set to record and has a valid product recorder
+    // Hand the collection to a writer only if the engine is set to record and has a valid product recorder
     if (record && engine->productCollectionRecorder) {
-        if (engine->verbose > 1) {
-            RKLog("%s Creating %s ...\n", engine->name, filename);
-        }
-        RKPreparePath(filename);
-        i = engine->productCollectionRecorder(collection, filename, RKWriterOptionNone);
-        if (i == RKResultSuccess) {
-            // Notify file manager of a new addition if the file handling script does not remove them
-            if (engine->fileManager && !(engine->fileHandlingScriptProperties & RKScriptPropertyRemoveNCFiles)) {
-                RKFileManagerAddFile(engine->fileManager, filename, RKFileTypeMoment);
-                if (engine->verbose > 1) {
-                    summarySize += sprintf(summary + summarySize, "%31sMonitor +%s%s%s\n",
-                                           "",
-                                           rkGlobalParameters.showColor ? RKMonokaiYellow : "",
-                                           filename,
-                                           rkGlobalParameters.showColor ? RKNoColor : "");
-                }
-            }
-        } else {
-            RKLog("%s Error creating %s\n", engine->name, filename);
-        }
+        RKSweepEnginePostJob(engine, NULL, collection, filename);
+        RKSweepEngineWaitForJobs(engine);
     } else if (engine->verbose > 1) {
         RKLog("%s Skipping %s ...\n", engine->name, filename);
     }
@@ -485,21 +465,10 @@ static void *sweepManager(void *in) {
     // Save a copy of the last recorded scratch space index
     engine->lastRecordedScratchSpaceIndex = index;
 
-    // Unmark the state
-    engine->state ^= RKEngineStateWritingFile;
-
     // We are done with the sweep
     RKSweepFree(sweep);
 
     if (record && engine->hasFileHandlingScript) {
-        if (engine->verbose > 1) {
-            RKLog("%s CMD: %s\n", engine->name, filelist);
-        }
-        j = system(filelist);
-        if (j) {
-            RKLog("%s Error. CMD: %s", engine->name, filelist);
-            RKLog("%s Error. Failed using system() -> %d   errno = %d\n", engine->name, j, errno);
-        }
         // Potential filenames that may be generated by the custom command. Need to notify file manager about them.
         if (engine->productCollectionRecorder) {
             RKReplaceFileExtension(filename, strrchr(filename, '.'), ".__");
@@ -523,9 +492,9 @@ static void *sweepManager(void *in) {
                         filename,
                         rkGlobalParameters.showColor ? RKNoColor : "");
             }
-            if (engine->fileManager && RKFilenameExists(filename)) {
-                RKFileManagerAddFile(engine->fileManager, filename, RKFileTypeMoment);
-            }
+            RKSweepEngineRunFileHandlingScript(engine, filelist, filename);
+        } else {
+            RKSweepEngineRunFileHandlingScript(engine, filelist, NULL);
         }
     }
     RKStripTail(summary + summarySize);
@@ -533,26 +502,187 @@ static void *sweepManager(void *in) {
     // Show a summary of all the files created
     RKLog("%s %s", engine->name, summary);
 
-    pthread_mutex_lock(&engine->productMutex);
-    engine->business--;
-    pthread_mutex_unlock(&engine->productMutex);
+}
+
+#pragma mark - Delegate Workers
+
+static void *productWriter(void *in) {
+    RKSweepWriter *me = (RKSweepWriter *)in;
+    RKSweepEngine *engine = me->parent;
+
+    int i;
+    uint32_t n;
+    struct timeval t0, t1;
+    RKSweepWriterJob job;
+
+    // Initiate my name
+    if (rkGlobalParameters.showColor) {
+        i = snprintf(me->name, RKChildNameLength, "%s %s", engine->name, RKGetColorOfIndex(me->id));
+    } else {
+        i = snprintf(me->name, RKChildNameLength, "%s ", engine->name);
+    }
+    i += snprintf(me->name + i, RKChildNameLength - i, engine->writerCount > 9 ? "W%02d" : "W%d", me->id);
+    if (rkGlobalParameters.showColor) {
+        snprintf(me->name + i, RKChildNameLength - i, RKNoColor);
+    }
+
+    if (engine->verbose > 1) {
+        RKLog(">%s Started.\n", me->name);
+    }
+
+    me->tic = 1;
+
+    while (true) {
+        pthread_mutex_lock(&engine->queueMutex);
+        while (engine->jobTakeCount == engine->jobPostCount && engine->state & RKEngineStateChildActive) {
+            pthread_cond_wait(&engine->jobPosted, &engine->queueMutex);
+        }
+        if (engine->jobTakeCount == engine->jobPostCount) {
+            pthread_mutex_unlock(&engine->queueMutex);
+            break;
+        }
+        job = engine->jobs[engine->jobTakeCount % RKSweepEngineJobQueueDepth];
+        engine->jobTakeCount++;
+        pthread_cond_signal(&engine->jobTaken);
+        pthread_mutex_unlock(&engine->queueMutex);
+
+        if (engine->verbose > 1) {
+            RKLog("%s Creating %s ...\n", me->name, job.filename);
+        }
+        // Products are views into the ray buffer, skip the job if the moment engine has taken some of the rays
+        gettimeofday(&t0, NULL);
+        if ((n = RKSweepEngineCountRecycledRays(&job))) {
+            RKLog("%s Error. Skipped %s   %s rays were recycled.\n", me->name, job.filename, RKIntegerToCommaStyleString(n));
+            i = RKResultFailedToWriteProduct;
+        } else {
+            // Recorders run concurrently, the netCDF writers serialize the calls into the library themselves
+            RKPreparePath(job.filename);
+            if (job.product) {
+                i = engine->productRecorder(job.product, job.filename);
+            } else {
+                i = engine->productCollectionRecorder(&job.collection, job.filename, RKWriterOptionNone);
+            }
+            // Rays recycled during the write leave a file with mixed sweeps, which is discarded
+            if (i == RKResultSuccess && (n = RKSweepEngineCountRecycledRays(&job))) {
+                RKLog("%s Error. Removed %s   %s rays were recycled while writing.\n", me->name, job.filename, RKIntegerToCommaStyleString(n));
+                remove(job.filename);
+                i = RKResultFailedToWriteProduct;
+            }
+        }
+        gettimeofday(&t1, NULL);
+        if (i == RKResultSuccess) {
+            // Notify file manager of a new addition if the file handling script does not remove them
+            if (engine->fileManager && !(engine->fileHandlingScriptProperties & RKScriptPropertyRemoveNCFiles)) {
+                RKFileManagerAddFile(engine->fileManager, job.filename, RKFileTypeMoment);
+                if (engine->verbose > 1) {
+                    RKLog("%s Monitor +%s%s%s\n", me->name,
+                          rkGlobalParameters.showColor ? RKMonokaiYellow : "",
+                          job.filename,
+                          rkGlobalParameters.showColor ? RKNoColor : "");
+                }
+            }
+            me->fileCount++;
+        } else if (n == 0) {
+            RKLog("%s Error creating %s\n", me->name, job.filename);
+        }
+        me->writeTime = RKTimevalDiff(t1, t0);
+
+        pthread_mutex_lock(&engine->queueMutex);
+        if (n) {
+            engine->almostFull++;
+        }
+        engine->writeTime = me->writeTime;
+        engine->writeTimeMaximum = MAX(engine->writeTimeMaximum, me->writeTime);
+        engine->jobDoneCount++;
+        pthread_cond_broadcast(&engine->jobDone);
+        pthread_mutex_unlock(&engine->queueMutex);
+
+        me->tic++;
+    }
+
+    if (engine->verbose > 1) {
+        RKLog(">%s Stopped.   fileCount = %s\n", me->name, RKIntegerToCommaStyleString(me->fileCount));
+    }
 
     return NULL;
 }
 
-#pragma mark - Delegate Workers
+static void *sweepManager(void *in) {
+    RKSweepEngine *engine = (RKSweepEngine *)in;
+
+    uint8_t index;
+
+    while (true) {
+        pthread_mutex_lock(&engine->queueMutex);
+        while (engine->sweepTakeCount == engine->sweepPostCount && engine->state & RKEngineStateWantActive) {
+            pthread_cond_wait(&engine->sweepPosted, &engine->queueMutex);
+        }
+        if (engine->sweepTakeCount == engine->sweepPostCount) {
+            pthread_mutex_unlock(&engine->queueMutex);
+            break;
+        }
+        index = engine->sweepQueue[engine->sweepTakeCount % RKSweepEngineSweepQueueDepth];
+        engine->sweepTakeCount++;
+        pthread_mutex_unlock(&engine->queueMutex);
+
+        // Notify the ray gatherer that I have grabbed the sweep
+        engine->tic++;
+
+        if (engine->productCollectionRecorder) {
+            sweepHandler(engine, index);
+        } else if (engine->productRecorder) {
+            sweepHandlerV1(engine, index);
+        }
+
+        pthread_mutex_lock(&engine->queueMutex);
+        engine->sweepDoneCount++;
+        if (engine->sweepDoneCount == engine->sweepPostCount) {
+            engine->state &= ~RKEngineStateWritingFile;
+        }
+        pthread_cond_broadcast(&engine->sweepDone);
+        pthread_mutex_unlock(&engine->queueMutex);
+
+        pthread_mutex_lock(&engine->productMutex);
+        engine->business--;
+        pthread_mutex_unlock(&engine->productMutex);
+    }
+
+    return NULL;
+}
+
+// Undo a partial start of the ray gatherer: stop the writers that have been launched, release the resources
+// and wake up RKSweepEngineStart(), which collects the result through pthread_join()
+static void *rayGathererAbort(RKSweepEngine *engine, const int writerCount, const int productCount, const int result) {
+    int k;
+    pthread_mutex_lock(&engine->queueMutex);
+    engine->state &= ~(RKEngineStateWantActive | RKEngineStateChildActive);
+    pthread_cond_broadcast(&engine->jobPosted);
+    pthread_mutex_unlock(&engine->queueMutex);
+    for (k = 0; k < writerCount; k++) {
+        pthread_join(engine->writers[k].tid, NULL);
+    }
+    if (engine->writers) {
+        engine->memoryUsage -= engine->writerCount * sizeof(RKSweepWriter);
+        free(engine->writers);
+        engine->writers = NULL;
+    }
+    for (k = 0; k < productCount; k++) {
+        RKSweepEngineUndescribeProduct(engine, engine->productIds[k]);
+    }
+    engine->tic = 1;
+    return (void *)(intptr_t)result;
+}
 
 static void *rayGatherer(void *in) {
     RKSweepEngine *engine = (RKSweepEngine *)in;
 
-    int j, n, p, s;
+    int j, k, n, p, s;
 
     struct timeval t0, t1;
 
     uint32_t is = 0;   // Start index
     uint64_t tic = 0;  // Local copy of engine tic
 
-    pthread_t tidSweepManager = (pthread_t)0;
     pthread_t tidRayReleaser = (pthread_t)0;
 
     RKRay *ray;
@@ -580,15 +710,51 @@ static void *rayGatherer(void *in) {
                (engine->fileHandlingScriptProperties & RKScriptPropertyProduceTxz ? ".txz" :
                 (engine->fileHandlingScriptProperties & RKScriptPropertyProduceTgz ? ".tgz" : ".zip"))) : "");
     }
-    RKLog("%s Started.   mem = %s B   productCount = %d   rayIndex = %d\n",
-        engine->name, RKUIntegerToCommaStyleString(engine->memoryUsage), productCount, *engine->rayIndex);
+    // Product writers
+    engine->writers = (RKSweepWriter *)malloc(engine->writerCount * sizeof(RKSweepWriter));
+    if (engine->writers == NULL) {
+        RKLog("%s Error. Unable to allocate product writers.\n", engine->name);
+        return rayGathererAbort(engine, 0, productCount, RKResultFailedToCreateUnitWorker);
+    }
+    memset(engine->writers, 0, engine->writerCount * sizeof(RKSweepWriter));
+    engine->memoryUsage += engine->writerCount * sizeof(RKSweepWriter);
+    engine->sweepPostCount = 0;
+    engine->sweepTakeCount = 0;
+    engine->sweepDoneCount = 0;
+    engine->jobPostCount = 0;
+    engine->jobTakeCount = 0;
+    engine->jobDoneCount = 0;
+    engine->state |= RKEngineStateChildActive;
+    for (k = 0; k < engine->writerCount; k++) {
+        RKSweepWriter *writer = &engine->writers[k];
+        writer->id = k;
+        writer->parent = engine;
+        if (pthread_create(&writer->tid, NULL, productWriter, writer) != 0) {
+            RKLog("%s Error. Failed to start a product writer.\n", engine->name);
+            return rayGathererAbort(engine, k, productCount, RKResultFailedToCreateUnitWorker);
+        }
+    }
+    if (engine->hasFileHandlingScript && RKHookRunnerStart(engine->hookRunner) != RKResultSuccess) {
+        RKLog("%s Error. Failed to start a hook runner.\n", engine->name);
+        return rayGathererAbort(engine, engine->writerCount, productCount, RKResultFailedToStartHookRunner);
+    }
+    if (pthread_create(&engine->tidSweepManager, NULL, sweepManager, engine) != 0) {
+        RKLog("%s Error. Failed to start a sweep manager.\n", engine->name);
+        if (engine->hookRunner->state & RKEngineStateWantActive) {
+            RKHookRunnerStop(engine->hookRunner);
+        }
+        return rayGathererAbort(engine, engine->writerCount, productCount, RKResultFailedToStartRayGatherer);
+    }
 
-    // Increase the tic once to indicate the engine is ready
-    engine->tic = 1;
+    RKLog("%s Started.   mem = %s B   productCount = %d   writerCount = %d   rayIndex = %d\n",
+        engine->name, RKUIntegerToCommaStyleString(engine->memoryUsage), productCount, engine->writerCount, *engine->rayIndex);
 
     // Update the engine state
     engine->state |= RKEngineStateActive;
 
+    // Increase the tic once to indicate the engine is ready
+    engine->tic = 1;
+
     gettimeofday(&t1, NULL); t1.tv_sec -= 1;
 
     j = 0;   // ray index
@@ -658,23 +824,17 @@ static void *rayGatherer(void *in) {
                 RKLog("%s Info. RKMarkerSweepEnd   is = %d   j = %d   n = %d\n", engine->name, is, j, n);
             }
 
-            // If the sweepManager is still going, wait for it to finish, launch a new one, wait for engine->scratchSpaceIndex is grabbed through engine->tic
-            if (tidSweepManager) {
-                pthread_join(tidSweepManager, NULL);
+            // Queue the sweep for the sweepManager. Wait if it has fallen RKSweepEngineSweepQueueDepth sweeps behind
+            // so that the scratch space the rayReleaser is about to release has been fully handled
+            pthread_mutex_lock(&engine->queueMutex);
+            while (engine->sweepPostCount - engine->sweepDoneCount >= RKSweepEngineSweepQueueDepth) {
+                pthread_cond_wait(&engine->sweepDone, &engine->queueMutex);
             }
-            tic = engine->tic;
-            if (engine->productCollectionRecorder) {
-                if (pthread_create(&tidSweepManager, NULL, sweepManager, engine)) {
-                    RKLog("%s Error. Unable to launch a sweep writer.\n", engine->name);
-                }
-            } else if (engine->productRecorder) {
-                if (pthread_create(&tidSweepManager, NULL, sweepManagerV1, engine)) {
-                    RKLog("%s Error. Unable to launch a sweep writer.\n", engine->name);
-                }
-            }
-            do {
-                usleep(50000);
-            } while (tic == engine->tic && engine->state & RKEngineStateWantActive);
+            engine->sweepQueue[engine->sweepPostCount % RKSweepEngineSweepQueueDepth] = engine->scratchSpaceIndex;
+            engine->sweepPostCount++;
+            engine->state |= RKEngineStateWritingFile;
+            pthread_cond_signal(&engine->sweepPosted);
+            pthread_mutex_unlock(&engine->queueMutex);
 
             // If the rayReleaser is still going, wait for it to finish, launch a new one, wait for engine->scratchSpaceIndex is grabbed through engine->tic
             if (tidRayReleaser) {
@@ -757,10 +917,29 @@ static void *rayGatherer(void *in) {
         // Update k to catch up for the next watch
         j = RKNextModuloS(j, engine->radarDescription->rayBufferDepth);
     }
-    if (tidSweepManager) {
-        pthread_join(tidSweepManager, NULL);
-        tidSweepManager = (pthread_t)0;
-    }
+    if (tidRayReleaser) {
+        pthread_join(tidRayReleaser, NULL);
+    }
+    // The sweepManager finishes the sweeps in the queue before it exits, then the writers finish the jobs
+    pthread_mutex_lock(&engine->queueMutex);
+    pthread_cond_broadcast(&engine->sweepPosted);
+    pthread_mutex_unlock(&engine->queueMutex);
+    pthread_join(engine->tidSweepManager, NULL);
+    engine->tidSweepManager = (pthread_t)0;
+    pthread_mutex_lock(&engine->queueMutex);
+    engine->state ^= RKEngineStateChildActive;
+    pthread_cond_broadcast(&engine->jobPosted);
+    pthread_mutex_unlock(&engine->queueMutex);
+    for (k = 0; k < engine->writerCount; k++) {
+        pthread_join(engine->writers[k].tid, NULL);
+    }
+    // Scripts that have been queued still run to completion
+    if (engine->hookRunner->state & RKEngineStateWantActive) {
+        RKHookRunnerStop(engine->hookRunner);
+    }
+    engine->memoryUsage -= engine->writerCount * sizeof(RKSweepWriter);
+    free(engine->writers);
+    engine->writers = NULL;
     for (p = 0; p < productCount; p++) {
         RKSweepEngineUndescribeProduct(engine, engine->productIds[p]);
     }
@@ -792,7 +971,19 @@ RKSweepEngine *RKSweepEngineInit(void) {
         return NULL;
     }
     pthread_mutex_init(&engine->productMutex, NULL);
-    engine->memoryUsage = sizeof(RKSweepEngine) + bytes;
+    pthread_mutex_init(&engine->queueMutex, NULL);
+    pthread_cond_init(&engine->sweepPosted, NULL);
+    pthread_cond_init(&engine->sweepDone, NULL);
+    pthread_cond_init(&engine->jobPosted, NULL);
+    pthread_cond_init(&engine->jobTaken, NULL);
+    pthread_cond_init(&engine->jobDone, NULL);
+    engine->writerCount = RKSweepEngineDefaultWriterCount;
+    engine->hookRunner = RKHookRunnerInit();
+    if (engine->hookRunner == NULL) {
+        RKLog("Error. Unable to allocate a hook runner for sweep engine.\n");
+        return NULL;
+    }
+    engine->memoryUsage = sizeof(RKSweepEngine) + sizeof(RKHookRunner) + bytes;
     return engine;
 }
 
@@ -801,7 +992,14 @@ void RKSweepEngineFree(RKSweepEngine *engine) {
         RKSweepEngineStop(engine);
     }
     pthread_mutex_destroy(&engine->productMutex);
+    pthread_mutex_destroy(&engine->queueMutex);
+    pthread_cond_destroy(&engine->sweepPosted);
+    pthread_cond_destroy(&engine->sweepDone);
+    pthread_cond_destroy(&engine->jobPosted);
+    pthread_cond_destroy(&engine->jobTaken);
+    pthread_cond_destroy(&engine->jobDone);
     RKProductBufferFree(engine->productBuffer, engine->productBufferDepth);
+    RKHookRunnerFree(engine->hookRunner);
     free(engine);
 }
 
@@ -809,6 +1007,7 @@ void RKSweepEngineFree(RKSweepEngine *engine) {
 
 void RKSweepEngineSetVerbose(RKSweepEngine *engine, const int verbose) {
     engine->verbose = verbose;
+    RKHookRunnerSetVerbose(engine->hookRunner, verbose);
 }
 
 void RKSweepEngineSetEssentials(RKSweepEngine *engine, RKRadarDesc *desc, RKFileManager _Nullable *fileManager,
@@ -837,10 +1036,37 @@ void RKSweepEngineSetFilesHandlingScript(RKSweepEngine *engine, const char *scri
     }
 }
 
+// Number of file handling scripts that may run at the same time
+void RKSweepEngineSetFilesHandlingConcurrency(RKSweepEngine *engine, const uint8_t count) {
+    RKHookRunnerSetConcurrency(engine->hookRunner, count);
+}
+
+// Maximum run time of a file handling script (s), 0 for no limit
+void RKSweepEngineSetFilesHandlingTimeout(RKSweepEngine *engine, const double timeout) {
+    RKHookRunnerSetTimeout(engine->hookRunner, timeout);
+}
+
 void RKSweepEngineSetProductRecorder(RKSweepEngine *engine, int (*routine)(RKProduct *, const char *)) {
     engine->productRecorder = routine;
 }
 
+// e.g., RKProductCollectionFileWriterRK() with extension "rkp" for the native format
+void RKSweepEngineSetProductCollectionRecorder(RKSweepEngine *engine, int (*routine)(RKProductCollection *, const char *, uint32_t)) {
+    engine->productCollectionRecorder = routine;
+}
+
+void RKSweepEngineSetProductFileExtension(RKSweepEngine *engine, const char *extension) {
+    snprintf(engine->productFileExtension, RKMaximumFileExtensionLength, "%s", extension);
+}
+
+void RKSweepEngineSetWriterCount(RKSweepEngine *engine, const uint8_t count) {
+    if (engine->state & RKEngineStateActive) {
+        RKLog("%s Error. Writer count cannot be changed while active.\n", engine->name);
+        return;
+    }
+    engine->writerCount = MIN(MAX(count, 1), RKSweepEngineMaximumWriterCount);
+}
+
 void RKSweepEngineFlush(RKSweepEngine *engine) {
     int k;
     uint32_t waitIndex = *engine->rayIndex;
@@ -912,6 +1138,12 @@ int RKSweepEngineStart(RKSweepEngine *engine) {
     while (engine->tic == 0) {
         usleep(10000);
     }
+    if (!(engine->state & RKEngineStateActive)) {
+        void *result;
+        pthread_join(engine->tidRayGatherer, &result);
+        engine->tidRayGatherer = (pthread_t)0;
+        return (int)(intptr_t)result;
+    }
     return RKResultSuccess;
 }
 
@@ -50,6 +50,14 @@
 printf("%s %s" RKNoColor "\n", str, res ? RKGreenColor "okay" : RKRedColor "too high") : \
 printf("%s %s\n", str, res ? "okay" : "too high");
 
+// Number of checks that have failed, see RKTestFailureCount()
+static int rkTestFailureCount = 0;
+
+#define TEST_SUCCESS(str, res)       ((res) ? (void)0 : (void)rkTestFailureCount++), \
+rkGlobalParameters.showColor ? \
+printf("%-70s : %s" RKNoColor "\n", str, res ? RKGreenColor "successful" : RKRedColor "failed") : \
+printf("%-70s : %s\n", str, res ? "successful" : "failed");
+
 typedef struct rk_spline {
     float head;
     float tail;
@@ -135,10 +143,81 @@ static void *popLoop(void *in) {
     return NULL;
 }
 
+typedef struct rk_test_clock_writer {
+    RKClock *clock;
+    int64_t time;
+    int count;
+    bool done;
+} RKTestClockWriter;
+
+// Noiseless readings, 1,000 tics per microsecond, every published mapping must agree with them
+static void *clockWriter(void *in) {
+    RKTestClockWriter *writer = (RKTestClockWriter *)in;
+    struct timespec t;
+    for (int k = 0; k < writer->count; k++) {
+        const int64_t x = writer->time + 1000LL * k;
+        t.tv_sec = x / 1000000000LL;
+        t.tv_nsec = x % 1000000000LL;
+        RKClockGetTimeOfReading(writer->clock, (double)(1000000LL * k), &t);
+    }
+    __atomic_store_n(&writer->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+typedef struct rk_test_config_writer {
+    RKConfig *configs;
+    uint32_t configIndex;
+    uint32_t depth;
+    int count;
+    bool done;
+} RKTestConfigWriter;
+
+// The sweep index of every config is its identifier
+static void *configWriter(void *in) {
+    RKTestConfigWriter *writer = (RKTestConfigWriter *)in;
+    for (int k = 0; k < writer->count; k++) {
+        RKConfigAdvanceEllipsis(writer->configs, &writer->configIndex, writer->depth, RKConfigKeySweepIndex, k, RKConfigKeyNull);
+    }
+    __atomic_store_n(&writer->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+typedef struct rk_test_log_worker {
+    int count;
+    int interval;
+    double *costs;
+} RKTestLogWorker;
+
+// A hot worker that logs, the cost of every RKLog() call is kept
+static void *logWorker(void *in) {
+    RKTestLogWorker *worker = (RKTestLogWorker *)in;
+    struct timespec t0, t1;
+    for (int k = 0; k < worker->count; k++) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        RKLog("<PulseCompressor> Warning. Overloaded   pulse %s   lag = %.2f   k = %d\n",
+              RKIntegerToCommaStyleString(1000000 + k), 0.85f, k);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        worker->costs[k] = 1.0e9 * RKTimespecDiff(t1, t0);
+        if (worker->interval) {
+            usleep(worker->interval);
+        }
+    }
+    return NULL;
+}
+
+static int double_cmp(const void *a, const void *b) {
+    const double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
 #pragma mark - Test Wrapper and Help Text
 
+int RKTestFailureCount(void) {
+    return rkTestFailureCount;
+}
+
 char *RKTestByNumberDescription(const int indent) {
-    static char text[4096];
+    static char text[8192];
     char helpText[] =
     "\n"
     UNDERLINE("100 series - basic") "\n"
@@ -154,6 +233,9 @@ char *RKTestByNumberDescription(const int indent) {
     "110 - Generating text for health overview\n"
     "111 - Revise boolean values\n"
     "112 - Time conversion\n"
+    "113 - Clock regression with jittered tics\n"
+    "114 - Config lookup by identifier - RKConfigWithId()\n"
+    "115 - Tokenize health strings into records\n"
     "\n"
     UNDERLINE("200 series - file handling functions") "\n"
     "201 - Count files using RKCountFilesInPath(); -T201 PATH\n"
@@ -169,6 +251,10 @@ char *RKTestByNumberDescription(const int indent) {
     "211 - Write product data from a plain file into a set of RKProductCollection\n"
     "212 - Write CF/radial data from a set of WDSS-II files into RKProductCollection; rkutil -T212 FILENAME\n"
     "213 - Write compressed CF/radial data from a set of WDSS-II files into RKProductCollection; rkutil -T213 FILENAME\n"
+    "214 - Raw data recorder write fault (ENOSPC) using /dev/full\n"
+    "215 - Product views of a sweep without copying - RKProductInitViewFromSweep()\n"
+    "216 - Native product file round trip - RKProductCollectionFileWriterRK()\n"
+    "217 - Preference index of a large file - RKPreferenceFindKeyword()\n"
     "\n"
     UNDERLINE("300 series - state machines") "\n"
     "301 - File manager module - RKFileManagerInit()\n"
@@ -180,6 +266,20 @@ char *RKTestByNumberDescription(const int indent) {
     "307 - Illustrate a simple RKPulseEngine() -T306 MODE (0 = no wait, 1 = process, 2 = consume)\n"
     "308 - Illustrate a simple RKMomentEngine() -T307 MODE (0 = show, 1 = archive)\n"
     "309 - Illustrate a command queue-dequeue mechanism\n"
+    "310 - Hook runner module - RKHookRunnerInit()\n"
+    "311 - RKWebSocket loopback with permessage-deflate\n"
+    "312 - RKRadarRelay two-process loopback with resume\n"
+    "313 - Position engine module - RKPositionEngineInit() -T313 ORDER (0 = linear, 2 = acceleration)\n"
+    "314 - File index with changes from other processes - RKFileManagerAddFile()\n"
+    "315 - Rate-limited file removal - RKFileManagerSetRemovalRate()\n"
+    "316 - Host monitor on the loopback - RKHostMonitorLatencyString()\n"
+    "317 - Command center on the loopback with a soft restart - RKCommandCenterStart()\n"
+    "318 - Ray stream blocks shared by two users - RKCommandCenter\n"
+    "319 - WebSocket port of RKServer on the loopback - RKServerSetWebSocketPort()\n"
+    "320 - Zero-copy sends and the copy fallback - RKServerSetZeroCopyThreshold()\n"
+    "321 - File manager stop while files are being written - RKFileManagerStop()\n";
+    // Two parts, each within the length of string literals compilers are required to support
+    char moreHelpText[] =
     "\n"
     UNDERLINE("400 seris - DSP functions") "\n"
     "401 - SIMD quick test\n"
@@ -213,9 +313,12 @@ char *RKTestByNumberDescription(const int indent) {
     "602 - Measure the speed of pulse compression math\n"
     "603 - Measure the speed of RKPulseEngine() -T603 CORES (default = 4)\n"
     "604 - Measure the speed of various moment methods\n"
-    "605 - Measure the speed of cached write\n";
-    RKIndentCopy(text, helpText, indent);
-    if (strlen(text) > 3000) {
+    "605 - Measure the speed of cached write\n"
+    "606 - Measure the size and speed of ray stream codecs - RKNetworkEncode()\n"
+    "607 - Measure the cost of RKLog() from hot workers - RKSetAsynchronousLog()\n";
+    int k = RKIndentCopy(text, helpText, indent);
+    RKIndentCopy(text + k, moreHelpText, indent);
+    if (strlen(text) > 7000) {
         fprintf(stderr, "Warning. Approaching limit. (%zu)\n", strlen(text));
     }
     return text;
@@ -261,6 +364,15 @@ void RKTestByNumber(const int number, const void *arg) {
         case 112:
             RKTestTimeConversion();
             break;
+        case 113:
+            RKTestClockRegression();
+            break;
+        case 114:
+            RKTestConfigWithId();
+            break;
+        case 115:
+            RKTestHealthRecord();
+            break;
 
         case 201:
             RKTestCountFiles((const char *)arg);
@@ -301,6 +413,18 @@ void RKTestByNumber(const int number, const void *arg) {
         case 213:
             RKTestProductWriteFromWDSS2ToProduct((const char *)arg, 1);
             break;
+        case 214:
+            RKTestRecorderWriteFault();
+            break;
+        case 215:
+            RKTestProductViewFromSweep();
+            break;
+        case 216:
+            RKTestProductNativeFile();
+            break;
+        case 217:
+            RKTestPreferenceIndex();
+            break;
 
         case 301:
             RKTestFileManager();
@@ -331,6 +455,42 @@ void RKTestByNumber(const int number, const void *arg) {
         case 309:
             RKTestCommandQueue();
             break;
+        case 310:
+            RKTestHookRunner();
+            break;
+        case 311:
+            RKTestWebSocketLoopback();
+            break;
+        case 312:
+            RKTestRadarRelayLoopback();
+            break;
+        case 313:
+            RKTestPositionEngine(arg == NULL ? 0 : atoi((char *)arg));
+            break;
+        case 314:
+            RKTestFileIndex();
+            break;
+        case 315:
+            RKTestFileRemovalRate();
+            break;
+        case 316:
+            RKTestHostMonitorLoopback();
+            break;
+        case 317:
+            RKTestCommandCenterLoopback();
+            break;
+        case 318:
+            RKTestRayStreamCache();
+            break;
+        case 319:
+            RKTestServerWebSocket();
+            break;
+        case 320:
+            RKTestServerZeroCopy();
+            break;
+        case 321:
+            RKTestFileManagerStopWhileWriting();
+            break;
 
         case 401:
             RKTestSIMD(RKTestSIMDFlagNull, 0);
@@ -424,6 +584,12 @@ void RKTestByNumber(const int number, const void *arg) {
         case 605:
             RKTestCacheWrite();
             break;
+        case 606:
+            RKTestRayStreamCodecs();
+            break;
+        case 607:
+            RKTestLogSpeed();
+            break;
         case 99:
             RKTestExperiment((const char *)arg);
             break;
@@ -1204,6 +1370,343 @@ void RKTestTimeConversion(void) {
     printf("timeString = %s\n", RKTimevalToString(tv0, 1083, true));
 }
 
+void RKTestClockRegression(void) {
+    SHOW_FUNCTION_NAME
+    int i, j, k;
+    bool okay;
+    char str[256];
+    struct timespec t;
+    struct timeval tv;
+    const int count = 6000;
+    const int stride = 1000;
+    const double prt = 1.0e-3;
+    const double drift = 2.0e-5;
+    const int64_t steps[] = {10000, 1LL << 30};
+
+    // Tic streams of a 10-MHz counter and a fast counter that moves the anchor, the counter runs 20 ppm fast
+    // The arrival times are late by a uniform jitter of 0 - 200 us, and by 2 ms every 97th pulse
+    srand(1);
+    struct timespec s0;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &s0);
+    for (i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        RKClock *clock = RKClockInitWithSize(stride + 1000, stride);
+        RKClockSetName(clock, "<TestClock>");
+        RKClockSetSource(clock, RKClockSourceMonotonicRaw);
+        const int64_t x0 = (int64_t)s0.tv_sec * 1000000000LL + s0.tv_nsec;
+        const int64_t u0 = 1000000000LL;
+        double y, e, sum_e = 0.0, sum_ee = 0.0, sum_j = 0.0, sum_jj = 0.0;
+        int n = 0;
+        for (k = 0; k < count; k++) {
+            const double jitter = 2.0e-4 * (double)rand() / RAND_MAX + (k % 97 == 0 ? 2.0e-3 : 0.0);
+            const int64_t truth = x0 + (int64_t)llround(1.0e9 * k * prt * (1.0 + drift));
+            const int64_t x = truth + (int64_t)llround(1.0e9 * jitter);
+            t.tv_sec = x / 1000000000LL;
+            t.tv_nsec = x % 1000000000LL;
+            y = RKClockGetTimeOfReading(clock, (double)(u0 + k * steps[i]), &t);
+            if (k >= stride) {
+                const int64_t r = truth + clock->epoch;
+                e = y - ((double)(r / 1000000000LL) + 1.0e-9 * (double)(r % 1000000000LL));
+                sum_e += e;
+                sum_ee += e * e;
+                sum_j += jitter;
+                sum_jj += jitter * jitter;
+                n++;
+            }
+        }
+        const double mean = sum_e / n;
+        const double std = sqrt(sum_ee / n - mean * mean);
+        const double latency = sum_j / n;
+        const double slope = clock->dx * steps[i] / prt / (1.0 + drift) - 1.0;
+
+        // Brute-force fit of the latest stride readings for reference
+        long double vm = 0.0, wm = 0.0, vv = 0.0, vw = 0.0;
+        const int l = RKPreviousModuloS(clock->index, clock->size);
+        for (j = 0; j < stride; j++) {
+            k = RKPreviousNModuloS(clock->index, j + 1, clock->size);
+            vm += (long double)(clock->vBuffer[k] - clock->vBuffer[l]);
+            wm += (long double)(clock->wBuffer[k] - clock->wBuffer[l]);
+        }
+        vm /= stride;
+        wm /= stride;
+        for (j = 0; j < stride; j++) {
+            k = RKPreviousNModuloS(clock->index, j + 1, clock->size);
+            const long double v = (long double)(clock->vBuffer[k] - clock->vBuffer[l]) - vm;
+            const long double w = (long double)(clock->wBuffer[k] - clock->wBuffer[l]) - wm;
+            vv += v * v;
+            vw += v * w;
+        }
+        const double reference = (double)(vw / vv);
+
+        printf("step = %s tics   jitter = %.1f us RMS   latency = %.1f us   error = %.1f +/- %.2f us   slope error = %.2f ppm   incremental vs batch = %.2e\n",
+               RKIntegerToCommaStyleString(steps[i]), 1.0e6 * sqrt(sum_jj / n), 1.0e6 * latency, 1.0e6 * mean, 1.0e6 * std,
+               1.0e6 * slope, fabs(1.0e9 * clock->dx / reference - 1.0));
+        okay = fabs(1.0e9 * clock->dx / reference - 1.0) < 1.0e-9;
+        sprintf(str, "Incremental fit equals the batch fit (step = %s)", RKIntegerToCommaStyleString(steps[i]));
+        TEST_SUCCESS(str, okay);
+        // Arrivals are only ever late, so the fit carries the mean latency, which is a constant offset of the source
+        okay = fabs(mean - latency) < 10.0e-6 && std < 10.0e-6 && fabs(slope) < 20.0e-6;
+        sprintf(str, "Bias - latency < 10 us, spread < 10 us, slope error < 20 ppm (step = %s)", RKIntegerToCommaStyleString(steps[i]));
+        TEST_SUCCESS(str, okay);
+        RKClockFree(clock);
+    }
+
+    // Readers see a whole mapping while the writer is updating
+    RKTestClockWriter writer = {
+        .clock = RKClockInitWithSize(2000, 1000),
+        .time = (int64_t)s0.tv_sec * 1000000000LL + s0.tv_nsec,
+        .count = 1000000
+    };
+    RKClockSetName(writer.clock, "<TestClock>");
+    RKClockSetSource(writer.clock, RKClockSourceTAI);
+    RKClockMapping mapping;
+    pthread_t tid;
+    uint64_t reads = 0, torn = 0;
+    pthread_create(&tid, NULL, clockWriter, &writer);
+    while (!__atomic_load_n(&writer.done, __ATOMIC_ACQUIRE)) {
+        RKClockGetMapping(writer.clock, &mapping);
+        if (mapping.count == 0) {
+            continue;
+        }
+        const int64_t expected = writer.time + writer.clock->epoch + mapping.tic / 1000LL;
+        if (llabs(mapping.time - expected) > 1 || fabs(mapping.slope - 1.0e-3) > 1.0e-9) {
+            torn++;
+        }
+        reads++;
+    }
+    pthread_join(tid, NULL);
+    printf("reads = %s   torn = %s\n", RKUIntegerToCommaStyleString(reads), RKUIntegerToCommaStyleString(torn));
+    TEST_SUCCESS("Mapping through the seqlock is never torn", torn == 0 && reads > 0);
+    RKClockFree(writer.clock);
+
+    // Live sources against the wall clock
+    const RKClockSource sources[] = {RKClockSourceMonotonicRaw, RKClockSourceTAI};
+    for (i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        RKClock *clock = RKClockInitWithSize(200, 100);
+        RKClockSetName(clock, "<TestClock>");
+        RKClockSetSource(clock, sources[i]);
+        double y = 0.0;
+        for (k = 0; k < 200; k++) {
+            y = RKClockGetTime(clock, (double)(10000 * k), NULL);
+            usleep(500);
+        }
+        gettimeofday(&tv, NULL);
+        const double x = (double)tv.tv_sec - clock->initDay + 1.0e-6 * (double)tv.tv_usec;
+        printf("%s   y = %.6f   gettimeofday() = %.6f   difference = %.3f ms   y(tic) = %.6f\n",
+               sources[i] == RKClockSourceTAI ? "CLOCK_TAI" : "CLOCK_MONOTONIC_RAW",
+               y, x, 1.0e3 * (x - y), RKClockGetTimeOfTic(clock, (double)(10000 * (k - 1))));
+        sprintf(str, "%s agrees with gettimeofday() within 10 ms", sources[i] == RKClockSourceTAI ? "CLOCK_TAI" : "CLOCK_MONOTONIC_RAW");
+        TEST_SUCCESS(str, fabs(x - y) < 0.01);
+        RKClockFree(clock);
+    }
+}
+
+void RKTestConfigWithId(void) {
+    SHOW_FUNCTION_NAME
+    int k;
+    bool okay;
+    RKConfig *config;
+    RKTestConfigWriter writer = {.depth = 8, .count = 200000};
+
+    RKConfigBufferAlloc(&writer.configs, writer.depth);
+    for (k = 0; k < 20; k++) {
+        RKConfigAdvanceEllipsis(writer.configs, &writer.configIndex, writer.depth, RKConfigKeySweepIndex, k, RKConfigKeyNull);
+    }
+    okay = true;
+    for (k = 0; k < 20; k++) {
+        config = RKConfigWithId(writer.configs, writer.depth, k);
+        if (k < 20 - writer.depth) {
+            okay &= config == NULL;
+        } else {
+            okay &= config == &writer.configs[k % writer.depth] && config->sweepIndex == k;
+        }
+    }
+    TEST_SUCCESS("Latest configs at id % depth, retired ids not found", okay);
+
+    // Unaligned identifiers are still found through the scan
+    for (k = 0; k < writer.depth; k++) {
+        writer.configs[k].i += 3;
+    }
+    okay = RKConfigWithId(writer.configs, writer.depth, 15) == &writer.configs[12 % writer.depth];
+    TEST_SUCCESS("Unaligned identifiers through the fallback", okay);
+    RKConfigBufferFree(writer.configs);
+
+    // A bad waveform leaves the slot retired, the next config takes its place
+    RKConfigBufferAlloc(&writer.configs, writer.depth);
+    writer.configIndex = 0;
+    for (k = 0; k < 20; k++) {
+        RKConfigAdvanceEllipsis(writer.configs, &writer.configIndex, writer.depth, RKConfigKeySweepIndex, k, RKConfigKeyNull);
+    }
+    RKConfigAdvanceEllipsis(writer.configs, &writer.configIndex, writer.depth, RKConfigKeySweepIndex, 99, RKConfigKeyWaveform, NULL, RKConfigKeyNull);
+    okay = RKConfigWithId(writer.configs, writer.depth, 20 - writer.depth) == NULL && writer.configIndex == 20 % writer.depth;
+    RKConfigAdvanceEllipsis(writer.configs, &writer.configIndex, writer.depth, RKConfigKeySweepIndex, 20, RKConfigKeyNull);
+    config = RKConfigWithId(writer.configs, writer.depth, 20);
+    okay &= config == &writer.configs[20 % writer.depth] && config->sweepIndex == 20;
+    TEST_SUCCESS("Bad waveform does not republish the slot", okay);
+    RKConfigBufferFree(writer.configs);
+
+    // Readers look up the latest config while a writer keeps advancing
+    RKConfigBufferAlloc(&writer.configs, writer.depth);
+    writer.configIndex = 0;
+    pthread_t tid;
+    uint64_t reads = 0, misses = 0, torn = 0;
+    RKLog("Advancing %s configs ...\n", RKIntegerToCommaStyleString(writer.count));
+    pthread_create(&tid, NULL, configWriter, &writer);
+    while (!__atomic_load_n(&writer.done, __ATOMIC_ACQUIRE)) {
+        const uint32_t index = __atomic_load_n(&writer.configIndex, __ATOMIC_ACQUIRE);
+        const RKIdentifier id = __atomic_load_n(&writer.configs[RKPreviousModuloS(index, writer.depth)].i, __ATOMIC_ACQUIRE);
+        if (id == RKConfigIdInvalid || id >= (RKIdentifier)writer.count) {
+            continue;
+        }
+        config = RKConfigWithId(writer.configs, writer.depth, id);
+        if (config == NULL) {
+            misses++;
+            continue;
+        }
+        const uint32_t sweepIndex = config->sweepIndex;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&config->i, __ATOMIC_RELAXED) == id && sweepIndex != id) {
+            torn++;
+        }
+        reads++;
+    }
+    pthread_join(tid, NULL);
+    printf("reads = %s   misses = %s   torn = %s\n",
+           RKUIntegerToCommaStyleString(reads), RKUIntegerToCommaStyleString(misses), RKUIntegerToCommaStyleString(torn));
+    TEST_SUCCESS("Readers never see a config that is being written", torn == 0 && reads > 0);
+    RKConfigBufferFree(writer.configs);
+}
+
+void RKTestHealthRecord(void) {
+    SHOW_FUNCTION_NAME
+    int i, j, k, n;
+    bool okay;
+    char *stringObject, *stringValue, *stringEnum;
+    char key[RKNameLength];
+    RKHealthSlot *slot;
+    RKHealthRecord record, other;
+    struct timeval tic, toc;
+    const char string[] = "{"
+    "\"Trigger\":{\"Value\":\"TRUE\",\"Enum\":1}, "
+    "\"FPGA Temp\":{\"Value\":\"79.5degC\",\"Enum\":0}, "
+    "\"GPS Latitude\":{\"Value\":\"35.1812820\",\"Enum\":0}, "
+    "\"GPS Heading\":{\"Value\":\"88.0 deg\", \"Enum\":0}, "
+    "\"Transmit H\":{\"Value\":\"-inf\", \"Enum\":5}, "
+    "\"Noise\":[0.123,0.456], "
+    "\"FFTPlanUsage\":{\"128\":2,\"256\":1}, "
+    "\"Event\":\"none\", "
+    "\"TransceiverCounter\": 12345, "
+    "\"Log Time\":1493410480"
+    "}";
+    printf("%s\n", string);
+
+    n = RKHealthRecordFromString(&record, string);
+    okay = n == 10;
+    for (k = 0; k < record.count; k++) {
+        slot = &record.slots[k];
+        stringObject = RKGetValueOfKey(string, slot->key);
+        if (slot->hasStatus) {
+            stringValue = RKGetValueOfKey(stringObject, "value");
+            stringEnum = RKGetValueOfKey(stringObject, "enum");
+            RKReviseLogicalValues(stringValue);
+            okay &= !strcmp(slot->value, stringValue) && slot->status == atoi(stringEnum);
+            printf("%-20s %-14s %.4f %d\n", slot->key, slot->value, slot->number, slot->status);
+        } else {
+            okay &= !strcmp(slot->value, stringObject);
+            printf("%-20s %-14s %.4f\n", slot->key, slot->value, slot->number);
+        }
+    }
+    TEST_SUCCESS("Slots agree with RKGetValueOfKey()", okay);
+
+    slot = RKHealthRecordFind(&record, "gps latitude");
+    okay = slot != NULL && slot->number == 35.181282 && isinf(RKHealthRecordFind(&record, "Transmit H")->number);
+    TEST_SUCCESS("Numbers of quoted values with units", okay);
+
+    // Render and tokenize again
+    char *text = (char *)malloc(4 * RKMaximumStringLength);
+    i = sprintf(text, "{");
+    i += RKHealthRecordToString(&record, text + i, RKMaximumStringLength - i);
+    sprintf(text + i - 2, "}");
+    printf("%s\n", text);
+    okay = RKHealthRecordFromString(&other, text) == record.count;
+    for (k = 0; k < other.count; k++) {
+        okay &= !strcmp(other.slots[k].key, record.slots[k].key) && !strcmp(other.slots[k].value, record.slots[k].value) &&
+                other.slots[k].hasStatus == record.slots[k].hasStatus && other.slots[k].status == record.slots[k].status;
+    }
+    TEST_SUCCESS("Round trip through RKHealthRecordToString()", okay);
+
+    // Strings that do not fit are left to the caller
+    i = sprintf(text, "{");
+    for (k = 0; k < RKHealthRecordSlotCount + 1; k++) {
+        i += sprintf(text + i, "\"Key %d\":{\"Value\":true,\"Enum\":0}, ", k);
+    }
+    sprintf(text + i - 2, "}");
+    okay = RKHealthRecordFromString(&other, text) == -1;
+    okay &= RKHealthRecordFromString(&other, "{\"Key\":\"A value that is too long to fit in the slot of a health record, really\"}") == -1;
+    okay &= RKHealthRecordFromString(&other, "{\"Key\":{\"Value\":true,\"Enum\":0}") == -1;
+    TEST_SUCCESS("Too many keys, long values and incomplete strings are rejected", okay);
+
+    // Typed records
+    RKHealthRecordReset(&other);
+    RKHealthRecordAddBool(&other, "Trigger", true, RKStatusEnumActive);
+    RKHealthRecordAddNumber(&other, "FPGA Temp", 79.5, "\"%.1fdegC\"", RKStatusEnumNormal);
+    RKHealthRecordAdd(&other, "Log Time", "1493410480");
+    okay = other.count == 3 && RKHealthRecordFind(&other, "FPGA Temp")->number == 79.5
+        && !strcmp(RKHealthRecordFind(&other, "FPGA Temp")->value, "\"79.5degC\"")
+        && RKHealthRecordHasStatus(&other, RKStatusEnumActive) && !RKHealthRecordHasStatus(&other, RKStatusEnumFault);
+    TEST_SUCCESS("Typed records through RKHealthRecordAdd*()", okay);
+
+    // Key lookups of every node in the combined string versus in the records
+    const int nodeCounts[] = {1, 4, 12};
+    const int keyCount = 20;
+    const int m = 100;
+    double t0, t1;
+    RKHealthRecord *records = (RKHealthRecord *)malloc(nodeCounts[2] * sizeof(RKHealthRecord));
+    for (j = 0; j < sizeof(nodeCounts) / sizeof(int); j++) {
+        i = sprintf(text, "{");
+        for (n = 0; n < nodeCounts[j]; n++) {
+            for (k = 0; k < keyCount; k++) {
+                i += sprintf(text + i, "\"Node %d Key %d\":{\"Value\":\"%.2f V\",\"Enum\":0}, ", n, k, 0.1 * k);
+            }
+        }
+        sprintf(text + i - 2, "}");
+        gettimeofday(&tic, NULL);
+        for (i = 0; i < m; i++) {
+            for (n = 0; n < nodeCounts[j]; n++) {
+                for (k = 0; k < keyCount; k++) {
+                    sprintf(key, "Node %d Key %d", n, k);
+                    RKGetValueOfKey(text, key);
+                }
+            }
+        }
+        gettimeofday(&toc, NULL);
+        t0 = RKTimevalDiff(toc, tic) / m;
+        // Each node is a string of its own, tokenize once then look up
+        char *node = (char *)malloc(RKMaximumStringLength);
+        gettimeofday(&tic, NULL);
+        for (i = 0; i < m; i++) {
+            for (n = 0; n < nodeCounts[j]; n++) {
+                int c = sprintf(node, "{");
+                for (k = 0; k < keyCount; k++) {
+                    c += sprintf(node + c, "\"Node %d Key %d\":{\"Value\":\"%.2f V\",\"Enum\":0}, ", n, k, 0.1 * k);
+                }
+                sprintf(node + c - 2, "}");
+                RKHealthRecordFromString(&records[n], node);
+                for (k = 0; k < keyCount; k++) {
+                    sprintf(key, "Node %d Key %d", n, k);
+                    RKHealthRecordFind(&records[n], key);
+                }
+            }
+        }
+        gettimeofday(&toc, NULL);
+        t1 = RKTimevalDiff(toc, tic) / m;
+        free(node);
+        printf("nodes = %2d   keys = %3d   RKGetValueOfKey() %8.1f us   RKHealthRecordFromString() %8.1f us\n",
+               nodeCounts[j], nodeCounts[j] * keyCount, 1.0e6 * t0, 1.0e6 * t1);
+    }
+    free(records);
+    free(text);
+}
+
 #pragma region File Handling
 
 void RKTestCountFiles(const char *arg) {
@@ -1779,221 +2282,1887 @@ void RKTestProductWriteFromPlainToProduct(void) {
         }
         memcpy(product->data, src, rayCount * gateCount * sizeof(float));
 
-        sprintf(filename, "data/RK-%s-A%.1f-%s.nc", datestring, product->header.sweepAzimuth, product->desc.symbol);
-        RKPreparePath(filename);
-        printf("filename = '%s'\n", filename);
-        RKProductFileWriterNC(product, filename);
-    }
+        sprintf(filename, "data/RK-%s-A%.1f-%s.nc", datestring, product->header.sweepAzimuth, product->desc.symbol);
+        RKPreparePath(filename);
+        printf("filename = '%s'\n", filename);
+        RKProductFileWriterNC(product, filename);
+    }
+
+    sprintf(filename, "data/RK-%s-A%.1f.nc", datestring, collection->products[0].header.sweepAzimuth);
+    RKPreparePath(filename);
+    printf("filename = '%s'\n", filename);
+    RKProductCollectionFileWriterCF(collection, filename, RKWriterOptionNone);
+
+    RKProductCollectionFree(collection);
+}
+
+void RKTestProductWriteFromWDSS2ToProduct(const char *source, const int mode) {
+    SHOW_FUNCTION_NAME
+    RKLog("source = '%s'\n", source);
+    RKProductCollection *collection = RKProductCollectionInitWithFilename(source);
+    if (collection == NULL) {
+        RKLog("Error. Unable to read the source file.\n");
+        return;
+    }
+
+    RKProduct *product = &collection->products[0];
+
+    product->header.sweepIndex = 42;
+    product->header.volumeIndex = 69;
+    product->header.startTime += 0.000123;
+    if (product->header.endTime == 0) {
+        product->header.endTime = product->header.startTime + 20.0;
+    }
+    product->header.altitude = (double)product->header.radarHeight;
+    for (int k = 0; k < product->header.rayCount; k++) {
+        product->startTime[k] = product->header.startTime + k / 360.0 * 20.0;
+    }
+    sprintf(product->header.momentMethod, "multilag_3");
+
+    // printf("pulseWidth = %f us\n", 1.0e6 * product->header.pw[0]);
+    // printf("momentMethod = %s\n", product->header.momentMethod);
+
+    // Extend collection to add another product (todo ...)
+    // RKProductCollection *newCollecion =
+
+    // RKProductCollectionStandardizeForCFRadial(collection);
+
+    char filename[256];
+    strcpy(filename, source);
+    if (mode == 0) {
+        strcpy(strstr(filename, "-Z.nc"), ".nc");
+        RKProductCollectionFileWriterCF(collection, filename, 0);
+    } else if (mode == 1) {
+        strcpy(strstr(filename, "-Z.nc"), ".cnc");
+        // RKProductCollectionFileWriterCF(collection, filename, RKWriterOptionPackPosition);
+        RKProductCollectionFileWriterCF(collection, filename, RKWriterOptionDeflateFields);
+    }
+    RKProductCollectionFree(collection);
+    RKLog("Output filename = '%s'\n", filename);
+}
+
+void RKTestRecorderWriteFault(void) {
+    SHOW_FUNCTION_NAME
+    bool okay;
+    char str[RKNameLength];
+    const char fullFile[] = "._testfull";
+    const char goodFile[] = "._testwrite";
+    const size_t chunkSize = 256 * 1024;
+
+    // A symbolic link to /dev/full so that any write() gets ENOSPC, and removing it never touches the device node
+    remove(fullFile);
+    if (symlink("/dev/full", fullFile)) {
+        RKLog("Error. Unable to create a link to /dev/full.   errno = %s\n", strerror(errno));
+        return;
+    }
+
+    void *payload = malloc(chunkSize);
+    if (payload == NULL) {
+        RKLog("Error. Unable to allocate payload.\n");
+        remove(fullFile);
+        return;
+    }
+    memset(payload, 0x5a, chunkSize);
+
+    RKRawDataRecorder *engine = RKRawDataRecorderInit();
+    RKRawDataRecorderSetCacheSize(engine, 1024 * 1024);
+    RKRawDataRecorderSetRetryPeriod(engine, 0.2);
+
+    // Fill the cache a few times over, each cache flush hits ENOSPC
+    RKRawDataRecorderNewFile(engine, fullFile);
+    for (int k = 0; k < 16; k++) {
+        RKRawDataRecorderCacheWrite(engine, payload, chunkSize);
+    }
+    RKRawDataRecorderCacheFlush(engine);
+
+    okay = engine->degraded && engine->filePartial && engine->lastErrno == ENOSPC;
+    snprintf(str, sizeof(str), "Degraded instead of exit()   errno = %s", strerror(engine->lastErrno));
+    TEST_SUCCESS(str, okay);
+
+    okay = engine->writeErrorCount == 1 && engine->cacheWriteIndex == 0;
+    snprintf(str, sizeof(str), "Writes skipped while degraded   writeErrorCount = %" PRIu64, engine->writeErrorCount);
+    TEST_SUCCESS(str, okay);
+
+    okay = !RKRawDataRecorderTryRecover(engine);
+    TEST_SUCCESS("No retry before the retry period", okay);
+
+    usleep(250000);
+    okay = RKRawDataRecorderTryRecover(engine) && !engine->degraded;
+    TEST_SUCCESS("Retry after the retry period", okay);
+
+    // Close the descriptor without going through RKRawDataRecorderCloseFile(), which removes empty files
+    close(engine->fd);
+    engine->fd = 0;
+
+    // Back to a regular file, everything should be written out
+    RKRawDataRecorderNewFile(engine, goodFile);
+    for (int k = 0; k < 16; k++) {
+        RKRawDataRecorderCacheWrite(engine, payload, chunkSize);
+    }
+    RKRawDataRecorderCacheFlush(engine);
+    okay = !engine->degraded && !engine->filePartial && engine->fileWriteSize == 16 * chunkSize;
+    snprintf(str, sizeof(str), "Recovered   fileWriteSize = %s B", RKUIntegerToCommaStyleString(engine->fileWriteSize));
+    TEST_SUCCESS(str, okay);
+    RKRawDataRecorderCloseFileQuiet(engine);
+    remove(goodFile);
+
+    // A file that fails part way is renamed so that it does not look complete
+    RKRawDataRecorderNewFile(engine, goodFile);
+    RKRawDataRecorderCacheWrite(engine, payload, chunkSize);
+    RKRawDataRecorderCacheFlush(engine);
+    int fd = open("/dev/full", O_WRONLY);
+    if (fd >= 0) {
+        dup2(fd, engine->fd);
+        close(fd);
+    }
+    RKRawDataRecorderCacheWrite(engine, payload, chunkSize);
+    RKRawDataRecorderCacheFlush(engine);
+    RKRawDataRecorderCloseFileQuiet(engine);
+    snprintf(str, sizeof(str), "%s.part", goodFile);
+    okay = access(goodFile, F_OK) != 0 && access(str, F_OK) == 0 && !strcmp(engine->filename, str);
+    TEST_SUCCESS("Partial file renamed with .part", okay);
+    remove(str);
+
+    remove(fullFile);
+    RKRawDataRecorderFree(engine);
+    free(payload);
+}
+
+void RKTestProductViewFromSweep(void) {
+    SHOW_FUNCTION_NAME
+    int j, k;
+    bool okay;
+    char str[RKNameLength];
+    struct timeval t0, t1;
+    const uint32_t rayCount = 360;
+    const uint32_t gateCount = 2000;
+    const int repeat = 20;
+
+    RKBuffer rays;
+    RKRayBufferAlloc(&rays, 2048, rayCount);
+    RKSweep *sweep = (RKSweep *)malloc(sizeof(RKSweep));
+    memset(sweep, 0, sizeof(RKSweep));
+    sweep->header.rayCount = rayCount;
+    sweep->header.gateCount = gateCount;
+    sweep->header.gateSizeMeters = 30.0f;
+    sweep->header.startTime = 1.6e9;
+    sweep->header.external = true;
+    for (k = 0; k < rayCount; k++) {
+        RKRay *ray = RKGetRayFromBuffer(rays, k);
+        ray->header.gateCount = gateCount;
+        ray->header.startAzimuth = (float)k;
+        ray->header.endAzimuth = (float)(k + 1);
+        RKFloat *x = RKGetFloatDataFromRay(ray, RKProductIndexZ);
+        for (j = 0; j < gateCount; j++) {
+            x[j] = j % 100 == 0 ? NAN : (RKFloat)(k + j) * 0.01f;
+        }
+        sweep->rays[k] = ray;
+    }
+
+    RKProduct *products;
+    RKProductBufferAlloc(&products, 2, rayCount, gateCount);
+    RKProductList list = RKProductListFloatZ;
+    products[0].desc = RKGetNextProductDescription(&list);
+    products[1].desc = products[0].desc;
+
+    gettimeofday(&t0, NULL);
+    for (k = 0; k < repeat; k++) {
+        RKProductInitFromSweep(&products[0], sweep);
+    }
+    gettimeofday(&t1, NULL);
+    const double copyTime = RKTimevalDiff(t1, t0) / repeat;
+    gettimeofday(&t0, NULL);
+    for (k = 0; k < repeat; k++) {
+        RKProductInitViewFromSweep(&products[1], sweep);
+    }
+    gettimeofday(&t1, NULL);
+    const double viewTime = RKTimevalDiff(t1, t0) / repeat;
+
+    okay = products[1].flag & RKProductStatusRayView;
+    for (k = 0; k < rayCount; k++) {
+        okay &= products[1].views[k] == RKGetFloatDataFromRay(sweep->rays[k], RKProductIndexZ);
+    }
+    TEST_SUCCESS("Views reference the ray buffer", okay);
+
+    okay = true;
+    for (k = 0; k < rayCount; k++) {
+        okay &= !memcmp(RKProductGetDataOfRay(&products[0], k), RKProductGetDataOfRay(&products[1], k), gateCount * sizeof(RKFloat));
+        okay &= products[0].startAzimuth[k] == products[1].startAzimuth[k];
+    }
+    TEST_SUCCESS("Same data through RKProductGetDataOfRay()", okay);
+
+    okay = RKProductCountRecycledViews(&products[1]) == 0;
+    RKGetRayFromBuffer(rays, 7)->header.i += 2048;
+    RKGetRayFromBuffer(rays, 9)->header.i += 2048;
+    okay &= RKProductCountRecycledViews(&products[1]) == 2;
+    TEST_SUCCESS("Recycled rays detected through RKProductCountRecycledViews()", okay);
+
+    RKProductFlatten(&products[1]);
+    okay = !(products[1].flag & RKProductStatusRayView) && !memcmp(products[0].data, products[1].data, rayCount * gateCount * sizeof(RKFloat));
+    TEST_SUCCESS("Same data after RKProductFlatten()", okay);
+
+    snprintf(str, sizeof(str), "Copy %.3f ms vs view %.3f ms", 1.0e3 * copyTime, 1.0e3 * viewTime);
+    TEST_SUCCESS(str, viewTime < copyTime);
+
+    RKProductBufferFree(products, 2);
+    RKRayBufferFree(rays);
+    free(sweep);
+}
+
+void RKTestProductNativeFile(void) {
+    SHOW_FUNCTION_NAME
+    int g, k, p, m;
+    bool okay;
+    char str[RKNameLength];
+    struct stat fileStat;
+    struct timeval t0, t1;
+    const uint32_t rayCount = 360;
+    const uint32_t gateCount = 1000;
+    const int productCount = 3;
+    const char *filenames[] = {"data/native.rkp", "data/native-deflated.rkp"};
+    const RKWriterOption options[] = {RKWriterOptionNone, RKWriterOptionDeflateFields};
+
+    TEST_SUCCESS("File header and block sizes", sizeof(RKProductFileHeader) == 4096 && sizeof(RKProductFileBlock) == 1280);
+
+    RKProductCollection *collection = RKProductCollectionInit(productCount, rayCount, gateCount);
+    RKProductList list = RKProductListFloatZ | RKProductListFloatV | RKProductListFloatW;
+    for (p = 0; p < productCount; p++) {
+        RKProduct *product = &collection->products[p];
+        product->desc = RKGetNextProductDescription(&list);
+        sprintf(product->header.radarName, "DemoRadar");
+        product->header.latitude = 35.23682;
+        product->header.longitude = -97.46381;
+        product->header.sweepElevation = 2.4f;
+        product->header.gateSizeMeters = 30.0f;
+        product->header.startTime = 1.6e9;
+        product->header.endTime = 1.6e9 + 10.0;
+        product->header.isPPI = true;
+        for (k = 0; k < rayCount; k++) {
+            product->startAzimuth[k] = (float)k;
+            product->endAzimuth[k] = (float)(k + 1);
+            product->startElevation[k] = 2.4f;
+            product->endElevation[k] = 2.4f;
+            product->startTime[k] = 1.6e9 + 0.025 * k;
+            product->endTime[k] = 1.6e9 + 0.025 * (k + 1);
+            RKFloat *x = product->data + k * gateCount;
+            for (g = 0; g < gateCount; g++) {
+                x[g] = g % 7 == 0 ? NAN : (RKFloat)((k + g) % 80) * 0.5f - 10.0f + (RKFloat)p;
+            }
+        }
+    }
+
+    for (m = 0; m < 2; m++) {
+        gettimeofday(&t0, NULL);
+        k = RKProductCollectionFileWriterRK(collection, filenames[m], options[m]);
+        gettimeofday(&t1, NULL);
+        stat(filenames[m], &fileStat);
+        snprintf(str, sizeof(str), "Write %s in %.2f ms (%s B)", filenames[m], 1.0e3 * RKTimevalDiff(t1, t0),
+                 RKUIntegerToCommaStyleString(fileStat.st_size));
+        TEST_SUCCESS(str, k == RKResultSuccess);
+
+        gettimeofday(&t0, NULL);
+        RKProductCollection *copy = RKProductCollectionInitWithFilename(filenames[m]);
+        gettimeofday(&t1, NULL);
+        if (copy == NULL) {
+            TEST_SUCCESS("Read the file back", false);
+            continue;
+        }
+        okay = copy->count == productCount;
+        for (p = 0; okay && p < productCount; p++) {
+            RKProduct *a = &collection->products[p];
+            RKProduct *b = &copy->products[p];
+            okay &= !strcmp(a->desc.symbol, b->desc.symbol)
+                 && b->header.rayCount == rayCount && b->header.gateCount == gateCount
+                 && b->header.startTime == a->header.startTime
+                 && !strcmp(b->header.radarName, a->header.radarName)
+                 && !memcmp(a->startAzimuth, b->startAzimuth, rayCount * sizeof(RKFloat))
+                 && !memcmp(a->endElevation, b->endElevation, rayCount * sizeof(RKFloat))
+                 && !memcmp(a->endTime, b->endTime, rayCount * sizeof(double))
+                 && (options[m] != RKWriterOptionNone || b->flag & RKProductStatusRayView);
+            for (k = 0; okay && k < rayCount; k++) {
+                okay &= !memcmp(RKProductGetDataOfRay(a, k), RKProductGetDataOfRay(b, k), gateCount * sizeof(RKFloat));
+            }
+        }
+        snprintf(str, sizeof(str), "Identical after reading back in %.2f ms", 1.0e3 * RKTimevalDiff(t1, t0));
+        TEST_SUCCESS(str, okay);
+        RKProductCollectionFree(copy);
+        remove(filenames[m]);
+    }
+
+    RKProductCollectionFree(collection);
+}
+
+void RKTestPreferenceIndex(void) {
+    SHOW_FUNCTION_NAME
+    int k;
+    bool okay;
+    bool flags[2];
+    double value;
+    char root[] = "/tmp/radarkit-XXXXXX";
+    char filename[RKMaximumPathLength];
+    struct timeval t0, t1;
+    RKWaveformCalibration cali;
+    if (mkdtemp(root) == NULL) {
+        RKLog("Error. Unable to create a temporary folder.\n");
+        return;
+    }
+
+    // A site configuration with thousands of waveform calibrations and controls
+    sprintf(filename, "%s/pref.conf", root);
+    FILE *fid = fopen(filename, "w");
+    if (fid == NULL) {
+        RKLog("Error. Unable to create %s.\n", filename);
+        return;
+    }
+    fprintf(fid, "# Generated by %s()\nName        Test\nFlag        yes no\n", __FUNCTION__);
+    for (k = 0; k < 1000; k++) {
+        fprintf(fid, "Key%04d     %d.5 %d\n", k, k, -k);
+    }
+    for (k = 0; k < 2000; k++) {
+        fprintf(fid, "WaveformCal w%04d 1 %.2f 0.02 0.03 0.04\n", k, 0.01 * k);
+        fprintf(fid, "Shortcut    \"S%d\" \"t %d\"   # Control %d\n", k, k, k);
+    }
+    fclose(fid);
+
+    gettimeofday(&t0, NULL);
+    RKPreference *preference = RKPreferenceInitWithFile(filename);
+    gettimeofday(&t1, NULL);
+    printf("Update: %s objects in %.3f ms\n", RKIntegerToCommaStyleString(preference->count), 1.0e3 * RKTimevalDiff(t1, t0));
+    okay = preference->count == 5002 &&
+           RKPreferenceGetKeywordCount(preference, "shortcut") == 2000 &&
+           RKPreferenceGetKeywordCount(preference, "WAVEFORMCAL") == 2000 &&
+           RKPreferenceGetKeywordCount(preference, "Nothing") == 0;
+    TEST_SUCCESS("All lines indexed and counted", okay);
+
+    gettimeofday(&t0, NULL);
+    okay = true;
+    for (k = 0; k < 1000; k++) {
+        sprintf(filename, "key%04d", k);
+        okay &= RKPreferenceGetValueOfKeyword(preference, 0, filename, &value, RKParameterTypeDouble, 1) == RKResultSuccess && value == (double)k + 0.5;
+    }
+    gettimeofday(&t1, NULL);
+    printf("Lookup: 1,000 keywords in %.3f ms\n", 1.0e3 * RKTimevalDiff(t1, t0));
+    okay &= RKPreferenceGetValueOfKeyword(preference, 0, "Flag", flags, RKParameterTypeBool, 2) == RKResultSuccess && flags[0] && !flags[1];
+    okay &= RKPreferenceFindKeyword(preference, "Nothing") == NULL;
+    TEST_SUCCESS("Typed values of keywords, case insensitive", okay);
+
+    k = 0;
+    okay = true;
+    while (RKPreferenceGetValueOfKeyword(preference, 0, "WaveformCal", &cali, RKParameterTypeWaveformCalibration, 0) == RKResultSuccess) {
+        sprintf(filename, "w%04d", k++);
+        okay &= !strcmp(cali.name, filename);
+    }
+    okay &= k == 2000;
+    TEST_SUCCESS("Repeated keywords in file order", okay);
+
+    RKPreferenceFree(preference);
+    RKRemoveFolder(root);
+}
+
+#pragma endregion
+
+#pragma region State Machines
+
+void RKTestFileManager(void) {
+    SHOW_FUNCTION_NAME
+    int e, j, k, s;
+    RKName filename;
+    struct timeval tm;
+    gettimeofday(&tm, NULL);
+    time_t startTime = tm.tv_sec;
+    float es[] = {2.0f, 4.0f, 6.0f, 8.0f};
+    const int ne = sizeof(es) / sizeof(float);
+    char ss[][2] = {"Z", "V", "D", "R"};
+    const int ns = sizeof(ss) / sizeof(RKName);
+    FILE *fid;
+    size_t filesize = 1024 * 1024;
+    char *payload = (char *)malloc(filesize);
+    if (payload == NULL) {
+        fprintf(stderr, "Unable to allocate payload.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const char dataPath[] = "data";
+    RKFileManager *fileManager = RKFileManagerInit();
+    RKFileManagerSetPathToMonitor(fileManager, dataPath);
+    RKFileManagerSetDiskUsageLimit(fileManager, 200 * 1024 * 1024);
+    RKFileManagerSetVerbose(fileManager, 3);
+
+    RKLog("Warning. All data in moment folder will be erased!\n");
+    printf("Press Enter to continue ... 'n' to keep moment files, or Ctrl-C to terminate.\n");
+
+    j = getchar();
+
+    //printf("j = %d = %c\n", j, j);
+    if (j != 'n' && j != 'N') {
+        if (system("rm -rf data/moment") == -1) {
+            RKLog("Error. Failed during system().\n");
+        }
+    }
+
+    RKFileManagerStart(fileManager);
+
+    e = 0;
+    for (j = 0; j < 50; j++) {
+        startTime += 3000;
+        k = sprintf(filename, "%s/%s/", dataPath, RKDataFolderMoment);
+        k += strftime(filename + k, 9, "%Y%m%d", gmtime(&startTime));
+        k += sprintf(filename + k, "/RK-");
+        k += strftime(filename + k, 16, "%Y%m%d-%H%M%S", gmtime(&startTime));
+        k += sprintf(filename + k, "-E%.1f", es[e]);
+
+        for (s = 0; s < ns; s++) {
+            sprintf(filename + k, "-%s.nc", ss[s]);
+
+            RKPreparePath(filename);
+
+            fid = fopen(filename, "w");
+            if (fid == NULL) {
+                fprintf(stderr, "Unable to create file.\n");
+                exit(EXIT_FAILURE);
+            }
+            fwrite(payload, filesize, 1, fid);
+            fclose(fid);
+
+            RKFileManagerAddFile(fileManager, filename, RKFileTypeMoment);
+        }
+        e = RKNextModuloS(e, ne);
+        usleep(500000);
+    }
+
+    RKFileManagerFree(fileManager);
+}
+
+typedef struct rk_test_file_writer {
+    RKFileManager *fileManager;
+    char          *root;
+    int           count;                                   // Files written
+    bool          stop;                                    // Set to stop writing
+    bool          stopped;                                 // Set once RKFileManagerStop() returns
+} RKTestFileWriter;
+
+// Keep writing small moment files, like a recorder that has not been told to stop
+static void *fileWriter(void *in) {
+    RKTestFileWriter *writer = (RKTestFileWriter *)in;
+    char filename[RKMaximumPathLength];
+    char payload[65536];
+    memset(payload, 0x5a, sizeof(payload));
+    while (!__atomic_load_n(&writer->stop, __ATOMIC_ACQUIRE)) {
+        snprintf(filename, sizeof(filename), "%s/%s/20261019/RK-20261019-%06d-E0.5-Z.nc", writer->root, RKDataFolderMoment, writer->count);
+        RKPreparePath(filename);
+        FILE *fid = fopen(filename, "w");
+        if (fid == NULL) {
+            break;
+        }
+        fwrite(payload, sizeof(payload), 1, fid);
+        fclose(fid);
+        RKFileManagerAddFile(writer->fileManager, filename, RKFileTypeMoment);
+        writer->count++;
+        usleep(2000);
+    }
+    return NULL;
+}
+
+static void *fileManagerStopper(void *in) {
+    RKTestFileWriter *writer = (RKTestFileWriter *)in;
+    RKFileManagerStop(writer->fileManager);
+    __atomic_store_n(&writer->stopped, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+void RKTestFileManagerStopWhileWriting(void) {
+    SHOW_FUNCTION_NAME
+    int k;
+    char root[] = "/tmp/radarkit-XXXXXX";
+    struct timeval t0, t1;
+    pthread_t tidWriter, tidStopper;
+    if (mkdtemp(root) == NULL) {
+        RKLog("Error. Unable to create a temporary folder.\n");
+        return;
+    }
+    RKTestFileWriter writer = {.fileManager = RKFileManagerInit(), .root = root};
+    RKFileManagerSetPathToMonitor(writer.fileManager, root);
+    RKFileManagerSetDiskUsageLimit(writer.fileManager, 4 * 1024 * 1024);
+    RKFileManagerStart(writer.fileManager);
+
+    pthread_create(&tidWriter, NULL, fileWriter, &writer);
+    sleep(1);
+
+    // Stop while the files keep coming, give it 5 s
+    gettimeofday(&t0, NULL);
+    pthread_create(&tidStopper, NULL, fileManagerStopper, &writer);
+    for (k = 0; k < 500 && !__atomic_load_n(&writer.stopped, __ATOMIC_ACQUIRE); k++) {
+        usleep(10000);
+    }
+    gettimeofday(&t1, NULL);
+    const bool stopped = __atomic_load_n(&writer.stopped, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&writer.stop, true, __ATOMIC_RELEASE);
+    pthread_join(tidWriter, NULL);
+    printf("files = %d   stop = %.2f s\n", writer.count, RKTimevalDiff(t1, t0));
+    TEST_SUCCESS("File manager stops while files are being written", stopped);
+    if (!stopped) {
+        // The stopper is stuck, nothing can be freed safely
+        return;
+    }
+    pthread_join(tidStopper, NULL);
+    RKFileManagerFree(writer.fileManager);
+    RKRemoveFolder(root);
+}
+
+void RKTestFileMonitor(void) {
+    SHOW_FUNCTION_NAME
+    const char *file = "pref.conf";
+    RKFileMonitor *mon = RKFileMonitorInit(file, &RKTestCallback, NULL);
+    RKLog("Touching file %s ...\n", file);
+    char command[strlen(file) + 10];
+    sprintf(command, "touch %s", file);
+    int k = system(command);
+    if (k) {
+        RKLog("Error. Failed using system() -> %d   errno = %d\n", k, errno);
+    }
+    sleep(2);
+    RKFileMonitorFree(mon);
+}
+
+void RKTestHostMonitor(void) {
+    SHOW_FUNCTION_NAME
+    RKHostMonitor *o = RKHostMonitorInit();
+    if (o == NULL) {
+        fprintf(stderr, "Unable to allocate a Host Monitor.\n");
+        return;
+    }
+    RKHostMonitorSetVerbose(o, 2);
+    RKHostMonitorAddHost(o, "www.amazon.com");
+    RKHostMonitorStart(o);
+    sleep(RKHostMonitorPingInterval * 3 + RKHostMonitorPingInterval - 1);
+    RKHostMonitorFree(o);
+}
+
+void RKTestHostMonitorLoopback(void) {
+    SHOW_FUNCTION_NAME
+    int j, k;
+    bool okay;
+    uint32_t count;
+    RKHostMonitor *o = RKHostMonitorInit();
+    if (o == NULL) {
+        fprintf(stderr, "Unable to allocate a Host Monitor.\n");
+        return;
+    }
+    RKHostMonitorClearHosts(o);
+    RKHostMonitorAddHost(o, "127.0.0.1");
+    RKHostMonitorAddHost(o, "127.0.0.2");
+    RKHostMonitorAddHost(o, "127.0.0.3");
+    RKHostMonitorAddHost(o, "localhost");
+    RKHostMonitorSetPingInterval(o, 0.1);
+    const size_t memoryUsage = o->memoryUsage;
+    RKHostMonitorStart(o);
+    sleep(2);
+    if (o->sd < 0) {
+        RKLog("Warning. No ICMP socket, skipping the test.\n");
+        RKHostMonitorFree(o);
+        return;
+    }
+
+    pthread_mutex_lock(&o->mutex);
+    okay = o->allReachable;
+    for (k = 0; k < o->workerCount; k++) {
+        RKUnitMonitor *host = &o->workers[k];
+        for (count = 0, j = 0; j < RKHostMonitorLatencyBinCount; j++) {
+            count += host->histogram[j];
+        }
+        printf("%-10s  requests = %u   replies = %u   latency = %.3f ms\n",
+               o->hosts[k], host->requestCount, host->replyCount, 1.0e3 * host->latency);
+        okay &= host->replyCount >= 15 && host->replyCount + 1 >= host->requestCount && count == host->replyCount;
+    }
+    pthread_mutex_unlock(&o->mutex);
+    TEST_SUCCESS("All loopback hosts replied through one socket", okay);
+
+    char *string = RKHostMonitorLatencyString(o);
+    printf("%s\n", string);
+    okay = string[0] == '{' && string[strlen(string) - 1] == '}' && strstr(string, "\"127.0.0.3\":{\"Latency\":") != NULL;
+    TEST_SUCCESS("Latency histograms in JSON", okay);
+
+    RKHostMonitorStop(o);
+    TEST_SUCCESS("Memory usage is restored after stopping", o->memoryUsage == memoryUsage);
+
+    RKHostMonitorFree(o);
+}
+
+void RKTestInitializingRadar(void) {
+    SHOW_FUNCTION_NAME
+    RKRadar *aRadar = RKInitLean();
+    RKShowOffsets(aRadar, NULL);
+    RKFree(aRadar);
+}
+
+static void _webSocketHandleOpen(RKWebSocket *w) {
+    char show[160];
+    char message[80];
+    // I know, magic packet here. First byte value = 1 means handshake in RadarHub
+    int r = sprintf(message, "%c{\"radar\":\"radarkit\", \"command\":\"radarConnect\"}", 1);
+    RKBinaryString(show, message, r);
+    RKLog("_webSocketHandleOpen() %s\n", show);
+    RKWebSocketSend(w, message, r);
+}
+
+static void _webSocketHandleMessage(RKWebSocket *w, void *payload, size_t size) {
+    RKLog("_webSocketHandleMessage() %s\n", (char *)payload);
+}
+
+static void _webSocketHandleClose(RKWebSocket *w) {
+    RKLog("_webSocketHandleClose()\n");
+}
+
+void RKTestWebSocket(void) {
+    SHOW_FUNCTION_NAME
+    RKLog("Initializing WebSocket ...");
+    RKWebSocket *w = RKWebSocketInit("radarhub.arrc.ou.edu:443", "/ws/radar/radarkit/");
+    //RKWebSocket *w = RKWebSocketInit("localhost:8000", "/ws/radar/radarkit/");
+    RKWebSocketSetOpenHandler(w, &_webSocketHandleOpen);
+    RKWebSocketSetCloseHandler(w, &_webSocketHandleClose);
+    RKWebSocketSetMessageHandler(w, &_webSocketHandleMessage);
+    RKWebSocketSetVerbose(w, 2);
+
+    RKLog("Starting WebSocket ...");
+    RKWebSocketStart(w);
+    int k = 0;
+    while (!w->connected && k++ < 50) {
+        usleep(10000);
+    }
+    k = 0;
+    while (w->payloadTail < 2 && k++ < 50) {
+        usleep(10000);
+    }
+    RKLog("Handshake and welcome messages received");
+    k = 0;
+    while (k++ < 3000) {
+        usleep(10000);
+    }
+    RKLog("Stopping WebSocket ...");
+    RKWebSocketStop(w);
+    RKWebSocketFree(w);
+}
+
+typedef struct rk_test_websocket_server {
+    int          sd;
+    int          port;
+    int          count;                                // Messages received
+    int          errors;                               // Messages that did not match
+    size_t       wireBytes;                            // Bytes received after the handshake
+    bool         deflate;                              // Agreed to permessage-deflate
+} RKTestWebSocketServer;
+
+static void _webSocketTestPayload(uint8_t *payload, const size_t size, const int k) {
+    // A display ray: a storm cell that moves along the range with a little noise
+    for (int i = 0; i < size; i++) {
+        const float r = (float)i / size - 0.3f - 0.2f * sinf(0.01f * k);
+        const float z = 50.0f * expf(-r * r / 0.01f) + (float)((i * 7 + k * 13) % 5) - 5.0f;
+        payload[i] = z > 0.0f ? (uint8_t)(2.0f * z + 64.0f) : 0;
+    }
+    memcpy(payload, &k, sizeof(int));
+}
+
+static bool _webSocketTestRead(int sd, void *buffer, size_t size, size_t *count) {
+    ssize_t r;
+    size_t k = 0;
+    while (k < size) {
+        if ((r = recv(sd, buffer + k, size - k, 0)) <= 0) {
+            return false;
+        }
+        k += r;
+    }
+    *count += size;
+    return true;
+}
+
+static void *_webSocketTestServer(void *in) {
+    RKTestWebSocketServer *server = (RKTestWebSocketServer *)in;
+    const size_t capacity = RKWebSocketFrameSize;
+    uint8_t *buffer = (uint8_t *)malloc(capacity);
+    uint8_t *message = (uint8_t *)malloc(capacity);
+    uint8_t *expected = (uint8_t *)malloc(capacity);
+    uint8_t header[14];
+    size_t k = 0, size;
+    char *c, key[64], digest[32];
+    z_stream inflater, deflater;
+
+    int sd = accept(server->sd, NULL, NULL);
+    if (sd < 0) {
+        RKLog("Error. Unable to accept().\n");
+        return NULL;
+    }
+    do {
+        ssize_t r = recv(sd, buffer + k, capacity - k - 1, 0);
+        if (r <= 0) {
+            break;
+        }
+        k += r;
+        buffer[k] = '\0';
+    } while (strstr((char *)buffer, "\r\n\r\n") == NULL);
+    if ((c = strstr((char *)buffer, "Sec-WebSocket-Key: ")) != NULL) {
+        sscanf(c + 19, "%63s", key);
+    }
+    RKWebSocketMakeAcceptKey(digest, key);
+    server->deflate &= strstr((char *)buffer, "permessage-deflate") != NULL;
+    k = sprintf((char *)buffer, "HTTP/1.1 101 Switching Protocols\r\n"
+                "Upgrade: websocket\r\n"
+                "Connection: Upgrade\r\n"
+                "Sec-WebSocket-Accept: %s\r\n"
+                "%s"
+                "\r\n",
+                digest, server->deflate ? "Sec-WebSocket-Extensions: permessage-deflate\r\n" : "");
+    send(sd, buffer, k, 0);
+
+    memset(&inflater, 0, sizeof(z_stream));
+    memset(&deflater, 0, sizeof(z_stream));
+    inflateInit2(&inflater, -15);
+    deflateInit2(&deflater, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+    while (_webSocketTestRead(sd, header, 2, &server->wireBytes)) {
+        const int opcode = header[0] & 0x0f;
+        const bool compressed = header[0] & 0x40;
+        size = header[1] & 0x7f;
+        if (size == 126) {
+            _webSocketTestRead(sd, header + 2, 2, &server->wireBytes);
+            size = ntohs(*(uint16_t *)(header + 2));
+        } else if (size == 127) {
+            _webSocketTestRead(sd, header + 2, 8, &server->wireBytes);
+            size = ntohll(*(uint64_t *)(header + 2));
+        }
+        ws_mask_key mask = {.u32 = 0};
+        if (header[1] & 0x80) {
+            _webSocketTestRead(sd, mask.code, 4, &server->wireBytes);
+        }
+        if (size > capacity - 4 || !_webSocketTestRead(sd, buffer, size, &server->wireBytes)) {
+            break;
+        }
+        for (k = 0; k < size; k++) {
+            buffer[k] ^= mask.code[k % 4];
+        }
+        if (opcode == RFC6455_OPCODE_CLOSE) {
+            break;
+        } else if (opcode == RFC6455_OPCODE_PING) {
+            header[0] = 0x80 | RFC6455_OPCODE_PONG;
+            header[1] = (uint8_t)size;
+            send(sd, header, 2, 0);
+            send(sd, buffer, size, 0);
+            continue;
+        } else if (opcode != RFC6455_OPCODE_BINARY) {
+            continue;
+        }
+        if (compressed) {
+            memcpy(buffer + size, "\x00\x00\xff\xff", 4);
+            inflater.next_in = buffer;
+            inflater.avail_in = (uInt)size + 4;
+            inflater.next_out = message;
+            inflater.avail_out = (uInt)capacity;
+            inflate(&inflater, Z_SYNC_FLUSH);
+            size = capacity - inflater.avail_out;
+        } else {
+            memcpy(message, buffer, size);
+        }
+        _webSocketTestPayload(expected, size, server->count);
+        if (memcmp(message, expected, size)) {
+            server->errors++;
+        }
+        if (++server->count % 1000 == 0) {
+            // Say something back, compressed if agreed, so the client side of inflate is exercised too
+            const char text[] = "Received another thousand messages. Received another thousand messages.";
+            size = sizeof(text) - 1;
+            if (server->deflate) {
+                deflater.next_in = (Bytef *)text;
+                deflater.avail_in = (uInt)size;
+                deflater.next_out = message;
+                deflater.avail_out = (uInt)capacity;
+                deflate(&deflater, Z_SYNC_FLUSH);
+                size = capacity - deflater.avail_out - 4;
+            } else {
+                memcpy(message, text, size);
+            }
+            header[0] = 0x80 | (server->deflate ? 0x40 : 0x00) | RFC6455_OPCODE_TEXT;
+            header[1] = (uint8_t)size;
+            send(sd, header, 2, 0);
+            send(sd, message, size, 0);
+        }
+    }
+    inflateEnd(&inflater);
+    deflateEnd(&deflater);
+    close(sd);
+    free(buffer);
+    free(message);
+    free(expected);
+    return NULL;
+}
+
+static int _webSocketTestReplyCount = 0;
+
+static void _webSocketTestHandleMessage(RKWebSocket *w, void *payload, size_t size) {
+    if (!strncmp((char *)payload, "Received another thousand messages.", 35)) {
+        _webSocketTestReplyCount++;
+    }
+}
+
+void RKTestWebSocketLoopback(void) {
+    SHOW_FUNCTION_NAME
+    int j, k, m;
+    char host[64];
+    pthread_t tid;
+    struct timeval time;
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(struct sockaddr_in);
+    double t0, t1;
+    const int count = 10000;
+    const int depth = RKWebSocketPayloadDepth / 2;
+    const size_t size = 4000;
+
+    uint8_t *payloads = (uint8_t *)malloc(depth * size);
+    for (j = 0; j < 2; j++) {
+        RKTestWebSocketServer server;
+        memset(&server, 0, sizeof(RKTestWebSocketServer));
+        server.deflate = j == 1;
+        server.sd = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&sa, 0, sizeof(struct sockaddr_in));
+        sa.sin_family = AF_INET;
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(server.sd, (struct sockaddr *)&sa, sizeof(struct sockaddr_in)) || listen(server.sd, 1)) {
+            RKLog("Error. Unable to start a loopback server.\n");
+            break;
+        }
+        getsockname(server.sd, (struct sockaddr *)&sa, &len);
+        server.port = ntohs(sa.sin_port);
+        pthread_create(&tid, NULL, _webSocketTestServer, &server);
+
+        _webSocketTestReplyCount = 0;
+        sprintf(host, "localhost:%d", server.port);
+        RKWebSocket *w = RKWebSocketInit(host, "/ws/test/");
+        RKWebSocketSetDeflate(w, j == 1);
+        RKWebSocketSetMessageHandler(w, &_webSocketTestHandleMessage);
+        RKWebSocketStart(w);
+        k = 0;
+        while (!w->connected && k++ < 200) {
+            usleep(10000);
+        }
+
+        gettimeofday(&time, NULL);
+        t0 = (double)time.tv_sec + 1.0e-6 * (double)time.tv_usec;
+        for (k = 0; k < count && w->connected; k++) {
+            // A payload is only referenced, so it is not reused until it has been sent
+            m = 0;
+            while ((w->payloadHead - w->payloadTail + RKWebSocketPayloadDepth) % RKWebSocketPayloadDepth >= depth - 1 && m++ < 100000) {
+                usleep(10);
+            }
+            uint8_t *payload = payloads + (k % depth) * size;
+            _webSocketTestPayload(payload, size, k);
+            RKWebSocketSend(w, payload, size);
+        }
+        m = 0;
+        while (server.count < count && m++ < 1000) {
+            usleep(10000);
+        }
+        gettimeofday(&time, NULL);
+        t1 = (double)time.tv_sec + 1.0e-6 * (double)time.tv_usec;
+        m = 0;
+        while (_webSocketTestReplyCount < count / 1000 && m++ < 100) {
+            usleep(10000);
+        }
+        const bool okay = server.count == count && server.errors == 0 && w->deflate == server.deflate && _webSocketTestReplyCount == count / 1000;
+        RKLog(">%-7s %s messages   %s B -> %s B (%.1f %%)   %.1f MB/s   %.1f frames / write   %s\n",
+              j == 1 ? "deflate" : "raw",
+              RKIntegerToCommaStyleString(server.count),
+              RKUIntegerToCommaStyleString(w->payloadByteCount),
+              RKUIntegerToCommaStyleString(server.wireBytes),
+              100.0 * server.wireBytes / MAX(1, w->payloadByteCount),
+              1.0e-6 * w->payloadByteCount / (t1 - t0),
+              (double)count / MAX(1, w->writeCount),
+              okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+        RKWebSocketStop(w);
+        RKWebSocketFree(w);
+        pthread_join(tid, NULL);
+        close(server.sd);
+    }
+    free(payloads);
+}
+
+static bool _relayTestFramesArrived(RKRadarRelay *relay, const uint64_t *counts) {
+    bool arrived = true;
+    for (int k = 0; k < RKRelayChannelCount; k++) {
+        arrived &= relay->frameCounts[k] > counts[k];
+    }
+    return arrived;
+}
+
+void RKTestRadarRelayLoopback(void) {
+    SHOW_FUNCTION_NAME
+    int k, m, port, fd[2];
+    char host[64];
+    pid_t pid;
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(struct sockaddr_in);
+    uint64_t counts[RKRelayChannelCount];
+
+    // An ephemeral port for the command center of the source radar
+    k = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&sa, 0, sizeof(struct sockaddr_in));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(k, (struct sockaddr *)&sa, sizeof(struct sockaddr_in))) {
+        RKLog("Error. Unable to find a free port.\n");
+        close(k);
+        return;
+    }
+    getsockname(k, (struct sockaddr *)&sa, &len);
+    port = ntohs(sa.sin_port);
+    close(k);
+
+    // The source radar lives in another process until the pipe is closed
+    if (pipe(fd)) {
+        RKLog("Error. Unable to create a pipe.\n");
+        return;
+    }
+    if ((pid = fork()) == 0) {
+        close(fd[1]);
+        // A lean radar with the health buffer of a full one, it must outlast the reconnect of the relay, which is
+        // RKNetworkReconnectSeconds. The status buffer is at most RKBufferSSlotCount, less than that at 4 Hz.
+        RKRadarDesc sourceDesc;
+        memset(&sourceDesc, 0, sizeof(RKRadarDesc));
+        sourceDesc.initFlags = RKInitFlagAllocEverything | RKInitFlagSignalProcessor;
+        sourceDesc.pulseCapacity = 2048;
+        sourceDesc.pulseToRayRatio = 1;
+        sourceDesc.configBufferDepth = 10;
+        sourceDesc.healthBufferDepth = RKBufferHSlotCount;
+        sourceDesc.positionBufferDepth = 500;
+        sourceDesc.pulseBufferDepth = 5000;
+        sourceDesc.rayBufferDepth = 1500;
+        RKRadar *radar = RKInitWithDesc(sourceDesc);
+        RKSetVerbosity(radar, 0);
+        RKSetTransceiver(radar, NULL, RKTestTransceiverInit, RKTestTransceiverExec, RKTestTransceiverFree);
+        RKSetPedestal(radar, NULL, RKTestPedestalInit, RKTestPedestalExec, RKTestPedestalFree);
+        RKSetRecordingLevel(radar, 0);
+        RKCommandCenter *center = RKCommandCenterInit();
+        RKCommandCenterSetVerbose(center, 0);
+        RKCommandCenterSetPort(center, port);
+        RKCommandCenterStart(center);
+        RKCommandCenterAddRadar(center, radar);
+        RKGoLive(radar);
+        RKExecuteCommand(radar, "v rr 0,20 245 18", NULL);
+        read(fd[0], &k, sizeof(int));
+        RKCommandCenterRemoveRadar(center, radar);
+        RKCommandCenterStop(center);
+        RKCommandCenterFree(center);
+        RKStop(radar);
+        RKFree(radar);
+        _exit(EXIT_SUCCESS);
+    }
+    close(fd[0]);
+
+    RKRadarDesc desc;
+    memset(&desc, 0, sizeof(RKRadarDesc));
+    desc.initFlags = RKInitFlagRelay;
+    desc.pulseCapacity = 2048;
+    desc.pulseToRayRatio = 1;
+    desc.configBufferDepth = 10;
+    desc.healthBufferDepth = 10;
+    desc.statusBufferDepth = 10;
+    desc.pulseBufferDepth = 5000;
+    desc.rayBufferDepth = 1500;
+    RKRadar *relay = RKInitWithDesc(desc);
+    RKSetVerbosity(relay, 0);
+    RKSetRecordingLevel(relay, 0);
+    sprintf(host, "127.0.0.1:%d", port);
+    RKRadarRelaySetHost(relay->radarRelay, host);
+    RKRadarRelaySetCodec(relay->radarRelay, RKNetworkCodecDeltaDeflate);
+    RKRadarRelayUpdateStreams(relay->radarRelay, RKStreamFromString("!hzvwdprki"));
+    RKGoLive(relay);
+
+    // Health comes after a few seconds, rays after the pedestal starts moving
+    memset(counts, 0, sizeof(counts));
+    m = 0;
+    while (!_relayTestFramesArrived(relay->radarRelay, counts) && m++ < 200) {
+        usleep(100000);
+    }
+    usleep(500000);
+
+    // Drop the connection, the relay reconnects and resumes where it left off
+    memcpy(counts, relay->radarRelay->frameCounts, sizeof(counts));
+    if (relay->radarRelay->client) {
+        shutdown(relay->radarRelay->client->sd, SHUT_RDWR);
+    }
+    m = 0;
+    while (!_relayTestFramesArrived(relay->radarRelay, counts) && m++ < 200) {
+        usleep(100000);
+    }
+    sleep(2);
+
+    const bool arrived = _relayTestFramesArrived(relay->radarRelay, counts);
+    RKLog(">Frames   status %s   health %s   ray %s   pulse %s   gaps %s %s %s %s\n",
+          RKUIntegerToCommaStyleString(relay->radarRelay->frameCounts[RKRelayChannelStatus]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->frameCounts[RKRelayChannelHealth]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->frameCounts[RKRelayChannelRay]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->frameCounts[RKRelayChannelPulse]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->gapCounts[RKRelayChannelStatus]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->gapCounts[RKRelayChannelHealth]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->gapCounts[RKRelayChannelRay]),
+          RKUIntegerToCommaStyleString(relay->radarRelay->gapCounts[RKRelayChannelPulse]));
+    TEST_SUCCESS("Frames of every channel arrive after the reconnect", arrived);
+    TEST_SUCCESS("Health and rays resume without gaps",
+                 relay->radarRelay->gapCounts[RKRelayChannelHealth] == 0 && relay->radarRelay->gapCounts[RKRelayChannelRay] == 0);
+
+    close(fd[1]);
+    waitpid(pid, NULL, 0);
+    RKStop(relay);
+    RKFree(relay);
+}
+
+// Azimuth of the pedestal, accelerating from 300° and crossing 0° along the way
+static float _positionTestAzimuth(const double t) {
+    return (float)fmod(300.0 + 30.0 * t + 2.0 * t * t, 360.0);
+}
+
+// A tagged pulse must follow the azimuth of the pedestal
+static bool _positionTestCheckPulse(RKPulse *pulse, float *error, int *beginCount) {
+    if (!(pulse->header.s & RKPulseStatusHasPosition)) {
+        return false;
+    }
+    float e = fabsf(RKGetSignedMinorSectorInDegrees(pulse->header.azimuthDegrees, _positionTestAzimuth(pulse->header.timeDouble)));
+    *error = MAX(*error, e);
+    if (pulse->header.marker & RKMarkerSweepBegin) {
+        (*beginCount)++;
+    }
+    return true;
+}
+
+void RKTestPositionEngine(const int order) {
+    SHOW_FUNCTION_NAME
+    int k, s;
+    const int count = 50000;
+    const double prt = 2.0e-4;
+    const double period = 0.01;
+    const double latency = 0.02;
+
+    RKRadarDesc desc = {
+        .name = "Hope",
+        .configBufferDepth = 4,
+        .pulseBufferDepth = 2000,
+        .positionBufferDepth = 500,
+        .pulseCapacity = 64,
+    };
+
+    uint32_t configIndex = 0;
+    uint32_t positionIndex = 0;
+    uint32_t pulseIndex = 0;
+
+    RKConfig *configs;
+    RKBuffer pulses;
+    RKPosition *positions = (RKPosition *)malloc(desc.positionBufferDepth * sizeof(RKPosition));
+    memset(positions, 0, desc.positionBufferDepth * sizeof(RKPosition));
+    RKConfigBufferAlloc(&configs, desc.configBufferDepth);
+    RKPulseBufferAlloc(&pulses, desc.pulseCapacity, desc.pulseBufferDepth);
+    RKClearPulseBuffer(pulses, desc.pulseBufferDepth);
+
+    // A new sweep shows the filter count of the waveform
+    RKWaveform *waveform = RKWaveformInitAsImpulse();
+    for (k = 0; k < desc.configBufferDepth; k++) {
+        configs[k].waveform = waveform;
+    }
+
+    RKPositionEngine *engine = RKPositionEngineInit();
+    RKPositionEngineSetEssentials(engine, &desc,
+                                  positions, &positionIndex,
+                                  configs, &configIndex,
+                                  pulses, &pulseIndex);
+    RKPositionEngineSetCoreCount(engine, 4);
+    RKPositionEngineSetPositionModel(engine, order, RKPositionModelDefaultExtrapolation);
+    RKPositionEngineStart(engine);
+
+    RKPulse *pulse;
+    RKPosition *position;
+    struct timeval t0, t1;
+    double t = 1.0, tp = 1.0;
+    float error = 0.0f;
+    int beginCount = 0, taggedCount = 0;
+    bool okay = true;
+
+    RKLog("Positions are %.0f ms behind the pulses   order = %d\n", 1.0e3 * latency, engine->model.order);
+
+    gettimeofday(&t0, NULL);
+    for (k = 0; k < count && okay; k++) {
+        // Positions arrive late, the first pair comes before any pulse
+        while (tp <= MAX(t - latency, 1.0 + period)) {
+            position = &positions[positionIndex];
+            position->timeDouble = tp;
+            position->azimuthDegrees = _positionTestAzimuth(tp);
+            position->elevationDegrees = 0.5f;
+            position->flag = RKPositionFlagReady | RKPositionFlagScanActive | RKPositionFlagElevationPoint | RKPositionFlagAzimuthSweep;
+            positionIndex = RKNextModuloS(positionIndex, desc.positionBufferDepth);
+            RKPositionEngineNotify(engine);
+            tp += period;
+        }
+        // Like the downstream engines, wait for the pulse to be tagged before its slot is reused
+        pulse = RKGetPulseFromBuffer(pulses, pulseIndex);
+        if (k >= desc.pulseBufferDepth) {
+            s = 0;
+            while (!_positionTestCheckPulse(pulse, &error, &beginCount) && s++ < 10000) {
+                usleep(100);
+            }
+            okay = s < 10000;
+            taggedCount++;
+        }
+        pulse = RKGetVacantPulseFromBuffer(pulses, &pulseIndex, desc.pulseBufferDepth);
+        pulse->header.timeDouble = t;
+        pulse->header.gateCount = desc.pulseCapacity;
+        pulse->header.s |= RKPulseStatusHasIQData | RKPulseStatusProcessed | RKPulseStatusRingProcessed;
+        RKPositionEngineNotify(engine);
+        t += prt;
+    }
+    // The positions catch up with the last pulses
+    while (tp <= t + period) {
+        position = &positions[positionIndex];
+        position->timeDouble = tp;
+        position->azimuthDegrees = _positionTestAzimuth(tp);
+        position->elevationDegrees = 0.5f;
+        position->flag = RKPositionFlagReady | RKPositionFlagScanActive | RKPositionFlagElevationPoint | RKPositionFlagAzimuthSweep;
+        positionIndex = RKNextModuloS(positionIndex, desc.positionBufferDepth);
+        RKPositionEngineNotify(engine);
+        tp += period;
+    }
+    for (k = 0; k < desc.pulseBufferDepth && okay; k++) {
+        pulse = RKGetPulseFromBuffer(pulses, pulseIndex);
+        s = 0;
+        while (!_positionTestCheckPulse(pulse, &error, &beginCount) && s++ < 10000) {
+            usleep(100);
+        }
+        okay = s < 10000;
+        taggedCount++;
+        pulseIndex = RKNextModuloS(pulseIndex, desc.pulseBufferDepth);
+    }
+    gettimeofday(&t1, NULL);
+
+    uint64_t extrapolationCount = 0;
+    for (k = 0; k < engine->coreCount; k++) {
+        extrapolationCount += engine->workers[k].extrapolationCount;
+    }
+    okay &= taggedCount == count && beginCount == 1 && error < 0.01f && (order == 0 || extrapolationCount > 0);
+    RKLog(">Tagged %s pulses @ %s pulses / s   coreCount = %d   beginCount = %d   error = %.2e°   %s\n",
+          RKIntegerToCommaStyleString(taggedCount),
+          RKFloatToCommaStyleString((double)taggedCount / RKTimevalDiff(t1, t0)),
+          engine->coreCount, beginCount, error,
+          okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+    RKLog(">Extrapolated %s pulses\n", RKUIntegerToCommaStyleString(extrapolationCount));
+
+    RKPositionEngineStop(engine);
+    RKPositionEngineFree(engine);
+    RKPulseBufferFree(pulses);
+    RKConfigBufferFree(configs);
+    RKWaveformFree(waveform);
+    free(positions);
+}
+
+static void writeFileOfSize(const char *filename, const size_t size) {
+    char *payload = (char *)malloc(size);
+    memset(payload, 0, size);
+    RKPreparePath(filename);
+    FILE *fid = fopen(filename, "w");
+    if (fid) {
+        fwrite(payload, size, 1, fid);
+        fclose(fid);
+    }
+    free(payload);
+}
+
+void RKTestFileIndex(void) {
+    SHOW_FUNCTION_NAME
+    int k;
+    bool okay;
+    char root[] = "/tmp/radarkit-XXXXXX";
+    char filename[RKMaximumPathLength];
+    const size_t size = 100 * 1024;
+    if (mkdtemp(root) == NULL) {
+        RKLog("Error. Unable to create a temporary folder.\n");
+        return;
+    }
+
+    // Two days of moment files before the file manager starts
+    for (k = 0; k < 10; k++) {
+        sprintf(filename, "%s/%s/%s/RK-%s-0000%02d-E1.0-Z.nc", root, RKDataFolderMoment,
+                k < 6 ? "20260101" : "20260102", k < 6 ? "20260101" : "20260102", k);
+        writeFileOfSize(filename, size);
+    }
+
+    RKFileManager *fileManager = RKFileManagerInit();
+    RKFileManagerSetPathToMonitor(fileManager, root);
+    RKFileManagerSetRawDataLimit(fileManager, 100 * size);
+    RKFileManagerSetMomentDataLimit(fileManager, 12 * size);
+    RKFileManagerSetHealthDataLimit(fileManager, 100 * size);
+    RKFileManagerStart(fileManager);
+    RKFileRemover *remover = &fileManager->workers[RKFileTypeMoment];
+
+    okay = remover->count == 10 && remover->usage == 10 * size && remover->folderCount == 2;
+    TEST_SUCCESS("Files listed at start", okay);
+
+    if (remover->fd >= 0) {
+        // A file written and another one removed by some other process
+        sprintf(filename, "%s/%s/20260102/RK-20260102-000010-E1.0-Z.nc", root, RKDataFolderMoment);
+        writeFileOfSize(filename, size);
+        usleep(300000);
+        okay = remover->count == 11 && remover->usage == 11 * size;
+        sprintf(filename, "%s/%s/20260102/RK-20260102-000009-E1.0-Z.nc", root, RKDataFolderMoment);
+        remove(filename);
+        usleep(300000);
+        okay &= remover->count == 10 && remover->usage == 10 * size;
+        TEST_SUCCESS("Files written and removed by others through inotify", okay);
+    } else {
+        RKLog("Warning. inotify is not available, skipping the external changes.\n");
+    }
+
+    // Files from the recorders through RKFileManagerAddFile(), over the limit
+    for (k = 0; k < 4; k++) {
+        sprintf(filename, "%s/%s/20260103/RK-20260103-0000%02d-E1.0-Z.nc", root, RKDataFolderMoment, k);
+        writeFileOfSize(filename, size);
+        RKFileManagerAddFile(fileManager, filename, RKFileTypeMoment);
+    }
+    sleep(2);
+    okay = remover->usage <= remover->limit && remover->count == 12;
+    for (k = 0; k < 6; k++) {
+        sprintf(filename, "%s/%s/20260101/RK-20260101-0000%02d-E1.0-Z.nc", root, RKDataFolderMoment, k);
+        okay &= (access(filename, F_OK) == 0) == (k >= 2);
+    }
+    TEST_SUCCESS("Oldest files removed first", okay);
+
+    for (k = 4; k < 10; k++) {
+        sprintf(filename, "%s/%s/20260103/RK-20260103-0000%02d-E1.0-Z.nc", root, RKDataFolderMoment, k);
+        writeFileOfSize(filename, size);
+        RKFileManagerAddFile(fileManager, filename, RKFileTypeMoment);
+    }
+    sleep(2);
+    sprintf(filename, "%s/%s/20260101", root, RKDataFolderMoment);
+    okay = remover->usage <= remover->limit && access(filename, F_OK) != 0 && remover->folderCount == 2;
+    TEST_SUCCESS("Empty folder removed", okay);
+
+    printf("count = %d   usage = %s B   folders = %d   scans = %s\n",
+           remover->count, RKUIntegerToCommaStyleString(remover->usage), remover->folderCount, RKUIntegerToCommaStyleString(remover->scanCount));
+    TEST_SUCCESS("No full scans after start", remover->scanCount == 1);
+
+    RKFileManagerFree(fileManager);
+    RKRemoveFolder(root);
+}
+
+static int countFilesInFolder(const char *path) {
+    int count = 0;
+    DIR *did = opendir(path);
+    struct dirent *dir;
+    if (did == NULL) {
+        return 0;
+    }
+    while ((dir = readdir(did)) != NULL) {
+        if (dir->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(did);
+    return count;
+}
+
+void RKTestFileRemovalRate(void) {
+    SHOW_FUNCTION_NAME
+    int k;
+    bool okay;
+    char root[] = "/tmp/radarkit-XXXXXX";
+    char folder[RKMaximumPathLength];
+    char filename[RKMaximumPathLength + 64];
+    const size_t size = 10 * 1024;
+    const double rate = 20.0;
+    if (mkdtemp(root) == NULL) {
+        RKLog("Error. Unable to create a temporary folder.\n");
+        return;
+    }
+
+    // Fifty files over the limit, which take a burst of one second worth and then 1.5 s at the rate
+    sprintf(folder, "%s/%s/20260101", root, RKDataFolderMoment);
+    for (k = 0; k < 60; k++) {
+        sprintf(filename, "%s/RK-20260101-0000%02d-E1.0-Z.nc", folder, k);
+        writeFileOfSize(filename, size);
+    }
+
+    RKFileManager *fileManager = RKFileManagerInit();
+    RKFileManagerSetPathToMonitor(fileManager, root);
+    RKFileManagerSetMomentDataLimit(fileManager, 10 * size);
+    RKFileManagerSetRemovalRate(fileManager, rate, 0);
+    RKFileManagerStart(fileManager);
+    RKFileRemover *remover = &fileManager->workers[RKFileTypeMoment];
+
+    usleep(300000);
+    k = countFilesInFolder(folder);
+    printf("count = %d   usage = %s B   files = %d   removed = %s\n",
+           remover->count, RKUIntegerToCommaStyleString(remover->usage), k, RKUIntegerToCommaStyleString(fileManager->removeCount));
+    okay = remover->usage <= remover->limit && remover->count == 10;
+    TEST_SUCCESS("Usage under the limit as the files are queued", okay);
+    okay = k > 10 + 20 && k < 60;
+    TEST_SUCCESS("Files removed at the rate", okay);
+
+    sleep(2);
+    k = countFilesInFolder(folder);
+    printf("count = %d   usage = %s B   files = %d   removed = %s\n",
+           remover->count, RKUIntegerToCommaStyleString(remover->usage), k, RKUIntegerToCommaStyleString(fileManager->removeCount));
+    sprintf(filename, "%s/RK-20260101-000049-E1.0-Z.nc", folder);
+    okay = k == 10 && fileManager->removeCount == 50 && access(filename, F_OK) != 0;
+    TEST_SUCCESS("All files over the limit removed, oldest first", okay);
+
+    RKFileManagerFree(fileManager);
+    RKRemoveFolder(root);
+}
+
+// Read one packet of the command center, the payload is cut short to fit. Returns the packet type or -1
+static int _commandCenterTestRead(const int sd, char *payload, const size_t capacity, uint32_t *size) {
+    RKNetDelimiter delimiter;
+    char scrap[1024];
+    size_t k = 0, n;
+    ssize_t r;
+    if (recv(sd, &delimiter, sizeof(RKNetDelimiter), MSG_WAITALL) != sizeof(RKNetDelimiter)) {
+        return -1;
+    }
+    payload[0] = '\0';
+    if (size) {
+        *size = MIN(delimiter.size, (uint32_t)capacity - 1);
+    }
+    while (k < delimiter.size) {
+        n = MIN(delimiter.size - k, sizeof(scrap));
+        if ((r = recv(sd, scrap, n, MSG_WAITALL)) <= 0) {
+            return -1;
+        }
+        if (k < capacity - 1) {
+            memcpy(payload + k, scrap, MIN((size_t)r, capacity - 1 - k));
+            payload[MIN(k + r, capacity - 1)] = '\0';
+        }
+        k += r;
+    }
+    return delimiter.type;
+}
+
+// A command center on an ephemeral port of the loopback with a lean radar, returns the port or 0
+// An ephemeral port on the loopback, returns 0 if there is none
+static int _commandCenterTestFreePort(void) {
+    int k, port;
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(struct sockaddr_in);
+
+    k = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&sa, 0, sizeof(struct sockaddr_in));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(k, (struct sockaddr *)&sa, sizeof(struct sockaddr_in))) {
+        RKLog("Error. Unable to find a free port.\n");
+        close(k);
+        return 0;
+    }
+    getsockname(k, (struct sockaddr *)&sa, &len);
+    port = ntohs(sa.sin_port);
+    close(k);
+    return port;
+}
+
+static int _commandCenterTestStart(RKRadar **radar, RKCommandCenter **center) {
+    int port = _commandCenterTestFreePort();
+    if (port == 0) {
+        return 0;
+    }
+
+    *radar = RKInitLean();
+    RKSetVerbosity(*radar, 0);
+    RKSetTransceiver(*radar, NULL, RKTestTransceiverInit, RKTestTransceiverExec, RKTestTransceiverFree);
+    RKSetPedestal(*radar, NULL, RKTestPedestalInit, RKTestPedestalExec, RKTestPedestalFree);
+    RKSetRecordingLevel(*radar, 0);
+    *center = RKCommandCenterInit();
+    RKCommandCenterSetVerbose(*center, 0);
+    RKCommandCenterSetPort(*center, port);
+    RKCommandCenterStart(*center);
+    RKCommandCenterAddRadar(*center, *radar);
+    RKGoLive(*radar);
+    return port;
+}
+
+static void _commandCenterTestStop(RKRadar *radar, RKCommandCenter *center) {
+    // Let the server see the clients leave before the radar is gone
+    usleep(500000);
+    RKCommandCenterRemoveRadar(center, radar);
+    RKCommandCenterStop(center);
+    RKCommandCenterFree(center);
+    RKStop(radar);
+    RKFree(radar);
+}
+
+// A client of the command center on the loopback, returns the socket or -1
+static int _commandCenterTestConnect(const int port) {
+    struct sockaddr_in sa;
+    struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+    memset(&sa, 0, sizeof(struct sockaddr_in));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sa.sin_port = htons(port);
+    int sd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(sd, (struct sockaddr *)&sa, sizeof(struct sockaddr_in))) {
+        RKLog("Error. Unable to connect to port %d.\n", port);
+        close(sd);
+        return -1;
+    }
+    return sd;
+}
+
+void RKTestCommandCenterLoopback(void) {
+    SHOW_FUNCTION_NAME
+    int k, sd, port, type;
+    bool okay;
+    char payload[RKMaximumStringLength];
+    struct timeval t0, t1, t2;
+    RKRadar *radar;
+    RKCommandCenter *center;
+
+    if ((port = _commandCenterTestStart(&radar, &center)) == 0) {
+        return;
+    }
+    if ((sd = _commandCenterTestConnect(port)) < 0) {
+        _commandCenterTestStop(radar, center);
+        return;
+    }
+
+    // Health stream first, then a restart through the worker that serves the stream
+    send(sd, "sh\n", 3, 0);
+    k = 0;
+    do {
+        type = _commandCenterTestRead(sd, payload, sizeof(payload), NULL);
+    } while (type != RKNetworkPacketTypeHealth && k++ < 20);
+    okay = type == RKNetworkPacketTypeHealth;
+    RKLog(">Health before 'dr'   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    gettimeofday(&t0, NULL);
+    send(sd, "dr\n", 3, 0);
+    k = 0;
+    do {
+        type = _commandCenterTestRead(sd, payload, sizeof(payload), NULL);
+    } while (!(type == RKNetworkPacketTypeCommandResponse && strstr(payload, "restart")) && k++ < 60);
+    gettimeofday(&t1, NULL);
+    okay &= type == RKNetworkPacketTypeCommandResponse;
+    RKStripTail(payload);
+    RKLog(">Response to 'dr' '%s' in %.2f s   %s\n",
+          type == RKNetworkPacketTypeCommandResponse ? payload : "", RKTimevalDiff(t1, t0),
+          type == RKNetworkPacketTypeCommandResponse ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // The streams are restored after the restart
+    k = 0;
+    do {
+        type = _commandCenterTestRead(sd, payload, sizeof(payload), NULL);
+    } while (type != RKNetworkPacketTypeHealth && k++ < 20);
+    gettimeofday(&t2, NULL);
+    okay &= type == RKNetworkPacketTypeHealth;
+    RKLog(">Health after 'dr' in %.2f s   %s\n", RKTimevalDiff(t2, t1),
+          type == RKNetworkPacketTypeHealth ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
 
-    sprintf(filename, "data/RK-%s-A%.1f.nc", datestring, collection->products[0].header.sweepAzimuth);
-    RKPreparePath(filename);
-    printf("filename = '%s'\n", filename);
-    RKProductCollectionFileWriterCF(collection, filename, RKWriterOptionNone);
+    RKLog(">Command center loopback   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
 
-    RKProductCollectionFree(collection);
+    close(sd);
+    _commandCenterTestStop(radar, center);
 }
 
-void RKTestProductWriteFromWDSS2ToProduct(const char *source, const int mode) {
+void RKTestRayStreamCache(void) {
     SHOW_FUNCTION_NAME
-    RKLog("source = '%s'\n", source);
-    RKProductCollection *collection = RKProductCollectionInitWithFilename(source);
-    if (collection == NULL) {
-        RKLog("Error. Unable to read the source file.\n");
+    int i, k, port, type;
+    int sd[2];
+    uint32_t size;
+    char payload[16384];
+    RKRadar *radar;
+    RKCommandCenter *center;
+
+    // The rays of the first user, looked up by the identifier in the header
+    const int depth = 256;
+    RKIdentifier *identifiers = (RKIdentifier *)malloc(depth * sizeof(RKIdentifier));
+    uint32_t *sizes = (uint32_t *)malloc(depth * sizeof(uint32_t));
+    char *rays = (char *)malloc(depth * sizeof(payload));
+    if (identifiers == NULL || sizes == NULL || rays == NULL) {
+        RKLog("Error. Unable to allocate the ray records.\n");
+        free(identifiers);
+        free(sizes);
+        free(rays);
         return;
     }
+    memset(identifiers, 0, depth * sizeof(RKIdentifier));
 
-    RKProduct *product = &collection->products[0];
-
-    product->header.sweepIndex = 42;
-    product->header.volumeIndex = 69;
-    product->header.startTime += 0.000123;
-    if (product->header.endTime == 0) {
-        product->header.endTime = product->header.startTime + 20.0;
+    if ((port = _commandCenterTestStart(&radar, &center)) == 0) {
+        free(identifiers);
+        free(sizes);
+        free(rays);
+        return;
     }
-    product->header.altitude = (double)product->header.radarHeight;
-    for (int k = 0; k < product->header.rayCount; k++) {
-        product->startTime[k] = product->header.startTime + k / 360.0 * 20.0;
+    // Rays come after the pedestal starts moving
+    RKExecuteCommand(radar, "v rr 0,20 245 18", NULL);
+    for (k = 0; k < 2; k++) {
+        if ((sd[k] = _commandCenterTestConnect(port)) < 0) {
+            while (k-- > 0) {
+                close(sd[k]);
+            }
+            _commandCenterTestStop(radar, center);
+            free(identifiers);
+            free(sizes);
+            free(rays);
+            return;
+        }
+        // Same product, same down-sampling ratio, same codec
+        send(sd[k], "e deflate;sz\n", 13, 0);
     }
-    sprintf(product->header.momentMethod, "multilag_3");
 
-    // printf("pulseWidth = %f us\n", 1.0e6 * product->header.pw[0]);
-    // printf("momentMethod = %s\n", product->header.momentMethod);
+    int count = 0, compared = 0, identical = 0;
+    while (count++ < 1000 && compared < 100) {
+        for (k = 0; k < 2; k++) {
+            type = _commandCenterTestRead(sd[k], payload, sizeof(payload), &size);
+            if (type != RKNetworkPacketTypeRayDisplay || size < sizeof(RKRayHeaderF1)) {
+                continue;
+            }
+            const RKIdentifier identifier = ((RKRayHeaderF1 *)payload)->i;
+            i = (int)(identifier % depth);
+            if (k == 0) {
+                identifiers[i] = identifier;
+                sizes[i] = size;
+                memcpy(rays + i * sizeof(payload), payload, size);
+            } else if (identifiers[i] == identifier) {
+                // The products after the header, the header has the user specific product list
+                compared++;
+                if (sizes[i] == size && !memcmp(rays + i * sizeof(payload) + sizeof(RKRayHeaderF1),
+                                                payload + sizeof(RKRayHeaderF1), size - sizeof(RKRayHeaderF1))) {
+                    identical++;
+                }
+            }
+        }
+    }
 
-    // Extend collection to add another product (todo ...)
-    // RKProductCollection *newCollecion =
+    pthread_mutex_lock(&center->rayStreamMutex);
+    const uint64_t hits = center->rayStreamHitCount;
+    const uint64_t misses = center->rayStreamMissCount;
+    pthread_mutex_unlock(&center->rayStreamMutex);
 
-    // RKProductCollectionStandardizeForCFRadial(collection);
+    RKLog(">Rays compared %d   identical %d   %s\n", compared, identical,
+          compared && identical == compared ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+    RKLog(">Ray stream blocks   hit %s   miss %s   %s\n", RKUIntegerToCommaStyleString(hits), RKUIntegerToCommaStyleString(misses),
+          hits > 0 ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
 
-    char filename[256];
-    strcpy(filename, source);
-    if (mode == 0) {
-        strcpy(strstr(filename, "-Z.nc"), ".nc");
-        RKProductCollectionFileWriterCF(collection, filename, 0);
-    } else if (mode == 1) {
-        strcpy(strstr(filename, "-Z.nc"), ".cnc");
-        // RKProductCollectionFileWriterCF(collection, filename, RKWriterOptionPackPosition);
-        RKProductCollectionFileWriterCF(collection, filename, RKWriterOptionDeflateFields);
+    for (k = 0; k < 2; k++) {
+        close(sd[k]);
     }
-    RKProductCollectionFree(collection);
-    RKLog("Output filename = '%s'\n", filename);
+    _commandCenterTestStop(radar, center);
+    free(identifiers);
+    free(sizes);
+    free(rays);
 }
 
-#pragma endregion
-
-#pragma region State Machines
-
-void RKTestFileManager(void) {
-    SHOW_FUNCTION_NAME
-    int e, j, k, s;
-    RKName filename;
-    struct timeval tm;
-    gettimeofday(&tm, NULL);
-    time_t startTime = tm.tv_sec;
-    float es[] = {2.0f, 4.0f, 6.0f, 8.0f};
-    const int ne = sizeof(es) / sizeof(float);
-    char ss[][2] = {"Z", "V", "D", "R"};
-    const int ns = sizeof(ss) / sizeof(RKName);
-    FILE *fid;
-    size_t filesize = 1024 * 1024;
-    char *payload = (char *)malloc(filesize);
-    if (payload == NULL) {
-        fprintf(stderr, "Unable to allocate payload.\n");
-        exit(EXIT_FAILURE);
-    }
+// A standalone server that echoes every command back as one message
+static int _serverTestQuietHandler(RKOperator *O) {
+    return 0;
+}
 
-    const char dataPath[] = "data";
-    RKFileManager *fileManager = RKFileManagerInit();
-    RKFileManagerSetPathToMonitor(fileManager, dataPath);
-    RKFileManagerSetDiskUsageLimit(fileManager, 200 * 1024 * 1024);
-    RKFileManagerSetVerbose(fileManager, 3);
+static int _serverTestEchoHandler(RKOperator *O) {
+    RKOperatorSendPackets(O, O->cmd, strlen(O->cmd), NULL);
+    return 0;
+}
 
-    RKLog("Warning. All data in moment folder will be erased!\n");
-    printf("Press Enter to continue ... 'n' to keep moment files, or Ctrl-C to terminate.\n");
+static RKServer *_serverTestStart(int *port, int *webSocketPort) {
+    *port = _commandCenterTestFreePort();
+    if (webSocketPort) {
+        *webSocketPort = _commandCenterTestFreePort();
+    }
+    if (*port == 0 || (webSocketPort && *webSocketPort == 0)) {
+        return NULL;
+    }
+    RKServer *M = RKServerInit();
+    RKServerSetName(M, "<TestServer>");
+    RKServerSetPort(M, *port);
+    if (webSocketPort) {
+        RKServerSetWebSocketPort(M, *webSocketPort);
+    }
+    RKServerSetWelcomeHandler(M, &_serverTestQuietHandler);
+    RKServerSetTerminateHandler(M, &_serverTestQuietHandler);
+    RKServerSetCommandHandler(M, &_serverTestEchoHandler);
+    RKServerStart(M);
+    return M;
+}
 
-    j = getchar();
+static void _serverTestStop(RKServer *M) {
+    usleep(200000);
+    RKServerStop(M);
+    RKServerWait(M);
+    RKServerFree(M);
+}
 
-    //printf("j = %d = %c\n", j, j);
-    if (j != 'n' && j != 'N') {
-        if (system("rm -rf data/moment") == -1) {
-            RKLog("Error. Failed during system().\n");
+// A masked client frame with the shortest length encoding, the first split bytes go out separately
+static void _serverTestSendFrame(const int sd, const uint8_t first, const bool masked, const void *payload, const size_t size, const size_t split) {
+    const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    uint8_t *frame = (uint8_t *)malloc(size + 14);
+    size_t k, n = 2;
+    frame[0] = first;
+    if (size < 126) {
+        frame[1] = (uint8_t)size;
+    } else if (size < 65536) {
+        frame[1] = 126;
+        frame[2] = (uint8_t)(size >> 8);
+        frame[3] = (uint8_t)size;
+        n = 4;
+    } else {
+        frame[1] = 127;
+        for (n = 2; n < 10; n++) {
+            frame[n] = (uint8_t)(size >> (8 * (9 - n)));
         }
     }
+    if (masked) {
+        frame[1] |= 0x80;
+        memcpy(frame + n, mask, 4);
+        n += 4;
+    }
+    for (k = 0; k < size; k++) {
+        frame[n + k] = ((uint8_t *)payload)[k] ^ (masked ? mask[k & 3] : 0);
+    }
+    n += size;
+    if (split) {
+        send(sd, frame, split, 0);
+        usleep(50000);
+    }
+    send(sd, frame + split, n - split, 0);
+    free(frame);
+}
 
-    RKFileManagerStart(fileManager);
-
-    e = 0;
-    for (j = 0; j < 50; j++) {
-        startTime += 3000;
-        k = sprintf(filename, "%s/%s/", dataPath, RKDataFolderMoment);
-        k += strftime(filename + k, 9, "%Y%m%d", gmtime(&startTime));
-        k += sprintf(filename + k, "/RK-");
-        k += strftime(filename + k, 16, "%Y%m%d-%H%M%S", gmtime(&startTime));
-        k += sprintf(filename + k, "-E%.1f", es[e]);
-
-        for (s = 0; s < ns; s++) {
-            sprintf(filename + k, "-%s.nc", ss[s]);
-
-            RKPreparePath(filename);
-
-            fid = fopen(filename, "w");
-            if (fid == NULL) {
-                fprintf(stderr, "Unable to create file.\n");
-                exit(EXIT_FAILURE);
-            }
-            fwrite(payload, filesize, 1, fid);
-            fclose(fid);
-
-            RKFileManagerAddFile(fileManager, filename, RKFileTypeMoment);
+// An unmasked server frame, returns the opcode or -1
+static int _serverTestReadFrame(const int sd, uint8_t *payload, const size_t capacity, size_t *size) {
+    uint8_t header[10];
+    size_t k;
+    *size = 0;
+    if (recv(sd, header, 2, MSG_WAITALL) != 2 || (header[1] & 0x80)) {
+        return -1;
+    }
+    *size = header[1] & 0x7f;
+    if (*size == 126) {
+        if (recv(sd, header + 2, 2, MSG_WAITALL) != 2) {
+            return -1;
+        }
+        *size = (size_t)header[2] << 8 | header[3];
+    } else if (*size == 127) {
+        if (recv(sd, header + 2, 8, MSG_WAITALL) != 8) {
+            return -1;
+        }
+        for (*size = 0, k = 2; k < 10; k++) {
+            *size = *size << 8 | header[k];
         }
-        e = RKNextModuloS(e, ne);
-        usleep(500000);
     }
-
-    RKFileManagerFree(fileManager);
+    if (*size > capacity || (*size && recv(sd, payload, *size, MSG_WAITALL) != (ssize_t)*size)) {
+        return -1;
+    }
+    return header[0] & 0x0f;
 }
 
-void RKTestFileMonitor(void) {
-    SHOW_FUNCTION_NAME
-    const char *file = "pref.conf";
-    RKFileMonitor *mon = RKFileMonitorInit(file, &RKTestCallback, NULL);
-    RKLog("Touching file %s ...\n", file);
-    char command[strlen(file) + 10];
-    sprintf(command, "touch %s", file);
-    int k = system(command);
-    if (k) {
-        RKLog("Error. Failed using system() -> %d   errno = %d\n", k, errno);
+// Upgrade request with a key, returns the response header
+static void _serverTestHandshake(const int sd, const char *key, char *response, const size_t capacity) {
+    char request[512];
+    ssize_t r;
+    size_t k = 0;
+    int n = snprintf(request, sizeof(request),
+                     "GET /ws/test/ HTTP/1.1\r\n"
+                     "Host: localhost\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\n"
+                     "Sec-WebSocket-Version: 13\r\n\r\n", key);
+    send(sd, request, n, 0);
+    response[0] = '\0';
+    // One byte at a time so that nothing after the header is taken
+    while (k < capacity - 1 && strstr(response, "\r\n\r\n") == NULL && (r = recv(sd, response + k, 1, 0)) == 1) {
+        response[++k] = '\0';
     }
-    sleep(2);
-    RKFileMonitorFree(mon);
 }
 
-void RKTestHostMonitor(void) {
+void RKTestServerWebSocket(void) {
     SHOW_FUNCTION_NAME
-    RKHostMonitor *o = RKHostMonitorInit();
-    if (o == NULL) {
-        fprintf(stderr, "Unable to allocate a Host Monitor.\n");
+    int sd, port, webSocketPort, opcode;
+    bool okay;
+    char response[1024];
+    char digest[64];
+    size_t k, size;
+    const size_t capacity = 128 * 1024;
+    uint8_t *message = (uint8_t *)malloc(capacity);
+    uint8_t *payload = (uint8_t *)malloc(capacity);
+
+    RKServer *M = _serverTestStart(&port, &webSocketPort);
+    if (M == NULL || message == NULL || payload == NULL) {
+        RKLog("Error. Unable to start a loopback server.\n");
+        free(message);
+        free(payload);
         return;
     }
-    RKHostMonitorSetVerbose(o, 2);
-    RKHostMonitorAddHost(o, "www.amazon.com");
-    RKHostMonitorStart(o);
-    sleep(RKHostMonitorPingInterval * 3 + RKHostMonitorPingInterval - 1);
-    RKHostMonitorFree(o);
-}
 
-void RKTestInitializingRadar(void) {
-    SHOW_FUNCTION_NAME
-    RKRadar *aRadar = RKInitLean();
-    RKShowOffsets(aRadar, NULL);
-    RKFree(aRadar);
-}
+    // A key that is not 16 bytes in base64 is turned away
+    if ((sd = _commandCenterTestConnect(webSocketPort)) >= 0) {
+        _serverTestHandshake(sd, "not-a-websocket-key", response, sizeof(response));
+        okay = strncmp(response, "HTTP/1.1 400", 12) == 0 && recv(sd, message, 1, 0) == 0;
+        RKLog(">Bad Sec-WebSocket-Key   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+        close(sd);
+    }
 
-static void _webSocketHandleOpen(RKWebSocket *w) {
-    char show[160];
-    char message[80];
-    // I know, magic packet here. First byte value = 1 means handshake in RadarHub
-    int r = sprintf(message, "%c{\"radar\":\"radarkit\", \"command\":\"radarConnect\"}", 1);
-    RKBinaryString(show, message, r);
-    RKLog("_webSocketHandleOpen() %s\n", show);
-    RKWebSocketSend(w, message, r);
+    if ((sd = _commandCenterTestConnect(webSocketPort)) < 0) {
+        _serverTestStop(M);
+        free(message);
+        free(payload);
+        return;
+    }
+    // The sample handshake of RFC 6455 1.3
+    _serverTestHandshake(sd, "dGhlIHNhbXBsZSBub25jZQ==", response, sizeof(response));
+    RKWebSocketMakeAcceptKey(digest, "dGhlIHNhbXBsZSBub25jZQ==");
+    okay = strncmp(response, "HTTP/1.1 101", 12) == 0 && strstr(response, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") && strstr(response, digest);
+    RKLog(">Handshake   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // Masked text frame with the header split across two segments
+    _serverTestSendFrame(sd, 0x80 | RFC6455_OPCODE_TEXT, true, "hello", 5, 1);
+    opcode = _serverTestReadFrame(sd, payload, capacity, &size);
+    okay = opcode == RFC6455_OPCODE_BINARY && size == 5 && !memcmp(payload, "hello", 5);
+    RKLog(">Split header   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // A message in two fragments
+    _serverTestSendFrame(sd, RFC6455_OPCODE_TEXT, true, "frag", 4, 0);
+    _serverTestSendFrame(sd, 0x80 | RFC6455_OPCODE_CONTINUATION, true, "ment", 4, 0);
+    opcode = _serverTestReadFrame(sd, payload, capacity, &size);
+    okay = opcode == RFC6455_OPCODE_BINARY && size == 8 && !memcmp(payload, "fragment", 8);
+    RKLog(">Fragmented message   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // 16-bit extended length both ways
+    for (k = 0; k < 300; k++) {
+        message[k] = 'a' + k % 26;
+    }
+    _serverTestSendFrame(sd, 0x80 | RFC6455_OPCODE_TEXT, true, message, 300, 3);
+    opcode = _serverTestReadFrame(sd, payload, capacity, &size);
+    okay = opcode == RFC6455_OPCODE_BINARY && size == 300 && !memcmp(payload, message, 300);
+    RKLog(">Extended length 126   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // 64-bit extended length, the command is the first RKMaximumCommandLength - 1 characters
+    for (k = 0; k < 70000; k++) {
+        message[k] = 'A' + k % 26;
+    }
+    _serverTestSendFrame(sd, 0x80 | RFC6455_OPCODE_TEXT, true, message, 70000, 6);
+    opcode = _serverTestReadFrame(sd, payload, capacity, &size);
+    okay = opcode == RFC6455_OPCODE_BINARY && size == RKMaximumCommandLength - 1 && !memcmp(payload, message, size);
+    RKLog(">Extended length 127   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // Ping is answered by the event loop with the same payload
+    _serverTestSendFrame(sd, 0x80 | RFC6455_OPCODE_PING, true, "beat", 4, 0);
+    opcode = _serverTestReadFrame(sd, payload, capacity, &size);
+    okay = opcode == RFC6455_OPCODE_PONG && size == 4 && !memcmp(payload, "beat", 4);
+    RKLog(">Ping   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    // An unmasked client frame is a protocol error
+    _serverTestSendFrame(sd, 0x80 | RFC6455_OPCODE_TEXT, false, "plain", 5, 0);
+    opcode = _serverTestReadFrame(sd, payload, capacity, &size);
+    okay = opcode == RFC6455_OPCODE_CLOSE && size == 2 && payload[0] == 0x03 && payload[1] == 0xea;
+    RKLog(">Unmasked frame closed with 1002   %s\n", okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+
+    close(sd);
+    _serverTestStop(M);
+    free(message);
+    free(payload);
 }
 
-static void _webSocketHandleMessage(RKWebSocket *w, void *payload, size_t size) {
-    RKLog("_webSocketHandleMessage() %s\n", (char *)payload);
+typedef struct rk_test_zero_copy_sender {
+    int          count;                                // Messages sent
+    int          target;                               // Messages to send
+    int          deferred;                             // Turns skipped while the kernel held the buffer
+    double       longestCheck;                         // Longest RKOperatorZeroCopyReleased() in seconds
+    uint32_t     zeroCopySent;                         // Sends with MSG_ZEROCOPY
+    bool         zeroCopy;                             // Socket still takes MSG_ZEROCOPY at the end
+    uint32_t     header;
+    uint8_t      *buffer;
+    size_t       size;
+} RKTestZeroCopySender;
+
+static void _serverTestZeroCopyPayload(uint8_t *buffer, const size_t size, const int k) {
+    for (size_t i = 0; i < size; i++) {
+        buffer[i] = (uint8_t)(k * 7 + i);
+    }
 }
 
-static void _webSocketHandleClose(RKWebSocket *w) {
-    RKLog("_webSocketHandleClose()\n");
+// Stream handler that reuses one buffer, only after the kernel lets go of it
+static int _serverTestZeroCopyStream(RKOperator *O) {
+    RKTestZeroCopySender *sender = (RKTestZeroCopySender *)O->M->userResource;
+    struct timeval t0, t1;
+    if (sender->count >= sender->target) {
+        return 0;
+    }
+    gettimeofday(&t0, NULL);
+    const bool released = RKOperatorZeroCopyReleased(O);
+    gettimeofday(&t1, NULL);
+    sender->longestCheck = MAX(sender->longestCheck, RKTimevalDiff(t1, t0));
+    if (!released) {
+        sender->deferred++;
+        return 0;
+    }
+    _serverTestZeroCopyPayload(sender->buffer, sender->size, sender->count);
+    sender->header = sender->count;
+    struct iovec vectors[2] = {
+        {.iov_base = &sender->header, .iov_len = sizeof(uint32_t)},
+        {.iov_base = sender->buffer, .iov_len = sender->size}
+    };
+    RKOperatorSendVector(O, vectors, 2, true);
+    sender->zeroCopySent = O->zeroCopySent;
+    sender->zeroCopy = O->zeroCopy;
+    sender->count++;
+    return 0;
 }
 
-void RKTestWebSocket(void) {
+void RKTestServerZeroCopy(void) {
     SHOW_FUNCTION_NAME
-    RKLog("Initializing WebSocket ...");
-    RKWebSocket *w = RKWebSocketInit("radarhub.arrc.ou.edu:443", "/ws/radar/radarkit/");
-    //RKWebSocket *w = RKWebSocketInit("localhost:8000", "/ws/radar/radarkit/");
-    RKWebSocketSetOpenHandler(w, &_webSocketHandleOpen);
-    RKWebSocketSetCloseHandler(w, &_webSocketHandleClose);
-    RKWebSocketSetMessageHandler(w, &_webSocketHandleMessage);
-    RKWebSocketSetVerbose(w, 2);
-
-    RKLog("Starting WebSocket ...");
-    RKWebSocketStart(w);
-    int k = 0;
-    while (!w->connected && k++ < 50) {
-        usleep(10000);
-    }
-    k = 0;
-    while (w->payloadTail < 2 && k++ < 50) {
-        usleep(10000);
-    }
-    RKLog("Handshake and welcome messages received");
-    k = 0;
-    while (k++ < 3000) {
-        usleep(10000);
-    }
-    RKLog("Stopping WebSocket ...");
-    RKWebSocketStop(w);
-    RKWebSocketFree(w);
+    int j, k, sd, port, errors;
+    uint32_t header;
+    RKTestZeroCopySender sender;
+    const size_t size = 64 * 1024;
+    uint8_t *expected = (uint8_t *)malloc(size);
+    uint8_t *received = (uint8_t *)malloc(size);
+
+    for (j = 0; j < 2; j++) {
+        memset(&sender, 0, sizeof(RKTestZeroCopySender));
+        sender.target = 500;
+        sender.size = size;
+        sender.buffer = (uint8_t *)malloc(size);
+        if ((port = _commandCenterTestFreePort()) == 0 || sender.buffer == NULL || expected == NULL || received == NULL) {
+            free(sender.buffer);
+            break;
+        }
+        RKServer *M = RKServerInit();
+        RKServerSetName(M, "<TestServer>");
+        RKServerSetPort(M, port);
+        // Without a threshold SO_ZEROCOPY is never set and every send is copied
+        RKServerSetZeroCopyThreshold(M, j == 0 ? 0 : 16 * 1024);
+        RKServerSetSharedResource(M, &sender);
+        RKServerSetWelcomeHandler(M, &_serverTestQuietHandler);
+        RKServerSetTerminateHandler(M, &_serverTestQuietHandler);
+        RKServerSetStreamHandler(M, &_serverTestZeroCopyStream);
+        RKServerStart(M);
+
+        k = 0;
+        errors = 0;
+        if ((sd = _commandCenterTestConnect(port)) >= 0) {
+            for (; k < sender.target; k++) {
+                if (recv(sd, &header, sizeof(uint32_t), MSG_WAITALL) != sizeof(uint32_t) ||
+                    recv(sd, received, size, MSG_WAITALL) != (ssize_t)size) {
+                    break;
+                }
+                _serverTestZeroCopyPayload(expected, size, (int)header);
+                if (header != (uint32_t)k || memcmp(received, expected, size)) {
+                    errors++;
+                }
+            }
+            close(sd);
+        }
+        const bool okay = k == sender.target && errors == 0;
+        RKLog(">%-9s %d messages   %d errors   %s MSG_ZEROCOPY   %d deferred   %.2f ms longest check   %s   %s\n",
+              j == 0 ? "copy" : "zero-copy", k, errors,
+              RKUIntegerToCommaStyleString(sender.zeroCopySent), sender.deferred, 1.0e3 * sender.longestCheck,
+              j == 0 ? "no SO_ZEROCOPY" : (sender.zeroCopy ? "zero copy" : "fell back to copy"),
+              okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+        _serverTestStop(M);
+        free(sender.buffer);
+    }
+    free(expected);
+    free(received);
 }
 
 void RKTestRadarHub(void) {
@@ -2346,6 +4515,53 @@ void RKTestSimpleMomentEngine(const int mode) {
     RKLog("done");
 }
 
+static void hookRunnerTestCompletion(RKHookJob *job) {
+    RKHookJob *result = (RKHookJob *)job->userResource;
+    memcpy(result, job, sizeof(RKHookJob));
+}
+
+void RKTestHookRunner(void) {
+    SHOW_FUNCTION_NAME
+    int k;
+    char str[RKNameLength];
+    struct timeval t0, t1;
+    RKHookJob *results = (RKHookJob *)malloc(4 * sizeof(RKHookJob));
+    memset(results, 0, 4 * sizeof(RKHookJob));
+
+    RKHookRunner *runner = RKHookRunnerInit();
+    RKHookRunnerSetConcurrency(runner, 2);
+    RKHookRunnerSetTimeout(runner, 0.5);
+    RKHookRunnerStart(runner);
+
+    RKHookRunnerSubmit(runner, "true", NULL, hookRunnerTestCompletion, &results[0]);
+    RKHookRunnerSubmit(runner, "false", NULL, hookRunnerTestCompletion, &results[1]);
+    RKHookRunnerSubmit(runner, "sleep 5", NULL, hookRunnerTestCompletion, &results[2]);
+    RKHookRunnerSubmit(runner, "/nonexistent/command", NULL, hookRunnerTestCompletion, &results[3]);
+    RKHookRunnerWaitWhileBusy(runner);
+
+    TEST_SUCCESS("Exit status of true is 0", results[0].status == 0);
+    TEST_SUCCESS("Exit status of false is 1", results[1].status == 1);
+    snprintf(str, sizeof(str), "Command terminated after %.2f s (status %d)", results[2].elapsedTime, results[2].status);
+    TEST_SUCCESS(str, results[2].timedOut && results[2].status == 128 + SIGTERM && results[2].elapsedTime < 1.0f);
+    TEST_SUCCESS("Missing command reports status -1", results[3].status == -1);
+
+    // Two commands of 0.2 s each should overlap with a concurrency of 2
+    RKHookRunnerSetTimeout(runner, 0.0);
+    gettimeofday(&t0, NULL);
+    for (k = 0; k < 2; k++) {
+        RKHookRunnerSubmit(runner, "sleep 0.2", NULL, NULL, NULL);
+    }
+    RKHookRunnerWaitWhileBusy(runner);
+    gettimeofday(&t1, NULL);
+    snprintf(str, sizeof(str), "Concurrent commands in %.2f s", RKTimevalDiff(t1, t0));
+    TEST_SUCCESS(str, RKTimevalDiff(t1, t0) < 0.35);
+
+    RKHookRunnerStop(runner);
+    TEST_SUCCESS("Spawn count is 5", runner->spawnCount == 5);
+    RKHookRunnerFree(runner);
+    free(results);
+}
+
 #pragma endregion
 
 #pragma region DSP Tests
@@ -4279,6 +6495,125 @@ void RKTestCacheWrite(void) {
     RKRawDataRecorderFree(fileEngine);
 }
 
+void RKTestRayStreamCodecs(void) {
+    SHOW_FUNCTION_NAME
+    int c, f, i, k;
+    const int rayCount = 720;
+    const int gateCount = 4000;
+    struct timeval time;
+    double t0, t1;
+
+    // Synthetic Z: a few storm cells over noise, censored beyond the echoes like the real display data
+    float *f32 = (float *)malloc(rayCount * gateCount * sizeof(float));
+    uint8_t *u8 = (uint8_t *)malloc(rayCount * gateCount * sizeof(uint8_t));
+    srand(1);
+    for (k = 0; k < rayCount; k++) {
+        const float a = (float)k / rayCount * 2.0f * M_PI;
+        for (i = 0; i < gateCount; i++) {
+            const float r = (float)i / gateCount;
+            float z = 45.0f * expf(-powf((r - 0.3f) / 0.05f, 2.0f) - powf(sinf(a - 1.0f) / 0.2f, 2.0f))
+                    + 30.0f * expf(-powf((r - 0.6f) / 0.1f, 2.0f) - powf(sinf(a + 2.0f) / 0.4f, 2.0f))
+                    + 2.0f * ((float)rand() / RAND_MAX - 0.5f) - 5.0f;
+            f32[k * gateCount + i] = z > 0.0f ? z : NAN;
+            u8[k * gateCount + i] = z > 0.0f ? (uint8_t)MIN(255.0f, z * 2.0f + 64.0f) : 0;
+        }
+    }
+
+    const size_t bound = RKNetworkCodecBound(RKNetworkCodecDeflate, gateCount * sizeof(float));
+    void *encoded = malloc(bound);
+    void *decoded = malloc(gateCount * sizeof(float));
+    for (f = 0; f < 2; f++) {
+        const size_t stride = f == 0 ? sizeof(uint8_t) : sizeof(float);
+        const size_t size = gateCount * stride;
+        for (c = 0; c < RKNetworkCodecCount; c++) {
+            bool okay = true;
+            size_t total = 0;
+            gettimeofday(&time, NULL);
+            t0 = (double)time.tv_sec + 1.0e-6 * (double)time.tv_usec;
+            for (k = 0; k < rayCount; k++) {
+                total += RKNetworkEncode(encoded, bound, (f == 0 ? (void *)u8 : (void *)f32) + k * size, size, stride, c);
+            }
+            gettimeofday(&time, NULL);
+            t1 = (double)time.tv_sec + 1.0e-6 * (double)time.tv_usec;
+            // Decode a few rays back for verification
+            for (k = 0; k < rayCount; k += rayCount / 8) {
+                const void *source = (f == 0 ? (void *)u8 : (void *)f32) + k * size;
+                const size_t n = RKNetworkEncode(encoded, bound, source, size, stride, c);
+                okay &= RKNetworkDecode(decoded, size, encoded, n, stride, c) == size && memcmp(decoded, source, size) == 0;
+            }
+            RKLog(">%-5s %-12s %6s B/ray (%5.1f %%)   %7.2f us/ray   %s\n",
+                  f == 0 ? "uint8" : "float", RKNetworkCodecString(c),
+                  RKIntegerToCommaStyleString(total / rayCount), 100.0 * total / (rayCount * size),
+                  1.0e6 * (t1 - t0) / rayCount, okay ? RKGreenColor "okay" RKNoColor : RKRedColor "failed" RKNoColor);
+        }
+    }
+    free(encoded);
+    free(decoded);
+    free(f32);
+    free(u8);
+}
+
+void RKTestLogSpeed(void) {
+    SHOW_FUNCTION_NAME
+    int i, k, m;
+    const int threadCount = 4;
+    const int count = 5000;
+    const char logfile[] = "rktest-607.log";
+    pthread_t tids[threadCount];
+    RKTestLogWorker workers[threadCount];
+    double *costs = (double *)malloc(threadCount * count * sizeof(double));
+    char previousLogfile[RKMaximumPathLength];
+
+    // Log to a file only, like a radar running in the background
+    snprintf(previousLogfile, RKMaximumPathLength, "%s", rkGlobalParameters.logfile);
+    const bool dailyLog = rkGlobalParameters.dailyLog;
+    RKSetUseDailyLog(false);
+    RKSetLogfile(logfile);
+
+    // Rings that hold a whole burst, a full ring drops messages rather than blocking
+    RKSetLogRingDepth(2 * count);
+
+    // Synchronous, asynchronous with bursts, asynchronous at 10 kHz
+    const bool modes[] = {false, true, true};
+    const int intervals[] = {0, 0, 100};
+    for (m = 0; m < 3; m++) {
+        RKSetWantScreenOutput(false);
+        RKSetAsynchronousLog(modes[m]);
+        const uint64_t dropCount = RKLogGetDropCount();
+        for (i = 0; i < threadCount; i++) {
+            workers[i].count = count;
+            workers[i].interval = intervals[m];
+            workers[i].costs = costs + i * count;
+            pthread_create(&tids[i], NULL, logWorker, &workers[i]);
+        }
+        for (i = 0; i < threadCount; i++) {
+            pthread_join(tids[i], NULL);
+        }
+        RKSetAsynchronousLog(false);
+        RKSetWantScreenOutput(true);
+        double sum = 0.0;
+        for (k = 0; k < threadCount * count; k++) {
+            sum += costs[k];
+        }
+        qsort(costs, threadCount * count, sizeof(double), double_cmp);
+        RKLog("%-12s %s   %d threads x %s   mean = %s ns   p50 = %s ns   p99 = %s ns   max = %s ns   drops = %s\n",
+              modes[m] ? "Asynchronous" : "Synchronous",
+              intervals[m] ? "every 100 us" : "burst       ",
+              threadCount, RKIntegerToCommaStyleString(count),
+              RKIntegerToCommaStyleString((long long)(sum / (threadCount * count))),
+              RKIntegerToCommaStyleString((long long)costs[threadCount * count / 2]),
+              RKIntegerToCommaStyleString((long long)costs[threadCount * count * 99 / 100]),
+              RKIntegerToCommaStyleString((long long)costs[threadCount * count - 1]),
+              RKUIntegerToCommaStyleString(RKLogGetDropCount() - dropCount));
+    }
+
+    RKSetLogRingDepth(RKLogRingDepth);
+    RKSetLogfile(previousLogfile);
+    RKSetUseDailyLog(dailyLog);
+    remove(logfile);
+    free(costs);
+}
+
 #pragma endregion
 
 #pragma region Transceiver Emulator
@@ -5390,20 +7725,15 @@ void *RKTestPedestalRunLoop(void *input) {
         if (tic % healthTicCount == 0) {
             RKHealth *health = RKGetVacantHealth(radar, RKHealthNodePedestal);
             if (health) {
-                sprintf(health->string, "{"
-                        "\"Pedestal AZ\":{\"Value\":\"%.2f deg\",\"Enum\":%d}, "
-                        "\"Pedestal EL\":{\"Value\":\"%.2f deg\",\"Enum\":%d}, "
-                        "\"Pedestal AZ Safety\":{\"Value\":true,\"Enum\":%d}, "
-                        "\"Pedestal EL Safety\":{\"Value\":true,\"Enum\":%d}, "
-                        "\"VCP Active\":{\"Value\":true,\"Enum\":%d}, "
-                        "\"Pedestal Operate\":{\"Value\":true,\"Enum\":%d}"
-                        "}",
-                        position->azimuthDegrees, RKStatusEnumNormal,
-                        position->elevationDegrees, RKStatusEnumNormal,
-                        RKStatusEnumNormal,
-                        RKStatusEnumNormal,
-                        position->elevationVelocityDegreesPerSecond > 0.1f || position->azimuthVelocityDegreesPerSecond > 0.1f ? RKStatusEnumNormal : RKStatusEnumStandby,
-                        position->elevationVelocityDegreesPerSecond > 0.1f || position->azimuthVelocityDegreesPerSecond > 0.1f ? RKStatusEnumNormal : RKStatusEnumStandby);
+                RKHealthRecordReset(&health->record);
+                RKHealthRecordAddNumber(&health->record, "Pedestal AZ", position->azimuthDegrees, "\"%.2f deg\"", RKStatusEnumNormal);
+                RKHealthRecordAddNumber(&health->record, "Pedestal EL", position->elevationDegrees, "\"%.2f deg\"", RKStatusEnumNormal);
+                RKHealthRecordAddBool(&health->record, "Pedestal AZ Safety", true, RKStatusEnumNormal);
+                RKHealthRecordAddBool(&health->record, "Pedestal EL Safety", true, RKStatusEnumNormal);
+                RKHealthRecordAddBool(&health->record, "VCP Active", true,
+                                      position->elevationVelocityDegreesPerSecond > 0.1f || position->azimuthVelocityDegreesPerSecond > 0.1f ? RKStatusEnumNormal : RKStatusEnumStandby);
+                RKHealthRecordAddBool(&health->record, "Pedestal Operate", true,
+                                      position->elevationVelocityDegreesPerSecond > 0.1f || position->azimuthVelocityDegreesPerSecond > 0.1f ? RKStatusEnumNormal : RKStatusEnumStandby);
                 RKSetHealthReady(radar, health);
             }
         }
@@ -11,7 +11,7 @@
 #pragma mark - Static Methods
 
 static char *RKGetHandshakeArgument(const char *buf, const char *key) {
-    static char argument[80] = {0};
+    static char argument[256] = {0};
     char *b, *e;
     b = strstr(buf, key);
     if (b == NULL) {
@@ -23,7 +23,8 @@ static char *RKGetHandshakeArgument(const char *buf, const char *key) {
         b++;
     }
     e = strstr(b, RKEOL);
-    size_t l = (size_t)(e - b);
+    size_t l = e == NULL ? strlen(b) : (size_t)(e - b);
+    l = MIN(l, sizeof(argument) - 1);
     memcpy(argument, b, l);
     argument[l] = '\0';
     return argument;
@@ -37,19 +38,38 @@ static int RKSocketRead(RKWebSocket *W, uint32_t origin, size_t size) {
     return (int)read(W->sd,W->frame + origin, size);
 }
 
-static int RKSocketWrite(RKWebSocket *W, size_t size) {
+static int RKSocketWrite(RKWebSocket *W, const void *buffer, size_t size) {
+    ssize_t r;
+    size_t sent = 0;
     W->tic++;
+    W->writeCount++;
     if (W->useSSL) {
-        return SSL_write(W->ssl, W->frame, (int)size);
+        r = SSL_write(W->ssl, buffer, (int)size);
+        if (r > 0) {
+            W->wireByteCount += r;
+        }
+        return (int)r;
+    }
+    // A blocking write may still return early, e.g., interrupted by a signal
+    while (sent < size) {
+        r = write(W->sd, buffer + sent, size - sent);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        } else if (r <= 0) {
+            return (int)r;
+        }
+        sent += r;
     }
-    return (int)write(W->sd, W->frame, size);
+    W->wireByteCount += sent;
+    return (int)sent;
 }
 
-static size_t RKWebSocketFrameEncode(void *buf, RFC6455_OPCODE code, const void *src, size_t size) {
+static size_t RKWebSocketFrameEncode(void *buf, RFC6455_OPCODE code, const void *src, size_t size, const bool compressed) {
     size_t r;
     ws_frame_header *h = buf;
     memset(h, 0, sizeof(ws_frame_header));
     h->fin = 1;
+    h->rsv = compressed ? 0x4 : 0x0;                                           // RSV1 marks a compressed message (RFC 7692)
     h->mask = true;
     h->opcode = code;
     char *payload = buf + sizeof(ws_frame_header);
@@ -65,9 +85,9 @@ static size_t RKWebSocketFrameEncode(void *buf, RFC6455_OPCODE code, const void
     if (r > 65535) {
         h->len = 127;
         // Frame header can be up to 10 bytes
-        if (r > RKWebSocketFrameSize - 10) {
-            r = RKWebSocketFrameSize - 10;
-            fprintf(stderr, "I am limited to %d bytes\n", RKWebSocketFrameSize - 10);
+        if (r > RKWebSocketFrameSize - RKWebSocketFrameHeaderSize - 1) {
+            r = RKWebSocketFrameSize - RKWebSocketFrameHeaderSize - 1;
+            fprintf(stderr, "I am limited to %d bytes\n", RKWebSocketFrameSize - RKWebSocketFrameHeaderSize - 1);
         }
         *((uint64_t *)payload) = htonll((uint64_t)r);
         payload += 8;
@@ -110,21 +130,26 @@ static size_t RKWebSocketFrameDecode(void **dst, void *buf) {
     } else {
         r = h->len;
     }
-    payload[r + 4 * h->mask] = '\0';
     if (h->mask) {
         ws_mask_key key = {.u32 = *(uint32_t *)payload};
-        for (int i = 0; i < h->len; i++) {
+        payload += 4;
+        for (int i = 0; i < r; i++) {
             payload[i] ^= key.code[i % 4];
         }
     }
+    payload[r] = '\0';
     *dst = payload;
     return r;
 }
 
-static size_t RKWebSocketFrameGetTargetSize(void *buf) {
+// Size of the frame at the beginning of buf, 0 if count is too short to tell
+static size_t RKWebSocketFrameGetTargetSize(void *buf, const size_t count) {
     size_t r = sizeof(ws_frame_header);
     void *xlen = buf + sizeof(ws_frame_header);
     ws_frame_header *h = (ws_frame_header *)buf;
+    if (count < r || count < r + (h->len == 127 ? 8 : (h->len == 126 ? 2 : 0))) {
+        return 0;
+    }
     if (h->len == 127) {
         r += 8 + ntohll(*(uint64_t *)xlen);
     } else if (h->len == 126) {
@@ -132,14 +157,84 @@ static size_t RKWebSocketFrameGetTargetSize(void *buf) {
     } else {
         r += h->len;
     }
-    return r;
+    return r + 4 * h->mask;
+}
+
+// Compress a message with the sync flush tail removed (RFC 7692 7.2.1), returns 0 if it does not fit
+static size_t RKWebSocketDeflate(RKWebSocket *W, const void *source, const size_t size) {
+    const size_t capacity = RKWebSocketFrameSize - RKWebSocketFrameHeaderSize - 1;
+    W->deflater.next_in = (Bytef *)source;
+    W->deflater.avail_in = (uInt)size;
+    W->deflater.next_out = W->deflated;
+    W->deflater.avail_out = (uInt)capacity;
+    int r = deflate(&W->deflater, Z_SYNC_FLUSH);
+    if (r != Z_OK || W->deflater.avail_in > 0 || W->deflater.avail_out == 0) {
+        // The peer will never see this message compressed, so it cannot be part of the context
+        deflateReset(&W->deflater);
+        return 0;
+    }
+    size_t length = capacity - W->deflater.avail_out;
+    if (length >= 4 && !memcmp(W->deflated + length - 4, "\x00\x00\xff\xff", 4)) {
+        length -= 4;
+    }
+    if (W->deflateNoContextTakeover) {
+        deflateReset(&W->deflater);
+    }
+    return length;
+}
+
+// Decompress a message after putting back the sync flush tail, returns 0 if the message is corrupt or too large
+static size_t RKWebSocketInflate(RKWebSocket *W, const void *source, const size_t size) {
+    static const uint8_t tail[] = {0x00, 0x00, 0xff, 0xff};
+    const size_t capacity = RKWebSocketFrameSize - 1;
+    W->inflater.next_in = (Bytef *)source;
+    W->inflater.avail_in = (uInt)size;
+    W->inflater.next_out = W->inflated;
+    W->inflater.avail_out = (uInt)capacity;
+    int r = inflate(&W->inflater, Z_SYNC_FLUSH);
+    if (r == Z_OK || r == Z_BUF_ERROR) {
+        W->inflater.next_in = (Bytef *)tail;
+        W->inflater.avail_in = sizeof(tail);
+        r = inflate(&W->inflater, Z_SYNC_FLUSH);
+    }
+    if ((r != Z_OK && r != Z_BUF_ERROR) || W->inflater.avail_out == 0) {
+        inflateReset(&W->inflater);
+        return 0;
+    }
+    size_t length = capacity - W->inflater.avail_out;
+    W->inflated[length] = '\0';
+    if (W->inflateNoContextTakeover) {
+        inflateReset(&W->inflater);
+    }
+    return length;
+}
+
+// Encode a payload as a frame at the end of the outbox, compressed if permessage-deflate is in use
+static size_t RKWebSocketFrameEncodePayload(RKWebSocket *W, const size_t origin, const RKWebSocketPayload *payload) {
+    size_t size = 0;
+    W->payloadByteCount += payload->size;
+    if (W->deflate && payload->size >= RKWebSocketDeflateThreshold) {
+        size = RKWebSocketDeflate(W, payload->source, payload->size);
+    }
+    if (size) {
+        return RKWebSocketFrameEncode(W->outbox + origin, RFC6455_OPCODE_BINARY, W->deflated, size, true);
+    }
+    return RKWebSocketFrameEncode(W->outbox + origin, RFC6455_OPCODE_BINARY, payload->source, payload->size, false);
+}
+
+static void RKWebSocketEndCompression(RKWebSocket *W) {
+    if (W->deflate) {
+        deflateEnd(&W->deflater);
+        inflateEnd(&W->inflater);
+        W->deflate = false;
+    }
 }
 
 static int RKWebSocketPingPong(RKWebSocket *W, const bool ping, const char *message, const int len) {
-    size_t size = RKWebSocketFrameEncode(W->frame,
+    size_t size = RKWebSocketFrameEncode(W->outbox,
         ping ? RFC6455_OPCODE_PING : RFC6455_OPCODE_PONG,
-        message, message == NULL ? 0 : (len == 0 ? strlen(message) : len));
-    int r = RKSocketWrite(W, size);
+        message, message == NULL ? 0 : (len == 0 ? strlen(message) : len), false);
+    int r = RKSocketWrite(W, W->outbox, size);
     if (r < 0) {
         fprintf(stderr, "Error. Unable to write. r = %d\n", r);
     } else if (W->verbose > 2) {
@@ -156,8 +251,8 @@ static int RKWebSocketPong(RKWebSocket *W, const char *message, const int len) {
     return RKWebSocketPingPong(W, false, message, len);
 }
 
-static void RKShowWebsocketFrameHeader(RKWebSocket *W) {
-    uint8_t *c = (uint8_t *)W->frame;
+static void RKShowWebsocketFrameHeader(const void *frame) {
+    uint8_t *c = (uint8_t *)frame;
     ws_frame_header *h = (ws_frame_header *)c;
     if (h->mask) {
         printf("%02x %02x   %02x %02x %02x %02x    %02x %02x %02x %02x %02x %02x %02x %02x ..."
@@ -241,14 +336,16 @@ static int RKWebSocketConnect(RKWebSocket *W) {
         "Connection: Upgrade\r\n"
         "Sec-WebSocket-Key: %s==\r\n"
         "Sec-WebSocket-Version: 13\r\n"
+        "%s"
         "\r\n",
         W->path,
         W->host,
-        W->secret);
+        W->secret,
+        W->wantDeflate ? "Sec-WebSocket-Extensions: permessage-deflate\r\n" : "");
     if (W->verbose > 2) {
         printf("%s", buf);
     }
-    r = RKSocketWrite(W, strlen(buf));
+    r = RKSocketWrite(W, buf, strlen(buf));
     if (r <= 0) {
         fprintf(stderr, "Error during handshake  (r = %d).\n", r);
         return -1;
@@ -278,10 +375,12 @@ static int RKWebSocketConnect(RKWebSocket *W) {
     strcpy(W->digest, RKGetHandshakeArgument(buf, "Sec-WebSocket-Accept"));
     strcpy(W->upgrade, RKGetHandshakeArgument(buf, "Upgrade"));
     strcpy(W->connection, RKGetHandshakeArgument(buf, "Connection"));
+    strcpy(W->extensions, RKGetHandshakeArgument(buf, "Sec-WebSocket-Extensions"));
 
-    // This block is now hardcoded for default secret key, should replace ...
-    if (strcmp(W->secret, "RadarHub123456789abcde") == 0 &&
-        strcmp(W->digest, "O9QKgAZPEwFaLSqyFPYMHcGBp5g=")) {
+    char key[32], digest[32];
+    snprintf(key, sizeof(key), "%s==", W->secret);
+    RKWebSocketMakeAcceptKey(digest, key);
+    if (strcmp(W->digest, digest)) {
         fprintf(stderr, "Error. W->digest = %s\n", W->digest);
         fprintf(stderr, "Error. Unexpected digest.\n");
         return -1;
@@ -299,6 +398,29 @@ static int RKWebSocketConnect(RKWebSocket *W) {
         return -1;
     }
 
+    // Compress the messages if the server agrees, keeping the context across messages unless told otherwise
+    RKWebSocketEndCompression(W);
+    if (W->wantDeflate && strstr(W->extensions, "permessage-deflate")) {
+        // Not offering client_max_window_bits so the deflater always has the full 15-bit window
+        const int bits = 15;
+        W->deflateNoContextTakeover = strstr(W->extensions, "client_no_context_takeover") != NULL;
+        W->inflateNoContextTakeover = strstr(W->extensions, "server_no_context_takeover") != NULL;
+        memset(&W->deflater, 0, sizeof(z_stream));
+        memset(&W->inflater, 0, sizeof(z_stream));
+        if (deflateInit2(&W->deflater, Z_BEST_SPEED, Z_DEFLATED, -bits, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+            if (inflateInit2(&W->inflater, -15) == Z_OK) {
+                W->deflate = true;
+            } else {
+                deflateEnd(&W->deflater);
+            }
+        }
+        if (W->verbose) {
+            RKLog("%s permessage-deflate %s  window = %d%s%s\n", W->name, W->deflate ? "on" : "failed", bits,
+                  W->deflateNoContextTakeover ? "  client_no_context_takeover" : "",
+                  W->inflateNoContextTakeover ? "  server_no_context_takeover" : "");
+        }
+    }
+
     // Discard all pending deliveries
     W->payloadTail = W->payloadHead;
 
@@ -319,7 +441,8 @@ void *transporter(void *in) {
 
     int i, r;
     void *anchor = NULL;
-    size_t size, targetFrameSize = 0;
+    size_t size, frameSize, targetFrameSize = 0;
+    uint8_t next = 0;
     ws_frame_header *h = (ws_frame_header *)W->frame;
     char words[][5] = {"love", "hope", "cool", "cute", "sexy", "nice", "calm", "wish"};
     char uword[5] = "xxxx";
@@ -332,7 +455,6 @@ void *transporter(void *in) {
     struct timeval timeout;
     time_t s1, s0;
 
-    uint32_t origin = 0;
     uint32_t total = 0;
     uint32_t *p32;
 
@@ -341,6 +463,7 @@ void *transporter(void *in) {
     while (W->wantActive) {
 
         RKWebSocketConnect(W);
+        total = 0;
 
         // Run loop for read and write
         while (W->wantActive && W->connected) {
@@ -364,21 +487,29 @@ void *transporter(void *in) {
                     }
                     break;
                 } else if (FD_ISSET(W->sd, &wfd)) {
-                    // Ready to write. Keep sending the payloads until the tail catches up
+                    // Ready to write. Keep sending the payloads until the tail catches up, coalescing the
+                    // frames of a backlog into the outbox so that they go out in one write
                     while (W->payloadTail != W->payloadHead) {
-                        uint16_t tail = W->payloadTail == RKWebSocketPayloadDepth - 1 ? 0 : W->payloadTail + 1;
-                        const RKWebSocketPayload *payload = &W->payloads[tail];
-                        if (W->verbose > 2) {
-                            if (payload->size < 64) {
-                                RKBinaryString(message, payload->source, payload->size);
-                            } else {
-                                RKRadarHubPayloadString(message, payload->source, payload->size);
+                        size = 0;
+                        while (W->payloadTail != W->payloadHead) {
+                            uint16_t tail = W->payloadTail == RKWebSocketPayloadDepth - 1 ? 0 : W->payloadTail + 1;
+                            const RKWebSocketPayload *payload = &W->payloads[tail];
+                            if (size > 0 && size + RKWebSocketFrameHeaderSize + payload->size + 1 > RKWebSocketFrameSize) {
+                                break;
+                            }
+                            if (W->verbose > 2) {
+                                if (payload->size < 64) {
+                                    RKBinaryString(message, payload->source, payload->size);
+                                } else {
+                                    RKRadarHubPayloadString(message, payload->source, payload->size);
+                                }
+                                printf("RKWebSocket.transporter: WRITE \033[38;5;154m%s\033[m (%zu)\n",
+                                       message, payload->size);
                             }
-                            printf("RKWebSocket.transporter: WRITE \033[38;5;154m%s\033[m (%zu)\n",
-                                   message, payload->size);
+                            size += RKWebSocketFrameEncodePayload(W, size, payload);
+                            W->payloadTail = tail;
                         }
-                        size = RKWebSocketFrameEncode(W->frame, RFC6455_OPCODE_BINARY, payload->source, payload->size);
-                        r = RKSocketWrite(W, size);
+                        r = RKSocketWrite(W, W->outbox, size);
                         if (r < 0) {
                             if (W->verbose) {
                                 RKLog("%s Error. RKSocketWrite() = %d\n", W->name, r);
@@ -389,7 +520,6 @@ void *transporter(void *in) {
                             W->connected = false;
                             break;
                         }
-                        W->payloadTail = tail;
                     }
                 } else {
                     // This shall not reach
@@ -405,16 +535,24 @@ void *transporter(void *in) {
             //
             //  Read
             //
-            //  wait up to tv_usec if there is nothing left to send
+            //  wait up to tv_usec if there is nothing left to send, a read may carry several frames
+            //  so a complete one may already be in the buffer
             //
             size = 0;
+            frameSize = 0;
             FD_ZERO(&rfd);
             FD_ZERO(&efd);
             FD_SET(W->sd, &rfd);
             FD_SET(W->sd, &efd);
             timeout.tv_sec = 0;
             timeout.tv_usec = W->timeoutDeltaMicroseconds;
-            r = select(W->sd + 1, &rfd, NULL, &efd, &timeout);
+            targetFrameSize = RKWebSocketFrameGetTargetSize(W->frame, total);
+            if (targetFrameSize && total >= targetFrameSize) {
+                FD_CLR(W->sd, &efd);
+                r = 1;
+            } else {
+                r = select(W->sd + 1, &rfd, NULL, &efd, &timeout);
+            }
             if (r > 0) {
                 if (FD_ISSET(W->sd, &efd)) {
                     // Exceptions
@@ -425,27 +563,37 @@ void *transporter(void *in) {
                     break;
                 } else if (FD_ISSET(W->sd, &rfd)) {
                     // There is something to read
-                    r = RKSocketRead(W, origin, RKWebSocketFrameSize);
-                    if (r <= 0) {
-                        if (W->verbose) {
-                            fprintf(stderr, "Error. RKSocketRead() = %d   origin = %u\n", r, origin);
+                    if (targetFrameSize == 0 || total < targetFrameSize) {
+                        r = RKSocketRead(W, total, RKWebSocketFrameSize - 1 - total);
+                        if (r <= 0) {
+                            if (W->verbose) {
+                                fprintf(stderr, "Error. RKSocketRead() = %d   total = %u\n", r, total);
+                            }
+                            W->connected = false;
+                            break;
                         }
-                        W->connected = false;
-                        break;
-                    }
-                    if (origin == 0) {
-                        targetFrameSize = RKWebSocketFrameGetTargetSize(W->frame);
-                        total = r;
-                    } else {
                         total += r;
+                        targetFrameSize = RKWebSocketFrameGetTargetSize(W->frame, total);
+                        if (targetFrameSize > RKWebSocketFrameSize - 1) {
+                            RKLog("%s Error. Frame of %zu bytes is too large.\n", W->name, targetFrameSize);
+                            W->connected = false;
+                            break;
+                        } else if (targetFrameSize == 0 || total < targetFrameSize) {
+                            continue;
+                        }
                     }
-                    if (total < targetFrameSize) {
-                        origin += r;
-                        continue;
-                    } else {
-                        origin = 0;
-                    }
+                    // Decoding terminates the payload with a '\0', which is the first byte of the next frame
+                    frameSize = targetFrameSize;
+                    next = W->frame[frameSize];
                     size = RKWebSocketFrameDecode((void **)&anchor, W->frame);
+                    if (size > 0 && h->rsv & 0x4 && W->deflate &&
+                        (h->opcode == RFC6455_OPCODE_TEXT || h->opcode == RFC6455_OPCODE_BINARY)) {
+                        size = RKWebSocketInflate(W, anchor, size);
+                        anchor = W->inflated;
+                        if (size == 0) {
+                            RKLog("%s Error. Unable to inflate a message.\n", W->name);
+                        }
+                    }
                     if (!h->fin) {
                         fprintf(stderr, "I need upgrade!\n"
                                         "I need upgrade!\n"
@@ -454,7 +602,7 @@ void *transporter(void *in) {
                     }
                     if (W->verbose > 1) {
                         if (W->verbose > 2) {
-                            printf("%2u read  ", total); RKShowWebsocketFrameHeader(W);
+                            printf("%2u read  ", total); RKShowWebsocketFrameHeader(W->frame);
                         }
                         if (size != 4 && h->opcode == RFC6455_OPCODE_PING) {
                             RKBytesInHex(show, anchor, size);
@@ -490,10 +638,10 @@ void *transporter(void *in) {
                     char *word = words[rand() % 8];
                     r = RKWebSocketPing(W, word, (int)strlen(word));
                     if (W->verbose > 1) {
-                        p32 = (uint32_t *)&W->frame[2];
+                        p32 = (uint32_t *)&W->outbox[2];
                         ws_mask_key key = {.u32 = *p32};
                         for (i = 0; i < 4; i++) {
-                            uword[i] = W->frame[6 + i] ^ key.code[i % 4];
+                            uword[i] = W->outbox[6 + i] ^ key.code[i % 4];
                         }
                         RKLog("%s C-PING: %s%s%s (%zu)\n", W->name,
                               rkGlobalParameters.showColor ? RKLimeColor : "",
@@ -501,7 +649,7 @@ void *transporter(void *in) {
                               rkGlobalParameters.showColor ? RKNoColor : "",
                               strlen(word));
                         if (W->verbose > 2) {
-                            printf("%s %2d sent  ", W->name, r); RKShowWebsocketFrameHeader(W);
+                            printf("%s %2d sent  ", W->name, r); RKShowWebsocketFrameHeader(W->outbox);
                         }
                     }
                 }
@@ -513,10 +661,10 @@ void *transporter(void *in) {
                     memcpy(message, anchor, h->len); message[h->len] = '\0';
                     RKWebSocketPong(W, message, h->len);
                     if (W->verbose > 1) {
-                        p32 = (uint32_t *)&W->frame[2];
+                        p32 = (uint32_t *)&W->outbox[2];
                         ws_mask_key key = {.u32 = *p32};
                         for (i = 0; i < 4; i++) {
-                            uword[i] = W->frame[6 + i] ^ key.code[i % 4];
+                            uword[i] = W->outbox[6 + i] ^ key.code[i % 4];
                         }
                         if (h->len != 4) {
                             RKBytesInHex(show, message, h->len);
@@ -529,7 +677,7 @@ void *transporter(void *in) {
                               rkGlobalParameters.showColor ? RKNoColor : "",
                               h->len);
                         if (W->verbose > 2) {
-                            printf("%2d sent  ", r); RKShowWebsocketFrameHeader(W);
+                            printf("%2d sent  ", r); RKShowWebsocketFrameHeader(W->outbox);
                         }
                     }
                 } else if (h->opcode == RFC6455_OPCODE_PONG) {
@@ -544,6 +692,12 @@ void *transporter(void *in) {
                 }
                 W->timeoutCount = 0;
             }
+            // Move the rest of the read, if any, to the beginning of the buffer
+            if (frameSize) {
+                W->frame[frameSize] = next;
+                total -= frameSize;
+                memmove(W->frame, W->frame + frameSize, total);
+            }
         } // while (W->wantActive && W->connected) ...
         if (W->sd) {
             if (W->verbose > 1) {
@@ -555,6 +709,7 @@ void *transporter(void *in) {
             close(W->sd);
             W->sd = 0;
         }
+        RKWebSocketEndCompression(W);
         s1 = time(NULL);
         i = 0;
         do {
@@ -649,6 +804,7 @@ RKWebSocket *RKWebSocketInit(const char *host, const char *path) {
         W->ssl = SSL_new(W->sslContext);
     }
     W->timeoutDeltaMicroseconds = RKWebSocketTimeoutDeltaMicroseconds;
+    W->wantDeflate = true;
     RKWebSocketSetPingInterval(W, RKWebSocketTimeoutThresholdSeconds);
 
     return W;
@@ -694,6 +850,11 @@ void RKWebSocketSetErrorHandler(RKWebSocket *W, void (*routine)(RKWebSocket *))
     W->onError = routine;
 }
 
+// Offer permessage-deflate during the next handshake, on by default
+void RKWebSocketSetDeflate(RKWebSocket *W, const bool deflate) {
+    W->wantDeflate = deflate;
+}
+
 #pragma mark - Methods
 
 void RKWebSocketStart(RKWebSocket *W) {
@@ -738,3 +899,13 @@ int RKWebSocketSend(RKWebSocket *W, void *source, const size_t size) {
     pthread_mutex_unlock(&W->lock);
     return 0;
 }
+
+// Sec-WebSocket-Accept = base64(SHA-1(key + GUID)), dst must hold at least 29 characters
+void RKWebSocketMakeAcceptKey(char *dst, const char *key) {
+    char buf[128];
+    unsigned int size = 0;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    int length = snprintf(buf, sizeof(buf), "%s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key);
+    EVP_Digest(buf, (size_t)length, digest, &size, EVP_sha1(), NULL);
+    EVP_EncodeBlock((unsigned char *)dst, digest, (int)size);
+}